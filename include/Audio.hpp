@@ -0,0 +1,150 @@
+/**
+ * @file Audio.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex audio output
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <vector>
+
+#include "AudioMixer.hpp"
+
+namespace Audio {
+    /** @brief Sound effect loaded from a WAV file into memory (tagged AUDIO) */
+    class Sound {
+    private:
+        void* memory = nullptr;     ///< Whole file
+        SoundData data;             ///< Samples inside memory
+
+    public:
+        Sound() {}
+
+        /** @brief Destructor, frees the samples */
+        ~Sound() { Unload(); }
+
+        Sound(const Sound&) = delete;
+        Sound& operator=(const Sound&) = delete;
+
+        /** @brief Load a 16 bit PCM WAV file
+         *  @param path Path of the file (romfs:/ or sdmc:/)
+         *  @return false if it cannot be read or is not 16 bit PCM
+         */
+        bool Load(const char* path);
+
+        /** @brief Free the samples (stop the voices playing it first) */
+        void Unload();
+
+        /** @brief Check if samples are loaded */
+        bool IsLoaded() const { return memory != nullptr; }
+
+        /** @brief Get the samples */
+        const SoundData& GetData() const { return data; }
+    };
+
+    /** @brief Backend playing the mix on one NDSP channel
+     *  BUFFER_COUNT wave buffers are queued; Update mixes into the ones the DSP finished, so the
+     *  main loop must not stall longer than the queued audio (about 90 ms) to avoid gaps.
+     */
+    class NdspBackend : public Backend {
+    private:
+        static constexpr int BUFFER_COUNT = 3;          ///< Wave buffers queued
+        static constexpr u32 BUFFER_FRAMES = 1024;      ///< Frames per wave buffer
+
+        Mixer* mixer = nullptr;                         ///< Mixer pulled
+        s16* samples = nullptr;                         ///< Wave buffer memory (linear)
+        ndspWaveBuf waveBuffers[BUFFER_COUNT];          ///< Wave buffers
+        bool initialized = false;                       ///< ndspInit succeeded
+        int channel = 0;                                ///< NDSP channel used
+
+        /** @brief Mix into a wave buffer and queue it */
+        void Fill(ndspWaveBuf& buffer);
+
+    public:
+        ~NdspBackend() { Stop(); }
+
+        /** @brief Initialize NDSP (needs sdmc:/3ds/dspfirm.cdc) and queue the first buffers */
+        bool Start(Mixer* target) override;
+
+        void Update(float deltaTime) override;
+        void Stop() override;
+    };
+
+    /** @brief Mixer, output and music decoding thread
+     *  Owned by the SceneManager (see SceneManager::EnableAudio) and updated once per frame.
+     *  Streams are decoded on a worker thread woken when one of them has a free block.
+     */
+    class AudioSystem {
+    private:
+        /** @brief A playing stream */
+        struct Music {
+            Stream* stream;     ///< Stream decoded by the worker
+            int handle;         ///< Mixer voice
+        };
+
+        Mixer mixer;                    ///< Software mixer
+        NdspBackend ndsp;               ///< DSP output
+        NullBackend silent;             ///< Used when the DSP is not available
+        Backend* backend = nullptr;     ///< Active backend (nullptr when stopped)
+        std::vector<Music> music;       ///< Streams decoded by the worker
+        LightLock lock;                 ///< Protects music
+        LightEvent wakeUp;              ///< Signaled when a stream needs data
+        Thread worker = nullptr;        ///< Decoding thread
+        volatile bool running = false;  ///< Worker keeps running
+
+        /** @brief Decoding thread entry */
+        static void WorkerMain(void* arg);
+
+    public:
+        /** @brief Constructor */
+        AudioSystem();
+
+        /** @brief Destructor, stops the output and the worker */
+        ~AudioSystem() { Stop(); }
+
+        AudioSystem(const AudioSystem&) = delete;
+        AudioSystem& operator=(const AudioSystem&) = delete;
+
+        /** @brief Start the output and the decoding thread
+         *  @return true with NDSP, false if the DSP is not available (mixing continues silently)
+         */
+        bool Start();
+
+        /** @brief Stop the output and the decoding thread */
+        void Stop();
+
+        /** @brief Feed the output and wake the decoder (called by SceneManager::Run) */
+        void Update(float deltaTime);
+
+        /** @brief Get the mixer */
+        Mixer& GetMixer() { return mixer; }
+
+        /** @brief Play a sound effect
+         *  @return Voice handle or -1 if every voice is busy
+         */
+        int Play(const Sound& sound, float volume = 1.0f, float pan = 0.0f, float pitch = 1.0f, bool loop = false) {
+            return mixer.Play(sound.GetData(), volume, pan, pitch, loop);
+        }
+
+        /** @brief Play an opened stream, decoded on the worker thread
+         *  @param stream Stream (call StopMusic before destroying it)
+         *  @param volume Volume
+         *  @return Voice handle or -1 if every voice is busy
+         */
+        int PlayMusic(Stream* stream, float volume = 1.0f);
+
+        /** @brief Stop a stream and stop decoding it
+         *  @param stream Stream given to PlayMusic
+         */
+        void StopMusic(Stream* stream);
+
+        /** @brief Check if the DSP output is used */
+        bool HasOutput() const { return backend == &ndsp; }
+    };
+}
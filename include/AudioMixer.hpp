@@ -0,0 +1,397 @@
+/**
+ * @file AudioMixer.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex software audio mixer
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+
+/**
+ * @namespace Audio
+ * @brief Sound effects and streamed music
+ * The mixer, the decoders and the WAV/null backends only use the standard library so the host
+ * tool (tools/audiomix.cpp) can build them on a PC; Audio.hpp adds the NDSP backend.
+ * Samples are signed 16 bit, stereo is interleaved (left first).
+ */
+namespace Audio {
+    /** @brief Output sample rate (the native rate of the DSP) */
+    constexpr uint32_t OUTPUT_RATE = 32728;
+
+    /** @brief Number of voices mixed at once */
+    constexpr int MAX_VOICES = 32;
+
+    /** @brief Output frames mixed per kernel call (the mixer splits larger requests) */
+    constexpr uint32_t MIX_BLOCK = 512;
+
+    /** @brief Unity volume in Q15 */
+    constexpr int32_t VOLUME_ONE = 1 << 15;
+
+    /** @brief PCM samples in memory (not owned) */
+    struct SoundData {
+        const int16_t* samples = nullptr;   ///< Samples, interleaved when stereo
+        uint32_t frames = 0;                ///< Number of frames (samples per channel)
+        uint32_t rate = OUTPUT_RATE;        ///< Sample rate
+        uint8_t channels = 1;               ///< 1 or 2
+    };
+
+    /** @brief Format of a WAV file */
+    struct WavInfo {
+        uint32_t rate = 0;          ///< Sample rate
+        uint8_t channels = 0;       ///< 1 or 2
+        uint32_t dataOffset = 0;    ///< Offset of the samples in the file
+        uint32_t dataSize = 0;      ///< Size of the samples in bytes
+    };
+
+    /** @brief Read the header of a 16 bit PCM WAV file
+     *  @param data Start of the file (at least the header and the chunks before the samples)
+     *  @param size Size of data
+     *  @param info Format found
+     *  @return false if the file is not 16 bit mono or stereo PCM
+     */
+    bool ParseWav(const uint8_t* data, size_t size, WavInfo& info);
+
+    /**
+     * @namespace Audio::Kernels
+     * @brief Inner loops of the mixer
+     * The accumulator is stereo interleaved 32 bit. Volumes are Q15. Resampling kernels read the
+     * source at index + fraction / 65536 with linear interpolation and need src[index + 1] to be
+     * valid for every frame they produce.
+     */
+    namespace Kernels {
+        /** @brief Mono source at the output rate (no resampling) */
+        void MixMono(int32_t* accumulator, const int16_t* source, uint32_t frames, int32_t left, int32_t right);
+
+        /** @brief Stereo source at the output rate (no resampling) */
+        void MixStereo(int32_t* accumulator, const int16_t* source, uint32_t frames, int32_t left, int32_t right);
+
+        /** @brief Resampled mono source
+         *  @param index Source frame, advanced past the frames read
+         *  @param fraction Position between index and index + 1 (16 bit), advanced
+         *  @param step Source frames per output frame (16.16 fixed point)
+         */
+        void MixMonoResample(int32_t* accumulator, const int16_t* source, uint32_t frames, int32_t left, int32_t right,
+                             uint32_t& index, uint32_t& fraction, uint32_t step);
+
+        /** @brief Resampled stereo source (see MixMonoResample) */
+        void MixStereoResample(int32_t* accumulator, const int16_t* source, uint32_t frames, int32_t left, int32_t right,
+                               uint32_t& index, uint32_t& fraction, uint32_t step);
+
+        /** @brief Saturate the accumulator to 16 bit samples
+         *  @param samples Number of samples (frames * 2)
+         */
+        void Clamp(int16_t* output, const int32_t* accumulator, uint32_t samples);
+    }
+
+    /** @brief Source of streamed samples (e.g. music decoded from a file) */
+    class Decoder {
+    public:
+        virtual ~Decoder() {}
+
+        /** @brief Decode the next frames
+         *  @param output Interleaved samples (frames * channels)
+         *  @param frames Frames wanted
+         *  @return Frames decoded, less than wanted at the end of the stream
+         */
+        virtual uint32_t Read(int16_t* output, uint32_t frames) = 0;
+
+        /** @brief Go back to the first frame
+         *  @return false if the stream cannot loop
+         */
+        virtual bool Rewind() = 0;
+
+        /** @brief Get the sample rate */
+        virtual uint32_t GetRate() const = 0;
+
+        /** @brief Get the number of channels (1 or 2) */
+        virtual uint8_t GetChannels() const = 0;
+    };
+
+    /** @brief Decoder reading 16 bit PCM WAV files in chunks */
+    class WavDecoder : public Decoder {
+    private:
+        FILE* file = nullptr;       ///< Open file
+        WavInfo info;               ///< Format
+        uint32_t remaining = 0;     ///< Bytes of samples left to read
+
+    public:
+        ~WavDecoder() { Close(); }
+
+        /** @brief Open a file
+         *  @param path Path of the file
+         *  @return false if it cannot be read or is not 16 bit PCM
+         */
+        bool Open(const char* path);
+
+        /** @brief Close the file */
+        void Close();
+
+        uint32_t Read(int16_t* output, uint32_t frames) override;
+        bool Rewind() override;
+        uint32_t GetRate() const override { return info.rate; }
+        uint8_t GetChannels() const override { return info.channels; }
+    };
+
+    /** @brief Double-buffered stream fed by a decoder
+     *  Decode fills the free blocks (on a worker thread on the 3DS) while the mixer plays the
+     *  other one; blocks are handed over with an atomic state, without locks.
+     */
+    class Stream {
+    private:
+        friend class Mixer;
+
+        /** @brief State of a block */
+        enum BlockState : uint8_t {
+            BLOCK_FREE,     ///< Can be decoded into
+            BLOCK_READY     ///< Decoded, waiting for or being played by the mixer
+        };
+
+        Decoder* decoder = nullptr;             ///< Source of the samples
+        std::vector<int16_t> blocks[2];         ///< Decoded samples
+        uint32_t blockFrames = 0;               ///< Capacity of a block in frames
+        uint32_t frames[2] = { 0, 0 };          ///< Frames decoded in each block
+        std::atomic<uint8_t> state[2];          ///< BlockState of each block
+        int decodeBlock = 0;                    ///< Next block to decode into
+        int playBlock = 0;                      ///< Block played by the mixer
+        bool loop = false;                      ///< Rewind the decoder at the end
+        std::atomic<bool> ended;                ///< Decoder has no more frames
+        std::atomic<uint32_t> underruns;        ///< Times the mixer found no ready block
+
+        /** @brief Get the block to play or nullptr if not decoded yet (mixer) */
+        const int16_t* AcquireBlock(uint32_t& count);
+
+        /** @brief Give the played block back to Decode (mixer) */
+        void ReleaseBlock();
+
+        /** @brief Check if the whole stream has been played (mixer) */
+        bool IsFinished() const;
+
+    public:
+        /** @brief Constructor */
+        Stream();
+
+        Stream(const Stream&) = delete;
+        Stream& operator=(const Stream&) = delete;
+
+        /** @brief Set the decoder and allocate the blocks
+         *  @param source Decoder (not owned)
+         *  @param framesPerBlock Frames per block (a block should last longer than a frame)
+         *  @param looping Rewind the decoder when it ends
+         */
+        void Open(Decoder* source, uint32_t framesPerBlock = 8192, bool looping = true);
+
+        /** @brief Decode every free block (any thread, one at a time)
+         *  @return true if a block was decoded
+         */
+        bool Decode();
+
+        /** @brief Check if a block is waiting to be decoded */
+        bool NeedsData() const;
+
+        /** @brief Get the number of times the mixer ran out of decoded samples */
+        uint32_t GetUnderruns() const { return underruns.load(std::memory_order_relaxed); }
+
+        /** @brief Get the decoder */
+        Decoder* GetDecoder() const { return decoder; }
+    };
+
+    /** @brief Fixed-point software mixer
+     *  Voices are played from memory (sound effects) or from a Stream (music). Each voice has
+     *  a Q15 volume per output channel and a 16.16 step for resampling and pitch. Mix is
+     *  called by the backend; Play and the setters must be called from the same thread.
+     */
+    class Mixer {
+    private:
+        /** @brief A playing sound */
+        struct Voice {
+            const int16_t* samples = nullptr;   ///< Sound samples (nullptr for streams)
+            Stream* stream = nullptr;           ///< Stream played
+            uint32_t frames = 0;                ///< Frames of the sound
+            uint32_t rate = OUTPUT_RATE;        ///< Source sample rate
+            uint32_t index = 0;                 ///< Current source frame
+            uint32_t fraction = 0;              ///< Position between two frames (16 bit)
+            int16_t history[2] = {};            ///< Last frame of the previous block or loop pass
+            bool seam = false;                  ///< Position is between history and the first frame of the source
+            uint32_t step = 1 << 16;            ///< Source frames per output frame (16.16)
+            int32_t left = VOLUME_ONE;          ///< Left volume (Q15)
+            int32_t right = VOLUME_ONE;         ///< Right volume (Q15)
+            uint16_t generation = 0;            ///< Incremented when the voice is reused
+            uint8_t channels = 1;               ///< Source channels
+            bool loop = false;                  ///< Restart at the end
+            bool active = false;                ///< Playing
+        };
+
+        Voice voices[MAX_VOICES];                   ///< Voice pool
+        int32_t accumulator[MIX_BLOCK * 2];         ///< Mix in 32 bit before saturation
+        int32_t masterVolume = VOLUME_ONE;          ///< Volume applied to every voice
+
+        /** @brief Find a free voice and build its handle */
+        int AllocateVoice();
+
+        /** @brief Get the voice of a handle or nullptr if it stopped */
+        Voice* GetVoice(int handle);
+
+        /** @brief Mix a voice into the accumulator
+         *  @return false once the voice ended
+         */
+        bool MixVoice(Voice& voice, uint32_t frames);
+
+        /** @brief Mix a memory voice */
+        bool MixSound(Voice& voice, uint32_t frames);
+
+        /** @brief Mix a streamed voice */
+        bool MixStream(Voice& voice, uint32_t frames);
+
+        /** @brief Mix a run of source frames with the right kernel
+         *  @param count Source frames available from voice.index
+         *  @return Output frames produced
+         */
+        uint32_t MixRun(Voice& voice, const int16_t* source, uint32_t count, int32_t* output, uint32_t frames);
+
+        /** @brief Carry the position of a voice from a finished source to the next one (block or loop pass)
+         *  The last frame is kept as history so interpolation spans the seam
+         *  @param source Finished source
+         *  @param count Source frames
+         */
+        static void NextSource(Voice& voice, const int16_t* source, uint32_t count);
+
+    public:
+        /** @brief Constructor */
+        Mixer() {}
+
+        /** @brief Play a sound
+         *  @param sound Samples (must stay valid while playing)
+         *  @param volume Volume (1 is unchanged)
+         *  @param pan -1 left to 1 right
+         *  @param pitch Playback speed (1 is unchanged)
+         *  @param loop Restart at the end
+         *  @return Voice handle or -1 if every voice is busy
+         */
+        int Play(const SoundData& sound, float volume = 1.0f, float pan = 0.0f, float pitch = 1.0f, bool loop = false);
+
+        /** @brief Play a stream
+         *  @param stream Opened stream (must stay valid while playing)
+         *  @param volume Volume (1 is unchanged)
+         *  @return Voice handle or -1 if every voice is busy
+         */
+        int PlayStream(Stream* stream, float volume = 1.0f);
+
+        /** @brief Stop a voice (does nothing if it already ended) */
+        void Stop(int handle);
+
+        /** @brief Stop every voice */
+        void StopAll();
+
+        /** @brief Check if a voice is still playing */
+        bool IsPlaying(int handle) { return GetVoice(handle) != nullptr; }
+
+        /** @brief Set the volume and pan of a voice */
+        void SetVolume(int handle, float volume, float pan = 0.0f);
+
+        /** @brief Set the playback speed of a voice */
+        void SetPitch(int handle, float pitch);
+
+        /** @brief Set the volume applied to every voice */
+        void SetMasterVolume(float volume);
+
+        /** @brief Get the number of playing voices */
+        int GetActiveVoices() const;
+
+        /** @brief Mix every voice
+         *  @param output Stereo interleaved samples (frames * 2)
+         *  @param frames Frames to produce
+         */
+        void Mix(int16_t* output, uint32_t frames);
+    };
+
+    /** @brief Writes 16 bit PCM WAV files */
+    class WavWriter {
+    private:
+        FILE* file = nullptr;       ///< Open file
+        uint32_t dataSize = 0;      ///< Bytes of samples written
+        uint32_t rate = 0;          ///< Sample rate
+        uint8_t channels = 0;       ///< Channels
+
+        /** @brief Write the header with the current sizes */
+        void WriteHeader();
+
+    public:
+        ~WavWriter() { Close(); }
+
+        /** @brief Create a file
+         *  @return false if it cannot be created
+         */
+        bool Open(const char* path, uint32_t sampleRate, uint8_t channelCount);
+
+        /** @brief Append frames */
+        void Write(const int16_t* samples, uint32_t frames);
+
+        /** @brief Write the final sizes and close the file */
+        void Close();
+    };
+
+    /** @brief Pulls mixed samples from a Mixer and plays them */
+    class Backend {
+    public:
+        virtual ~Backend() {}
+
+        /** @brief Start playing
+         *  @return false if the output is not available
+         */
+        virtual bool Start(Mixer* mixer) = 0;
+
+        /** @brief Mix what the output needs (called once per frame) */
+        virtual void Update(float deltaTime) = 0;
+
+        /** @brief Stop playing */
+        virtual void Stop() = 0;
+    };
+
+    /** @brief Backend mixing in real time and discarding the samples (no sound hardware, tests) */
+    class NullBackend : public Backend {
+    protected:
+        Mixer* mixer = nullptr;                 ///< Mixer pulled
+        int16_t buffer[MIX_BLOCK * 2];          ///< Mixed samples
+        double pending = 0;                     ///< Frames owed for the elapsed time
+
+        /** @brief Receive mixed samples */
+        virtual void Output(const int16_t* samples, uint32_t frames) {}
+
+    public:
+        bool Start(Mixer* target) override { mixer = target; pending = 0; return true; }
+        void Update(float deltaTime) override;
+        void Stop() override { mixer = nullptr; }
+
+        /** @brief Mix a number of frames immediately (offline rendering)
+         *  @param frames Frames to produce
+         */
+        void Render(uint32_t frames);
+    };
+
+    /** @brief Backend writing the mix to a WAV file */
+    class WavBackend : public NullBackend {
+    private:
+        WavWriter writer;       ///< Output file
+
+    protected:
+        void Output(const int16_t* samples, uint32_t frames) override { writer.Write(samples, frames); }
+
+    public:
+        /** @brief Create the output file
+         *  @return false if it cannot be created
+         */
+        bool Open(const char* path) { return writer.Open(path, OUTPUT_RATE, 2); }
+
+        void Stop() override { NullBackend::Stop(); writer.Close(); }
+    };
+}
@@ -0,0 +1,135 @@
+/**
+ * @file Benchmark.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex microbenchmark harness
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <string.h>
+#include <vector>
+
+namespace Debug
+{
+    /** @brief State of a running benchmark
+     *  Use it as the loop condition: `while (state.KeepRunning()) { ... }`
+     *  Anything done before the first KeepRunning() call is not timed.
+     */
+    class BenchmarkState {
+    public:
+        static constexpr u32 MAX_COUNTERS = 4;     ///< Counters a benchmark can report
+
+        /** @brief Named value reported with the timing (e.g. vertices per iteration) */
+        struct Counter {
+            const char* name;   ///< JSON key (static string)
+            double value;       ///< Value
+        };
+
+    private:
+        u32 iterations;         ///< Iterations requested by the harness
+        u32 remaining;          ///< Iterations left
+        u64 startTick = 0;      ///< Tick when timing (re)started
+        u64 elapsedTicks = 0;   ///< Accumulated timed ticks
+        u32 arg;                ///< Argument of this run
+        u64 items = 0;          ///< Items processed (for throughput)
+        Counter counters[MAX_COUNTERS];     ///< Reported counters
+        u32 counterCount = 0;               ///< Used counters
+
+    public:
+        /** @brief Constructor (called by the harness)
+         *  @param iterations Number of iterations to run
+         *  @param arg Argument of this run
+         */
+        BenchmarkState(u32 iterations, u32 arg) : iterations(iterations), remaining(iterations), arg(arg) {}
+
+        /** @brief Loop condition, starts the timer on first call and stops it on the last
+         *  @return true while iterations remain
+         */
+        bool KeepRunning() {
+            if (remaining == iterations) {
+                startTick = svcGetSystemTick();
+            }
+            if (remaining == 0) {
+                elapsedTicks += svcGetSystemTick() - startTick;
+                return false;
+            }
+            remaining--;
+            return true;
+        }
+
+        /** @brief Stop the timer (for per-iteration setup) */
+        void PauseTiming() { elapsedTicks += svcGetSystemTick() - startTick; }
+
+        /** @brief Restart the timer after PauseTiming() */
+        void ResumeTiming() { startTick = svcGetSystemTick(); }
+
+        /** @brief Get the argument of this run (e.g. element count)
+         *  @return Argument
+         */
+        u32 GetArg() const { return arg; }
+
+        /** @brief Set the number of items processed in total (reported as items per second)
+         *  @param count Item count
+         */
+        void SetItemsProcessed(u64 count) { items = count; }
+
+        /** @brief Report a value with the timing, added to the JSON line
+         *  @param name JSON key (static string), setting it again replaces the value
+         *  @param value Value (e.g. divided by GetIterations() for a per iteration count)
+         */
+        void SetCounter(const char* name, double value) {
+            for (u32 i = 0; i < counterCount; i++) {
+                if (strcmp(counters[i].name, name) == 0) {
+                    counters[i].value = value;
+                    return;
+                }
+            }
+            if (counterCount < MAX_COUNTERS) counters[counterCount++] = { name, value };
+        }
+
+        u32 GetIterations() const { return iterations; }
+        u64 GetElapsedTicks() const { return elapsedTicks; }
+        u64 GetItemsProcessed() const { return items; }
+        u32 GetCounterCount() const { return counterCount; }
+        const Counter& GetCounter(u32 index) const { return counters[index]; }
+    };
+
+    /** @brief Function measured by a benchmark */
+    typedef void (*BenchmarkFunction)(BenchmarkState& state);
+
+    /** @brief Prevent the compiler from removing a computation whose result is unused
+     *  @param value Value to keep
+     */
+    template<typename T>
+    inline void DoNotOptimize(T const& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /** @brief Register a benchmark
+     *  @param name Name of the benchmark (the argument is appended as "/arg")
+     *  @param function Function to measure
+     *  @param args Arguments, the benchmark runs once per argument (empty for a single run with 0)
+     */
+    void RegisterBenchmark(const char* name, BenchmarkFunction function, const std::vector<u32>& args = {});
+
+    /** @brief Register the benchmarks of every engine subsystem
+     *  They create their own scenes and managers, the game's scene manager is left untouched
+     */
+    void RegisterEngineBenchmarks();
+
+    /** @brief Run the registered benchmarks and write one JSON object per line
+     *  Each line looks like {"name":"Scene::Update/100","iterations":512,"ns_per_iter":1234.5,"items_per_second":8.1e7},
+     *  followed by the counters set with BenchmarkState::SetCounter
+     *  @param outputPath File receiving the results ("-" for stdout only, nullptr to only print them on the console)
+     *  @param filter Only run benchmarks whose name starts with this (nullptr for all)
+     *  @param minSeconds Minimum measured time per benchmark
+     *  @return Number of benchmarks run
+     */
+    int RunBenchmarks(const char* outputPath, const char* filter = nullptr, float minSeconds = 0.2f);
+} // namespace Debug
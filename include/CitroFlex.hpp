@@ -16,6 +16,23 @@
  * - Random utilities
  * - Color definitions
  * - Logging system
+ * - Job system
+ * - Tweens
+ * - Timers
+ * - Coroutines
+ * - Physics
+ * - Pathfinding
+ * - Draw commands
+ * - Instanced primitives
+ * - Math types
+ * - Benchmarks
+ * - Memory accounting
+ * - Binary scene files
+ * - Asset packs
+ * - File watcher (hot-reload)
+ * - Event bus
+ * - UI widgets
+ * - Audio
  */
 
 #pragma once
@@ -26,3 +43,20 @@
 #include "Colors.hpp"
 #include "Input.hpp"
 #include "Logging.hpp"
+#include "Jobs.hpp"
+#include "Tween.hpp"
+#include "Timers.hpp"
+#include "Coroutines.hpp"
+#include "Physics.hpp"
+#include "Pathfinding.hpp"
+#include "Render.hpp"
+#include "Primitives.hpp"
+#include "Math.hpp"
+#include "Benchmark.hpp"
+#include "Memory.hpp"
+#include "SceneFile.hpp"
+#include "Pack.hpp"
+#include "FileWatcher.hpp"
+#include "Events.hpp"
+#include "UI.hpp"
+#include "Audio.hpp"
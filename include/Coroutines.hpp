@@ -0,0 +1,277 @@
+/**
+ * @file Coroutines.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex coroutines for multi-step behaviours
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <vector>
+#include <unordered_map>
+#include "Timers.hpp"
+#include "Events.hpp"
+
+namespace Objects { class Object; }  // Forward declaration
+
+/** @brief Start the body of Coroutine::Run */
+#define CO_BEGIN switch (resumeLine) { case 0:
+
+/** @brief Suspend after setting up a wait, the next Run continues after this line */
+#define CO_AWAIT(wait) do { wait; resumeLine = __LINE__; return false; case __LINE__:; } while (0)
+
+/** @brief Suspend until the next frame */
+#define CO_YIELD() CO_AWAIT(WaitFrames(1))
+
+/** @brief Suspend for a number of frames */
+#define CO_WAIT_FRAMES(frames) CO_AWAIT(WaitFrames(frames))
+
+/** @brief Suspend for a duration in seconds (scene time, paused with the scene) */
+#define CO_WAIT_SECONDS(seconds) CO_AWAIT(WaitSeconds(seconds))
+
+/** @brief Suspend until a condition function returns true (checked once per frame) */
+#define CO_WAIT_UNTIL(condition, userData) CO_AWAIT(WaitUntil(condition, userData))
+
+/** @brief Suspend until an event of a type is dispatched, optionally copying it to out */
+#define CO_WAIT_EVENT(Type, out) CO_AWAIT(WaitEvent<Type>(out))
+
+/** @brief End the body of Coroutine::Run (the coroutine is finished) */
+#define CO_END } resumeLine = 0; return true;
+
+/**
+ * @namespace Coroutines
+ * @brief Stackless coroutines resumed by the scene
+ */
+namespace Coroutines {
+    /** @brief Condition polled by WaitUntil
+     *  @param userData Pointer given to WaitUntil
+     *  @return true to resume the coroutine
+     */
+    typedef bool (*Condition)(void* userData);
+
+    class Scheduler;  // Forward declaration
+
+    /** @brief Base class of a coroutine
+     *  Run is written between CO_BEGIN and CO_END and suspends with the CO_ macros. Like any
+     *  stackless coroutine, local variables do not survive a suspension: keep the state in members.
+     *  Example:
+     *  @code
+     *  class Patrol : public Coroutines::Coroutine {
+     *      Objects::Object* guard;
+     *      int step = 0;
+     *  protected:
+     *      bool Run() override {
+     *          CO_BEGIN;
+     *          while (true) {
+     *              for (step = 0; step < 60; step++) { guard->AddX(1); CO_YIELD(); }
+     *              CO_WAIT_SECONDS(2.0f);
+     *          }
+     *          CO_END;
+     *      }
+     *  };
+     *  @endcode
+     *  The coroutine object is owned by the caller and must outlive its scheduling
+     *  (destroying it stops it).
+     */
+    class Coroutine {
+    private:
+        friend class Scheduler;
+
+        /** @brief What a suspended coroutine waits for */
+        enum class Wait : u8 {
+            FRAMES,     ///< A number of frames
+            SECONDS,    ///< A timer of the scene's timer wheel
+            CONDITION,  ///< A condition polled every frame
+            EVENT       ///< An event type
+        };
+
+        typedef u32 (*Subscriber)(Events::EventBus& bus, Scheduler* scheduler);
+
+        Scheduler* scheduler = nullptr;             ///< Scheduler running it (nullptr when stopped)
+        const Objects::Object* owner = nullptr;     ///< Object whose removal stops it
+        Coroutine* ownerPrevious = nullptr;         ///< Previous coroutine of the same owner
+        Coroutine* ownerNext = nullptr;             ///< Next coroutine of the same owner
+        u32 slot = 0;                               ///< Index in the scheduler
+        Wait wait = Wait::FRAMES;                   ///< Current wait
+        u32 frames = 1;                             ///< Frames for Wait::FRAMES
+        float seconds = 0;                          ///< Delay for Wait::SECONDS
+        Timers::Handle timer = 0;                   ///< Timer for Wait::SECONDS
+        Condition condition = nullptr;              ///< Function for Wait::CONDITION
+        void* conditionData = nullptr;              ///< Passed to condition
+        u32 pollIndex = 0;                          ///< Index in the polled list
+        u32 eventType = 0;                          ///< Event type for Wait::EVENT
+        u32 eventSize = 0;                          ///< Size of the event
+        void* eventOut = nullptr;                   ///< Where the event is copied (can be nullptr)
+        Subscriber subscribe = nullptr;             ///< Subscribes the scheduler to the event type
+
+    protected:
+        int resumeLine = 0;                         ///< Resume point used by the CO_ macros
+
+        /** @brief Body of the coroutine, resumed by the scheduler
+         *  @return true when finished (CO_END), false when suspended
+         */
+        virtual bool Run() = 0;
+
+        /** @brief Wait for a number of frames (at least one) */
+        void WaitFrames(u32 count) { wait = Wait::FRAMES; frames = count > 0 ? count : 1; }
+
+        /** @brief Wait for a duration (through the scene's timer wheel) */
+        void WaitSeconds(float delay) { wait = Wait::SECONDS; seconds = delay; }
+
+        /** @brief Wait until a function returns true (polled once per frame) */
+        void WaitUntil(Condition function, void* userData) {
+            wait = Wait::CONDITION;
+            condition = function;
+            conditionData = userData;
+        }
+
+        /** @brief Wait for the next event of type T
+         *  @param out Where the event is copied (can be nullptr)
+         */
+        template<typename T>
+        void WaitEvent(T* out = nullptr);
+
+    public:
+        /** @brief Virtual destructor (stops the coroutine) */
+        virtual ~Coroutine();
+
+        /** @brief Check if the coroutine is scheduled */
+        bool IsRunning() const { return scheduler != nullptr; }
+
+        /** @brief Get the object whose removal stops the coroutine */
+        const Objects::Object* GetOwner() const { return owner; }
+
+        /** @brief Stop the coroutine (the next Start runs it from the beginning) */
+        void Stop();
+    };
+
+    /** @brief Runs the coroutines of a scene
+     *  Suspended coroutines are filed by what they wait for: a frame heap, the scene's timer wheel,
+     *  per-type event lists and a polled list for conditions. Update only resumes the coroutines
+     *  that are due, so idle ones cost nothing until they wake up.
+     */
+    class Scheduler {
+    private:
+        /** @brief Reference to a coroutine that becomes invalid when it stops */
+        struct Ticket {
+            u32 slot;           ///< Index in slots
+            u32 generation;     ///< Generation of the slot when filed
+        };
+
+        /** @brief Coroutine waiting for a frame */
+        struct FrameWait {
+            u32 frame;          ///< Frame at which it resumes
+            Ticket ticket;      ///< Coroutine
+
+            bool operator<(const FrameWait& other) const { return frame > other.frame; }
+        };
+
+        /** @brief Coroutines waiting for one event type */
+        struct EventWaiters {
+            u32 subscription = 0;           ///< Event bus subscription (0 when not subscribed)
+            Coroutine::Subscriber subscribe = nullptr; ///< Subscribes to the type again on another bus
+            std::vector<Ticket> waiting;    ///< Coroutines to resume on the next event
+        };
+
+        Timers::TimerWheel& timers;                 ///< Timers of the scene
+        Events::EventBus* bus = nullptr;            ///< Event bus of the scene manager
+        std::vector<Coroutine*> slots;              ///< Scheduled coroutines (nullptr for free slots)
+        std::vector<u32> generations;               ///< Incremented each time a slot is freed
+        std::vector<u32> freeSlots;                 ///< Unused slots
+        std::vector<FrameWait> frameHeap;           ///< Coroutines waiting for a frame (min-heap)
+        std::vector<Coroutine*> polled;             ///< Coroutines waiting for a condition
+        std::vector<EventWaiters> events;           ///< Coroutines waiting for an event, by type id
+        std::vector<Ticket> ready;                  ///< Coroutines to resume this frame
+        std::vector<Ticket> running;                ///< Coroutines being resumed
+        std::unordered_map<const Objects::Object*, Coroutine*> owners; ///< First coroutine of each owner
+        u32 frame = 0;                              ///< Frames updated
+        u32 count = 0;                              ///< Scheduled coroutines
+        u32 resumed = 0;                            ///< Coroutines resumed by the last Update
+
+        /** @brief Get the coroutine of a ticket or nullptr if it stopped */
+        Coroutine* Resolve(const Ticket& ticket) const {
+            return generations[ticket.slot] == ticket.generation ? slots[ticket.slot] : nullptr;
+        }
+
+        /** @brief Get the current ticket of a coroutine */
+        Ticket TicketOf(const Coroutine* coroutine) const { return { coroutine->slot, generations[coroutine->slot] }; }
+
+        /** @brief File a suspended coroutine under what it waits for */
+        void Suspend(Coroutine* coroutine);
+
+        /** @brief Remove a polled coroutine in O(1) */
+        void RemovePolled(Coroutine* coroutine);
+
+        /** @brief Timer callback resuming a coroutine */
+        static void OnTimer(void* userData);
+
+        /** @brief Resume the coroutines waiting for an event type */
+        void WakeEvent(u32 type, const void* event);
+
+        template<typename T>
+        static void OnEvent(const T& event, void* userData) {
+            static_cast<Scheduler*>(userData)->WakeEvent(Events::GetTypeId<T>(), &event);
+        }
+
+        template<typename T>
+        static u32 SubscribeEvent(Events::EventBus& bus, Scheduler* scheduler) {
+            return bus.Subscribe<T>(&OnEvent<T>, scheduler);
+        }
+
+        friend class Coroutine;
+
+    public:
+        /** @brief Constructor
+         *  @param wheel Timer wheel used by WaitSeconds
+         */
+        explicit Scheduler(Timers::TimerWheel& wheel) : timers(wheel) {}
+
+        /** @brief Destructor (stops every coroutine, see Clear for the event bus) */
+        ~Scheduler();
+
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        /** @brief Schedule a coroutine from its beginning, it first runs on the next Update
+         *  A coroutine already running on a scheduler is restarted
+         *  @param coroutine Coroutine to run
+         *  @param owner Object whose removal from the scene stops it (can be nullptr)
+         */
+        void Start(Coroutine* coroutine, const Objects::Object* owner = nullptr);
+
+        /** @brief Stop a coroutine (safe inside any Run, including its own) */
+        void Stop(Coroutine* coroutine);
+
+        /** @brief Stop every coroutine of an object (called when it is removed from the scene) */
+        void StopOwner(const Objects::Object* owner);
+
+        /** @brief Stop every coroutine and unsubscribe from the event bus (called on unload) */
+        void Clear();
+
+        /** @brief Resume the coroutines that are due (called by Scene::Update after the timers)
+         *  @param eventBus Bus used by WaitEvent
+         */
+        void Update(Events::EventBus* eventBus);
+
+        /** @brief Get the number of scheduled coroutines */
+        u32 GetCount() const { return count; }
+
+        /** @brief Get the number of coroutines resumed by the last Update */
+        u32 GetResumedCount() const { return resumed; }
+    };
+
+    template<typename T>
+    void Coroutine::WaitEvent(T* out) {
+        static_assert(std::is_trivially_copyable<T>::value, "Events must be trivially copyable");
+        wait = Wait::EVENT;
+        eventType = Events::GetTypeId<T>();
+        eventSize = sizeof(T);
+        eventOut = out;
+        subscribe = &Scheduler::SubscribeEvent<T>;
+    }
+}
@@ -0,0 +1,169 @@
+/**
+ * @file Events.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex event bus
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <atomic>
+#include <vector>
+#include <type_traits>
+
+/**
+ * @namespace Events
+ * @brief Typed events delivered once per frame
+ * An event is any trivially copyable struct, e.g. `struct LevelCompleted { int level; };`
+ */
+namespace Events {
+    /** @brief Maximum size of an event posted with PostAsync */
+    constexpr u32 ASYNC_EVENT_SIZE = 48;
+
+    /** @brief Number of events PostAsync can hold between two dispatches (power of two) */
+    constexpr u32 ASYNC_CAPACITY = 256;
+
+    /** @brief Event counters of one frame */
+    struct Stats {
+        u32 posted = 0;     ///< Events posted (Post and PostAsync)
+        u32 delivered = 0;  ///< Handler calls
+        u32 dropped = 0;    ///< PostAsync calls rejected because the ring was full
+    };
+
+    /** @brief Get a new event type identifier (use GetTypeId) */
+    u32 NextTypeId();
+
+    /** @brief Get the identifier of an event type
+     *  Identifiers are small consecutive integers so handlers are found by index
+     *  @return Type identifier
+     */
+    template<typename T>
+    u32 GetTypeId() {
+        static const u32 id = NextTypeId();
+        return id;
+    }
+
+    /** @brief Event queues and handlers
+     *  Post queues an event for the next Dispatch, which delivers every queued event to the handlers
+     *  of its type. Events posted by handlers during Dispatch are delivered on the next one.
+     */
+    class EventBus {
+    private:
+        typedef void (*GenericHandler)();
+        typedef void (*Invoker)(GenericHandler handler, const void* event, void* userData);
+
+        /** @brief A registered handler */
+        struct Subscriber {
+            u32 id;                     ///< Identifier returned by Subscribe
+            GenericHandler handler;     ///< Typed handler (nullptr once unsubscribed)
+            Invoker invoke;             ///< Calls handler with the right type
+            void* userData;             ///< Pointer passed to the handler
+        };
+
+        /** @brief Header of a queued event, followed by the event padded to 8 bytes */
+        struct QueuedEvent {
+            u32 type;   ///< Type identifier
+            u32 size;   ///< Size of the event
+        };
+
+        /** @brief Slot of the PostAsync ring */
+        struct AsyncSlot {
+            std::atomic<u32> sequence;              ///< Slot state (see PushAsync)
+            u32 type;                               ///< Type identifier
+            u32 size;                               ///< Size of the event
+            alignas(8) u8 data[ASYNC_EVENT_SIZE];   ///< Event
+        };
+
+        std::vector<std::vector<Subscriber>> subscribers;  ///< Handlers by type identifier
+        std::vector<u8> queues[2];                  ///< Events posted this frame and events being dispatched
+        int writeQueue = 0;                         ///< Index of the queue receiving Post
+        AsyncSlot* ring;                            ///< Bounded multi-producer single-consumer ring
+        std::atomic<u32> enqueuePosition;           ///< Next slot for producers
+        u32 dequeuePosition = 0;                    ///< Next slot for Dispatch
+        u32 nextSubscriberId = 1;                   ///< Next Subscribe identifier
+        bool dispatching = false;                   ///< Dispatch is running
+        bool removedDuringDispatch = false;         ///< Subscribers to compact after Dispatch
+        std::atomic<u32> posted;                    ///< Events posted since the last Dispatch
+        std::atomic<u32> dropped;                   ///< PostAsync failures since the last Dispatch
+        Stats lastStats;                            ///< Counters of the last Dispatch
+
+        template<typename T>
+        static void Invoke(GenericHandler handler, const void* event, void* userData) {
+            reinterpret_cast<void (*)(const T&, void*)>(handler)(*static_cast<const T*>(event), userData);
+        }
+
+        /** @brief Register a type erased handler */
+        u32 AddSubscriber(u32 type, GenericHandler handler, Invoker invoke, void* userData);
+
+        /** @brief Append an event to the write queue */
+        void Push(u32 type, const void* event, u32 size);
+
+        /** @brief Add an event to the ring (any thread) */
+        bool PushAsync(u32 type, const void* event, u32 size);
+
+    public:
+        /** @brief Constructor */
+        EventBus();
+
+        /** @brief Destructor */
+        ~EventBus();
+
+        EventBus(const EventBus&) = delete;
+        EventBus& operator=(const EventBus&) = delete;
+
+        /** @brief Register a handler for an event type
+         *  @param handler Function called with each event of type T
+         *  @param userData Pointer passed to the handler
+         *  @return Identifier for Unsubscribe
+         */
+        template<typename T>
+        u32 Subscribe(void (*handler)(const T& event, void* userData), void* userData = nullptr) {
+            return AddSubscriber(GetTypeId<T>(), reinterpret_cast<GenericHandler>(handler), &Invoke<T>, userData);
+        }
+
+        /** @brief Remove a handler (safe inside a handler)
+         *  @param id Identifier returned by Subscribe
+         */
+        void Unsubscribe(u32 id);
+
+        /** @brief Remove every handler registered with a user data pointer
+         *  @param userData Pointer given to Subscribe
+         */
+        void UnsubscribeAll(void* userData);
+
+        /** @brief Queue an event for the next Dispatch (main thread only)
+         *  @param event Event to copy
+         */
+        template<typename T>
+        void Post(const T& event) {
+            static_assert(std::is_trivially_copyable<T>::value, "Events must be trivially copyable");
+            static_assert(alignof(T) <= 8, "Events must not need more than 8 byte alignment");
+            Push(GetTypeId<T>(), &event, sizeof(T));
+        }
+
+        /** @brief Queue an event from any thread without locking (workers, loaders)
+         *  @param event Event to copy (at most ASYNC_EVENT_SIZE bytes)
+         *  @return false if ASYNC_CAPACITY events are already waiting (the event is dropped)
+         */
+        template<typename T>
+        bool PostAsync(const T& event) {
+            static_assert(std::is_trivially_copyable<T>::value, "Events must be trivially copyable");
+            static_assert(sizeof(T) <= ASYNC_EVENT_SIZE, "Event too large for PostAsync");
+            static_assert(alignof(T) <= 8, "Events must not need more than 8 byte alignment");
+            return PushAsync(GetTypeId<T>(), &event, sizeof(T));
+        }
+
+        /** @brief Deliver every queued event (called by SceneManager::Run before the scenes update) */
+        void Dispatch();
+
+        /** @brief Get the counters of the last Dispatch
+         *  @return Events posted before it, handler calls and dropped events
+         */
+        const Stats& GetStats() const { return lastStats; }
+    };
+}
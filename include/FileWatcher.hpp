@@ -0,0 +1,116 @@
+/**
+ * @file FileWatcher.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex file watcher for hot-reloading
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+namespace Debug
+{
+    /** @brief Watches files on the SD card and calls a function when they change
+     *  Files are polled with stat() a few per frame (there is no change notification on the 3DS),
+     *  and a change is only reported once the file stopped changing, so a file still being
+     *  copied (e.g. over FTP) is not reloaded half written. romfs:/ files never change.
+     *  On Linux (host builds) the directories of the files are watched with inotify instead and a
+     *  change is reported once the file is closed after writing or moved in place; files inotify
+     *  cannot watch are still polled.
+     */
+    class FileWatcher {
+    public:
+        /** @brief Function called when a watched file changed
+         *  @param path Path of the file
+         *  @param userData Pointer given to Watch
+         */
+        typedef void (*Callback)(const char* path, void* userData);
+
+    private:
+        /** @brief A watched file */
+        struct Entry {
+            int id;                 ///< Identifier returned by Watch
+            std::string path;       ///< Path of the file
+            Callback callback;      ///< Function to call
+            void* userData;         ///< Pointer passed to the callback
+            time_t modified;        ///< Last modification time seen
+            off_t size;             ///< Last size seen
+            bool pending;           ///< Changed on the last check, reported once stable
+            int watch;              ///< inotify watch of the directory, -1 when polled
+        };
+
+        std::vector<Entry> entries;     ///< Watched files
+        std::vector<Entry> fired;       ///< Changes reported by the current Poll
+        size_t next = 0;                ///< Next entry to check
+        int nextId = 0;                 ///< Next identifier
+        u32 filesPerPoll = 2;           ///< Files checked per Poll
+
+#ifdef __linux__
+        int notify = -1;                ///< inotify instance, created by the first Watch
+
+        /** @brief Watch the directory of a file with inotify
+         *  @param path Path of the file
+         *  @return Watch descriptor, -1 if the file has to be polled
+         */
+        int AddWatch(const std::string& path);
+
+        /** @brief Report the files changed since the last call
+         *  Events of the same file are merged, so a file is reported once per Poll
+         */
+        void ReadEvents();
+#endif
+
+        /** @brief Remove an entry, and its inotify watch when no other entry uses it
+         *  @param index Index of the entry
+         */
+        void Remove(size_t index);
+
+    public:
+        FileWatcher() {}
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+        ~FileWatcher();
+
+        /** @brief Watch a file
+         *  @param path Path of the file (sdmc:/)
+         *  @param callback Function called when the file changed
+         *  @param userData Pointer passed to the callback
+         *  @return Identifier for Unwatch
+         */
+        int Watch(const char* path, Callback callback, void* userData = nullptr);
+
+        /** @brief Stop watching a file
+         *  @param id Identifier returned by Watch
+         */
+        void Unwatch(int id);
+
+        /** @brief Stop watching every file registered with a user data pointer
+         *  @param userData Pointer given to Watch
+         */
+        void UnwatchAll(void* userData);
+
+        /** @brief Check the next files and call the callbacks of the changed ones
+         *  Called by SceneManager::Run between two frames
+         *  @return Number of callbacks called
+         */
+        int Poll();
+
+        /** @brief Set the number of polled files checked per Poll
+         *  @param count Files per poll (stat() on the SD card takes about a millisecond)
+         */
+        void SetFilesPerPoll(u32 count) { filesPerPoll = count; }
+
+        /** @brief Get the number of watched files
+         *  @return File count
+         */
+        size_t GetCount() const { return entries.size(); }
+    };
+} // namespace Debug
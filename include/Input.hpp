@@ -14,6 +14,8 @@
 #include <3ds.h>
 #include <map>
 
+#include "Math.hpp"
+
 /**
  * @namespace Input
  * @brief Handles input management for the 3DS console
@@ -44,10 +46,7 @@ namespace Input {
     /**
      * @brief Represents a 2D vector for stick positions
      */
-    struct Vector2D {
-        float x = 0.0f;  ///< X coordinate
-        float y = 0.0f;  ///< Y coordinate
-    };
+    typedef Math::Vec2f Vector2D;
 
     /**
      * @brief Represents the touch screen input state
@@ -0,0 +1,181 @@
+/**
+ * @file Jobs.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex job system
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <atomic>
+#include <vector>
+
+/**
+ * @namespace Jobs
+ * @brief Work-stealing job system running on the extra CPU cores
+ */
+namespace Jobs {
+    /** @brief Function executed by a job
+     *  @param data User data given when the job was created
+     *  @param begin First index of the range handled by the job
+     *  @param end One past the last index of the range handled by the job
+     */
+    typedef void (*JobFunction)(void* data, u32 begin, u32 end);
+
+    /** @brief Maximum number of jobs that can wait on a single job */
+    constexpr int MAX_CONTINUATIONS = 8;
+
+    /** @brief Maximum number of threads (main thread included) */
+    constexpr int MAX_WORKERS = 4;
+
+    /** @brief A unit of work
+     *  Jobs live in a ring owned by the JobSystem, never allocate them yourself.
+     *  Create skips the jobs still in flight, so a job can be kept across frames until it finishes
+     *  (its slot is reused once finished).
+     */
+    struct Job {
+        JobFunction function = nullptr;         ///< Function to run
+        void* data = nullptr;                   ///< User data passed to the function
+        u32 begin = 0;                          ///< Start of the range
+        u32 end = 0;                            ///< End of the range
+        Job* parent = nullptr;                  ///< Job notified when this one finishes
+        std::atomic<s32> unfinished{0};         ///< This job + unfinished children (-1 while notifying, 0: slot free)
+        std::atomic<s32> dependencies;          ///< Jobs that must finish before this one can start
+        std::atomic<s32> continuationCount;     ///< Number of jobs waiting on this one
+        Job* continuations[MAX_CONTINUATIONS];  ///< Jobs waiting on this one
+    };
+
+    /** @brief Double-ended queue of jobs owned by a single worker
+     *  The owner pushes and pops at the back, other workers steal from the front
+     */
+    class WorkQueue {
+    private:
+        std::vector<Job*> jobs;     ///< Ring buffer of jobs
+        u32 head = 0;               ///< Index of the oldest job (steal side)
+        u32 tail = 0;               ///< Index after the newest job (owner side)
+        LightLock lock;             ///< Protects head and tail
+
+    public:
+        /** @brief Constructor
+         *  @param capacity Maximum number of queued jobs (must be a power of two)
+         */
+        explicit WorkQueue(u32 capacity = 1024);
+
+        /** @brief Push a job at the back (owner only)
+         *  @return false if the queue is full
+         */
+        bool Push(Job* job);
+
+        /** @brief Pop the newest job (owner only)
+         *  @return Job or nullptr if empty
+         */
+        Job* Pop();
+
+        /** @brief Steal the oldest job (other workers)
+         *  @return Job or nullptr if empty
+         */
+        Job* Steal();
+    };
+
+    /** @brief Pool of worker threads executing jobs
+     *  The calling thread is always worker 0 and helps while waiting.
+     *  With a single worker every job runs inline on submission.
+     */
+    class JobSystem {
+    private:
+        struct Worker {
+            JobSystem* system = nullptr;    ///< Owner of the worker
+            Thread thread = nullptr;        ///< libctru thread (nullptr for worker 0)
+            WorkQueue queue;                ///< Jobs pushed by this worker
+            int index = 0;                  ///< Index of the worker
+        };
+
+        std::vector<Worker*> workers;       ///< All workers, main thread at index 0 (never reallocated)
+        std::atomic<int> visibleWorkers;    ///< Workers the threads can steal from (Start adds them while threads run)
+        std::vector<Job> jobPool;           ///< Ring of reusable jobs
+        std::atomic<u32> nextJob;           ///< Next job to allocate in the ring
+        std::atomic<bool> running;          ///< Cleared to stop the threads
+        LightSemaphore wakeUp;              ///< Signaled when jobs are pushed
+        bool changedCpuLimit = false;       ///< True if we raised the syscore time limit
+
+        static void WorkerMain(void* arg);
+        Job* AllocateJob();
+        Job* FindJob(int workerIndex);
+        void Execute(Job* job);
+        void Finish(Job* job);
+        void Schedule(Job* job);
+
+    public:
+        /** @brief Constructor - starts single threaded */
+        JobSystem();
+
+        /** @brief Destructor - stops all worker threads */
+        ~JobSystem();
+
+        /** @brief Start worker threads
+         *  @param workerCount Total number of workers including the calling thread (1 to MAX_WORKERS)
+         *  @return Number of workers actually running (threads that could not be created are skipped)
+         */
+        int Start(int workerCount);
+
+        /** @brief Stop worker threads and go back to single threaded execution */
+        void Stop();
+
+        /** @brief Get the number of workers including the main thread
+         *  @return Worker count (1 means single threaded)
+         */
+        int GetWorkerCount() const { return workers.size(); }
+
+        /** @brief Get the number of workers that can run on this console
+         *  @return 2 on Old 3DS (core 1), 3 on New 3DS (cores 1 and 2)
+         */
+        static int GetRecommendedWorkerCount();
+
+        /** @brief Create a job without scheduling it
+         *  @param function Function to run
+         *  @param data User data
+         *  @param begin Start of the range
+         *  @param end End of the range
+         *  @param parent Optional job which will only complete once this one completes
+         *  @return New job
+         */
+        Job* Create(JobFunction function, void* data, u32 begin = 0, u32 end = 0, Job* parent = nullptr);
+
+        /** @brief Make a job wait for another one
+         *  Must be called before either job is submitted
+         *  @param job Job that will wait
+         *  @param dependency Job that must finish first
+         *  @return false if the dependency has too many continuations
+         */
+        bool AddDependency(Job* job, Job* dependency);
+
+        /** @brief Schedule a job (it will start once its dependencies are done)
+         *  @param job Job to run
+         */
+        void Submit(Job* job);
+
+        /** @brief Check if a job and its children are finished
+         *  @param job Job to check
+         *  @return true if finished
+         */
+        bool IsFinished(const Job* job) const { return job->unfinished.load() <= 0; }
+
+        /** @brief Wait for a job while helping with other jobs
+         *  @param job Job to wait for
+         */
+        void Wait(Job* job);
+
+        /** @brief Run a function over a range, split into chunks across the workers
+         *  @param count Number of items
+         *  @param grainSize Minimum number of items per job
+         *  @param function Function called with each chunk
+         *  @param data User data
+         */
+        void ParallelFor(u32 count, u32 grainSize, JobFunction function, void* data);
+    };
+}
@@ -0,0 +1,279 @@
+/**
+ * @file Math.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex math types (fixed-point, vectors, matrices, fast trigonometry)
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ *
+ * @details
+ * Header only. The ARM11 has no double precision fast path, so prefer float or
+ * Fixed for per-frame math and keep double for values that need the range.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @namespace Math
+ * @brief Scalar, vector and matrix helpers usable in constant expressions
+ */
+namespace Math {
+    constexpr float PI = 3.14159265358979323846f;     ///< Pi
+    constexpr float TWO_PI = 2.0f * PI;               ///< 2 * Pi
+    constexpr float HALF_PI = 0.5f * PI;              ///< Pi / 2
+
+    /** @brief Convert degrees to radians */
+    template<typename T>
+    constexpr T DegToRad(T degrees) { return degrees * T(PI / 180.0f); }
+
+    /** @brief Convert radians to degrees */
+    template<typename T>
+    constexpr T RadToDeg(T radians) { return radians * T(180.0f / PI); }
+
+    /** @brief Linear interpolation */
+    template<typename T, typename S>
+    constexpr T Lerp(T a, T b, S t) { return a + (b - a) * t; }
+
+    /** @brief Clamp a value between min and max */
+    template<typename T>
+    constexpr T Clamp(T value, T min, T max) { return value < min ? min : (value > max ? max : value); }
+
+    /** @brief Fixed-point number
+     *  @tparam IntBits Number of integer bits (sign included)
+     *  @tparam FracBits Number of fractional bits
+     */
+    template<int IntBits, int FracBits>
+    class Fixed {
+        static_assert(IntBits + FracBits <= 32, "Fixed is stored in 32 bits");
+        static_assert(FracBits > 0, "Fixed needs fractional bits");
+
+    public:
+        int32_t raw = 0;    ///< Raw value (value * 2^FracBits)
+
+        static constexpr int32_t ONE = int32_t(1) << FracBits;     ///< Raw value of 1
+
+        constexpr Fixed() = default;
+        constexpr Fixed(int value) : raw(value * ONE) {}
+        constexpr Fixed(float value) : raw(int32_t(value * ONE + (value >= 0 ? 0.5f : -0.5f))) {}
+        constexpr Fixed(double value) : raw(int32_t(value * ONE + (value >= 0 ? 0.5 : -0.5))) {}
+
+        /** @brief Build from a raw value */
+        static constexpr Fixed FromRaw(int32_t value) { Fixed f; f.raw = value; return f; }
+
+        constexpr float ToFloat() const { return float(raw) / ONE; }
+        constexpr double ToDouble() const { return double(raw) / ONE; }
+        constexpr int ToInt() const { return raw >> FracBits; }     ///< Rounded toward -infinity
+
+        constexpr explicit operator float() const { return ToFloat(); }
+        constexpr explicit operator double() const { return ToDouble(); }
+        constexpr explicit operator int() const { return ToInt(); }
+
+        constexpr Fixed operator-() const { return FromRaw(-raw); }
+        constexpr Fixed operator+(Fixed o) const { return FromRaw(raw + o.raw); }
+        constexpr Fixed operator-(Fixed o) const { return FromRaw(raw - o.raw); }
+        constexpr Fixed operator*(Fixed o) const { return FromRaw(int32_t((int64_t(raw) * o.raw) >> FracBits)); }
+        constexpr Fixed operator/(Fixed o) const { return FromRaw(int32_t((int64_t(raw) << FracBits) / o.raw)); }
+        constexpr Fixed operator*(int o) const { return FromRaw(raw * o); }
+        constexpr Fixed operator/(int o) const { return FromRaw(raw / o); }
+
+        constexpr Fixed& operator+=(Fixed o) { raw += o.raw; return *this; }
+        constexpr Fixed& operator-=(Fixed o) { raw -= o.raw; return *this; }
+        constexpr Fixed& operator*=(Fixed o) { return *this = *this * o; }
+        constexpr Fixed& operator/=(Fixed o) { return *this = *this / o; }
+
+        constexpr bool operator==(Fixed o) const { return raw == o.raw; }
+        constexpr bool operator!=(Fixed o) const { return raw != o.raw; }
+        constexpr bool operator<(Fixed o) const { return raw < o.raw; }
+        constexpr bool operator<=(Fixed o) const { return raw <= o.raw; }
+        constexpr bool operator>(Fixed o) const { return raw > o.raw; }
+        constexpr bool operator>=(Fixed o) const { return raw >= o.raw; }
+    };
+
+    typedef Fixed<16, 16> Fixed16;  ///< Q16.16, range +-32768 with 1/65536 precision
+    typedef Fixed<20, 12> Fixed12;  ///< Q20.12, larger range for world coordinates
+
+    /** @brief 2D vector */
+    template<typename T>
+    struct Vec2 {
+        T x = T();  ///< X coordinate
+        T y = T();  ///< Y coordinate
+
+        constexpr Vec2() = default;
+        constexpr Vec2(T x, T y) : x(x), y(y) {}
+
+        /** @brief Convert from a vector of another scalar type */
+        template<typename U>
+        constexpr explicit Vec2(const Vec2<U>& o) : x(static_cast<T>(o.x)), y(static_cast<T>(o.y)) {}
+
+        constexpr Vec2 operator-() const { return Vec2(-x, -y); }
+        constexpr Vec2 operator+(const Vec2& o) const { return Vec2(x + o.x, y + o.y); }
+        constexpr Vec2 operator-(const Vec2& o) const { return Vec2(x - o.x, y - o.y); }
+        constexpr Vec2 operator*(T s) const { return Vec2(x * s, y * s); }
+        constexpr Vec2 operator/(T s) const { return Vec2(x / s, y / s); }
+        constexpr Vec2& operator+=(const Vec2& o) { x += o.x; y += o.y; return *this; }
+        constexpr Vec2& operator-=(const Vec2& o) { x -= o.x; y -= o.y; return *this; }
+        constexpr Vec2& operator*=(T s) { x *= s; y *= s; return *this; }
+        constexpr bool operator==(const Vec2& o) const { return x == o.x && y == o.y; }
+        constexpr bool operator!=(const Vec2& o) const { return !(*this == o); }
+
+        constexpr T Dot(const Vec2& o) const { return x * o.x + y * o.y; }
+        constexpr T Cross(const Vec2& o) const { return x * o.y - y * o.x; }
+        constexpr T LengthSquared() const { return x * x + y * y; }
+    };
+
+    typedef Vec2<float> Vec2f;      ///< Float vector
+    typedef Vec2<double> Vec2d;     ///< Double vector
+    typedef Vec2<Fixed16> Vec2x;    ///< Fixed-point vector
+
+    /** @brief 3x3 matrix for 2D affine transforms (row major) */
+    template<typename T>
+    struct Mat3 {
+        T m[9] = { T(1), T(0), T(0), T(0), T(1), T(0), T(0), T(0), T(1) };   ///< Elements
+
+        /** @brief Identity matrix */
+        static constexpr Mat3 Identity() { return Mat3(); }
+
+        /** @brief Translation matrix */
+        static constexpr Mat3 Translation(T x, T y) { Mat3 r; r.m[2] = x; r.m[5] = y; return r; }
+
+        /** @brief Scale matrix */
+        static constexpr Mat3 Scale(T x, T y) { Mat3 r; r.m[0] = x; r.m[4] = y; return r; }
+
+        /** @brief Rotation matrix from a precomputed sine and cosine */
+        static constexpr Mat3 Rotation(T sin, T cos) {
+            Mat3 r;
+            r.m[0] = cos; r.m[1] = -sin;
+            r.m[3] = sin; r.m[4] = cos;
+            return r;
+        }
+
+        constexpr Mat3 operator*(const Mat3& o) const {
+            Mat3 r;
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 3; col++) {
+                    r.m[row * 3 + col] = m[row * 3] * o.m[col] + m[row * 3 + 1] * o.m[3 + col] + m[row * 3 + 2] * o.m[6 + col];
+                }
+            }
+            return r;
+        }
+
+        /** @brief Transform a point */
+        constexpr Vec2<T> Transform(const Vec2<T>& p) const {
+            return Vec2<T>(m[0] * p.x + m[1] * p.y + m[2], m[3] * p.x + m[4] * p.y + m[5]);
+        }
+    };
+
+    /** @brief Axis aligned rectangle */
+    template<typename T>
+    struct Rect {
+        T x = T();  ///< Left
+        T y = T();  ///< Top
+        T w = T();  ///< Width
+        T h = T();  ///< Height
+
+        constexpr Rect() = default;
+        constexpr Rect(T x, T y, T w, T h) : x(x), y(y), w(w), h(h) {}
+
+        constexpr T Right() const { return x + w; }
+        constexpr T Bottom() const { return y + h; }
+        constexpr bool Contains(const Vec2<T>& p) const { return p.x >= x && p.y >= y && p.x < x + w && p.y < y + h; }
+        constexpr bool Intersects(const Rect& o) const { return x < o.x + o.w && o.x < x + w && y < o.y + o.h && o.y < y + h; }
+    };
+
+    typedef Rect<float> Rectf;  ///< Float rectangle
+
+    namespace Detail {
+        // Taylor series, only used to build the tables at compile time
+        constexpr double TaylorSin(double x) {
+            while (x > 3.14159265358979323846) x -= 6.28318530717958647692;
+            while (x < -3.14159265358979323846) x += 6.28318530717958647692;
+            double term = x, sum = x;
+            for (int n = 1; n < 12; n++) {
+                term *= -x * x / ((2 * n) * (2 * n + 1));
+                sum += term;
+            }
+            return sum;
+        }
+
+        template<int Size>
+        struct SinTable {
+            float values[Size + 1] = {};
+            constexpr SinTable() {
+                for (int i = 0; i <= Size; i++) {
+                    values[i] = float(TaylorSin(6.28318530717958647692 * i / Size));
+                }
+            }
+        };
+    }
+
+    constexpr int SIN_TABLE_BITS = 10;                          ///< log2 of the table size
+    constexpr int SIN_TABLE_SIZE = 1 << SIN_TABLE_BITS;         ///< Entries for a full turn
+
+    /** @brief Sine of a full turn, built at compile time (last entry repeats the first); inline so every translation unit shares one copy */
+    inline constexpr Detail::SinTable<SIN_TABLE_SIZE> sinTable;
+
+    /** @brief Sine of a binary angle (65536 = full turn), interpolated from the table */
+    constexpr float SinAngle(uint16_t angle) {
+        int index = angle >> (16 - SIN_TABLE_BITS);
+        float frac = float(angle & ((1 << (16 - SIN_TABLE_BITS)) - 1)) / (1 << (16 - SIN_TABLE_BITS));
+        return sinTable.values[index] + (sinTable.values[index + 1] - sinTable.values[index]) * frac;
+    }
+
+    /** @brief Cosine of a binary angle (65536 = full turn) */
+    constexpr float CosAngle(uint16_t angle) { return SinAngle(uint16_t(angle + 16384)); }
+
+    /** @brief Convert radians to a binary angle */
+    constexpr uint16_t ToAngle(float radians) { return uint16_t(int32_t(radians * (65536.0f / TWO_PI))); }
+
+    /** @brief Convert degrees to a binary angle */
+    constexpr uint16_t DegToAngle(float degrees) { return uint16_t(int32_t(degrees * (65536.0f / 360.0f))); }
+
+    /** @brief Fast sine (table lookup, error below 1e-4) */
+    constexpr float Sin(float radians) { return SinAngle(ToAngle(radians)); }
+
+    /** @brief Fast cosine (table lookup, error below 1e-4) */
+    constexpr float Cos(float radians) { return CosAngle(ToAngle(radians)); }
+
+    /** @brief Fast inverse square root (one Newton step, relative error below 0.2%) */
+    inline float RSqrt(float x) {
+        uint32_t i;
+        memcpy(&i, &x, sizeof(i));
+        i = 0x5F3759DF - (i >> 1);
+        float y;
+        memcpy(&y, &i, sizeof(y));
+        return y * (1.5f - 0.5f * x * y * y);
+    }
+
+    /** @brief Fast atan2 (polynomial, error below 0.0015 radians) */
+    constexpr float Atan2(float y, float x) {
+        if (x == 0.0f && y == 0.0f) return 0.0f;
+        float ax = x < 0 ? -x : x;
+        float ay = y < 0 ? -y : y;
+        float a = (ax < ay ? ax : ay) / (ax > ay ? ax : ay);
+        float s = a * a;
+        float r = ((-0.0464964749f * s + 0.15931422f) * s - 0.327622764f) * s * a + a;
+        if (ay > ax) r = HALF_PI - r;
+        if (x < 0) r = PI - r;
+        if (y < 0) r = -r;
+        return r;
+    }
+
+    /** @brief Normalize a float vector using RSqrt */
+    inline Vec2f Normalize(const Vec2f& v) {
+        float lengthSquared = v.LengthSquared();
+        return lengthSquared > 0.0f ? v * RSqrt(lengthSquared) : v;
+    }
+
+    /** @brief Rotate a vector by a binary angle */
+    template<typename T>
+    constexpr Vec2<T> Rotate(const Vec2<T>& v, uint16_t angle) {
+        T s = T(SinAngle(angle));
+        T c = T(CosAngle(angle));
+        return Vec2<T>(v.x * c - v.y * s, v.x * s + v.y * c);
+    }
+}
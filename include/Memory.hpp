@@ -0,0 +1,281 @@
+/**
+ * @file Memory.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex memory accounting
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @namespace Memory
+ * @brief Tagged allocations with live/peak counters per tag and per scene
+ * Only memory routed through this namespace (or reported with Track) is counted.
+ */
+namespace Memory {
+    /** @brief What an allocation is used for */
+    enum class Tag : u8 {
+        GENERAL,    ///< Anything else
+        SCENE,      ///< Scene element lists, indexes and tweens
+        SPRITE,     ///< Sprite sheets and textures
+        TEXT,       ///< Text buffers
+        COMMANDS,   ///< Draw command lists
+        AUDIO,      ///< Audio buffers
+        FRAME,      ///< Per-frame arenas
+        COUNT
+    };
+
+    /** @brief Memory region */
+    enum class Region : u8 {
+        HEAP,       ///< Application heap (malloc)
+        LINEAR,     ///< GPU/DSP accessible linear memory (linearAlloc)
+        COUNT
+    };
+
+    /** @brief Allocation counters */
+    struct Counters {
+        size_t live = 0;        ///< Bytes currently allocated
+        size_t peak = 0;        ///< High-water mark of live
+        u32 allocations = 0;    ///< Number of allocations currently alive
+        u32 failures = 0;       ///< Number of failed allocations
+    };
+
+    /** @brief Maximum number of scopes (scope 0 is global, scene N uses scope N + 1) */
+    constexpr int MAX_SCOPES = 64;
+
+    /** @brief Function called when an allocation fails
+     *  @param size Requested size
+     *  @param tag Tag of the allocation
+     *  @param region Region of the allocation
+     */
+    typedef void (*FailureHandler)(size_t size, Tag tag, Region region);
+
+    /** @brief Allocate from the heap
+     *  @param size Size in bytes
+     *  @param tag Tag of the allocation
+     *  @return Pointer (8 byte aligned) or nullptr on failure
+     */
+    void* Allocate(size_t size, Tag tag = Tag::GENERAL);
+
+    /** @brief Free memory returned by Allocate
+     *  @param pointer Pointer to free (nullptr is ignored)
+     */
+    void Free(void* pointer);
+
+    /** @brief Allocate from linear memory (for the GPU or the DSP)
+     *  @param size Size in bytes
+     *  @param tag Tag of the allocation
+     *  @param alignment Alignment (power of two)
+     *  @return Pointer or nullptr on failure
+     */
+    void* LinearAllocate(size_t size, Tag tag, size_t alignment = 0x80);
+
+    /** @brief Free memory returned by LinearAllocate
+     *  @param pointer Pointer to free (nullptr is ignored)
+     */
+    void LinearFree(void* pointer);
+
+    /** @brief Account memory allocated by a library (e.g. a texture loaded by citro2d)
+     *  @param tag Tag of the memory
+     *  @param region Region of the memory
+     *  @param bytes Bytes allocated (negative when released)
+     */
+    void Track(Tag tag, Region region, ptrdiff_t bytes);
+
+    /** @brief Set the scope receiving the following allocations
+     *  @param scope Scope index (0 for global)
+     *  @return Previous scope
+     */
+    int SetScope(int scope);
+
+    /** @brief Get the current scope
+     *  @return Scope index
+     */
+    int GetScope();
+
+    /** @brief Get counters of a tag
+     *  @param tag Tag
+     *  @param region Region
+     *  @return Counters
+     */
+    Counters GetCounters(Tag tag, Region region = Region::HEAP);
+
+    /** @brief Get counters of a scope (all tags)
+     *  @param scope Scope index
+     *  @param region Region
+     *  @return Counters
+     */
+    Counters GetScopeCounters(int scope, Region region = Region::HEAP);
+
+    /** @brief Get the bytes currently allocated in a region (all tags)
+     *  @param region Region
+     *  @return Live bytes
+     */
+    size_t GetLiveBytes(Region region = Region::HEAP);
+
+    /** @brief Get the high-water mark of a region (all tags)
+     *  @param region Region
+     *  @return Peak bytes
+     */
+    size_t GetPeakBytes(Region region = Region::HEAP);
+
+    /** @brief Reset every peak to the current live value */
+    void ResetPeaks();
+
+    /** @brief Get the name of a tag
+     *  @param tag Tag
+     *  @return Name (e.g. "SPRITE")
+     */
+    const char* GetTagName(Tag tag);
+
+    /** @brief Set the function called on allocation failure (Dump by default)
+     *  @param handler Function to call, nullptr to restore the default
+     */
+    void SetFailureHandler(FailureHandler handler);
+
+    /** @brief Get the number of heap allocations made so far
+     *  Counts Memory::Allocate calls, plus every operator new when built with CITROFLEX_DEBUG
+     *  @return Allocation count
+     */
+    u32 GetHeapAllocationCount();
+
+    /** @brief Print every counter and the free memory left
+     *  @param output File to print to
+     */
+    void Dump(FILE* output = stdout);
+
+    /** @brief STL allocator counting its memory under a tag
+     *  e.g. std::vector<Objects::Object*, Memory::Allocator<Objects::Object*, Memory::Tag::SCENE>>
+     */
+    template<typename T, Tag TAG>
+    class Allocator {
+    public:
+        typedef T value_type;
+
+        template<typename U>
+        struct rebind { typedef Allocator<U, TAG> other; };
+
+        Allocator() = default;
+
+        template<typename U>
+        Allocator(const Allocator<U, TAG>&) {}
+
+        T* allocate(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), TAG)); }
+        void deallocate(T* pointer, size_t) { Free(pointer); }
+
+        template<typename U>
+        bool operator==(const Allocator<U, TAG>&) const { return true; }
+
+        template<typename U>
+        bool operator!=(const Allocator<U, TAG>&) const { return false; }
+    };
+
+    /** @brief Linear (bump) allocator for short-lived data
+     *  Allocations are never freed one by one, everything goes away on Reset().
+     *  When the block is full, extra blocks are taken from the heap and the main block
+     *  grows to the high-water mark on the next Reset(), so a steady state never allocates.
+     */
+    class Arena {
+    private:
+        u8* block = nullptr;                ///< Main block
+        size_t capacity = 0;                ///< Size of the main block
+        size_t used = 0;                    ///< Bytes used in the main block
+        size_t overflowUsed = 0;            ///< Bytes taken from overflow blocks since Reset
+        size_t peak = 0;                    ///< Highest total usage between two resets
+        std::vector<void*> overflow;        ///< Extra blocks allocated when the main block was full
+        Tag tag;                            ///< Tag of the blocks
+
+    public:
+        /** @brief Constructor
+         *  @param capacity Initial size of the main block
+         *  @param tag Tag used to count the blocks
+         */
+        explicit Arena(size_t capacity = 64 * 1024, Tag tag = Tag::GENERAL);
+
+        /** @brief Destructor - frees every block */
+        ~Arena();
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        /** @brief Allocate memory valid until the next Reset()
+         *  @param size Size in bytes
+         *  @param alignment Alignment (power of two)
+         *  @return Pointer or nullptr if the heap is exhausted
+         */
+        void* Allocate(size_t size, size_t alignment = 8);
+
+        /** @brief Allocate an uninitialized array valid until the next Reset()
+         *  @param count Number of elements
+         *  @return Pointer to the first element
+         */
+        template<typename T>
+        T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+
+        /** @brief Release every allocation at once */
+        void Reset();
+
+        /** @brief Get the bytes used since the last Reset
+         *  @return Used bytes
+         */
+        size_t GetUsed() const { return used + overflowUsed; }
+
+        /** @brief Get the highest usage between two resets
+         *  @return Peak bytes
+         */
+        size_t GetPeak() const { return peak; }
+
+        /** @brief Get the size of the main block
+         *  @return Capacity in bytes
+         */
+        size_t GetCapacity() const { return capacity; }
+    };
+
+    /** @brief STL allocator taking its memory from an Arena (deallocate does nothing) */
+    template<typename T>
+    class ArenaAllocator {
+    public:
+        typedef T value_type;
+
+        Arena* arena;   ///< Arena providing the memory
+
+        ArenaAllocator(Arena& arena) : arena(&arena) {}
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+        T* allocate(size_t count) { return arena->AllocateArray<T>(count); }
+        void deallocate(T*, size_t) {}
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+    };
+
+    /** @brief Vector living in an Arena, valid until the arena is reset */
+    template<typename T>
+    using ScratchVector = std::vector<T, ArenaAllocator<T>>;
+
+    /** @brief Create a scratch vector with reserved capacity
+     *  @param arena Arena providing the memory
+     *  @param reserve Number of elements to reserve
+     *  @return Empty vector
+     */
+    template<typename T>
+    ScratchVector<T> MakeScratchVector(Arena& arena, size_t reserve = 0) {
+        ScratchVector<T> vector{ ArenaAllocator<T>(arena) };
+        vector.reserve(reserve);
+        return vector;
+    }
+}
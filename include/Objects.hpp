@@ -12,15 +12,62 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <citro2d.h>
 #include <citro3d.h>
 
 #include "Colors.hpp"
 #include "Input.hpp"
+#include "Render.hpp"
+#include "Math.hpp"
+#include "Memory.hpp"
 namespace Scene { class Scene; }  // Forward declaration
 
 namespace Objects
 {
+    /** @brief Built-in type of an object, lets the scene draw runs of shapes without virtual calls */
+    enum class ObjectKind : u8 {
+        CUSTOM,     ///< User type deriving directly from Object
+        RECTANGLE,
+        LINE,
+        CIRCLE,
+        ELLIPSE,
+        SPRITE
+    };
+
+    constexpr u32 OBJECT_KIND_COUNT = (u32)ObjectKind::SPRITE + 1;   ///< Number of ObjectKind values
+    constexpr u32 MAX_TAGS = 32;                                    ///< Tags that can be registered
+
+    typedef u32 NameId;     ///< Interned object name (0: unnamed)
+    typedef u32 TagMask;    ///< Set of tags, one bit per tag returned by RegisterTag
+
+    /** @brief Get the id of a name, adding it to the name table the first time
+     *  @param name Name (nullptr or empty gives 0)
+     *  @return Id shared by every object with this name
+     */
+    NameId InternName(const char* name);
+
+    /** @brief Get the id of a name without adding it (lookups of unknown names)
+     *  @return Id or 0 if no object was ever given this name
+     */
+    NameId FindName(const char* name);
+
+    /** @brief Get the text of an interned name
+     *  @return Name ("" for 0 or an unknown id)
+     */
+    const char* GetNameString(NameId id);
+
+    /** @brief Get the bit of a tag, registering it the first time
+     *  @param name Tag name (e.g. "enemy")
+     *  @return Tag bit or 0 when MAX_TAGS tags are already registered
+     */
+    TagMask RegisterTag(const char* name);
+
+    /** @brief Get the bit of a registered tag
+     *  @return Tag bit or 0 if the tag was never registered
+     */
+    TagMask FindTag(const char* name);
+
     /** @brief Base abstract class for all Scene objects
      *  Cannot be instantiated directly due to pure virtual methods
      */
@@ -32,6 +79,29 @@ namespace Objects
         double relativeY = 0;  ///< Relative Y position when attached to parent
         Scene::Scene* currentScene = nullptr;  ///< Pointer to current scene
         Input::InputManager* inputManager = nullptr;  ///< Pointer to input manager
+        bool hasLogic = true;  ///< The type overrides OnUpdate (see DetectOverrides)
+        bool customDraw = false;  ///< The type overrides Update or Draw of its built-in shape
+        s16 layer = 0;         ///< Draw layer, higher layers are drawn on top
+        float z = 0;           ///< Draw order inside the layer, higher is drawn on top
+        NameId nameId = 0;     ///< Interned name (indexed by the scene)
+        TagMask tags = 0;      ///< Tags (indexed by the scene)
+
+        /** @brief Texture cache owned by the object (copies of the object start without one) */
+        struct CacheOwner {
+            Render::TextureCache* cache = nullptr;
+            CacheOwner() = default;
+            CacheOwner(const CacheOwner&) {}
+            CacheOwner& operator=(const CacheOwner&) { return *this; }
+            ~CacheOwner() { delete cache; }
+        };
+
+        CacheOwner renderCache;         ///< Set by SetCached
+        u32 cachedFrame = 0;            ///< Cache frame of the scene when a cached ancestor recorded this object
+
+        /** @brief Record the attached elements into a cache (parents first, then in attach order)
+         *  @param frame Cache frame of the scene, 0 to clear the marks
+         */
+        void RecordAttached(u32 frame);
 
         /** @brief Sets the relative position of the object
          *  @param x: X position
@@ -41,9 +111,28 @@ namespace Objects
 
 	public:
         bool visible = true;
+        bool threadSafe = false;    // OnUpdate can run on a worker thread (see Scene::Update)
+        float depth = 0;            // Stereoscopic depth, positive comes out of the screen (in pixels at full 3D)
         std::vector<Objects::Object *> attachedElements;
         Object *parent = nullptr;
 		int id = -1;	// ID given by the scene (-1: Not bound to a scene)
+
+        Object() = default;
+
+        /** @brief Copy an object
+         *  The copy has the same position, name, tags and draw order but belongs to no scene and
+         *  has no parent, attached elements or texture cache: add it with Scene::AddElement
+         *  @param other Object to copy
+         */
+        Object(const Object& other);
+
+        /** @brief Copy the state of another object
+         *  This object keeps its scene, parent, attached elements and texture cache; the scene's
+         *  indexes and draw order follow the copied name, tags, layer and z
+         *  @param other Object to copy
+         *  @return This object
+         */
+        Object& operator=(const Object& other);
         
         /** @brief Get the X position
          *  @return Current X position
@@ -75,6 +164,121 @@ namespace Objects
          */
         void AddY(double add_y);
 
+        /** @brief Get the position
+         *  @return Current position
+         */
+        Math::Vec2d GetPosition() const { return Math::Vec2d(x, y); }
+
+        /** @brief Set both coordinates (attached elements are updated once)
+         *  @param new_x New X position
+         *  @param new_y New Y position
+         */
+        void SetPosition(double new_x, double new_y);
+
+        /** @brief Set the position from any Math vector (float, double or fixed-point)
+         *  @param position New position
+         */
+        template<typename T>
+        void SetPosition(const Math::Vec2<T>& position) {
+            SetPosition(static_cast<double>(position.x), static_cast<double>(position.y));
+        }
+
+        /** @brief Move by any Math vector (float, double or fixed-point)
+         *  @param offset Offset to add
+         */
+        template<typename T>
+        void Move(const Math::Vec2<T>& offset) {
+            SetPosition(x + static_cast<double>(offset.x), y + static_cast<double>(offset.y));
+        }
+
+        /** @brief Get the draw layer
+         *  @return Layer (higher is drawn on top)
+         */
+        s16 GetLayer() const { return layer; }
+
+        /** @brief Set the draw layer (the scene sorts again on its next frame)
+         *  @param newLayer Layer, objects of a layer are drawn above every lower layer
+         */
+        void SetLayer(s16 newLayer);
+
+        /** @brief Get the draw order inside the layer
+         *  @return Z value (higher is drawn on top)
+         */
+        float GetZ() const { return z; }
+
+        /** @brief Set the draw order inside the layer (the scene sorts again on its next frame)
+         *  Objects with equal layer and z keep the order in which they were added
+         *  @param newZ Z value
+         */
+        void SetZ(float newZ);
+
+        /** @brief Get the built-in type of the object
+         *  @return Kind (subclasses of the shapes keep the kind of their shape)
+         */
+        ObjectKind GetKind() const { return kind; }
+
+        /** @brief Set the name (the scene's name index follows, see Scene::FindByName)
+         *  @param name Name, several objects may share one (nullptr or empty clears it)
+         */
+        void SetName(const char* name) { SetNameId(InternName(name)); }
+
+        /** @brief Set the name from an interned id
+         *  @param id Id from InternName (0 clears the name)
+         */
+        void SetNameId(NameId id);
+
+        /** @brief Get the interned name
+         *  @return Id (0 if unnamed)
+         */
+        NameId GetNameId() const { return nameId; }
+
+        /** @brief Get the name
+         *  @return Name ("" if unnamed)
+         */
+        const char* GetName() const { return GetNameString(nameId); }
+
+        /** @brief Replace the tags (the scene's tag index follows, see Scene::ForEachTagged)
+         *  @param mask Tag bits from RegisterTag
+         */
+        void SetTags(TagMask mask);
+
+        /** @brief Add tags
+         *  @param mask Tag bits from RegisterTag
+         */
+        void AddTags(TagMask mask) { SetTags(tags | mask); }
+
+        /** @brief Remove tags
+         *  @param mask Tag bits from RegisterTag
+         */
+        void RemoveTags(TagMask mask) { SetTags(tags & ~mask); }
+
+        /** @brief Get the tags
+         *  @return Tag bits
+         */
+        TagMask GetTags() const { return tags; }
+
+        /** @brief Check if the object has every tag of a mask */
+        bool HasTags(TagMask mask) const { return (tags & mask) == mask; }
+
+        /** @brief Check if the object has at least one tag of a mask */
+        bool HasAnyTag(TagMask mask) const { return (tags & mask) != 0; }
+
+        /** @brief Check if OnUpdate does something
+         *  @return false once the object is known not to override OnUpdate
+         */
+        bool HasLogic() const { return hasLogic; }
+
+        /** @brief Check if a subclass of a built-in shape replaces its Update or Draw
+         *  @return true if the scene must draw the object with virtual calls
+         */
+        bool HasCustomDraw() const { return customDraw; }
+
+        /** @brief Look up which virtual functions the type of the object overrides (called by Scene::AddElement)
+         *  Types that do not override OnUpdate are never called for it, built-in shapes whose Update
+         *  and Draw are not overridden are drawn in batches (see Scene::SetShapeBatching)
+         */
+        void DetectOverrides();
+
         /** @brief Initialize the object
          */
         virtual void Init();
@@ -84,11 +288,63 @@ namespace Objects
          */
         virtual void Update(Scene::Scene* scene);
 
+        /** @brief Run the custom update logic only, without drawing
+         *  @param scene Pointer to the current scene
+         *  @note Called from worker threads for thread-safe objects
+         */
+        void UpdateLogic(Scene::Scene* scene) { if (hasLogic) OnUpdate(scene); }
+
+        /** @brief Draw the object (called by Update when the object is visible)
+         *  Overrides should draw through Render (Render::Rect, Render::Image...): direct C2D_Draw*
+         *  calls are not recorded, so they miss the right eye in stereo and the texture of a cached object.
+         */
+        virtual void Draw() {}
+
+        /** @brief Draw the object as the scene does: from its texture cache, not at all when a cached
+         *  ancestor already drew it, or with Draw when visible
+         */
+        void DrawInScene();
+
+        /** @brief Render this object and its attached elements into a texture, then draw that texture
+         *  instead while nothing in the subtree changes
+         *  Before each frame the scene records the subtree's draws (without drawing) and renders the
+         *  texture again only when they differ from the cached ones, so changes of any descendant are
+         *  picked up; moving the whole subtree keeps the texture. Worth it for static groups of many
+         *  shapes or sprites (decor, tile chunks, UI panels).
+         *  @note The subtree is drawn at this object's place in the draw order and at its depth;
+         *  attached elements must be in the same scene, and custom Draw overrides must draw through
+         *  the Render functions. Changes made by OnUpdate show one frame later.
+         *  @note Falls back to normal drawing when the subtree is larger than 1024x1024 or VRAM runs out
+         *  @param enabled Enable the cache (disabling frees the texture)
+         */
+        void SetCached(bool enabled);
+
+        /** @brief Check if the object has a texture cache */
+        bool IsCached() const { return renderCache.cache != nullptr; }
+
+        /** @brief Get the texture cache (hits, rebuilds, memory)
+         *  @return Cache or nullptr
+         */
+        Render::TextureCache* GetRenderCache() const { return renderCache.cache; }
+
+        /** @brief Render the cache again next frame (e.g. after a sprite sheet was reloaded in place) */
+        void InvalidateCache() { if (renderCache.cache) renderCache.cache->Invalidate(); }
+
+        /** @brief Check if a cached ancestor draws this object this frame */
+        bool IsDrawnByCache() const;
+
+        /** @brief Check if the object has a cache or is drawn by one (the scene then skips direct draws) */
+        bool UsesRenderCache() const { return renderCache.cache || (cachedFrame != 0 && IsDrawnByCache()); }
+
+        /** @brief Record the subtree and update the texture cache (called by the scene before drawing) */
+        void UpdateCache();
+
         /** @brief Updates the objects attached to this instance
          */
         void UpdateAttached();
 
         /** @brief Attach an object to this object and set its relative position
+         *  Attaching an attached object moves it to this parent or only updates its relative position
          *  @param obj: Object instance to attach
          */
         void Attach(Object *obj);
@@ -111,10 +367,14 @@ namespace Objects
         }
 
     protected:
+        ObjectKind kind = ObjectKind::CUSTOM;  ///< Set by the constructor of the built-in shapes (kept by subclasses)
+
         /** @brief Custom update logic (can be override to add custom logic before Drawing)
          *  @param scene: Scene instance
+         *  @note If threadSafe is set this may run on a worker thread: it must only modify this
+         *  object (and its attached children) and must not draw or load scenes
          */
-        virtual void OnUpdate( Scene::Scene* scene ) {};
+        virtual void OnUpdate( Scene::Scene* scene ) {}
 
         /** @brief Getter for the InputManager
          *  @return InputManager instance
@@ -133,10 +393,18 @@ namespace Objects
         double height = 10;   ///< Height of the rectangle
         u32 color = Colors::clrWhite;  ///< Color of the rectangle
 
-        /** @brief Update and draw the rectangle
-         *  @param scene Pointer to the current scene
+        static constexpr ObjectKind KIND = ObjectKind::RECTANGLE;  ///< Kind of the type (see Cast)
+
+        Rectangle() { kind = KIND; }
+
+        /** @brief Update and draw
+         *  @param scene Current scene
+         */
+        void Update(Scene::Scene* scene) override final { Object::Update(scene); }
+
+        /** @brief Draw the rectangle
          */
-        virtual void Update(Scene::Scene* scene) override final;
+        virtual void Draw() override;
     };
     
     /** @brief Line object
@@ -150,10 +418,18 @@ namespace Objects
         u32 color = Colors::clrWhite;  ///< Color of the line
         float thickness = 1.0f;        ///< Thickness of the line
 
-        /** @brief Update and draw the line
-         *  @param scene Pointer to the current scene
+        static constexpr ObjectKind KIND = ObjectKind::LINE;  ///< Kind of the type (see Cast)
+
+        Line() { kind = KIND; }
+
+        /** @brief Update and draw
+         *  @param scene Current scene
          */
-        virtual void Update(Scene::Scene* scene) override;
+        void Update(Scene::Scene* scene) override { Object::Update(scene); }
+
+        /** @brief Draw the line
+         */
+        virtual void Draw() override;
 
         /** @brief Set the end point of the line
          *  @param x End X position
@@ -169,10 +445,18 @@ namespace Objects
         double radius = 10;   ///< Radius of the circle
         u32 color = Colors::clrWhite;  ///< Color of the circle
 
-        /** @brief Update and draw the circle
-         *  @param scene Pointer to the current scene
+        static constexpr ObjectKind KIND = ObjectKind::CIRCLE;  ///< Kind of the type (see Cast)
+
+        Circle() { kind = KIND; }
+
+        /** @brief Update and draw
+         *  @param scene Current scene
          */
-        void Update(Scene::Scene* scene) override;
+        void Update(Scene::Scene* scene) override { Object::Update(scene); }
+
+        /** @brief Draw the circle
+         */
+        void Draw() override;
     };
 
     /** @brief Ellipse shape object
@@ -183,33 +467,125 @@ namespace Objects
         double height = 10;   ///< Height of the ellipse
         u32 color = Colors::clrWhite;  ///< Color of the ellipse
 
-        /** @brief Update and draw the ellipse
-         *  @param scene Pointer to the current scene
+        static constexpr ObjectKind KIND = ObjectKind::ELLIPSE;  ///< Kind of the type (see Cast)
+
+        Ellipse() { kind = KIND; }
+
+        /** @brief Update and draw
+         *  @param scene Current scene
+         */
+        void Update(Scene::Scene* scene) override { Object::Update(scene); }
+
+        /** @brief Draw the ellipse
+         */
+        virtual void Draw() override;
+    };
+
+    /** @brief Sprite sheet shared by every sprite drawing it
+     *  Loaded once per path and reference counted: Sprite and SpriteBatch only keep a pointer to it,
+     *  so a thousand sprites of one sheet hold one texture.
+     */
+    class SpriteDef {
+    public:
+        /** @brief One image of the sheet */
+        struct Frame {
+            C2D_Image image;    ///< Image in the sheet
+            float width;        ///< Size in pixels
+            float height;
+        };
+
+    private:
+        C2D_SpriteSheet sheet = nullptr;    ///< Loaded sheet
+        size_t sheetBytes = 0;              ///< Linear memory used by the sheet (counted as Memory::Tag::SPRITE)
+        std::vector<Frame> frames;          ///< Images of the sheet
+        std::string path;                   ///< Path given to Load
+        u32 references = 0;                 ///< Sprites and batches using the definition
+
+        SpriteDef(const char* sheetPath) : path(sheetPath) {}
+        ~SpriteDef();
+
+        /** @brief Replace the sheet with the file at path (kept on failure) */
+        bool LoadSheet();
+
+    public:
+        float centerX = 0.5f;   ///< Pivot as a fraction of the frame size (rotation and position)
+        float centerY = 0.5f;
+
+        SpriteDef(const SpriteDef&) = delete;
+        SpriteDef& operator=(const SpriteDef&) = delete;
+
+        /** @brief Get the definition of a sheet, loading it the first time (from a mounted pack if one has it)
+         *  @param path Path of the .t3x sheet
+         *  @return Definition with one more reference (Release it) or nullptr if the sheet cannot be loaded
          */
-        virtual void Update(Scene::Scene* scene) override;
+        static SpriteDef* Load(const char* path);
+
+        /** @brief Find a loaded definition
+         *  @param path Path given to Load
+         *  @return Definition (no reference taken) or nullptr
+         */
+        static SpriteDef* Find(const char* path);
+
+        /** @brief Take a reference */
+        void Retain() { references++; }
+
+        /** @brief Drop a reference, the last one frees the sheet */
+        void Release();
+
+        /** @brief Load the sheet again from its file (hot-reload), every user sees the new images
+         *  @return false if the file cannot be loaded (the old sheet stays)
+         */
+        bool Reload();
+
+        /** @brief Get the number of frames */
+        u32 GetFrameCount() const { return frames.size(); }
+
+        /** @brief Get a frame
+         *  @return Frame or nullptr if index is out of range
+         */
+        const Frame* GetFrame(u32 index) const { return index < frames.size() ? &frames[index] : nullptr; }
+
+        /** @brief Get the path of the sheet */
+        const std::string& GetPath() const { return path; }
+
+        /** @brief Get the linear memory used by the sheet in bytes */
+        size_t GetMemory() const { return sheetBytes; }
     };
 
     /** @brief Sprite object for displaying images
+     *  Holds only its frame and angle; the sheet is a shared SpriteDef
      */
     class Sprite : public Object {
     private:
-        C2D_SpriteSheet spriteSheet = nullptr;  ///< Sprite sheet containing the image
-        C2D_Sprite sprite;                      ///< Sprite instance
-        int frameIndex = 0;                     ///< Current frame index
-        double angle = 0;                       ///< Rotation angle
+        SpriteDef* def = nullptr;   ///< Shared sheet (one reference)
+        int frameIndex = 0;         ///< Current frame index
+        float angle = 0;            ///< Rotation angle in degrees
+        float radians = 0;          ///< Rotation angle in radians, computed when the angle changes
 
     public:
         float width = 0;   ///< Width of the sprite
         float height = 0;  ///< Height of the sprite
 
+        static constexpr ObjectKind KIND = ObjectKind::SPRITE;  ///< Kind of the type (see Cast)
+
+        Sprite() { kind = KIND; }
+
+        /** @brief Copy (shares the definition) */
+        Sprite(const Sprite& other);
+        Sprite& operator=(const Sprite& other);
+
         /** @brief Destructor
          */
         ~Sprite();
 
-        /** @brief Update and draw the sprite
-         *  @param scene Pointer to the current scene
+        /** @brief Update and draw
+         *  @param scene Current scene
+         */
+        void Update(Scene::Scene* scene) override { Object::Update(scene); }
+
+        /** @brief Draw the sprite
          */
-        virtual void Update(Scene::Scene* scene) override;
+        virtual void Draw() override;
 
         /** @brief Get the current rotation angle
          *  @return Current angle in degrees
@@ -226,15 +602,121 @@ namespace Objects
          */
         void AddAngle(double add_angle);
 
-        /** @brief Load a sprite from a file
+        /** @brief Load a sprite from a file (from a mounted pack if one has it, see Pack::Mount)
+         *  Sprites loading the same path share one SpriteDef
          *  @param path Path to the image file
          *  @return true if loading succeeded, false otherwise
          */
         bool LoadFromFile(const char* path);
 
+        /** @brief Use a loaded definition
+         *  @param definition Definition (a reference is taken) or nullptr
+         */
+        void SetDef(SpriteDef* definition);
+
+        /** @brief Get the definition
+         *  @return Definition or nullptr
+         */
+        SpriteDef* GetDef() const { return def; }
+
         /** @brief Set the current frame of the sprite
          *  @param index Index of the frame to display
          */
         void SetFrame(int index);
     };
+
+    /** @brief Sprite drawn by a SpriteBatch: only what differs between instances, in 20 bytes */
+    struct SpriteInstance {
+        /** @brief Flags */
+        enum Flags : u8 {
+            VISIBLE = 1 << 0,
+            FLIP_X = 1 << 1,        ///< Mirrored horizontally
+            FLIP_Y = 1 << 2         ///< Mirrored vertically
+        };
+
+        float x = 0;                ///< Position of the pivot relative to the batch
+        float y = 0;
+        u32 tint = 0xFFFFFFFF;      ///< Tint color (C2D_Color32), its alpha fades the sprite
+        u16 angle = 0;              ///< Rotation, 65536 is a full turn (see Math::DegToAngle)
+        u16 frame = 0;              ///< Frame of the batch's SpriteDef
+        u16 scale = 256;            ///< Scale in 8.8 fixed point (256 is 1)
+        u8 blend = 0;               ///< Strength of the tint color, 0 keeps the image colors
+        u8 flags = VISIBLE;         ///< Flags
+    };
+    static_assert(sizeof(SpriteInstance) == 20, "SpriteInstance layout changed");
+
+    /** @brief Many sprites of one SpriteDef as a single object
+     *  Instances are plain structs in one array, drawn in one pass computing their draw parameters;
+     *  tens of thousands fit where Sprite objects (each a full Object) would not.
+     *  Instances are indexed by position: Remove moves the last one into the hole.
+     */
+    class SpriteBatch : public Object {
+    private:
+        SpriteDef* def = nullptr;   ///< Shared sheet (one reference)
+        std::vector<SpriteInstance, Memory::Allocator<SpriteInstance, Memory::Tag::SPRITE>> instances;  ///< Sprites
+
+    public:
+        SpriteBatch() = default;
+
+        /** @brief Destructor (releases the definition) */
+        ~SpriteBatch();
+
+        SpriteBatch(const SpriteBatch&) = delete;
+        SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+        /** @brief Draw every visible instance
+         */
+        void Draw() override;
+
+        /** @brief Load the sheet of the instances (shared with sprites of the same path)
+         *  @param path Path to the image file
+         *  @return true if loading succeeded, false otherwise
+         */
+        bool LoadFromFile(const char* path);
+
+        /** @brief Use a loaded definition
+         *  @param definition Definition (a reference is taken) or nullptr
+         */
+        void SetDef(SpriteDef* definition);
+
+        /** @brief Get the definition
+         *  @return Definition or nullptr
+         */
+        SpriteDef* GetDef() const { return def; }
+
+        /** @brief Add an instance
+         *  @param instance Instance to copy
+         *  @return Index of the instance
+         */
+        u32 Add(const SpriteInstance& instance) { instances.push_back(instance); return instances.size() - 1; }
+
+        /** @brief Remove an instance, the last one takes its index
+         *  @param index Index of the instance
+         */
+        void Remove(u32 index);
+
+        /** @brief Remove every instance (keeps the memory) */
+        void Clear() { instances.clear(); }
+
+        /** @brief Reserve memory for a number of instances */
+        void Reserve(size_t count) { instances.reserve(count); }
+
+        /** @brief Get the number of instances */
+        size_t Size() const { return instances.size(); }
+
+        /** @brief Get an instance to modify it */
+        SpriteInstance& operator[](u32 index) { return instances[index]; }
+        const SpriteInstance& operator[](u32 index) const { return instances[index]; }
+
+        /** @brief Get every instance */
+        SpriteInstance* Data() { return instances.data(); }
+    };
+
+    /** @brief Downcast to a built-in type by its kind (no RTTI needed)
+     *  @return The object as T or nullptr if it is not a T (or a subclass of T)
+     */
+    template<typename T>
+    T* Cast(Object* object) {
+        return object && object->GetKind() == T::KIND ? static_cast<T*>(object) : nullptr;
+    }
 } // namespace Objects
@@ -0,0 +1,139 @@
+/**
+ * @file Pack.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex asset pack reader
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include "PackFormat.hpp"
+#include "Memory.hpp"
+
+/**
+ * @namespace Pack
+ * @brief Assets read from .cfp pack files (built by tools/packc.cpp)
+ * Reading fewer bytes from the SD card or romfs is what makes loading faster: entries are LZ4
+ * compressed and decompressed chunk by chunk straight into their destination buffer.
+ * Mounted packs are searched by ReadFile, which Sprite::LoadFromFile and SceneFile::Load use,
+ * so assets move into a pack without changing the paths in the game code.
+ */
+namespace Pack {
+    /** @brief Decompress an LZ4 block
+     *  @param source Compressed block
+     *  @param sourceSize Size of the block
+     *  @param destination Output buffer
+     *  @param capacity Size of the output buffer
+     *  @return Number of bytes written, -1 if the block is malformed or does not fit
+     */
+    int DecompressBlock(const u8* source, size_t sourceSize, u8* destination, size_t capacity);
+
+    /** @brief An open pack file
+     *  The header, entry table and names are read once by Open; the file stays open for the reads.
+     *  Reads are serialized, so loading threads can share a pack.
+     */
+    class PackFile {
+    private:
+        FILE* file = nullptr;                           ///< Open pack
+        u8* table = nullptr;                            ///< Header, entries and names (Memory::Allocate)
+        const PackFormat::EntryRecord* entries = nullptr; ///< Entries sorted by hash
+        const char* names = nullptr;                    ///< Name table
+        u32 entryCount = 0;                             ///< Number of entries
+        u32 chunkSize = 0;                              ///< Uncompressed size of a chunk
+        u32 dataEnd = 0;                                ///< Size of the file
+        std::vector<u8> staging;                        ///< Compressed chunk being decompressed
+        std::vector<u32> chunkSizes;                    ///< Chunk table of the entry being read
+        LightLock lock;                                 ///< Serializes reads
+        std::string path;                               ///< Path given to Open
+
+        /** @brief Read an entry (lock held) */
+        bool ReadLocked(const PackFormat::EntryRecord* entry, u8* destination);
+
+    public:
+        /** @brief Constructor */
+        PackFile();
+
+        /** @brief Destructor (closes the pack) */
+        ~PackFile();
+
+        PackFile(const PackFile&) = delete;
+        PackFile& operator=(const PackFile&) = delete;
+
+        /** @brief Open a pack and read its table of contents
+         *  @param filePath Path of the .cfp file
+         *  @return false if the file cannot be read or is not a valid pack
+         */
+        bool Open(const char* filePath);
+
+        /** @brief Close the pack (unmount it first) */
+        void Close();
+
+        /** @brief Check if a pack is open */
+        bool IsOpen() const { return file != nullptr; }
+
+        /** @brief Get the path given to Open */
+        const std::string& GetPath() const { return path; }
+
+        /** @brief Find an entry by name (binary search on the name hash)
+         *  @return Entry or nullptr
+         */
+        const PackFormat::EntryRecord* Find(const char* name) const;
+
+        /** @brief Get the number of entries */
+        u32 GetEntryCount() const { return entryCount; }
+
+        /** @brief Get an entry by index (sorted by hash) */
+        const PackFormat::EntryRecord* GetEntry(u32 index) const { return index < entryCount ? &entries[index] : nullptr; }
+
+        /** @brief Get the name of an entry */
+        const char* GetName(const PackFormat::EntryRecord* entry) const { return names + entry->name; }
+
+        /** @brief Decompress an entry into a buffer
+         *  @param entry Entry of this pack
+         *  @param destination Buffer of at least capacity bytes
+         *  @param capacity Size of the buffer (must hold entry->size bytes)
+         *  @return false on a read error, a corrupted entry or a buffer too small
+         */
+        bool Read(const PackFormat::EntryRecord* entry, void* destination, size_t capacity);
+
+        /** @brief Decompress an entry into a new buffer
+         *  @param entry Entry of this pack
+         *  @param tag Tag of the allocation
+         *  @param linear Allocate from linear memory (128 byte aligned, for the GPU or the DSP)
+         *  @return Buffer of entry->size bytes (Memory::Free or Memory::LinearFree it) or nullptr
+         */
+        void* ReadAlloc(const PackFormat::EntryRecord* entry, Memory::Tag tag = Memory::Tag::GENERAL, bool linear = false);
+    };
+
+    /** @brief Search a pack in ReadFile (last mounted first)
+     *  The pack must stay open until it is unmounted.
+     */
+    void Mount(PackFile* pack);
+
+    /** @brief Stop searching a pack */
+    void Unmount(PackFile* pack);
+
+    /** @brief Find a file in the mounted packs
+     *  @param path Name of the entry (the path given to packc, e.g. "romfs:/gfx/coin.t3x")
+     *  @param entry Receives the entry
+     *  @return Pack holding the entry or nullptr
+     */
+    PackFile* FindMounted(const char* path, const PackFormat::EntryRecord** entry);
+
+    /** @brief Read a whole file from the mounted packs, or from the file system if no pack has it
+     *  @param path Path of the file
+     *  @param size Receives the size of the file
+     *  @param tag Tag of the allocation
+     *  @param linear Allocate from linear memory (128 byte aligned)
+     *  @return Buffer (Memory::Free or Memory::LinearFree it) or nullptr on failure
+     */
+    void* ReadFile(const char* path, size_t& size, Memory::Tag tag = Memory::Tag::GENERAL, bool linear = false);
+}
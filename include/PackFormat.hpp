@@ -0,0 +1,88 @@
+/**
+ * @file PackFormat.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex asset pack file layout
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @namespace PackFormat
+ * @brief Layout of .cfp pack files
+ * Only plain structs and inline functions so the host packer (tools/packc.cpp) can include this file.
+ * Every value is little-endian:
+ *
+ *     FileHeader | EntryRecord[entryCount] (sorted by hash) | names | entry data...
+ *
+ * Each entry's data starts on an ALIGNMENT boundary. A compressed entry is a table of uint32_t
+ * chunk sizes followed by the chunks: every chunk but the last holds chunkSize bytes once
+ * decompressed, and is an independent LZ4 block, or stored as is when STORED_CHUNK is set in its size.
+ */
+namespace PackFormat {
+    /** @brief "CFPK" */
+    constexpr uint32_t MAGIC = 0x4B504643;
+
+    /** @brief Current version, files with another version are rejected */
+    constexpr uint16_t VERSION = 1;
+
+    /** @brief Alignment of entry data in the file */
+    constexpr uint32_t ALIGNMENT = 128;
+
+    /** @brief Default uncompressed size of a chunk */
+    constexpr uint32_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    /** @brief Set in a chunk size when the chunk is not compressed */
+    constexpr uint32_t STORED_CHUNK = 0x80000000;
+
+    /** @brief Entry flags */
+    enum EntryFlags : uint32_t {
+        FLAG_COMPRESSED = 1 << 0    ///< Chunked LZ4, otherwise the data is stored as is
+    };
+
+    /** @brief File header */
+    struct FileHeader {
+        uint32_t magic;             ///< MAGIC
+        uint16_t version;           ///< VERSION
+        uint16_t headerSize;        ///< sizeof(FileHeader)
+        uint32_t entryCount;        ///< Number of EntryRecord
+        uint32_t entriesOffset;     ///< Offset of the EntryRecord array
+        uint32_t namesOffset;       ///< Offset of the name table (null-terminated strings)
+        uint32_t namesSize;         ///< Size of the name table
+        uint32_t chunkSize;         ///< Uncompressed size of a chunk
+        uint32_t fileSize;          ///< Size of the whole file
+    };
+
+    /** @brief One asset */
+    struct EntryRecord {
+        uint32_t hash;              ///< HashName of the name
+        uint32_t name;              ///< Offset of the name in the name table
+        uint32_t flags;             ///< EntryFlags
+        uint32_t offset;            ///< Offset of the data (multiple of ALIGNMENT)
+        uint32_t storedSize;        ///< Size of the data in the file
+        uint32_t size;              ///< Size once decompressed
+    };
+
+    /** @brief FNV-1a hash of an entry name */
+    inline uint32_t HashName(const char* name) {
+        uint32_t hash = 2166136261u;
+        while (*name) {
+            hash = (hash ^ (uint8_t)*name++) * 16777619u;
+        }
+        return hash;
+    }
+
+    /** @brief Number of chunks of a compressed entry */
+    inline uint32_t ChunkCount(uint32_t size, uint32_t chunkSize) {
+        return (size + chunkSize - 1) / chunkSize;
+    }
+
+    static_assert(sizeof(FileHeader) == 32, "FileHeader layout changed");
+    static_assert(sizeof(EntryRecord) == 24, "EntryRecord layout changed");
+}
@@ -0,0 +1,331 @@
+/**
+ * @file Pathfinding.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex grid pathfinding
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include "Jobs.hpp"
+
+/**
+ * @namespace Pathfinding
+ * @brief Paths over a tile grid computed off the game logic
+ * Movement is 8-directional without cutting corners: a diagonal step needs both orthogonal
+ * neighbours to be walkable. Straight steps cost 10, diagonal ones 14.
+ */
+namespace Pathfinding {
+    /** @brief Tile coordinates */
+    struct Point {
+        s16 x;  ///< Column
+        s16 y;  ///< Row
+    };
+
+    /** @brief Search algorithm */
+    enum class Algorithm : u8 {
+        ASTAR,  ///< A* over every tile
+        JPS     ///< Jump point search (same paths, far fewer nodes on open maps)
+    };
+
+    /** @brief Handle to a queued request (0 is invalid) */
+    typedef u32 RequestId;
+
+    /** @brief Function receiving the result of a request
+     *  @param id Request
+     *  @param path Tiles from start to goal, both included (valid during the call only)
+     *  @param length Number of tiles, 0 if there is no path
+     *  @param userData Pointer given to the request
+     */
+    typedef void (*PathCallback)(RequestId id, const Point* path, u32 length, void* userData);
+
+    /** @brief Counters since the last ResetStats */
+    struct Stats {
+        u32 requests = 0;       ///< Requests queued
+        u32 cacheHits = 0;      ///< Requests answered from the cache
+        u32 searches = 0;       ///< Searches completed
+        u32 expanded = 0;       ///< Nodes expanded by the searches
+        u32 restarts = 0;       ///< Searches restarted because tiles changed
+        u64 ticks = 0;          ///< CPU ticks spent searching on the main thread
+    };
+
+    /** @brief Walkable tiles, with change counters per 16×16 region for cache validation */
+    class Grid {
+    private:
+        u16 width = 0;                  ///< Tiles per row
+        u16 height = 0;                 ///< Rows
+        u16 regionsX = 0;               ///< Regions per row
+        std::vector<u8> blocked;        ///< 1 for walls
+        std::vector<u32> regionVersions; ///< Incremented when a tile near the region changes
+        u32 version = 0;                ///< Incremented on every change
+
+    public:
+        static constexpr int REGION_SHIFT = 4;  ///< Regions are 16×16 tiles
+
+        /** @brief Resize the grid, every tile walkable (invalidates everything) */
+        void Resize(u16 newWidth, u16 newHeight);
+
+        /** @brief Get the number of columns */
+        u16 GetWidth() const { return width; }
+
+        /** @brief Get the number of rows */
+        u16 GetHeight() const { return height; }
+
+        /** @brief Check if a tile can be walked on (false outside the grid) */
+        bool IsWalkable(int x, int y) const {
+            return (unsigned)x < width && (unsigned)y < height && !blocked[y * width + x];
+        }
+
+        /** @brief Change a tile
+         *  Cached paths through the region of the tile or the 8 around it are invalidated, failed
+         *  searches by any change. Paths elsewhere stay valid, though an opening far from them can
+         *  make them longer than the new shortest path. Use PathService::SetWalkable once queries run.
+         */
+        void SetWalkable(int x, int y, bool walkable);
+
+        /** @brief Get the region of a tile */
+        u32 GetRegion(int x, int y) const { return (y >> REGION_SHIFT) * regionsX + (x >> REGION_SHIFT); }
+
+        /** @brief Get the change counter of a region */
+        u32 GetRegionVersion(u32 region) const { return regionVersions[region]; }
+
+        /** @brief Get the change counter of the whole grid */
+        u32 GetVersion() const { return version; }
+    };
+
+    /** @brief One search at a time, resumable under a deadline
+     *  Node data is kept between searches and tagged with a search number, so nothing is cleared
+     *  when a new search begins.
+     */
+    class Pathfinder {
+    public:
+        /** @brief State of the current search */
+        enum class Status : u8 {
+            IDLE,       ///< No search
+            RUNNING,    ///< Interrupted by the deadline, call Continue again
+            FOUND,      ///< Path available with GetPath
+            NOT_FOUND   ///< Goal unreachable
+        };
+
+    private:
+        /** @brief Open list entry */
+        struct OpenNode {
+            u32 f;      ///< Cost so far + heuristic
+            u32 g;      ///< Cost so far when pushed (stale entries are skipped)
+            u32 node;   ///< Tile index
+
+            bool operator<(const OpenNode& other) const {
+                // Smallest f first, deeper node first on ties
+                return f != other.f ? f > other.f : g < other.g;
+            }
+        };
+
+        const Grid* grid = nullptr;         ///< Grid searched
+        std::vector<u32> cost;              ///< Cost so far of each tile
+        std::vector<u32> parent;            ///< Previous tile (jump point with JPS)
+        std::vector<u32> visited;           ///< Search number when the tile was reached
+        std::vector<u32> closed;            ///< Search number when the tile was expanded
+        std::vector<OpenNode> open;         ///< Binary heap
+        std::vector<Point> path;            ///< Result of the last search
+        u32 search = 0;                     ///< Current search number
+        Algorithm algorithm = Algorithm::JPS; ///< Algorithm of the current search
+        Point start = { 0, 0 };             ///< Start of the current search
+        Point goal = { 0, 0 };              ///< Goal of the current search
+        u32 gridVersion = 0;                ///< Grid version when the search began
+        u32 expanded = 0;                   ///< Nodes expanded by the current search
+        Status status = Status::IDLE;       ///< State of the current search
+
+        /** @brief Estimated cost between two tiles (octile distance) */
+        static u32 Heuristic(int x0, int y0, int x1, int y1);
+
+        /** @brief Reach a tile from another one with a cost so far */
+        void Reach(u32 node, u32 from, u32 g);
+
+        /** @brief Push the neighbours of a tile (A*) */
+        void ExpandAStar(u32 node);
+
+        /** @brief Push the jump points reachable from a tile (JPS) */
+        void ExpandJps(u32 node);
+
+        /** @brief Scan from a tile in one direction until a jump point, a wall or the goal
+         *  @return Tile index of the jump point or 0xFFFFFFFF
+         */
+        u32 Jump(int x, int y, int dx, int dy) const;
+
+        /** @brief Scan straight (dx or dy is 0) for a jump point */
+        bool JumpStraight(int& x, int& y, int dx, int dy) const;
+
+        /** @brief Build the tile path from the parents (filling the gaps between jump points) */
+        void BuildPath();
+
+    public:
+        /** @brief Start a search (a running one is abandoned)
+         *  @return false if start or goal is not walkable
+         */
+        bool Begin(const Grid& target, Point from, Point to, Algorithm method);
+
+        /** @brief Run the search until it ends or the deadline passes
+         *  @param deadline svcGetSystemTick value (checked every few nodes)
+         *  @return State of the search
+         */
+        Status Continue(u64 deadline);
+
+        /** @brief Run a whole search
+         *  @return Tiles from start to goal, empty if there is none
+         */
+        const std::vector<Point>& Find(const Grid& target, Point from, Point to, Algorithm method);
+
+        /** @brief Check if the grid changed since the search began */
+        bool IsStale() const { return grid && grid->GetVersion() != gridVersion; }
+
+        /** @brief Get the state of the current search */
+        Status GetStatus() const { return status; }
+
+        /** @brief Get the path of the last finished search */
+        const std::vector<Point>& GetPath() const { return path; }
+
+        /** @brief Get the number of nodes expanded by the current search */
+        u32 GetExpanded() const { return expanded; }
+    };
+
+    /** @brief Queued path requests answered asynchronously
+     *  Update answers cached requests at once and searches the others within a time budget
+     *  (a search can span several frames) or, with a job system, in batches on a worker while
+     *  the frame goes on. Results are delivered on the main thread by Update; requests queued by
+     *  the callbacks are answered by the next Update.
+     */
+    class PathService {
+    private:
+        /** @brief A queued request */
+        struct QueuedRequest {
+            RequestId id;               ///< Handle
+            Point start;                ///< Start tile
+            Point goal;                 ///< Goal tile
+            Algorithm algorithm;        ///< Algorithm used on a cache miss
+            PathCallback callback;      ///< Result receiver (nullptr once cancelled)
+            void* userData;             ///< Passed to callback
+        };
+
+        /** @brief Request searched by the worker */
+        struct BatchEntry {
+            QueuedRequest request;      ///< Request
+            std::vector<Point> path;    ///< Result
+            u32 expanded;               ///< Nodes expanded
+        };
+
+        /** @brief Cached result */
+        struct CacheEntry {
+            u64 key = 0;                        ///< Start and goal
+            bool found = false;                 ///< false for unreachable goals
+            u32 gridVersion = 0;                ///< Grid version (validates failures)
+            std::vector<Point> path;            ///< Tiles
+            std::vector<u32> regions;           ///< Regions crossed, each followed by its version
+        };
+
+        Grid grid;                              ///< Tiles
+        Pathfinder finder;                      ///< Main thread searches
+        Pathfinder workerFinder;                ///< Worker searches
+        std::deque<QueuedRequest> queue;        ///< Requests waiting
+        QueuedRequest current;                  ///< Request searched on the main thread
+        bool searching = false;                 ///< current is being searched
+        std::vector<CacheEntry> cache;          ///< Ring of cached results
+        std::unordered_map<u64, u32> cacheIndex; ///< Cache entry of each key
+        u32 cacheNext = 0;                      ///< Next ring entry replaced
+        u32 cacheCapacity = 256;                ///< Maximum cached results
+        Jobs::JobSystem* jobs = nullptr;        ///< Worker pool (nullptr for main thread only)
+        Jobs::Job* job = nullptr;               ///< Batch job in flight
+        std::vector<BatchEntry> batch;          ///< Requests searched by the job
+        u32 batchVersion = 0;                   ///< Grid version when the job was submitted
+        u32 batchSize = 16;                     ///< Requests per job
+        RequestId nextId = 1;                   ///< Next handle
+        Stats stats;                            ///< Counters
+
+        static u64 KeyOf(Point start, Point goal) {
+            return ((u64)(u16)start.x << 48) | ((u64)(u16)start.y << 32) | ((u32)(u16)goal.x << 16) | (u16)goal.y;
+        }
+
+        /** @brief Find a valid cached result
+         *  @return Entry or nullptr
+         */
+        const CacheEntry* Lookup(Point start, Point goal);
+
+        /** @brief Store a result */
+        void Store(Point start, Point goal, const std::vector<Point>& path);
+
+        /** @brief Store and deliver a result */
+        void Complete(const QueuedRequest& request, const std::vector<Point>& path);
+
+        /** @brief Deliver a cached result if there is one */
+        bool AnswerFromCache(const QueuedRequest& request);
+
+        /** @brief Deliver the results of a finished batch */
+        void FinishBatch();
+
+        /** @brief Job entry searching batch[begin, end) */
+        static void BatchJob(void* data, u32 begin, u32 end);
+
+    public:
+        /** @brief Constructor */
+        PathService() = default;
+
+        /** @brief Destructor (waits for the batch in flight) */
+        ~PathService();
+
+        PathService(const PathService&) = delete;
+        PathService& operator=(const PathService&) = delete;
+
+        /** @brief Get the grid (build it before queuing requests, then change tiles with SetWalkable) */
+        Grid& GetGrid() { return grid; }
+
+        /** @brief Change a tile, waiting for the worker batch if one is running */
+        void SetWalkable(int x, int y, bool walkable);
+
+        /** @brief Search on the job system's workers instead of the main thread
+         *  @param system Job system (nullptr or a single worker searches on the main thread)
+         *  @param requestsPerJob Requests searched by each batch
+         */
+        void SetJobSystem(Jobs::JobSystem* system, u32 requestsPerJob = 16);
+
+        /** @brief Set the number of cached results (256 by default, 0 disables the cache) */
+        void SetCacheCapacity(u32 capacity);
+
+        /** @brief Queue a path request
+         *  @param start Start tile
+         *  @param goal Goal tile
+         *  @param callback Function receiving the path during a later Update
+         *  @param userData Passed to callback
+         *  @param algorithm Algorithm used if the path is not cached
+         *  @return Handle of the request (0 if callback is nullptr)
+         */
+        RequestId Request(Point start, Point goal, PathCallback callback, void* userData = nullptr,
+                          Algorithm algorithm = Algorithm::JPS);
+
+        /** @brief Cancel a request (its callback will not be called) */
+        void Cancel(RequestId id);
+
+        /** @brief Cancel every request of a user data pointer (e.g. an agent being destroyed) */
+        void CancelAll(void* userData);
+
+        /** @brief Answer requests
+         *  @param budgetMilliseconds Main thread time spent searching (not used with workers)
+         */
+        void Update(float budgetMilliseconds);
+
+        /** @brief Get the number of requests not answered yet */
+        u32 GetPendingCount() const { return queue.size() + (searching ? 1 : 0) + batch.size(); }
+
+        /** @brief Get the counters */
+        const Stats& GetStats() const { return stats; }
+
+        /** @brief Reset the counters */
+        void ResetStats() { stats = Stats(); }
+    };
+}
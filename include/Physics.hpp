@@ -0,0 +1,275 @@
+/**
+ * @file Physics.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex 2D rigid body physics
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+
+/**
+ * @namespace Physics
+ * @brief Fixed-step rigid bodies for axis-aligned boxes and circles
+ * Bodies do not rotate (rectangles are drawn axis-aligned), so only their linear motion is
+ * simulated. The world only uses the standard library so the host tool (tools/physbench.cpp) can
+ * build it on a PC; Scene binds bodies to Rectangle and Circle objects.
+ * Units are pixels and seconds, y points down.
+ */
+namespace Physics {
+    /** @brief Duration of one simulation step */
+    constexpr float FIXED_STEP = 1.0f / 60.0f;
+
+    /** @brief Maximum number of steps run by one World::Step (the rest of the time is dropped) */
+    constexpr int MAX_STEPS = 4;
+
+    /** @brief Handle to a body (0 is invalid) */
+    typedef uint32_t BodyId;
+
+    /** @brief How a body moves */
+    enum class BodyType : uint8_t {
+        STATIC,     ///< Never moves (ground, walls)
+        KINEMATIC,  ///< Moves at its velocity, pushes dynamic bodies but is not pushed
+        DYNAMIC     ///< Moved by gravity, impulses and contacts
+    };
+
+    /** @brief Collision shape */
+    enum class ShapeType : uint8_t {
+        BOX,        ///< Axis-aligned box
+        CIRCLE      ///< Circle
+    };
+
+    /** @brief Description of a body */
+    struct BodyDef {
+        BodyType type = BodyType::DYNAMIC;  ///< How the body moves
+        ShapeType shape = ShapeType::BOX;   ///< Collision shape
+        float x = 0;                        ///< Center X
+        float y = 0;                        ///< Center Y
+        float width = 10;                   ///< Box width
+        float height = 10;                  ///< Box height
+        float radius = 5;                   ///< Circle radius
+        float density = 1;                  ///< Mass per square pixel (dynamic bodies)
+        float friction = 0.5f;              ///< Friction coefficient (combined as a geometric mean)
+        float restitution = 0;              ///< Bounciness between 0 and 1 (the larger one is used)
+        float gravityScale = 1;             ///< Multiplier of the world gravity
+        void* userData = nullptr;           ///< Passed to the sync callback, see FindBody
+    };
+
+    /** @brief Counters of the last step */
+    struct Stats {
+        uint32_t bodies = 0;        ///< Bodies in the world
+        uint32_t awake = 0;         ///< Dynamic and kinematic bodies simulated
+        uint32_t islands = 0;       ///< Groups of touching awake dynamic bodies
+        uint32_t slept = 0;         ///< Islands put to sleep
+        uint32_t pairs = 0;         ///< Overlapping bounding boxes found by the broadphase
+        uint32_t contacts = 0;      ///< Contacts solved
+        uint32_t steps = 0;         ///< Steps run by the last World::Step
+    };
+
+    /** @brief Function receiving the position of a body that moved
+     *  @param userData User data of the body
+     *  @param x Left of a box, center of a circle (the anchor of Rectangle and Circle objects)
+     *  @param y Top of a box, center of a circle
+     */
+    typedef void (*SyncCallback)(void* userData, float x, float y);
+
+    /** @brief Simulated bodies and contacts
+     *  Bodies are stored as parallel arrays (one per property) in a dense order. Each step:
+     *  velocities are integrated, a sort-and-sweep broadphase on X (kept sorted incrementally)
+     *  finds the overlapping pairs involving an awake body, contacts are solved with sequential
+     *  impulses warm-started from the previous step, positions are integrated, and touching bodies
+     *  are grouped into islands with a union-find. Islands that stayed still long enough sleep
+     *  until an awake body touches them; sleeping and static bodies are skipped by every stage.
+     */
+    class World {
+    private:
+        static constexpr uint32_t NONE = 0xFFFFFFFF;    ///< Invalid index
+        static constexpr uint32_t INDEX_BITS = 20;      ///< Handle bits holding the slot
+
+        /** @brief Body flags */
+        enum Flags : uint8_t {
+            AWAKE = 1,      ///< Simulated (dynamic and kinematic bodies)
+            MOVED = 2       ///< Position changed since the last Sync
+        };
+
+        /** @brief Touching pair */
+        struct Contact {
+            uint64_t key;           ///< Handles of both bodies (lower one first)
+            uint32_t a;             ///< Dense index of the body with the lower handle
+            uint32_t b;             ///< Dense index of the other body
+            float normalX;          ///< Normal from a to b
+            float normalY;
+            float penetration;      ///< Overlap along the normal
+            float normalMass;       ///< 1 / (sum of inverse masses)
+            float friction;         ///< Combined friction
+            float velocityBias;     ///< Target separating velocity (restitution and overlap)
+            float normalImpulse;    ///< Accumulated normal impulse
+            float tangentImpulse;   ///< Accumulated friction impulse
+        };
+
+        // Bodies (dense arrays, same index everywhere)
+        std::vector<float> positionX;       ///< Center X
+        std::vector<float> positionY;       ///< Center Y
+        std::vector<float> velocityX;       ///< Velocity X
+        std::vector<float> velocityY;       ///< Velocity Y
+        std::vector<float> inverseMass;     ///< 0 for static and kinematic bodies
+        std::vector<float> halfWidth;       ///< Half box width or radius
+        std::vector<float> halfHeight;      ///< Half box height or radius
+        std::vector<float> friction;        ///< Friction coefficient
+        std::vector<float> restitution;     ///< Restitution
+        std::vector<float> gravityScale;    ///< Gravity multiplier
+        std::vector<float> sleepTime;       ///< Time spent below the sleep velocity
+        std::vector<uint8_t> types;         ///< BodyType
+        std::vector<uint8_t> shapes;        ///< ShapeType
+        std::vector<uint8_t> flags;         ///< Flags
+        std::vector<void*> userData;        ///< User data
+        std::vector<BodyId> handles;        ///< Handle of each dense index
+
+        // Handles
+        std::vector<uint32_t> denseIndex;   ///< Dense index of each slot
+        std::vector<uint16_t> generations;  ///< Incremented each time a slot is freed
+        std::vector<uint32_t> freeSlots;    ///< Unused slots
+        std::unordered_map<const void*, BodyId> bodiesByUserData; ///< See FindBody
+
+        // Step data (kept to reuse the memory)
+        std::vector<uint32_t> sweep;        ///< Dense indices sorted by left edge
+        std::vector<uint32_t> openActive;   ///< Sweep: awake bodies whose right edge is not passed
+        std::vector<uint32_t> openInactive; ///< Sweep: static and sleeping bodies likewise
+        std::vector<Contact> contacts;      ///< Contacts of this step (sorted by key)
+        std::vector<Contact> previous;      ///< Contacts of the last step for warm starting
+        std::vector<uint32_t> islandParent; ///< Union-find parents
+        std::vector<float> islandSleep;     ///< Smallest sleep time of each island root
+
+        float gravityX = 0;                 ///< Gravity X
+        float gravityY = 500;               ///< Gravity Y
+        float accumulator = 0;              ///< Time not simulated yet
+        int iterations = 8;                 ///< Velocity iterations
+        bool sleeping = true;               ///< Islands can sleep
+        Stats stats;                        ///< Counters of the last step
+
+        /** @brief Get the dense index of a handle or NONE */
+        uint32_t Find(BodyId id) const;
+
+        /** @brief Check if a body takes part in the step (awake dynamic or kinematic) */
+        bool IsActive(uint32_t index) const { return (flags[index] & AWAKE) != 0; }
+
+        /** @brief Wake a body by dense index */
+        void WakeIndex(uint32_t index);
+
+        /** @brief Wake the sleeping bodies whose box touches a body (it is about to move or disappear) */
+        void WakeTouching(uint32_t index);
+
+        /** @brief Sort the sweep list and find the overlapping pairs */
+        void Broadphase();
+
+        /** @brief Create the contact of an overlapping pair if the shapes touch
+         *  @return true if a contact was created
+         */
+        bool Collide(uint32_t first, uint32_t second);
+
+        /** @brief Copy the impulses of last step's contacts and prepare the solver */
+        void PrepareContacts(float step);
+
+        /** @brief Run the sequential impulse iterations */
+        void SolveContacts();
+
+        /** @brief Group touching bodies and put the still islands to sleep */
+        void UpdateIslands(float step);
+
+        /** @brief Union-find root with path halving */
+        uint32_t Root(uint32_t index);
+
+        /** @brief Run one fixed step */
+        void StepOnce(float step);
+
+    public:
+        /** @brief Constructor */
+        World() = default;
+
+        World(const World&) = delete;
+        World& operator=(const World&) = delete;
+
+        /** @brief Create a body
+         *  @param def Description of the body
+         *  @return Handle of the body (0 if the world is full)
+         */
+        BodyId CreateBody(const BodyDef& def);
+
+        /** @brief Destroy a body (nothing happens for an invalid handle)
+         *  Sleeping bodies touching it wake up, so a pile does not float once its support is gone
+         */
+        void DestroyBody(BodyId id);
+
+        /** @brief Destroy every body */
+        void Clear();
+
+        /** @brief Find the body created with a user data pointer
+         *  @return Handle or 0 if there is none
+         */
+        BodyId FindBody(const void* userData) const;
+
+        /** @brief Check if a handle refers to a body */
+        bool IsValid(BodyId id) const { return Find(id) != NONE; }
+
+        /** @brief Set the gravity (500 pixels/s² down by default) */
+        void SetGravity(float x, float y) { gravityX = x; gravityY = y; }
+
+        /** @brief Set the number of solver iterations per step (8 by default) */
+        void SetIterations(int count) { iterations = count > 0 ? count : 1; }
+
+        /** @brief Enable or disable sleeping (enabled by default)
+         *  Disabling it wakes every body
+         */
+        void SetSleeping(bool enabled);
+
+        /** @brief Get the center of a body */
+        bool GetPosition(BodyId id, float& x, float& y) const;
+
+        /** @brief Move a body to a center position (wakes it, and the sleeping bodies touching a moved static body) */
+        void SetPosition(BodyId id, float x, float y);
+
+        /** @brief Get the velocity of a body */
+        bool GetVelocity(BodyId id, float& x, float& y) const;
+
+        /** @brief Set the velocity of a dynamic or kinematic body (wakes it) */
+        void SetVelocity(BodyId id, float x, float y);
+
+        /** @brief Add an impulse to a dynamic body (wakes it)
+         *  @param x Impulse X (mass × pixels/s)
+         *  @param y Impulse Y
+         */
+        void ApplyImpulse(BodyId id, float x, float y);
+
+        /** @brief Check if a body is simulated (static bodies never are) */
+        bool IsAwake(BodyId id) const;
+
+        /** @brief Wake a dynamic or kinematic body */
+        void Wake(BodyId id);
+
+        /** @brief Advance the simulation by whole fixed steps
+         *  Leftover time is kept for the next call, at most MAX_STEPS steps run per call
+         *  @param deltaTime Elapsed time in seconds
+         *  @return Number of steps run
+         */
+        int Step(float deltaTime);
+
+        /** @brief Report the bodies that moved since the last call
+         *  @param callback Function receiving each body's user data and position
+         */
+        void Sync(SyncCallback callback);
+
+        /** @brief Get the number of bodies */
+        size_t GetBodyCount() const { return handles.size(); }
+
+        /** @brief Get the counters of the last step */
+        const Stats& GetStats() const { return stats; }
+    };
+}
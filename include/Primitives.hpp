@@ -0,0 +1,97 @@
+/**
+ * @file Primitives.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex instanced rectangles, circles and ellipses
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <citro2d.h>
+#include <citro3d.h>
+
+/**
+ * @namespace Primitives
+ * @brief Renderer drawing solid shapes from one static mesh instead of citro2d's per-shape vertices
+ * citro2d writes 6 vertices per shape on the CPU. Here a static buffer of unit quads is drawn with the
+ * rectangle and color of each shape in vertex shader uniforms (source/primitives.v.pica), so the CPU
+ * writes 2 vectors per shape; ellipses are cut out by a precomputed anti-aliased circle texture.
+ *
+ * Render::Rect, Circle and Ellipse queue their shapes here. A queue of at least GetMinBatch() shapes
+ * is drawn instanced, shorter ones through citro2d (switching pipelines costs more than a few shapes),
+ * and any other draw flushes the queue first, so the draw order never changes.
+ */
+namespace Primitives {
+    /** @brief Kind of queued shape */
+    enum class Shape : u8 {
+        RECT,
+        ELLIPSE     ///< Ellipse inside the rectangle (circles too)
+    };
+
+    constexpr u32 BATCH_SIZE = 45;          ///< Shapes per draw call (2 of the 96 shader uniforms each)
+    constexpr u32 QUEUE_SIZE = 512;         ///< Shapes queued before an automatic flush
+    constexpr u32 MIN_BATCH = 16;           ///< Default smallest queue drawn instanced
+    constexpr float MAX_ELLIPSE_SIZE = 64;  ///< Larger ellipses go to citro2d (size of the circle texture)
+
+    /** @brief Submission counters (see ResetStats) */
+    struct Stats {
+        u32 shapes = 0;             ///< Shapes drawn
+        u32 instanced = 0;          ///< Shapes drawn instanced
+        u32 drawCalls = 0;          ///< Instanced draw calls
+        u32 switches = 0;           ///< Flushes drawn instanced (citro2d state restored after each)
+        u32 vertices = 0;           ///< Vertices written by the CPU (6 per citro2d shape, none instanced)
+        u32 uniforms = 0;           ///< Uniform vectors written for the instanced shapes
+    };
+
+    /** @brief Load the shader, the mesh and the circle texture (called by the SceneManager constructor)
+     *  @return false if something could not be allocated, every shape then goes to citro2d
+     */
+    bool Init();
+
+    /** @brief Free everything (called by the SceneManager destructor) */
+    void Fini();
+
+    /** @brief Enable or disable the instanced path (disabled, every shape goes to citro2d)
+     *  @param enabled Draw queued shapes instanced
+     */
+    void SetEnabled(bool enabled);
+
+    /** @brief Check if shapes are drawn instanced (enabled and initialized) */
+    bool IsEnabled();
+
+    /** @brief Set the smallest queue drawn instanced
+     *  @param count Shapes, 1 draws every queue instanced
+     */
+    void SetMinBatch(u32 count);
+
+    /** @brief Get the smallest queue drawn instanced */
+    u32 GetMinBatch();
+
+    /** @brief Set the target the next shapes are drawn to (called by Render::SceneBegin after a flush)
+     *  @param target Screen or texture target
+     */
+    void SetTarget(C3D_RenderTarget* target);
+
+    /** @brief Draw a shape, queued when the instanced path takes it
+     *  @param shape Kind of shape
+     *  @param x Left
+     *  @param y Top
+     *  @param width Width
+     *  @param height Height
+     *  @param color Color (C2D_Color32)
+     */
+    void Draw(Shape shape, float x, float y, float width, float height, u32 color);
+
+    /** @brief Draw the queued shapes */
+    void Flush();
+
+    /** @brief Get the counters since the last ResetStats */
+    const Stats& GetStats();
+
+    /** @brief Reset the counters (e.g. once per frame) */
+    void ResetStats();
+}
@@ -0,0 +1,248 @@
+/**
+ * @file Render.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex draw commands
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <vector>
+#include <citro2d.h>
+#include <citro3d.h>
+
+#include "Memory.hpp"
+
+/**
+ * @namespace Render
+ * @brief Draw functions used by the objects
+ * Draws go straight to citro2d, or are recorded in a DrawList while one is active
+ * so they can be replayed several times (e.g. once per eye in stereoscopic 3D).
+ * Rectangles, circles and ellipses are queued and drawn instanced (see Primitives).
+ */
+namespace Render {
+    /** @brief Type of a recorded draw */
+    enum class CommandType : u8 {
+        RECT,
+        LINE,
+        CIRCLE,
+        ELLIPSE,
+        IMAGE
+    };
+
+    /** @brief A recorded draw */
+    struct DrawCommand {
+        CommandType type;       ///< Kind of primitive
+        float depth;            ///< Stereoscopic depth (layer depth included)
+        union {
+            struct {
+                float x, y;     ///< Position
+                float a, b;     ///< Size, radius (a) or line end point
+                float thickness;///< Line thickness
+                u32 color;      ///< Color
+            } shape;
+            struct {
+                C2D_Image image;        ///< Image to draw
+                C2D_DrawParams params;  ///< Position, size, center and angle
+                u32 tint;               ///< Tint color, its alpha fades the image
+                u8 blend;               ///< Strength of the tint color
+            } image;
+        };
+    };
+
+    /** @brief List of recorded draws */
+    class DrawList {
+    private:
+        std::vector<DrawCommand, Memory::Allocator<DrawCommand, Memory::Tag::COMMANDS>> commands;  ///< Recorded draws in order
+
+    public:
+        /** @brief Remove every command (keeps the memory) */
+        void Clear() { commands.clear(); }
+
+        /** @brief Append a command
+         *  @param command Command to append
+         */
+        void Add(const DrawCommand& command) { commands.push_back(command); }
+
+        /** @brief Get the number of commands
+         *  @return Command count
+         */
+        size_t Size() const { return commands.size(); }
+
+        /** @brief Get the commands
+         *  @return First of Size() commands
+         */
+        DrawCommand* Data() { return commands.data(); }
+        const DrawCommand* Data() const { return commands.data(); }
+
+        /** @brief Exchange the commands of two lists (no copy)
+         *  @param other List to exchange with
+         */
+        void Swap(DrawList& other) { commands.swap(other.commands); }
+
+        /** @brief Draw every command
+         *  @param parallax Horizontal offset applied per unit of depth
+         */
+        void Replay(float parallax = 0.0f) const;
+    };
+
+    /** @brief Draws rendered once into a texture, then drawn as a single image while they stay the same
+     *  Every frame the draws are recorded again (nothing reaches the GPU) and compared with the ones in
+     *  the texture, which is only rendered again when they differ. Positions are taken relative to an
+     *  origin, so moving all the draws together keeps the texture. Used by Object::SetCached.
+     *  @note Translucent draws are blended twice (into the texture, then onto the screen) and come out
+     *  a little more transparent
+     */
+    class TextureCache {
+    private:
+        DrawList rendered;                  ///< Draws in the texture, relative to the origin
+        DrawList recorded;                  ///< Draws recorded this frame
+        DrawList* outerList = nullptr;      ///< List recording before Record
+        C3D_Tex texture;                    ///< Texture the draws are rendered into
+        C3D_RenderTarget* target = nullptr; ///< Render target of texture (created by the first render)
+        Tex3DS_SubTexture subTexture = {};  ///< Part of the texture holding the draws
+        u16 textureWidth = 0;               ///< Size of texture (powers of two, only grows)
+        u16 textureHeight = 0;
+        float left = 0;                     ///< Top-left corner of the draws relative to the origin
+        float top = 0;
+        bool ready = false;                 ///< The texture matches the draws of this frame
+        bool empty = true;                  ///< Nothing was drawn
+        u8 flash = 0;                       ///< Frames left of the rebuild highlight (debug)
+        u32 hits = 0;                       ///< Frames drawn from an unchanged texture
+        u32 rebuilds = 0;                   ///< Renders of the texture
+        static bool debug;                  ///< Highlight hits and rebuilds
+
+        /** @brief Render the recorded draws into the texture
+         *  @return false if they do not fit in MAX_SIZE or the texture cannot be allocated
+         */
+        bool RenderTexture();
+
+        /** @brief Hand the render target over to ReleaseRetired */
+        void ReleaseTarget();
+
+    public:
+        static constexpr int MAX_SIZE = 1024;   ///< Largest texture side (GPU limit)
+
+        TextureCache() = default;
+
+        /** @brief Destructor (the texture is freed by the next ReleaseRetired) */
+        ~TextureCache();
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        /** @brief Start recording this frame's draws (outside a scene, before C2D_SceneBegin) */
+        void Record();
+
+        /** @brief Stop recording and render the texture again if the draws changed
+         *  @param originX Origin the positions are made relative to
+         *  @param originY Origin the positions are made relative to
+         *  @return true if the texture is ready for Draw this frame
+         */
+        bool Finish(float originX, float originY);
+
+        /** @brief Skip this frame (not ready, the draws are made directly) */
+        void Skip() { ready = false; }
+
+        /** @brief Check if the texture holds this frame's draws */
+        bool IsReady() const { return ready; }
+
+        /** @brief Draw the texture
+         *  @param x Origin of this frame
+         *  @param y Origin of this frame
+         *  @param depth Stereoscopic depth of the whole image
+         */
+        void Draw(float x, float y, float depth = 0.0f);
+
+        /** @brief Render again on the next Finish (e.g. after the pixels of a sprite sheet changed) */
+        void Invalidate() { rendered.Clear(); empty = true; }
+
+        /** @brief Get the number of frames drawn from an unchanged texture */
+        u32 GetHits() const { return hits; }
+
+        /** @brief Get the number of renders of the texture */
+        u32 GetRebuilds() const { return rebuilds; }
+
+        /** @brief Get the VRAM used by the texture in bytes */
+        size_t GetMemory() const { return target ? (size_t)textureWidth * textureHeight * 4 : 0; }
+
+        /** @brief Outline the images drawn from a cache in green, flash them in red when rendered again
+         *  @param enabled Enable the highlight
+         */
+        static void SetDebug(bool enabled) { debug = enabled; }
+
+        /** @brief Check if hits and rebuilds are highlighted */
+        static bool IsDebug() { return debug; }
+    };
+
+    /** @brief Free the render targets of destroyed texture caches
+     *  citro3d cannot delete targets during a frame; SceneManager::Run calls this after C3D_FrameEnd
+     */
+    void ReleaseRetired();
+
+    /** @brief Start recording draws into a list instead of drawing them
+     *  @param list List receiving the commands
+     */
+    void BeginRecording(DrawList* list);
+
+    /** @brief Stop recording, following draws go to citro2d again */
+    void EndRecording();
+
+    /** @brief Check if draws are being recorded
+     *  @return true if a DrawList is active
+     */
+    bool IsRecording();
+
+    /** @brief Start drawing to a target (instead of C2D_SceneBegin, so queued shapes reach their target)
+     *  @param target Screen or texture target
+     */
+    void SceneBegin(C3D_RenderTarget* target);
+
+    /** @brief Translate the citro2d view (instead of C2D_ViewTranslate, queued shapes keep their view) */
+    void ViewTranslate(float x, float y);
+
+    /** @brief Reset the citro2d view (instead of C2D_ViewReset, queued shapes keep their view) */
+    void ViewReset();
+
+    /** @brief Draw the queued shapes and flush citro2d (before drawing with citro2d or citro3d directly) */
+    void Flush();
+
+    /** @brief Set the depth added to every following draw (depth of the current layer)
+     *  @param depth Layer depth
+     */
+    void SetLayerDepth(float depth);
+
+    /** @brief Draw a solid rectangle
+     *  @param depth Stereoscopic depth (positive comes out of the screen)
+     */
+    void Rect(float x, float y, float width, float height, u32 color, float depth = 0.0f);
+
+    /** @brief Draw a line
+     *  @param depth Stereoscopic depth (positive comes out of the screen)
+     */
+    void Line(float x0, float y0, float x1, float y1, u32 color, float thickness, float depth = 0.0f);
+
+    /** @brief Draw a solid circle
+     *  @param depth Stereoscopic depth (positive comes out of the screen)
+     */
+    void Circle(float x, float y, float radius, u32 color, float depth = 0.0f);
+
+    /** @brief Draw a solid ellipse
+     *  @param depth Stereoscopic depth (positive comes out of the screen)
+     */
+    void Ellipse(float x, float y, float width, float height, u32 color, float depth = 0.0f);
+
+    /** @brief Draw an image (sprite)
+     *  @param image Image to draw
+     *  @param params Draw parameters
+     *  @param depth Stereoscopic depth (positive comes out of the screen)
+     *  @param tint Tint color (C2D_Color32), its alpha fades the image
+     *  @param blend Strength of the tint color, 0 keeps the image colors
+     */
+    void Image(const C2D_Image& image, const C2D_DrawParams& params, float depth = 0.0f,
+               u32 tint = 0xFFFFFFFF, u8 blend = 0);
+}
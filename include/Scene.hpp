@@ -13,8 +13,18 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <unordered_map>
 #include "Objects.hpp"
 #include "Input.hpp"
+#include "Jobs.hpp"
+#include "Tween.hpp"
+#include "Timers.hpp"
+#include "Coroutines.hpp"
+#include "Physics.hpp"
+#include "Memory.hpp"
+#include "FileWatcher.hpp"
+#include "Audio.hpp"
+#include "Events.hpp"
 
 namespace Scene {
     // Forward declarations
@@ -27,18 +37,197 @@ namespace Scene {
         BOTTOM  ///< Bottom screen
     };
 
+    /** @brief Lifecycle state of a scene */
+    enum class SceneState {
+        UNLOADED,   ///< Constructed, nothing loaded
+        LOADING,    ///< OnPreload called, OnLoadStep in progress
+        LOADED,     ///< Loaded but not displayed (preloaded or kept loaded)
+        ACTIVE      ///< Displayed and updated
+    };
+
+    /** @brief Transition played when a scene replaces another */
+    enum class Transition {
+        NONE,           ///< Switch as soon as the new scene is loaded
+        FADE,           ///< Fade to black, load, fade in
+        SLIDE_LEFT,     ///< Old scene leaves to the left, new one comes from the right
+        SLIDE_RIGHT     ///< Old scene leaves to the right, new one comes from the left
+    };
+
+    /** @brief What happens to the layers below a scene pushed on a screen
+     *  Ordered from the cheapest for the scene to the cheapest for the layers below,
+     *  each layer gets the strongest policy of the layers above it.
+     */
+    enum class LayerPolicy {
+        UPDATE_BELOW,   ///< Lower layers keep updating and drawing (HUD)
+        DRAW_BELOW,     ///< Lower layers are drawn but not updated
+        FREEZE_BELOW,   ///< Lower layers are rendered once into a texture drawn as a single quad (pause menu)
+        HIDE_BELOW      ///< Lower layers are neither updated nor drawn (full screen scene)
+    };
+
+    /** @brief Element list type, counted under Memory::Tag::SCENE */
+    typedef std::vector<Objects::Object*, Memory::Allocator<Objects::Object*, Memory::Tag::SCENE>> ElementList;
+
+    /** @brief Memory allocated or freed by a scene transition */
+    struct MemoryDelta {
+        ptrdiff_t heap = 0;     ///< Heap bytes (positive when allocated)
+        ptrdiff_t linear = 0;   ///< Linear memory bytes (positive when allocated)
+    };
+
+    /** @brief Draw order sorting counters of a scene */
+    struct SortStats {
+        u32 frames = 0;         ///< Frames drawn
+        u32 sorts = 0;          ///< Frames where the draw order was sorted again
+        u32 moved = 0;          ///< Elements that changed position in the draw order
+        u64 lastTicks = 0;      ///< Duration of the last sort (system ticks)
+        u64 totalTicks = 0;     ///< Duration of every sort (system ticks)
+    };
+
+    /** @brief Region query counters of a scene (see Scene::QueryRadius) */
+    struct QueryStats {
+        u32 queries = 0;        ///< Region queries
+        u32 rebuilds = 0;       ///< Spatial grid rebuilds
+        u32 tested = 0;         ///< Elements whose position was tested (a full scan tests every element)
+        u32 found = 0;          ///< Elements returned
+    };
+
+    /** @brief Element in the spatial grid of a scene */
+    struct SpatialEntry {
+        Objects::Object* element;   ///< Element
+        float x;                    ///< Position when the grid was built
+        float y;
+        Objects::TagMask tags;      ///< Tags when the grid was built
+    };
+
+    /** @brief Read-only view over the elements of a scene (no copy)
+     *  Invalidated when elements are added or removed
+     */
+    class ElementRange {
+    private:
+        Objects::Object* const* first;  ///< First element
+        Objects::Object* const* last;   ///< One past the last element
+
+    public:
+        ElementRange(Objects::Object* const* first, Objects::Object* const* last) : first(first), last(last) {}
+
+        Objects::Object* const* begin() const { return first; }
+        Objects::Object* const* end() const { return last; }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+        Objects::Object* operator[](size_t index) const { return first[index]; }
+    };
+
     /** @brief Base class for managing game scenes
      *  Handles objects, updates, etc...
+     *
+     *  Lifecycle: construct (constructor), preload (OnPreload then OnLoadStep until it returns true,
+     *  spread over frames), activate (OnActivate), deactivate (OnDeactivate) and unload (OnUnload).
      */
     class Scene {
     protected:
-        std::vector<Objects::Object*> elements;     ///< List of objects in the scene
-        bool isLoaded = false;                      ///< Flag indicating if scene is loaded
+        ElementList elements;                       ///< List of objects in the scene
+        SceneState state = SceneState::UNLOADED;    ///< Lifecycle state
+        bool keepLoaded = false;                    ///< Stay loaded when deactivated
         std::string name;                           ///< Unique name of the scene
         bool canExit = false;                       ///< Flag indicating if scene can be exited
         SceneManager* sceneManager = nullptr;       ///< Pointer to scene manager
         Input::InputManager* inputManager = nullptr; ///< Pointer to input manager
         u32 backgroundColor = Colors::clrBlack;     ///< Background color of the scene
+        float depth = 0;                            ///< Stereoscopic depth added to every element
+        LayerPolicy layerPolicy = LayerPolicy::HIDE_BELOW; ///< Policy applied to the layers below this scene
+        bool updating = false;                      ///< Displayed and not paused by a layer above (set by the manager each frame)
+        ElementList parallelElements;               ///< Thread-safe elements updated on workers this frame
+        bool shapeBatching = true;                  ///< Draw runs of built-in shapes without virtual calls
+        ElementList drawOrder;                      ///< Elements sorted by layer, z (and y), stable
+        u32 orderChanges = 0;                       ///< Layer or z changes since the last sort (0: sorted)
+        bool ySort = false;                         ///< Sort by y inside equal layer and z
+        SortStats sortStats;                        ///< Sorting counters
+        ElementList cachedElements;                 ///< Elements with a texture cache, outer caches first
+        bool cacheListDirty = false;                ///< cachedElements must be collected again
+        u32 cacheFrame = 0;                         ///< Incremented by UpdateCaches (0 is never used)
+        ElementList kindElements[Objects::OBJECT_KIND_COUNT]; ///< Elements of each built-in kind (any order)
+        ElementList taggedElements[Objects::MAX_TAGS]; ///< Elements having each tag (any order)
+        std::unordered_map<Objects::NameId, ElementList> namedElements; ///< Elements of each name (any order)
+        std::vector<SpatialEntry, Memory::Allocator<SpatialEntry, Memory::Tag::SCENE>> spatialEntries; ///< Elements sorted by grid cell
+        std::vector<u32, Memory::Allocator<u32, Memory::Tag::SCENE>> spatialCells; ///< First entry of each cell, then the entry count
+        std::vector<SpatialEntry, Memory::Allocator<SpatialEntry, Memory::Tag::SCENE>> spatialBuffer; ///< Unsorted entries while building
+        float spatialCellSize = 64;                 ///< Requested cell size (doubled while the grid has too many cells)
+        float gridCellSize = 64;                    ///< Cell size of the built grid
+        float gridLeft = 0;                         ///< Bounds of the element positions when the grid was built
+        float gridTop = 0;
+        float gridRight = 0;
+        float gridBottom = 0;
+        u32 gridColumns = 0;                        ///< Cells of the built grid (0 when empty)
+        u32 gridRows = 0;
+        bool spatialDirty = true;                   ///< Grid built again by the next query
+        QueryStats queryStats;                      ///< Region query counters
+        Timers::TimerWheel timers;                  ///< Timers advanced by Update (paused with the scene)
+        Coroutines::Scheduler coroutines{ timers }; ///< Coroutines resumed by Update after the timers
+        Physics::World physics;                     ///< Bodies stepped by Update before the elements
+        MemoryDelta loadDelta;                      ///< Memory allocated by the last OnLoad
+        MemoryDelta unloadDelta;                    ///< Memory allocated by the last OnUnload (negative when freed)
+        MemoryDelta loadStart;                      ///< Live memory of the scope when loading started
+
+        friend class SceneManager;
+
+        /** @brief Physics sync callback moving an element to its body */
+        static void SyncBody(void* userData, float x, float y);
+
+        /** @brief Job entry running OnUpdate on a range of parallelElements */
+        static void UpdateElementsJob(void* data, u32 begin, u32 end);
+
+        /** @brief Draw a run of visible elements of one built-in type with direct calls */
+        template<typename T>
+        static void DrawShapes(Objects::Object* const* run, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                if (run[i]->visible) static_cast<T*>(run[i])->T::Draw();
+            }
+        }
+
+        /** @brief Check if an element only needs drawing this frame, with the Draw of its built-in shape
+         *  @param parallel Thread-safe elements already ran their logic on the workers
+         */
+        static bool IsDrawOnly(const Objects::Object* element, bool parallel) {
+            return (!element->HasLogic() || (parallel && element->threadSafe)) && !element->HasCustomDraw() &&
+                   !element->UsesRenderCache();
+        }
+
+        /** @brief Draw drawOrder[begin, end) of one built-in kind, all draw-only */
+        void DrawRun(Objects::ObjectKind kind, size_t begin, size_t end);
+
+        /** @brief Check if an element must be drawn after another one */
+        bool DrawsAfter(const Objects::Object* a, const Objects::Object* b) const {
+            if (a->GetLayer() != b->GetLayer()) return a->GetLayer() > b->GetLayer();
+            if (a->GetZ() != b->GetZ()) return a->GetZ() > b->GetZ();
+            return ySort && a->GetPosition().y > b->GetPosition().y;
+        }
+
+        /** @brief Sort the draw order if a layer or z changed (every frame with y-sorting) */
+        void SortDrawOrder();
+
+        /** @brief Add an element to the kind, tag and name indexes */
+        void IndexElement(Objects::Object* element);
+
+        /** @brief Remove an element from the kind, tag and name indexes */
+        void UnindexElement(Objects::Object* element);
+
+        /** @brief Remove many elements from the indexes
+         *  @param sorted Elements sorted by address
+         */
+        void UnindexElements(const std::vector<Objects::Object*>& sorted);
+
+        /** @brief Get the shortest list of elements having one of the tags of a mask
+         *  @param tags Tag bits (at least one)
+         */
+        const ElementList& ShortestTagList(Objects::TagMask tags) const;
+
+        /** @brief Sort the element positions into grid cells (counting sort) */
+        void BuildSpatialGrid();
+
+        /** @brief Find the elements with every tag of a mask whose position is inside a rectangle,
+         *  and inside a circle when radius is not negative
+         */
+        size_t Query(float left, float top, float right, float bottom, float radius, Objects::TagMask tags,
+                     Objects::Object** results, size_t capacity);
 
     public:
         /** @brief Constructor
@@ -80,24 +269,92 @@ namespace Scene {
         void SetInputManager(Input::InputManager* manager);
 
         /** @brief Add new element to scene
+         *  Adding an element that is already in the scene does nothing, so OnLoad can run again safely
          *  @param element Pointer to object to add
          */
         void AddElement(Objects::Object* element);
 
         /** @brief Updates scene and all elements
+         *  Elements flagged threadSafe run their OnUpdate in parallel on the scene manager's
+         *  job system first, then every element is drawn on the main thread by layer and z
+         *  (elements with equal keys keep the order in which they were added).
+         *  Consecutive built-in shapes of the same type without OnUpdate logic (and whose type does
+         *  not override Update or Draw) are drawn as a run with direct calls (see SetShapeBatching); the draw order never changes.
+         *  The scene's timers fire, its coroutines resume and its physics steps first, so a scene
+         *  paused below another one also pauses them.
          */
         virtual void Update();
 
+        /** @brief Enable or disable drawing runs of built-in shapes without virtual calls
+         *  Scenes creating shapes of the same type together get the longest runs
+         *  @param enabled false updates every element through Object::Update (for comparison)
+         */
+        void SetShapeBatching(bool enabled) { shapeBatching = enabled; }
+
+        /** @brief Sort elements by y inside equal layer and z (lower y drawn first, for top-down games)
+         *  The order is then checked every frame; elements moving a little cost almost nothing
+         *  @param enabled Enable y-sorting
+         */
+        void SetYSort(bool enabled) { ySort = enabled; MarkOrderDirty(); }
+
+        /** @brief Request a sort of the draw order before the next frame
+         *  Called by Object::SetLayer and Object::SetZ
+         */
+        void MarkOrderDirty() { orderChanges++; }
+
+        /** @brief Render the texture caches of the cached elements whose subtree changed
+         *  Must run outside C2D_SceneBegin of the screen: the scene manager calls it before each screen
+         *  (call it before Update or Draw when driving the scene yourself)
+         */
+        void UpdateCaches();
+
+        /** @brief Collect the cached elements again before the next UpdateCaches
+         *  Called by Object::SetCached
+         */
+        void MarkCachesDirty() { cacheListDirty = true; }
+
+        /** @brief Get the frame number of the last UpdateCaches (marks the elements drawn by a cache) */
+        u32 GetCacheFrame() const { return cacheFrame; }
+
+        /** @brief Get the elements in draw order
+         *  @return View over the object pointers, sorted on the last frame
+         */
+        ElementRange GetDrawOrder() const {
+            return ElementRange(drawOrder.data(), drawOrder.data() + drawOrder.size());
+        }
+
+        /** @brief Get the draw order sorting counters
+         *  @return Frames, sorts (sorts / frames is the re-sort frequency) and sorting time
+         */
+        const SortStats& GetSortStats() const { return sortStats; }
+
+        /** @brief Reset the draw order sorting counters */
+        void ResetSortStats() { sortStats = SortStats(); }
+
+        /** @brief Draw every visible element without updating them
+         *  Used for layers paused by a scene pushed above them
+         */
+        virtual void Draw();
+
         /** @brief Remove element at specified index
+         *  Tweens targeting the element and timers and coroutines owned by it are cancelled, its body is destroyed
          *  @param index Index of element to remove
          */
         void RemoveElement(size_t index);
 
         /** @brief Remove specific element instance
+         *  Tweens targeting the element and timers and coroutines owned by it are cancelled, its body is destroyed
          *  @param element Pointer to element to remove
          */
         void RemoveElementByInstance(Objects::Object* element);
 
+        /** @brief Remove many elements at once (keeps the order of the others)
+         *  Tweens targeting the elements and timers and coroutines owned by them are cancelled, their bodies are destroyed
+         *  @param list Elements to remove
+         *  @param count Number of elements in list
+         */
+        void RemoveElements(Objects::Object* const* list, size_t count);
+
         /** @brief Get index of specific element
          *  @param element Pointer to element to find
          *  @return Index of element or -1 if not found
@@ -105,10 +362,10 @@ namespace Scene {
         int GetElementIndex(Objects::Object* element) const;
 
         /** @brief Get all elements in scene
-         *  @return Vector of object pointers
+         *  @return View over the object pointers (not a copy)
          */
-        std::vector<Objects::Object*> GetElements() const {
-            return elements; 
+        ElementRange GetElements() const {
+            return ElementRange(elements.data(), elements.data() + elements.size());
         }
 
         /** @brief Get element at specific index
@@ -119,6 +376,167 @@ namespace Scene {
             return elements[index]; 
         }
 
+        /** @brief Find an element by name through the name index
+         *  @param name Name given with Object::SetName
+         *  @return An element with this name or nullptr
+         */
+        Objects::Object* FindByName(const char* name) const;
+
+        /** @brief Get every element with a name
+         *  @param name Name given with Object::SetName
+         *  @return View over the elements (any order, invalidated when names change or elements are removed)
+         */
+        ElementRange FindAllByName(const char* name) const;
+
+        /** @brief Get every element having a tag
+         *  @param tag One tag bit from Objects::RegisterTag
+         *  @return View over the elements (any order, invalidated when tags change or elements are removed)
+         */
+        ElementRange GetTagged(Objects::TagMask tag) const;
+
+        /** @brief Call a function for each element having every tag of a mask
+         *  Walks the index of the rarest of the tags instead of the whole scene
+         *  @param tags Tag bits from Objects::RegisterTag
+         *  @param function Called with each Objects::Object* (must not add or remove elements or change tags)
+         */
+        template<typename Function>
+        void ForEachTagged(Objects::TagMask tags, Function function) const {
+            if (tags == 0) return;
+            for (Objects::Object* element : ShortestTagList(tags)) {
+                if (element->HasTags(tags)) function(element);
+            }
+        }
+
+        /** @brief Get every element of a built-in kind
+         *  @param kind Kind (subclasses of the shapes keep the kind of their shape)
+         *  @return View over the elements (any order, invalidated when elements are added or removed)
+         */
+        ElementRange GetElementsOfKind(Objects::ObjectKind kind) const {
+            const ElementList& list = kindElements[(u32)kind];
+            return ElementRange(list.data(), list.data() + list.size());
+        }
+
+        /** @brief Call a function for each element of a built-in type, already cast (no RTTI)
+         *  @tparam T Rectangle, Line, Circle, Ellipse or Sprite
+         *  @param function Called with each T* (must not add or remove elements)
+         */
+        template<typename T, typename Function>
+        void ForEachOfType(Function function) const {
+            for (Objects::Object* element : kindElements[(u32)T::KIND]) {
+                function(static_cast<T*>(element));
+            }
+        }
+
+        /** @brief Find the elements with every tag of a mask whose position is within a distance
+         *  The positions are sorted into a grid on the first query after the elements may have moved
+         *  (each Update, adds and removals), so a query tests the elements of the cells it covers,
+         *  or the rarest tag's elements when there are fewer of them. Elements moved after the grid
+         *  was built are found at their old position until MarkSpatialDirty.
+         *  @param x Center X
+         *  @param y Center Y
+         *  @param radius Distance
+         *  @param tags Tag bits every result must have (0 for any element)
+         *  @param results Array receiving the elements (e.g. from GetFrameArena)
+         *  @param capacity Size of results
+         *  @return Number of elements written (at most capacity)
+         */
+        size_t QueryRadius(float x, float y, float radius, Objects::TagMask tags,
+                           Objects::Object** results, size_t capacity) {
+            return Query(x - radius, y - radius, x + radius, y + radius, radius, tags, results, capacity);
+        }
+
+        /** @brief Find the elements with every tag of a mask whose position is inside a rectangle
+         *  Same grid and rules as QueryRadius
+         *  @param x Left
+         *  @param y Top
+         *  @param width Width
+         *  @param height Height
+         *  @param tags Tag bits every result must have (0 for any element)
+         *  @param results Array receiving the elements
+         *  @param capacity Size of results
+         *  @return Number of elements written (at most capacity)
+         */
+        size_t QueryRect(float x, float y, float width, float height, Objects::TagMask tags,
+                         Objects::Object** results, size_t capacity) {
+            return Query(x, y, x + width, y + height, -1.0f, tags, results, capacity);
+        }
+
+        /** @brief Set the cell size of the spatial grid
+         *  About the usual query radius works best; it grows when the elements spread over too many cells
+         *  @param size Cell size in pixels
+         */
+        void SetSpatialCellSize(float size) { spatialCellSize = size > 1.0f ? size : 1.0f; spatialDirty = true; }
+
+        /** @brief Build the spatial grid again on the next query (after moving elements during a frame) */
+        void MarkSpatialDirty() { spatialDirty = true; }
+
+        /** @brief Get the region query counters
+         *  @return Queries, grid rebuilds, tested and found elements
+         */
+        const QueryStats& GetQueryStats() const { return queryStats; }
+
+        /** @brief Reset the region query counters */
+        void ResetQueryStats() { queryStats = QueryStats(); }
+
+        /** @brief Move an element between name indexes (called by Object::SetNameId)
+         *  @param element Element of the scene
+         *  @param old Previous name
+         */
+        void OnNameChanged(Objects::Object* element, Objects::NameId old);
+
+        /** @brief Move an element between tag indexes (called by Object::SetTags)
+         *  @param element Element of the scene
+         *  @param old Previous tags
+         */
+        void OnTagsChanged(Objects::Object* element, Objects::TagMask old);
+
+        /** @brief Get the timers of the scene
+         *  They only advance while the scene is updated and are all cancelled when it is unloaded.
+         *  Pass an element as owner to cancel its timers when it is removed.
+         *  @return Timer wheel
+         */
+        Timers::TimerWheel& GetTimers() { return timers; }
+
+        /** @brief Start a coroutine on the scene
+         *  It first runs on the next Update and is stopped when the scene is unloaded or the owner removed
+         *  @param coroutine Coroutine to run (owned by the caller)
+         *  @param owner Element whose removal stops it (can be nullptr)
+         */
+        void StartCoroutine(Coroutines::Coroutine* coroutine, const Objects::Object* owner = nullptr) {
+            coroutines.Start(coroutine, owner);
+        }
+
+        /** @brief Get the coroutine scheduler of the scene
+         *  @return Scheduler
+         */
+        Coroutines::Scheduler& GetCoroutines() { return coroutines; }
+
+        /** @brief Give a rectangle a box body moved by the scene's physics
+         *  @param rectangle Element of the scene (its position and size are used)
+         *  @param def Type and material of the body (shape, position and size are replaced)
+         *  @return Handle of the body (0 on failure)
+         */
+        Physics::BodyId AddBody(Objects::Rectangle* rectangle, Physics::BodyDef def = Physics::BodyDef());
+
+        /** @brief Give a circle a circle body moved by the scene's physics
+         *  @param circle Element of the scene (its position and radius are used)
+         *  @param def Type and material of the body (shape, position and radius are replaced)
+         *  @return Handle of the body (0 on failure)
+         */
+        Physics::BodyId AddBody(Objects::Circle* circle, Physics::BodyDef def = Physics::BodyDef());
+
+        /** @brief Get the physics world of the scene
+         *  It steps while the scene is updated and is cleared when it is unloaded
+         *  @return World
+         */
+        Physics::World& GetPhysics() { return physics; }
+
+        /** @brief Get the per-frame arena of the scene manager
+         *  Memory taken from it is released at the end of the frame
+         *  @return Arena or nullptr if the scene is not managed
+         */
+        Memory::Arena* GetFrameArena() const;
+
         /** @brief Get background color
          *  @return Current background color
          */
@@ -129,10 +547,82 @@ namespace Scene {
          */
         void SetBackgroundColor(u32 newColor) { backgroundColor = newColor; }
 
-        /** @brief Called when scene is loaded
+        /** @brief Get stereoscopic depth of the scene
+         *  @return Depth added to every element
+         */
+        float GetDepth() const { return depth; }
+
+        /** @brief Set stereoscopic depth of the scene
+         *  @param newDepth Depth added to every element (positive comes out of the screen)
+         */
+        void SetDepth(float newDepth) { depth = newDepth; }
+
+        /** @brief Get the memory allocated by the last OnLoad
+         *  @return Heap and linear deltas counted in this scene's memory scope
+         */
+        const MemoryDelta& GetLoadMemoryDelta() const { return loadDelta; }
+
+        /** @brief Get the memory allocated by the last OnUnload
+         *  @return Heap and linear deltas (negative when memory was freed)
+         */
+        const MemoryDelta& GetUnloadMemoryDelta() const { return unloadDelta; }
+
+        /** @brief Get lifecycle state
+         *  @return Current state
+         */
+        SceneState GetState() const { return state; }
+
+        /** @brief Check if the scene is loaded (LOADED or ACTIVE)
+         *  @return true if loaded
+         */
+        bool IsLoaded() const { return state == SceneState::LOADED || state == SceneState::ACTIVE; }
+
+        /** @brief Check if the scene's elements are updated this frame
+         *  false while it is not displayed or a layer pushed above it does not use UPDATE_BELOW;
+         *  tweens of its elements are paused meanwhile
+         *  @return true if the scene updates
+         */
+        bool IsUpdating() const { return updating; }
+
+        /** @brief Get policy applied to the layers below this scene
+         *  @return Layer policy
+         */
+        LayerPolicy GetLayerPolicy() const { return layerPolicy; }
+
+        /** @brief Set policy applied to the layers below this scene when it is pushed on a screen
+         *  @param policy Layer policy
+         */
+        void SetLayerPolicy(LayerPolicy policy) { layerPolicy = policy; }
+
+        /** @brief Keep the scene loaded when another scene replaces it
+         *  Switching back is then instant but the scene keeps its memory
+         *  @param value true to keep loaded
+         */
+        void SetKeepLoaded(bool value) { keepLoaded = value; }
+
+        /** @brief Called once when loading starts (before the first OnLoadStep)
+         */
+        virtual void OnPreload() {}
+
+        /** @brief Load a part of the scene, called every frame until it returns true
+         *  Each call should be short: the manager calls it again while its time budget allows.
+         *  The default implementation calls OnLoad once.
+         *  @return true when loading is complete
+         */
+        virtual bool OnLoadStep() { OnLoad(); return true; }
+
+        /** @brief Called when scene is loaded (by the default OnLoadStep)
          */
         virtual void OnLoad() {}
 
+        /** @brief Called when the scene becomes the displayed scene of a screen
+         */
+        virtual void OnActivate() {}
+
+        /** @brief Called when another scene replaces this one
+         */
+        virtual void OnDeactivate() {}
+
         /** @brief Called when scene is unloaded
          */
         virtual void OnUnload() {}
@@ -143,43 +633,285 @@ namespace Scene {
      */
     class SceneManager {
     private:
-        C3D_RenderTarget* topScreen;                    ///< Top screen render target
+        /** @brief Maximum number of scenes stacked on a screen */
+        static constexpr int MAX_LAYERS = 8;
+
+        /** @brief Scenes stacked on a screen and the transition in progress */
+        struct ScreenState {
+            int layers[MAX_LAYERS];                     ///< Scene indices from bottom to top
+            int layerCount = 0;                         ///< Number of stacked scenes
+            int pending = -1;                           ///< Index of the scene being loaded for this screen
+            bool pendingPush = false;                   ///< Pending scene goes on top instead of replacing the stack
+            bool pendingReload = false;                 ///< Pending scene is displayed: unload the stack once it has left
+            Transition transition = Transition::NONE;   ///< Transition being played
+            float duration = 0;                         ///< Duration of each half of the transition in seconds
+            float elapsed = 0;                          ///< Time spent in the current half
+            bool fadingIn = false;                      ///< Second half (new scene appearing)
+            C3D_Tex cacheTexture;                       ///< Frozen layers rendered once
+            C3D_RenderTarget* cacheTarget = nullptr;    ///< Render target of cacheTexture (created on first freeze)
+            int cachedLayers = 0;                       ///< Number of bottom layers in the cache (0 when invalid)
+
+            int Top() const { return layerCount > 0 ? layers[layerCount - 1] : -1; }
+        };
+
+        C3D_RenderTarget* topScreen;                    ///< Top screen render target (left eye)
+        C3D_RenderTarget* topScreenRight = nullptr;     ///< Top screen right eye target (stereo only)
         C3D_RenderTarget* bottomScreen;                 ///< Bottom screen render target
         std::vector<Scene*> scenes;                     ///< List of all scenes
-        int currentTopSceneIndex = -1;                  ///< Index of current top screen scene
-        int currentBottomSceneIndex = -1;               ///< Index of current bottom screen scene
+        std::unordered_map<std::string, int> sceneIndices; ///< Scene index by name
+        ScreenState screens[2];                         ///< State of the top and bottom screens
+        std::vector<int> preloadQueue;                  ///< Scenes to load in the background
         Input::InputManager inputManager;               ///< Input manager instance
         Input::Button exitKey = Input::Button::START;   ///< Exit key
+        Jobs::JobSystem jobSystem;                      ///< Worker threads for parallel updates
+        Tween::TweenManager tweenManager;               ///< Tweens of every scene (paused with their target's scene)
+        Debug::FileWatcher fileWatcher;                 ///< Files reloaded when they change (polled between frames)
+        Events::EventBus eventBus;                      ///< Events dispatched once per frame before the scenes update
+        Audio::AudioSystem audio;                       ///< Mixer and sound output (started by EnableAudio)
+        u64 lastFrameTime = 0;                          ///< Time of the previous frame in milliseconds
+        float deltaTime = 0;                            ///< Duration of the last frame in seconds
+        float loadBudget = 4.0f;                        ///< Milliseconds per frame spent loading scenes
+        bool stereo = false;                            ///< Stereoscopic 3D on the top screen
+        bool graphics = true;                           ///< Owns the GPU and the screen targets
+        Render::DrawList topDrawList;                   ///< Top screen draws recorded once per frame in stereo
+        bool reportMemory = false;                      ///< Print memory deltas of scene transitions
+        Memory::Arena frameArena;                       ///< Transient allocations, reset at the end of each frame
+        u32 framesSinceLoad = 0;                        ///< Frames since the last scene change (steady state check)
+
+        /** @brief Start loading a scene (calls OnPreload)
+         *  @param index Index of the scene
+         */
+        void BeginLoading(int index);
+
+        /** @brief Run OnLoadStep until the scene is loaded or the deadline is reached
+         *  @param index Index of the scene
+         *  @param deadline System tick at which to stop
+         *  @return true once the scene is loaded
+         */
+        bool StepLoading(int index, u64 deadline);
+
+        /** @brief Activate the pending scene of a screen
+         *  Pushes it on the stack or replaces every layer depending on pendingPush
+         *  @param screen Screen state
+         */
+        void SwitchScene(ScreenState& screen);
+
+        /** @brief Deactivate a scene and unload it unless it is kept loaded
+         *  @param index Index of the scene
+         */
+        void Deactivate(int index);
+
+        /** @brief Call OnUnload in the scene's memory scope and record the delta
+         *  @param index Index of the scene
+         */
+        void Unload(int index);
+
+        /** @brief Render the frozen layers of a screen into its cache texture
+         *  @param screen Screen state
+         *  @param first First layer not hidden by a HIDE_BELOW layer (its background clears the cache)
+         *  @param count Number of bottom layers frozen (layers [first, count) are drawn)
+         */
+        void RenderLayerCache(ScreenState& screen, int first, int count);
+
+        /** @brief Update and draw the layers of a screen above the frozen ones
+         *  @param screen Screen state
+         *  @param frozen Number of bottom layers drawn from the cache
+         *  @param width Width of the screen
+         */
+        void UpdateLayers(const ScreenState& screen, int frozen, float width);
+
+        /** @brief Update and draw the scenes of a screen with its transition
+         *  @param screen Screen to draw
+         */
+        void UpdateScreen(Screen screen);
+
+        /** @brief Flag the scenes whose elements update this frame (see Scene::IsUpdating) */
+        void MarkUpdatingScenes();
+
+        /** @brief Tween filter pausing tweens of elements whose scene does not update */
+        static bool IsTweenPaused(const Objects::Object* owner);
 
     public:
+        /** @brief Advance loading and transitions of both screens within the load budget
+         *  Run calls it every frame; headless managers call it themselves
+         */
+        void UpdateLoading();
+
         /** @brief Get input manager
          *  @return Reference to input manager
          */
         Input::InputManager& GetInputManager() { return inputManager; }
 
+        /** @brief Get job system
+         *  @return Reference to the job system (single threaded until EnableJobs is called)
+         */
+        Jobs::JobSystem& GetJobSystem() { return jobSystem; }
+
+        /** @brief Start worker threads used for thread-safe object updates
+         *  @param workerCount Number of workers including the main thread (0 to use the recommended count, 1 to disable)
+         *  @return Number of workers actually running
+         */
+        int EnableJobs(int workerCount = 0);
+
+        /** @brief Start the sound output and the music decoding thread
+         *  @return false if the DSP is not available (dspfirm.cdc missing); sounds are then mixed silently
+         */
+        bool EnableAudio() { return audio.Start(); }
+
+        /** @brief Get the audio system
+         *  @return Reference to the audio system (updated once per frame by Run)
+         */
+        Audio::AudioSystem& GetAudio() { return audio; }
+
+        /** @brief Get the per-frame arena
+         *  @return Arena reset at the end of each frame in Run
+         */
+        Memory::Arena& GetFrameArena() { return frameArena; }
+
+        /** @brief Get the duration of the last frame
+         *  @return Seconds between the last two frames
+         */
+        float GetDeltaTime() const { return deltaTime; }
+
+        /** @brief Get tween manager
+         *  @return Reference to the tween manager (updated once per frame before the scenes)
+         */
+        Tween::TweenManager& GetTweenManager() { return tweenManager; }
+
+        /** @brief Get event bus
+         *  @return Reference to the event bus (dispatched by Run before the scenes update)
+         */
+        Events::EventBus& GetEventBus() { return eventBus; }
+
+        /** @brief Get file watcher
+         *  @return Reference to the file watcher (polled between frames by Run)
+         */
+        Debug::FileWatcher& GetFileWatcher() { return fileWatcher; }
+
         /** @brief Constructor - initializes C2D and C3D */
-        SceneManager();
+        SceneManager() : SceneManager(true) {}
+
+        /** @brief Constructor
+         *  @param initGraphics false creates a headless manager that only loads and switches scenes
+         *  (UpdateLoading), e.g. inside benchmarks while the game's manager owns the screens
+         */
+        explicit SceneManager(bool initGraphics);
 
         /** @brief Destructor - cleans up C2D and C3D */
         virtual ~SceneManager();
 
+        /** @brief Enable or disable stereoscopic 3D on the top screen
+         *  The top scene is updated once per frame and its draws are replayed for each eye,
+         *  shifted by the depth of each element scaled by the 3D slider.
+         *  Only draws made through Render are recorded: C2D_Draw* calls made directly in a Draw
+         *  override reach the left eye only, under everything drawn through Render.
+         *  @param enable true to enable
+         */
+        void SetStereo(bool enable);
+
+        /** @brief Check if stereoscopic 3D is enabled
+         *  @return true if enabled
+         */
+        bool IsStereo() const { return stereo; }
+
+        /** @brief Print the memory delta of every scene load and unload on the console
+         *  Unload deltas that don't cancel the load deltas point to leaks
+         *  @param enable true to print
+         */
+        void SetMemoryReport(bool enable) { reportMemory = enable; }
+
+        /** @brief Get the memory scope of a scene (see Memory::SetScope)
+         *  @param index Index of the scene
+         *  @return Scope index
+         */
+        static int GetMemoryScope(int index) { return index + 1 < Memory::MAX_SCOPES ? index + 1 : 0; }
+
+        /** @brief Set the time spent loading scenes each frame
+         *  @param milliseconds Budget per frame (loading always makes at least one step per frame)
+         */
+        void SetLoadBudget(float milliseconds) { loadBudget = milliseconds; }
+
         /** @brief Add new scene to manager
          *  @param scene Pointer to scene to add
          *  @return Index of the scene in the scenes vector
          */
         int AddScene(Scene* scene);
 
-        /** @brief Load scene by name
+        /** @brief Get index of a scene by name
+         *  @param sceneName Name of the scene
+         *  @return Index or -1 if not found
+         */
+        int GetSceneIndex(const std::string& sceneName) const;
+
+        /** @brief Load scene by name, replacing every layer of the screen
+         *  The scene is loaded over the next frames, the current one stays on screen until then
          *  @param sceneName Name of scene to load
          *  @param targetScreen Screen to load scene on
+         *  @param transition Transition to play
+         *  @param duration Total duration of the transition in seconds (loading time excluded)
          */
-        void LoadScene(const std::string& sceneName, Screen targetScreen);
+        void LoadScene(const std::string& sceneName, Screen targetScreen, Transition transition = Transition::NONE, float duration = 0.5f);
 
         /** @brief Load scene by index
          *  @param index Index of scene to load
          *  @param targetScreen Screen to load scene on
+         *  @param transition Transition to play
+         *  @param duration Total duration of the transition in seconds (loading time excluded)
+         */
+        void LoadScene(int index, Screen targetScreen, Transition transition = Transition::NONE, float duration = 0.5f);
+
+        /** @brief Push a scene on top of the scenes of a screen (pause menu, HUD...)
+         *  Its layer policy decides what happens to the layers below
+         *  @param sceneName Name of the scene
+         *  @param targetScreen Screen to push the scene on
+         */
+        void PushScene(const std::string& sceneName, Screen targetScreen);
+
+        /** @brief Push a scene on top of the scenes of a screen
+         *  @param index Index of the scene
+         *  @param targetScreen Screen to push the scene on
+         */
+        void PushScene(int index, Screen targetScreen);
+
+        /** @brief Remove the top scene of a screen and resume the one below
+         *  @param targetScreen Screen to pop
+         *  @return false if the screen has no scene
+         */
+        bool PopScene(Screen targetScreen);
+
+        /** @brief Get the top scene of a screen
+         *  @param targetScreen Screen
+         *  @return Scene or nullptr if the screen is empty
+         */
+        Scene* GetTopScene(Screen targetScreen) const;
+
+        /** @brief Render the frozen layers of a screen again on the next frame
+         *  Needed when a frozen scene changes (e.g. its elements are moved by the scene above)
+         *  @param targetScreen Screen
+         */
+        void InvalidateLayerCache(Screen targetScreen) { screens[static_cast<int>(targetScreen)].cachedLayers = 0; }
+
+        /** @brief Load a scene in the background so that LoadScene can switch to it instantly
+         *  Loading uses the frame time left in the load budget
+         *  @param sceneName Name of the scene
+         */
+        void PreloadScene(const std::string& sceneName);
+
+        /** @brief Load a scene in the background by index
+         *  @param index Index of the scene
+         */
+        void PreloadScene(int index);
+
+        /** @brief Unload a scene which is loaded but not displayed
+         *  @param index Index of the scene
+         */
+        void UnloadScene(int index);
+
+        /** @brief Check if a screen is loading a new scene or playing a transition
+         *  @param screen Screen to check
+         *  @return true while the transition is not over
          */
-        void LoadScene(int index, Screen targetScreen);
+        bool IsTransitioning(Screen screen) const;
 
         /** @brief Update and render current scenes */
         void Update();
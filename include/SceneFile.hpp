@@ -0,0 +1,258 @@
+/**
+ * @file SceneFile.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex binary scene loader
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include "SceneFormat.hpp"
+#include "Objects.hpp"
+#include "FileWatcher.hpp"
+
+namespace Scene { class Scene; }  // Forward declaration
+
+namespace SceneFormat {
+    /** @brief Function creating the object of a CUSTOM record
+     *  The factory owns the object (e.g. a pool in the game code) and must keep it alive until SceneFile::Clear
+     *  @param record Record of the object (position, params and properties are applied by the caller)
+     *  @param userData Pointer given to RegisterFactory
+     *  @return Object or nullptr to skip the record
+     */
+    typedef Objects::Object* (*Factory)(const ObjectRecord& record, void* userData);
+
+    /** @brief Register the factory of a custom type (shared by every SceneFile)
+     *  @param typeName Name used by the typeName of the records
+     *  @param factory Function creating the objects
+     *  @param userData Pointer passed to the factory
+     */
+    void RegisterFactory(const char* typeName, Factory factory, void* userData = nullptr);
+
+    /** @brief A loaded .cfs file and the objects instantiated from it
+     *  The file is read in one block and used as is: records are only validated, never parsed field by field.
+     *  Objects of each instantiation live in per-type arrays sized from the counts stored in the file.
+     *
+     *  Typical use: Load in OnPreload, Instantiate in OnLoad, Clear in OnUnload.
+     */
+    class SceneFile {
+    private:
+        /** @brief Objects created by one Instantiate call */
+        struct Instance {
+            std::vector<Objects::Rectangle> rectangles;
+            std::vector<Objects::Line> lines;
+            std::vector<Objects::Circle> circles;
+            std::vector<Objects::Ellipse> ellipses;
+            std::vector<Objects::Sprite> sprites;
+            std::vector<Objects::Object*> objects;  ///< Object of each record of the block (nullptr if skipped)
+            uint32_t first = 0;                     ///< Index of the first record of the block
+            float offsetX = 0;                      ///< Offset applied to the records
+            float offsetY = 0;                      ///< Offset applied to the records
+        };
+
+        const uint8_t* data = nullptr;          ///< File contents
+        uint8_t* ownedData = nullptr;           ///< Block allocated by Load (nullptr for LoadFromMemory)
+        const FileHeader* header = nullptr;     ///< Header in data
+        const ObjectRecord* records = nullptr;  ///< Object records in data
+        const PropertyRecord* properties = nullptr; ///< Property records in data
+        const PrefabRecord* prefabs = nullptr;  ///< Prefab records in data
+        const char* strings = nullptr;          ///< String table in data
+        std::vector<Instance*> instances;       ///< Instantiated blocks (scene and prefab instances)
+        Instance* sceneInstance = nullptr;      ///< Block created by Instantiate
+        std::string path;                       ///< Path given to Load (empty for LoadFromMemory)
+        Debug::FileWatcher* watcher = nullptr;  ///< Watcher used by Watch
+        Scene::Scene* watchedScene = nullptr;   ///< Scene updated on hot-reload
+
+        /** @brief Called by the watcher when the file changed */
+        static void OnFileChanged(const char* path, void* userData);
+
+        /** @brief Called by the watcher when a sprite sheet changed */
+        static void OnSheetChanged(const char* path, void* userData);
+
+        /** @brief Set the values of a record on its object (the object type must match the record)
+         *  @param object Object to update
+         *  @param record Record to apply
+         *  @param offsetX Added to every x
+         *  @param offsetY Added to every y
+         */
+        void Apply(Objects::Object* object, const ObjectRecord& record, float offsetX, float offsetY);
+
+        /** @brief Read a file in one block (see Pack::ReadFile)
+         *  @param filePath Path of the file
+         *  @param size Receives the size of the file
+         *  @return Block (Memory::Free it) or nullptr on failure
+         */
+        static uint8_t* ReadFile(const char* filePath, size_t& size);
+
+        /** @brief Check every offset and index of the file
+         *  @param size Size of the data
+         *  @return true if the file can be used
+         */
+        bool Validate(size_t size);
+
+        /** @brief Create the objects of a block and add them to a scene
+         *  @param scene Scene receiving the objects (nullptr to only create them)
+         *  @param first Index of the first record
+         *  @param count Number of records
+         *  @param types Records by type
+         *  @param offsetX Added to every x
+         *  @param offsetY Added to every y
+         *  @return New instance
+         */
+        Instance* Create(Scene::Scene* scene, uint32_t first, uint32_t count, const TypeCounts& types,
+                         float offsetX, float offsetY);
+
+        /** @brief Remove the objects of an instance from a scene and free them
+         *  @param scene Scene holding the objects (nullptr if they were not added to a scene)
+         *  @param instance Instance to free (still listed in instances)
+         */
+        void Destroy(Scene::Scene* scene, Instance* instance);
+
+    public:
+        SceneFile() = default;
+
+        /** @brief Destructor - frees the objects and the file (remove them from their scene first, see Clear) */
+        ~SceneFile();
+
+        SceneFile(const SceneFile&) = delete;
+        SceneFile& operator=(const SceneFile&) = delete;
+
+        /** @brief Read a file in one block (romfs:/ or sdmc:/)
+         *  @param path Path of the .cfs file
+         *  @return true if the file was read and is valid
+         */
+        bool Load(const char* path);
+
+        /** @brief Use a file already in memory without copying it
+         *  @param memory File contents (must outlive this object)
+         *  @param size Size in bytes
+         *  @return true if the file is valid
+         */
+        bool LoadFromMemory(const void* memory, size_t size);
+
+        /** @brief Check if a file is loaded
+         *  @return true if loaded
+         */
+        bool IsLoaded() const { return header != nullptr; }
+
+        /** @brief Create the scene objects and add them to a scene
+         *  Does nothing if the scene objects were already instantiated
+         *  @param scene Scene receiving the objects
+         *  @return Number of objects created
+         */
+        int Instantiate(Scene::Scene* scene);
+
+        /** @brief Create the objects of a prefab and add them to a scene
+         *  @param scene Scene receiving the objects
+         *  @param prefabName Name of the prefab
+         *  @param x X position of the root (other objects keep their offset)
+         *  @param y Y position of the root
+         *  @return Root object or nullptr if the prefab doesn't exist
+         */
+        Objects::Object* InstantiatePrefab(Scene::Scene* scene, const char* prefabName, double x, double y);
+
+        /** @brief Remove every instantiated object from a scene and free them (the file stays loaded)
+         *  @param scene Scene holding the objects (nullptr if they were not added to a scene)
+         */
+        void Clear(Scene::Scene* scene);
+
+        /** @brief Free the objects and the file
+         *  @param scene Scene holding the objects
+         */
+        void Unload(Scene::Scene* scene);
+
+        /** @brief Read the file again and update the instantiated objects in place
+         *  When the objects of the scene block keep the same types and hierarchy, every object keeps
+         *  its address and only its values change. Otherwise the objects of the scene block are recreated.
+         *  A scene block that was never instantiated stays so.
+         *  Prefab instances are kept as they are, only new instances use the new prefabs.
+         *  @param scene Scene holding the objects
+         *  @return false if the new file can't be read (the current one stays in use)
+         */
+        bool Reload(Scene::Scene* scene);
+
+        /** @brief Load again the sheet of every sprite using it (their shared Objects::SpriteDef)
+         *  @param sheetPath Path of the sprite sheet
+         */
+        void ReloadSheet(const char* sheetPath);
+
+        /** @brief Reload the file and the sprite sheets it uses when they change on the SD card
+         *  Only sheets whose file changed are reloaded. Stops on Unload.
+         *  @param fileWatcher Watcher to register with (e.g. SceneManager::GetFileWatcher)
+         *  @param scene Scene holding the objects
+         */
+        void Watch(Debug::FileWatcher& fileWatcher, Scene::Scene* scene);
+
+        /** @brief Get number of object records (scene and prefabs)
+         *  @return Record count
+         */
+        uint32_t GetRecordCount() const { return header ? header->objectCount : 0; }
+
+        /** @brief Get an object record
+         *  @param index Index of the record
+         *  @return Record or nullptr if out of range
+         */
+        const ObjectRecord* GetRecord(uint32_t index) const;
+
+        /** @brief Get the index of a scene record by name
+         *  @param name Name of the object
+         *  @return Index or -1 if not found
+         */
+        int FindRecord(const char* name) const;
+
+        /** @brief Get the object instantiated from a scene record
+         *  @param index Index of the record
+         *  @return Object or nullptr if not instantiated
+         */
+        Objects::Object* GetObject(uint32_t index) const;
+
+        /** @brief Get a scene object by name
+         *  @param name Name of the object
+         *  @return Object or nullptr if not found
+         */
+        Objects::Object* FindObject(const char* name) const;
+
+        /** @brief Get a string of the string table
+         *  @param offset String offset
+         *  @return String, "" for NO_STRING
+         */
+        const char* GetString(uint32_t offset) const;
+
+        /** @brief Get a custom property of a record
+         *  @param index Index of the record
+         *  @param key Key of the property
+         *  @return Property or nullptr if not found
+         */
+        const PropertyRecord* FindProperty(uint32_t index, const char* key) const;
+
+        /** @brief Get an integer property
+         *  @param index Index of the record
+         *  @param key Key of the property
+         *  @param fallback Value returned if missing
+         *  @return Value (floats are truncated)
+         */
+        int GetInt(uint32_t index, const char* key, int fallback = 0) const;
+
+        /** @brief Get a float property
+         *  @param index Index of the record
+         *  @param key Key of the property
+         *  @param fallback Value returned if missing
+         *  @return Value
+         */
+        float GetFloat(uint32_t index, const char* key, float fallback = 0.0f) const;
+
+        /** @brief Get a string property
+         *  @param index Index of the record
+         *  @param key Key of the property
+         *  @param fallback Value returned if missing
+         *  @return Value
+         */
+        const char* GetText(uint32_t index, const char* key, const char* fallback = "") const;
+    };
+}
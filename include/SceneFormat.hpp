@@ -0,0 +1,129 @@
+/**
+ * @file SceneFormat.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex binary scene file layout
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @namespace SceneFormat
+ * @brief Layout of .cfs scene files
+ * Only plain structs so the host converter (tools/scenec.cpp) can include this file.
+ * Every value is little-endian and every section is 4 byte aligned:
+ *
+ *     FileHeader | ObjectRecord[objectCount] | PropertyRecord[propertyCount] | PrefabRecord[prefabCount] | strings
+ */
+namespace SceneFormat {
+    /** @brief "CFSN" */
+    constexpr uint32_t MAGIC = 0x4E534643;
+
+    /** @brief Current version, files with another version are rejected */
+    constexpr uint16_t VERSION = 1;
+
+    /** @brief String offset meaning "no string" */
+    constexpr uint32_t NO_STRING = 0xFFFFFFFF;
+
+    /** @brief Type of an object record */
+    enum ObjectType : uint8_t {
+        RECTANGLE,
+        LINE,
+        CIRCLE,
+        ELLIPSE,
+        SPRITE,
+        CUSTOM,     ///< Created by a factory registered under typeName
+        TYPE_COUNT
+    };
+
+    /** @brief Object flags */
+    enum ObjectFlags : uint8_t {
+        FLAG_VISIBLE = 1 << 0,      ///< Object::visible
+        FLAG_THREAD_SAFE = 1 << 1   ///< Object::threadSafe
+    };
+
+    /** @brief Type of a property value */
+    enum PropertyType : uint8_t {
+        PROPERTY_INT,
+        PROPERTY_FLOAT,
+        PROPERTY_STRING
+    };
+
+    /** @brief Objects of a block (the scene or a prefab) by type, to size the pools in one go */
+    struct TypeCounts {
+        uint32_t counts[TYPE_COUNT];
+    };
+
+    /** @brief File header */
+    struct FileHeader {
+        uint32_t magic;             ///< MAGIC
+        uint16_t version;           ///< VERSION
+        uint16_t headerSize;        ///< sizeof(FileHeader)
+        uint32_t fileSize;          ///< Size of the whole file
+        uint32_t objectCount;       ///< Scene objects followed by prefab objects
+        uint32_t sceneObjectCount;  ///< Objects instantiated by SceneFile::Instantiate
+        uint32_t objectsOffset;     ///< Offset of the ObjectRecord array
+        uint32_t propertyCount;     ///< Number of PropertyRecord
+        uint32_t propertiesOffset;  ///< Offset of the PropertyRecord array
+        uint32_t prefabCount;       ///< Number of PrefabRecord
+        uint32_t prefabsOffset;     ///< Offset of the PrefabRecord array
+        uint32_t stringsOffset;     ///< Offset of the string table (null-terminated strings)
+        uint32_t stringsSize;       ///< Size of the string table
+        TypeCounts sceneTypes;      ///< Scene objects by type
+    };
+
+    /** @brief One object
+     *  params by type:
+     *  - RECTANGLE, ELLIPSE: width, height
+     *  - LINE: end x, end y, thickness
+     *  - CIRCLE: radius
+     *  - SPRITE: width, height, angle in degrees, frame
+     *  - CUSTOM: free for the factory
+     */
+    struct ObjectRecord {
+        uint8_t type;               ///< ObjectType
+        uint8_t flags;              ///< ObjectFlags
+        uint16_t propertyCount;     ///< Number of properties starting at firstProperty
+        int32_t parent;             ///< Index of the parent relative to the block, -1 for none (always lower than this one)
+        uint32_t name;              ///< String offset of the name, NO_STRING if unnamed
+        uint32_t typeName;          ///< String offset of the custom type name (CUSTOM only)
+        uint32_t resource;          ///< String offset of the sprite sheet path (SPRITE only)
+        uint32_t firstProperty;     ///< Index of the first property
+        float x;                    ///< X position
+        float y;                    ///< Y position
+        float depth;                ///< Stereoscopic depth
+        uint32_t color;             ///< Color (C2D_Color32 format)
+        float params[4];            ///< Type specific values
+    };
+
+    /** @brief Custom property of an object */
+    struct PropertyRecord {
+        uint32_t key;               ///< String offset of the key
+        uint8_t type;               ///< PropertyType
+        uint8_t reserved[3];
+        union {
+            int32_t i;              ///< PROPERTY_INT
+            float f;                ///< PROPERTY_FLOAT
+            uint32_t s;             ///< PROPERTY_STRING (string offset)
+        } value;
+    };
+
+    /** @brief Block of objects instantiated by name */
+    struct PrefabRecord {
+        uint32_t name;              ///< String offset of the name
+        uint32_t firstObject;       ///< Index of the first object (the root)
+        uint32_t objectCount;       ///< Number of objects
+        TypeCounts types;           ///< Objects by type
+    };
+
+    static_assert(sizeof(FileHeader) == 48 + sizeof(TypeCounts), "FileHeader layout changed");
+    static_assert(sizeof(ObjectRecord) == 56, "ObjectRecord layout changed");
+    static_assert(sizeof(PropertyRecord) == 12, "PropertyRecord layout changed");
+    static_assert(sizeof(PrefabRecord) == 12 + sizeof(TypeCounts), "PrefabRecord layout changed");
+}
@@ -0,0 +1,146 @@
+/**
+ * @file Timers.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex timer wheel
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <vector>
+#include <unordered_map>
+
+namespace Objects { class Object; }  // Forward declaration
+
+/**
+ * @namespace Timers
+ * @brief Delayed and repeating callbacks
+ */
+namespace Timers {
+    /** @brief Function called when a timer fires
+     *  @param userData User data given when scheduling
+     */
+    typedef void (*Callback)(void* userData);
+
+    /** @brief Handle to a timer (0 is invalid) */
+    typedef u32 Handle;
+
+    /** @brief Hierarchical timer wheel with millisecond ticks
+     *  Four levels of 64 slots cover 2^24 ms (about 4.6 hours, longer delays are re-bucketed when
+     *  they come closer). Scheduling and cancelling are O(1) list operations on a pooled array;
+     *  advancing a tick only looks at one slot, so pending timers cost nothing until they fire
+     *  apart from being moved one level down every 64^level ticks.
+     */
+    class TimerWheel {
+    private:
+        static constexpr int LEVELS = 4;                    ///< Wheel levels
+        static constexpr int SLOT_BITS = 6;                 ///< Slots per level as a power of two
+        static constexpr u32 SLOTS = 1 << SLOT_BITS;        ///< Slots per level
+        static constexpr u32 NONE = 0xFFFFFFFF;             ///< End of a list
+        static constexpr u32 INDEX_BITS = 20;               ///< Handle bits holding the pool index
+
+        struct TimerData {
+            Callback callback;          ///< Function called
+            void* userData;             ///< Passed to callback
+            const Objects::Object* owner; ///< Object used for CancelOwner (can be nullptr)
+            u32 expires;                ///< Tick at which it fires
+            u32 interval;               ///< Ticks between repeats (0 for one-shot)
+            u32 previous;               ///< Previous timer in the slot (NONE for the first)
+            u32 next;                   ///< Next timer in the slot or in the free list
+            u32 ownerPrevious;          ///< Previous timer of the same owner
+            u32 ownerNext;              ///< Next timer of the same owner
+            u16 generation;             ///< Incremented each time the entry is reused
+            u8 level;                   ///< Level of the slot holding it
+            u8 slot;                    ///< Slot holding it
+            bool active;                ///< Scheduled
+        };
+
+        std::vector<TimerData> timers;                  ///< Pool of timers
+        u32 freeList = NONE;                            ///< Unused entries
+        u32 slots[LEVELS][SLOTS];                       ///< First timer of each slot
+        std::unordered_map<const Objects::Object*, u32> owners; ///< First timer of each owner
+        u32 now = 0;                                    ///< Current tick
+        float remainder = 0;                            ///< Milliseconds not yet turned into ticks
+        u32 count = 0;                                  ///< Scheduled timers
+
+        /** @brief Get the timer of a handle or nullptr if it fired or was cancelled */
+        TimerData* Find(Handle handle);
+
+        /** @brief Put a timer in the slot matching its expiry */
+        void Insert(u32 index);
+
+        /** @brief Take a timer out of its slot */
+        void Unlink(u32 index);
+
+        /** @brief Unlink a timer, remove it from its owner and free it */
+        void Release(u32 index);
+
+        /** @brief Move the timers of a slot of a higher level to the lower levels */
+        void Cascade(int level);
+
+        /** @brief Create a timer
+         *  @return Handle or 0 if the callback is nullptr
+         */
+        Handle Schedule(u32 delay, u32 interval, Callback callback, void* userData, const Objects::Object* owner);
+
+    public:
+        /** @brief Constructor
+         *  @param capacity Timers allocated up front (the pool grows past it when needed)
+         */
+        explicit TimerWheel(u32 capacity = 64);
+
+        /** @brief Call a function once after a delay
+         *  @param seconds Delay (rounded to the millisecond, at least one tick)
+         *  @param callback Function to call
+         *  @param userData Data given to the function
+         *  @param owner Object whose removal cancels the timer (can be nullptr)
+         *  @return Handle of the timer (0 if callback is nullptr)
+         */
+        Handle After(float seconds, Callback callback, void* userData = nullptr, const Objects::Object* owner = nullptr);
+
+        /** @brief Call a function repeatedly
+         *  @param seconds Interval (at least one tick); the first call happens after one interval
+         *  @param callback Function to call
+         *  @param userData Data given to the function
+         *  @param owner Object whose removal cancels the timer (can be nullptr)
+         *  @return Handle of the timer (0 if callback is nullptr)
+         */
+        Handle Every(float seconds, Callback callback, void* userData = nullptr, const Objects::Object* owner = nullptr);
+
+        /** @brief Cancel a timer (safe inside a callback, including its own)
+         *  @param handle Timer to cancel
+         *  @return false if the timer already fired or was cancelled
+         */
+        bool Cancel(Handle handle);
+
+        /** @brief Cancel every timer of an object (called when it is removed from the scene)
+         *  @param owner Object passed when scheduling
+         */
+        void CancelOwner(const Objects::Object* owner);
+
+        /** @brief Cancel every timer */
+        void Clear();
+
+        /** @brief Check if a timer is still scheduled */
+        bool IsActive(Handle handle) { return Find(handle) != nullptr; }
+
+        /** @brief Get the time left before a timer fires
+         *  @return Seconds, 0 if the timer is not scheduled
+         */
+        float GetRemaining(Handle handle);
+
+        /** @brief Get the number of scheduled timers */
+        u32 GetCount() const { return count; }
+
+        /** @brief Advance time and call the timers that expire, in expiry order
+         *  Timers scheduled by callbacks fire on a later tick, never during the same one
+         *  @param deltaTime Elapsed time in seconds
+         */
+        void Advance(float deltaTime);
+    };
+}
@@ -0,0 +1,258 @@
+/**
+ * @file Tween.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex tweens and easing
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <vector>
+
+#include "Objects.hpp"
+#include "Memory.hpp"
+
+/**
+ * @namespace Tween
+ * @brief Interpolation of object properties over time
+ */
+namespace Tween {
+    /** @brief Available easing curves */
+    enum class Ease : u8 {
+        LINEAR,
+        QUAD_IN, QUAD_OUT, QUAD_IN_OUT,
+        CUBIC_IN, CUBIC_OUT, CUBIC_IN_OUT,
+        SINE_IN, SINE_OUT, SINE_IN_OUT,
+        EXPO_IN, EXPO_OUT,
+        BACK_IN, BACK_OUT,
+        ELASTIC_OUT,
+        BOUNCE_OUT,
+        COUNT
+    };
+
+    /** @brief Property written by a tween */
+    enum class Property : u8 {
+        X,      ///< Object position X (Objects::Object::SetX)
+        Y,      ///< Object position Y (Objects::Object::SetY)
+        ANGLE,  ///< Sprite angle in degrees (Objects::Sprite::SetAngle)
+        COLOR,  ///< RGBA color (u32), each channel is interpolated
+        VALUE   ///< Any double
+    };
+
+    /** @brief Function called when a tween completes
+     *  @param userData User data given to OnComplete
+     */
+    typedef void (*Callback)(void* userData);
+
+    /** @brief Handle to a tween (0 is invalid) */
+    typedef u32 Handle;
+
+    /** @brief Function telling if the tweens of an owner are paused this frame
+     *  @param owner Object passed when creating the tween (never nullptr)
+     */
+    typedef bool (*PauseFilter)(const Objects::Object* owner);
+
+    /** @brief Evaluate an easing curve
+     *  @param ease Easing curve
+     *  @param t Progress between 0 and 1
+     *  @return Eased progress
+     */
+    float Evaluate(Ease ease, float t);
+
+    /** @brief Interpolate two colors channel by channel
+     *  @param from Start color
+     *  @param to End color
+     *  @param t Progress between 0 and 1
+     *  @return Interpolated color
+     */
+    u32 LerpColor(u32 from, u32 to, float t);
+
+    /** @brief Owns and evaluates every active tween in one pass per frame
+     *  Tweens are stored in a contiguous array that grows up to the capacity and is never shrunk,
+     *  so once the peak count is reached creating them does not allocate. The arrays are counted
+     *  under Memory::Tag::SCENE.
+     */
+    class TweenManager {
+    private:
+        static constexpr u16 INITIAL_CAPACITY = 64;    ///< Tweens allocated by the constructor
+
+        enum Flags : u8 {
+            ACTIVE = 1 << 0,        ///< Running (not waiting for a previous tween of a sequence)
+            STARTED = 1 << 1,       ///< Start value captured
+            FROM_CURRENT = 1 << 2,  ///< Start from the current value of the property
+            YOYO = 1 << 3,          ///< Play backward after each forward pass
+            REVERSED = 1 << 4,      ///< Currently playing backward
+            DEAD = 1 << 5           ///< Finished or cancelled, removed at the end of Update
+        };
+
+        struct TweenData {
+            void* target;               ///< Object, Sprite, u32 or double written to
+            Objects::Object* owner;     ///< Object used for CancelTarget
+            double from;                ///< Start value (double like object positions)
+            double to;                  ///< End value
+            u32 fromColor;              ///< Start color
+            u32 toColor;                ///< End color
+            float duration;             ///< Duration in seconds
+            float delay;                ///< Delay before start in seconds
+            float elapsed;              ///< Time spent since creation or last repeat
+            Callback onComplete;        ///< Called once the tween completes
+            void* userData;             ///< Passed to onComplete
+            Handle next;                ///< Tween started once this one completes
+            u16 slot;                   ///< Slot of the handle pointing to this tween
+            s16 repeats;                ///< Remaining repeats (-1 for infinite)
+            Property property;          ///< Property written
+            Ease ease;                  ///< Easing curve
+            u8 flags;                   ///< Flags
+        };
+
+        /** @brief What Update needs of a completed tween once it is removed */
+        struct Completion {
+            Callback onComplete;        ///< Called once the tween completes
+            void* userData;             ///< Passed to onComplete
+            Handle next;                ///< Tween started once this one completes
+        };
+
+        template<typename T>
+        using Array = std::vector<T, Memory::Allocator<T, Memory::Tag::SCENE>>;
+
+        Array<TweenData> tweens;                ///< Dense array of tweens
+        Array<u16> slotToIndex;                 ///< Handle slot -> index in tweens
+        Array<u16> slotGeneration;              ///< Incremented each time a slot is reused
+        Array<u16> freeSlots;                   ///< Unused slots
+        Array<Completion> completed;            ///< Tweens completed this frame (for callbacks)
+        u16 capacity;                           ///< Maximum number of slots
+
+        TweenData* Find(Handle handle);
+        Handle Create(Property property, void* target, Objects::Object* owner, double to, float duration, Ease ease);
+        void Start(TweenData& tween);
+        void Write(TweenData& tween, float progress);
+        void Remove(size_t index);
+
+    public:
+        /** @brief Constructor
+         *  @param capacity Maximum number of simultaneous tweens (the arrays start smaller and grow)
+         */
+        explicit TweenManager(u16 capacity = 4096);
+
+        /** @brief Tween the X position of an object
+         *  @param object Object to move
+         *  @param to Final X position
+         *  @param duration Duration in seconds
+         *  @param ease Easing curve
+         *  @return Handle of the tween (0 if the manager is full)
+         */
+        Handle MoveX(Objects::Object* object, double to, float duration, Ease ease = Ease::LINEAR);
+
+        /** @brief Tween the Y position of an object
+         *  @param object Object to move
+         *  @param to Final Y position
+         *  @param duration Duration in seconds
+         *  @param ease Easing curve
+         *  @return Handle of the tween (0 if the manager is full)
+         */
+        Handle MoveY(Objects::Object* object, double to, float duration, Ease ease = Ease::LINEAR);
+
+        /** @brief Tween the angle of a sprite
+         *  @param sprite Sprite to rotate
+         *  @param to Final angle in degrees
+         *  @param duration Duration in seconds
+         *  @param ease Easing curve
+         *  @return Handle of the tween (0 if the manager is full)
+         */
+        Handle Rotate(Objects::Sprite* sprite, double to, float duration, Ease ease = Ease::LINEAR);
+
+        /** @brief Tween a color
+         *  @param owner Object owning the color (used by CancelTarget, can be nullptr)
+         *  @param color Color to modify (e.g. &rectangle.color)
+         *  @param to Final color
+         *  @param duration Duration in seconds
+         *  @param ease Easing curve
+         *  @return Handle of the tween (0 if the manager is full)
+         */
+        Handle Color(Objects::Object* owner, u32* color, u32 to, float duration, Ease ease = Ease::LINEAR);
+
+        /** @brief Tween any double value
+         *  @param owner Object owning the value (used by CancelTarget, can be nullptr)
+         *  @param value Value to modify
+         *  @param to Final value
+         *  @param duration Duration in seconds
+         *  @param ease Easing curve
+         *  @return Handle of the tween (0 if the manager is full)
+         */
+        Handle Value(Objects::Object* owner, double* value, double to, float duration, Ease ease = Ease::LINEAR);
+
+        /** @brief Set the start value instead of using the current one
+         *  @param handle Tween to modify
+         *  @param from Start value
+         */
+        void From(Handle handle, double from);
+
+        /** @brief Set the start color instead of using the current one
+         *  @param handle Tween to modify
+         *  @param from Start color
+         */
+        void FromColor(Handle handle, u32 from);
+
+        /** @brief Wait before starting
+         *  @param handle Tween to modify
+         *  @param delay Delay in seconds
+         */
+        void SetDelay(Handle handle, float delay);
+
+        /** @brief Repeat the tween
+         *  @param handle Tween to modify
+         *  @param count Number of extra passes (-1 for infinite)
+         *  @param yoyo If true every other pass plays backward
+         */
+        void SetRepeat(Handle handle, s16 count, bool yoyo = false);
+
+        /** @brief Set a function called when the tween completes (not when it is cancelled)
+         *  @param handle Tween to modify
+         *  @param callback Function to call
+         *  @param userData Data given to the function
+         */
+        void OnComplete(Handle handle, Callback callback, void* userData = nullptr);
+
+        /** @brief Start a tween only once another completes (sequence)
+         *  @param handle Tween playing first
+         *  @param next Tween to play after it (it must not have started yet)
+         *  @return next, so calls can be chained
+         */
+        Handle Then(Handle handle, Handle next);
+
+        /** @brief Check if a tween is still running or waiting
+         *  @param handle Tween to check
+         *  @return true if the tween exists
+         */
+        bool IsActive(Handle handle);
+
+        /** @brief Cancel a tween and the tweens sequenced after it
+         *  @param handle Tween to cancel
+         */
+        void Cancel(Handle handle);
+
+        /** @brief Cancel every tween writing to an object
+         *  @param owner Object (or Sprite) passed when creating the tweens
+         */
+        void CancelTarget(const Objects::Object* owner);
+
+        /** @brief Cancel all tweens */
+        void Clear();
+
+        /** @brief Get the number of tweens (running or waiting)
+         *  @return Tween count
+         */
+        size_t GetCount() const { return tweens.size(); }
+
+        /** @brief Advance and apply every tween
+         *  @param deltaTime Elapsed time in seconds
+         *  @param isPaused Tweens whose owner it returns true for keep their progress (nullptr: none paused)
+         */
+        void Update(float deltaTime, PauseFilter isPaused = nullptr);
+    };
+}
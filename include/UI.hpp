@@ -0,0 +1,461 @@
+/**
+ * @file UI.hpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex touch UI widgets
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <3ds.h>
+#include <vector>
+
+#include "Objects.hpp"
+#include "Colors.hpp"
+#include "Math.hpp"
+
+/**
+ * @namespace UI
+ * @brief Widget tree for the bottom screen
+ * A Canvas is an object added to a bottom screen scene. It owns the root widget, lays the tree
+ * out when it changes, finds the widget under the stylus through a grid and moves the focus
+ * with the D-pad. Widgets are not owned by the tree: like scene elements they are usually
+ * members of the scene.
+ */
+namespace UI {
+    /** @brief Screen rectangle */
+    struct Rect {
+        float x = 0;
+        float y = 0;
+        float width = 0;
+        float height = 0;
+
+        /** @brief Check if a point is inside */
+        bool Contains(float px, float py) const {
+            return px >= x && py >= y && px < x + width && py < y + height;
+        }
+
+        /** @brief Check if the rectangle has no area */
+        bool Empty() const { return width <= 0 || height <= 0; }
+
+        /** @brief Get the overlap of two rectangles (empty if they do not overlap) */
+        Rect Intersect(const Rect& other) const;
+    };
+
+    /** @brief Type of a touch event */
+    enum class TouchType : u8 {
+        PRESS,          ///< Stylus put down on the widget
+        DRAG,           ///< Stylus moved further than the drag threshold
+        RELEASE,        ///< Stylus lifted (position is the last one touched)
+        LONG_PRESS,     ///< Stylus held still for the long press time
+        CANCEL          ///< A parent took over the touch (e.g. a scroll view started scrolling)
+    };
+
+    /** @brief Touch event sent to a widget */
+    struct TouchEvent {
+        TouchType type;         ///< Event type
+        Math::Vec2f position;   ///< Current position
+        Math::Vec2f delta;      ///< Movement since the previous event
+        Math::Vec2f start;      ///< Position of the press
+    };
+
+    /** @brief D-pad direction used for focus navigation */
+    enum class Direction : u8 {
+        LEFT,
+        RIGHT,
+        UP,
+        DOWN
+    };
+
+    /** @brief Counters of a canvas */
+    struct Stats {
+        u32 layouts = 0;        ///< Layout passes (only when the tree changed)
+        u32 hitTests = 0;       ///< Touches looked up in the grid
+        u32 widgetsTested = 0;  ///< Widgets tested by those lookups
+    };
+
+    class Canvas;
+
+    /** @brief Base class of the widgets
+     *  The frame is relative to the content of the parent. Changing the tree, a frame or the
+     *  visibility marks the layout dirty; it is recomputed once before the next touch or draw.
+     */
+    class Widget {
+    private:
+        friend class Canvas;
+
+        Rect frame;                         ///< Position in the parent and size
+        Rect bounds;                        ///< Screen rectangle (set by the layout)
+        Rect clip;                          ///< Visible part of the screen (set by the layout)
+        Widget* parent = nullptr;           ///< Parent widget
+        Canvas* canvas = nullptr;           ///< Canvas of the tree
+        std::vector<Widget*> children;      ///< Child widgets, drawn in order
+        bool visible = true;                ///< Drawn and touchable
+        bool enabled = true;                ///< Touchable and focusable
+        bool focused = false;               ///< Has the D-pad focus
+        bool pressed = false;               ///< Stylus is down on the widget
+
+        /** @brief Set the canvas of a subtree */
+        void SetCanvas(Canvas* newCanvas);
+
+    protected:
+        bool touchable = false;             ///< Receives touch events (set by the widget types)
+        bool focusable = false;             ///< Can get the D-pad focus (set by the widget types)
+
+        /** @brief Mark the layout of the canvas dirty */
+        void MarkLayoutDirty();
+
+        /** @brief Set the frames of the children (containers)
+         *  Called by the layout before and after the children arranged themselves
+         */
+        virtual void Arrange() {}
+
+        /** @brief Get the offset applied to the children (scrolling) */
+        virtual Math::Vec2f GetContentOffset() const { return Math::Vec2f(0, 0); }
+
+        /** @brief Check if the children are clipped to the bounds */
+        virtual bool ClipsChildren() const { return false; }
+
+        /** @brief Handle a touch event
+         *  @param event Event
+         *  @return true if handled; unhandled events go to the parent, and a parent handling a DRAG
+         *  takes over the touch (the widget receives CANCEL)
+         */
+        virtual bool OnTouch(const TouchEvent& event) { return false; }
+
+        /** @brief Handle a D-pad direction while focused
+         *  @return true if used (e.g. a slider), false to move the focus
+         */
+        virtual bool OnDirection(Direction direction) { return false; }
+
+        /** @brief Called when A is pressed while focused */
+        virtual void OnActivate() {}
+
+        /** @brief Called when a descendant gets the focus (scroll views scroll to it) */
+        virtual void OnDescendantFocused(Widget* widget) {}
+
+        /** @brief Draw the widget (children are drawn after it) */
+        virtual void Draw() {}
+
+        /** @brief Call OnDescendantFocused on the ancestors of a widget (e.g. a list row moved to) */
+        static void RevealWidget(Widget* widget);
+
+        /** @brief Fill a rectangle clipped to the visible part of the widget
+         *  @param x Left in screen coordinates
+         *  @param y Top in screen coordinates
+         *  @param width Width
+         *  @param height Height
+         *  @param color Color
+         */
+        void FillRect(float x, float y, float width, float height, u32 color) const;
+
+        /** @brief Draw a one pixel outline inside the bounds, clipped */
+        void DrawOutline(u32 color) const;
+
+    public:
+        /** @brief Destructor, removes the widget from its parent */
+        virtual ~Widget();
+
+        /** @brief Add a child widget
+         *  @param child Widget (removed from its previous parent)
+         */
+        void Add(Widget* child);
+
+        /** @brief Remove a child widget
+         *  @param child Widget
+         */
+        void Remove(Widget* child);
+
+        /** @brief Set the position in the parent and the size
+         *  @param x Left relative to the parent content
+         *  @param y Top relative to the parent content
+         *  @param width Width
+         *  @param height Height
+         */
+        void SetFrame(float x, float y, float width, float height);
+
+        /** @brief Set the size, keeping the position */
+        void SetSize(float width, float height) { SetFrame(frame.x, frame.y, width, height); }
+
+        /** @brief Show or hide the widget and its children */
+        void SetVisible(bool value);
+
+        /** @brief Enable or disable touch and focus on the widget */
+        void SetEnabled(bool value);
+
+        const Rect& GetFrame() const { return frame; }
+        const Rect& GetBounds() const { return bounds; }
+        Widget* GetParent() const { return parent; }
+        Canvas* GetCanvas() const { return canvas; }
+        size_t GetChildCount() const { return children.size(); }
+        Widget* GetChild(size_t index) const { return children[index]; }
+        bool IsVisible() const { return visible; }
+        bool IsEnabled() const { return enabled; }
+        bool IsFocused() const { return focused; }
+        bool IsPressed() const { return pressed; }
+
+        /** @brief Check if this widget is an ancestor of another one (or the same) */
+        bool Contains(const Widget* widget) const;
+    };
+
+    /** @brief Touchable rectangle with click and long press callbacks */
+    class Button : public Widget {
+    public:
+        /** @brief Function called by a button
+         *  @param button Button
+         *  @param userData Pointer given with the callback
+         */
+        typedef void (*Callback)(Button* button, void* userData);
+
+    private:
+        Callback onClick = nullptr;         ///< Called on release inside the button or on A
+        void* clickData = nullptr;          ///< Pointer passed to onClick
+        Callback onLongPress = nullptr;     ///< Called on long press
+        void* longPressData = nullptr;      ///< Pointer passed to onLongPress
+        bool longPressed = false;           ///< The current touch was a long press (no click on release)
+
+    protected:
+        bool OnTouch(const TouchEvent& event) override;
+        void OnActivate() override;
+        void Draw() override;
+
+    public:
+        u32 color = Colors::clrSkyBlue;         ///< Normal color
+        u32 pressedColor = Colors::clrBlue;     ///< Color while pressed
+        u32 focusColor = Colors::clrWhite;      ///< Outline color when focused
+        u32 disabledColor = Colors::clrBrown;   ///< Color when disabled
+
+        Button() { touchable = true; focusable = true; }
+
+        /** @brief Set the function called on click */
+        void SetOnClick(Callback callback, void* userData = nullptr) { onClick = callback; clickData = userData; }
+
+        /** @brief Set the function called on long press */
+        void SetOnLongPress(Callback callback, void* userData = nullptr) { onLongPress = callback; longPressData = userData; }
+    };
+
+    /** @brief Horizontal value slider (stylus or left/right when focused) */
+    class Slider : public Widget {
+    public:
+        /** @brief Function called when the value changes
+         *  @param slider Slider
+         *  @param userData Pointer given with the callback
+         */
+        typedef void (*Callback)(Slider* slider, void* userData);
+
+    private:
+        float value = 0;                    ///< Current value
+        float minimum = 0;                  ///< Lowest value
+        float maximum = 1;                  ///< Highest value
+        float step = 0.05f;                 ///< D-pad increment
+        Callback onChange = nullptr;        ///< Called when the value changes
+        void* changeData = nullptr;         ///< Pointer passed to onChange
+
+        /** @brief Set the value from a screen x position */
+        void SetFromPosition(float x);
+
+    protected:
+        bool OnTouch(const TouchEvent& event) override;
+        bool OnDirection(Direction direction) override;
+        void Draw() override;
+
+    public:
+        u32 trackColor = Colors::clrLavender;   ///< Track color
+        u32 fillColor = Colors::clrSkyBlue;     ///< Color of the part below the value
+        u32 knobColor = Colors::clrWhite;       ///< Knob color
+        u32 focusColor = Colors::clrWhite;      ///< Outline color when focused
+
+        Slider() { touchable = true; focusable = true; }
+
+        /** @brief Set the range and the D-pad increment */
+        void SetRange(float min, float max, float dpadStep);
+
+        /** @brief Set the value (clamped, calls onChange if it changed) */
+        void SetValue(float newValue);
+
+        float GetValue() const { return value; }
+
+        /** @brief Set the function called when the value changes */
+        void SetOnChange(Callback callback, void* userData = nullptr) { onChange = callback; changeData = userData; }
+    };
+
+    /** @brief Vertical stack of rows with a selected row
+     *  Children are placed from top to bottom at full width and keep their height; the list is
+     *  as tall as its rows. Tapping a row or pressing A selects it.
+     */
+    class List : public Widget {
+    public:
+        /** @brief Function called when a row is selected
+         *  @param list List
+         *  @param index Selected row
+         *  @param userData Pointer given with the callback
+         */
+        typedef void (*Callback)(List* list, int index, void* userData);
+
+    private:
+        int selected = -1;                  ///< Selected row (-1: none)
+        int highlighted = 0;                ///< Row moved with the D-pad
+        Callback onSelect = nullptr;        ///< Called when a row is selected
+        void* selectData = nullptr;         ///< Pointer passed to onSelect
+
+        /** @brief Get the row at a screen y position (-1 if none) */
+        int GetRowAt(float y) const;
+
+    protected:
+        void Arrange() override;
+        bool OnTouch(const TouchEvent& event) override;
+        bool OnDirection(Direction direction) override;
+        void OnActivate() override;
+        void Draw() override;
+
+    public:
+        float spacing = 2;                          ///< Space between rows
+        u32 selectedColor = Colors::clrSkyBlue;     ///< Background of the selected row
+        u32 highlightColor = Colors::clrLavender;   ///< Background of the D-pad row when focused
+
+        List() { touchable = true; focusable = true; }
+
+        /** @brief Select a row (calls onSelect)
+         *  @param index Row index (-1 to clear the selection without callback)
+         */
+        void Select(int index);
+
+        int GetSelected() const { return selected; }
+
+        /** @brief Set the function called when a row is selected */
+        void SetOnSelect(Callback callback, void* userData = nullptr) { onSelect = callback; selectData = userData; }
+    };
+
+    /** @brief Vertically scrolling, clipped container
+     *  Dragging anywhere inside scrolls, also when the drag started on a button.
+     */
+    class ScrollView : public Widget {
+    private:
+        float scroll = 0;                   ///< Scroll offset
+        float contentHeight = 0;            ///< Height of the children
+
+    protected:
+        void Arrange() override;
+        Math::Vec2f GetContentOffset() const override { return Math::Vec2f(0, scroll); }
+        bool ClipsChildren() const override { return true; }
+        bool OnTouch(const TouchEvent& event) override;
+        void OnDescendantFocused(Widget* widget) override;
+        void Draw() override;
+
+    public:
+        u32 barColor = Colors::clrLavender; ///< Scroll bar color
+
+        ScrollView() { touchable = true; }
+
+        /** @brief Scroll to an offset (clamped to the content) */
+        void ScrollTo(float offset);
+
+        float GetScroll() const { return scroll; }
+    };
+
+    /** @brief Root of a widget tree, added to a bottom screen scene
+     *  Touch lookups use a grid of CELL_SIZE cells holding the touchable widgets that overlap
+     *  them, rebuilt with the layout, so a touch only tests the few widgets under the stylus.
+     */
+    class Canvas : public Objects::Object {
+    private:
+        friend class Widget;
+
+        static constexpr int CELL_SIZE = 32;                            ///< Grid cell size in pixels
+        static constexpr int GRID_COLUMNS = (320 + CELL_SIZE - 1) / CELL_SIZE;
+        static constexpr int GRID_ROWS = (240 + CELL_SIZE - 1) / CELL_SIZE;
+
+        Widget root;                                    ///< Root widget covering the bottom screen
+        std::vector<Widget*> cells[GRID_COLUMNS * GRID_ROWS]; ///< Touchable widgets per cell, topmost last
+        std::vector<Widget*> focusables;                ///< Focusable widgets in tree order
+        bool layoutDirty = true;                        ///< Tree changed since the last layout
+        Widget* captured = nullptr;                     ///< Widget receiving the current touch
+        Widget* focus = nullptr;                        ///< Focused widget
+        bool touching = false;                          ///< Stylus is down
+        bool dragging = false;                          ///< Stylus moved beyond the drag threshold
+        bool longPressSent = false;                     ///< LONG_PRESS already sent for this touch
+        float holdTime = 0;                             ///< Seconds since the press
+        Math::Vec2f touchStart;                         ///< Position of the press
+        Math::Vec2f lastTouch;                          ///< Last position
+        Stats stats;                                    ///< Counters
+
+        /** @brief Let the containers of a subtree set the frames of their children */
+        void ArrangeWidget(Widget* widget);
+
+        /** @brief Place a subtree and add it to the grid */
+        void LayoutWidget(Widget* widget);
+
+        /** @brief Send an event to a widget, then to its parents until one handles it
+         *  @return Widget that handled it or nullptr
+         */
+        Widget* Deliver(Widget* widget, TouchType type, Math::Vec2f position, Math::Vec2f delta);
+
+        /** @brief Draw a subtree */
+        void DrawWidget(Widget* widget);
+
+        /** @brief Forget the focus and the touch of a removed subtree */
+        void OnWidgetRemoved(Widget* widget);
+
+    protected:
+        /** @brief Read the touch screen, the D-pad and A */
+        void OnUpdate(Scene::Scene* scene) override;
+
+    public:
+        float longPressTime = 0.5f;     ///< Seconds held still before LONG_PRESS
+        float dragThreshold = 6.0f;     ///< Pixels moved before a press becomes a drag
+
+        /** @brief Constructor */
+        Canvas();
+
+        /** @brief Destructor, detaches the widgets */
+        ~Canvas();
+
+        /** @brief Add a widget to the root */
+        void Add(Widget* widget) { root.Add(widget); }
+
+        /** @brief Get the root widget (covers the bottom screen) */
+        Widget& GetRoot() { return root; }
+
+        /** @brief Lay the tree out if it changed */
+        void Layout();
+
+        /** @brief Get the topmost touchable widget at a point
+         *  @return Widget or nullptr
+         */
+        Widget* HitTest(float x, float y);
+
+        /** @brief Feed the touch state of a frame (called by OnUpdate)
+         *  @param pressed Stylus is down
+         *  @param x Touch x
+         *  @param y Touch y
+         *  @param deltaTime Seconds since the previous call
+         */
+        void ProcessTouch(bool pressed, float x, float y, float deltaTime);
+
+        /** @brief Move the focus or let the focused widget use the direction */
+        void ProcessDirection(Direction direction);
+
+        /** @brief Activate the focused widget (A button) */
+        void ProcessActivate();
+
+        /** @brief Give the focus to a widget
+         *  @param widget Focusable widget of this canvas or nullptr
+         */
+        void SetFocus(Widget* widget);
+
+        Widget* GetFocus() const { return focus; }
+
+        /** @brief Draw the widget tree */
+        void Draw() override;
+
+        /** @brief Get the counters since the last reset */
+        const Stats& GetStats() const { return stats; }
+
+        /** @brief Reset the counters */
+        void ResetStats() { stats = Stats(); }
+    };
+}
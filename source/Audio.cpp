@@ -0,0 +1,207 @@
+/**
+ * @file Audio.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex audio output implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Audio.hpp"
+#include "Memory.hpp"
+#include <string.h>
+
+namespace Audio {
+    static constexpr size_t WORKER_STACK_SIZE = 32 * 1024;
+
+    // Sound
+
+    bool Sound::Load(const char* path) {
+        Unload();
+
+        FILE* file = fopen(path, "rb");
+        if (!file) return false;
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        memory = size > 0 ? Memory::Allocate(size, Memory::Tag::AUDIO) : nullptr;
+        bool loaded = memory && fread(memory, 1, size, file) == (size_t)size;
+        fclose(file);
+
+        WavInfo info;
+        if (!loaded || !ParseWav(static_cast<const u8*>(memory), size, info) ||
+            (size_t)info.dataOffset + info.dataSize > (size_t)size) {
+            Unload();
+            return false;
+        }
+
+        // Chunks have even sizes, so the samples are 2 byte aligned in the 8 byte aligned block
+        data.samples = reinterpret_cast<const s16*>(static_cast<const u8*>(memory) + info.dataOffset);
+        data.frames = info.dataSize / (info.channels * 2);
+        data.rate = info.rate;
+        data.channels = info.channels;
+        return true;
+    }
+
+    void Sound::Unload() {
+        Memory::Free(memory);
+        memory = nullptr;
+        data = SoundData();
+    }
+
+    // NdspBackend
+
+    bool NdspBackend::Start(Mixer* target) {
+        Stop();
+        if (R_FAILED(ndspInit())) return false;
+        initialized = true;
+
+        samples = static_cast<s16*>(Memory::LinearAllocate(BUFFER_COUNT * BUFFER_FRAMES * 2 * sizeof(s16), Memory::Tag::AUDIO));
+        if (!samples) {
+            Stop();
+            return false;
+        }
+
+        ndspSetOutputMode(NDSP_OUTPUT_STEREO);
+        ndspChnReset(channel);
+        ndspChnSetInterp(channel, NDSP_INTERP_NONE);
+        ndspChnSetRate(channel, OUTPUT_RATE);
+        ndspChnSetFormat(channel, NDSP_FORMAT_STEREO_PCM16);
+
+        float mix[12] = { 0 };
+        mix[0] = 1.0f;
+        mix[1] = 1.0f;
+        ndspChnSetMix(channel, mix);
+
+        mixer = target;
+        memset(waveBuffers, 0, sizeof(waveBuffers));
+        for (int i = 0; i < BUFFER_COUNT; i++) {
+            waveBuffers[i].data_pcm16 = samples + i * BUFFER_FRAMES * 2;
+            waveBuffers[i].nsamples = BUFFER_FRAMES;
+            Fill(waveBuffers[i]);
+        }
+        return true;
+    }
+
+    void NdspBackend::Fill(ndspWaveBuf& buffer) {
+        mixer->Mix(buffer.data_pcm16, BUFFER_FRAMES);
+        DSP_FlushDataCache(buffer.data_pcm16, BUFFER_FRAMES * 2 * sizeof(s16));
+        ndspChnWaveBufAdd(channel, &buffer);
+    }
+
+    void NdspBackend::Update(float deltaTime) {
+        if (!mixer) return;
+        for (ndspWaveBuf& buffer : waveBuffers) {
+            if (buffer.status == NDSP_WBUF_DONE) Fill(buffer);
+        }
+    }
+
+    void NdspBackend::Stop() {
+        if (initialized) {
+            ndspChnWaveBufClear(channel);
+            ndspExit();
+            initialized = false;
+        }
+        Memory::LinearFree(samples);
+        samples = nullptr;
+        mixer = nullptr;
+    }
+
+    // AudioSystem
+
+    AudioSystem::AudioSystem() {
+        LightLock_Init(&lock);
+        LightEvent_Init(&wakeUp, RESET_ONESHOT);
+    }
+
+    bool AudioSystem::Start() {
+        Stop();
+
+        backend = &ndsp;
+        if (!ndsp.Start(&mixer)) {
+            backend = &silent;
+            silent.Start(&mixer);
+        }
+
+        // Above the main thread so decoding catches up while a frame is being built
+        s32 priority = 0x30;
+        svcGetThreadPriority(&priority, CUR_THREAD_HANDLE);
+        running = true;
+        worker = threadCreate(WorkerMain, this, WORKER_STACK_SIZE, priority - 1, -2, false);
+        if (!worker) running = false;
+
+        return HasOutput();
+    }
+
+    void AudioSystem::Stop() {
+        if (worker) {
+            running = false;
+            LightEvent_Signal(&wakeUp);
+            threadJoin(worker, U64_MAX);
+            threadFree(worker);
+            worker = nullptr;
+        }
+        if (backend) {
+            backend->Stop();
+            backend = nullptr;
+        }
+        mixer.StopAll();
+        music.clear();
+    }
+
+    void AudioSystem::WorkerMain(void* arg) {
+        AudioSystem* system = static_cast<AudioSystem*>(arg);
+        while (true) {
+            LightEvent_Wait(&system->wakeUp);
+            if (!system->running) break;
+
+            LightLock_Lock(&system->lock);
+            for (const Music& playing : system->music) {
+                playing.stream->Decode();
+            }
+            LightLock_Unlock(&system->lock);
+        }
+    }
+
+    void AudioSystem::Update(float deltaTime) {
+        if (!backend) return;
+        backend->Update(deltaTime);
+
+        for (const Music& playing : music) {
+            if (playing.stream->NeedsData()) {
+                if (worker) {
+                    LightEvent_Signal(&wakeUp);
+                } else {
+                    // No thread available: decode on the main thread
+                    playing.stream->Decode();
+                }
+            }
+        }
+    }
+
+    int AudioSystem::PlayMusic(Stream* stream, float volume) {
+        int handle = mixer.PlayStream(stream, volume);
+        if (handle < 0) return -1;
+
+        LightLock_Lock(&lock);
+        music.push_back({ stream, handle });
+        LightLock_Unlock(&lock);
+        return handle;
+    }
+
+    void AudioSystem::StopMusic(Stream* stream) {
+        // Waits for the worker to finish decoding so the stream can be destroyed afterwards
+        LightLock_Lock(&lock);
+        for (size_t i = 0; i < music.size(); i++) {
+            if (music[i].stream == stream) {
+                mixer.Stop(music[i].handle);
+                music.erase(music.begin() + i);
+                break;
+            }
+        }
+        LightLock_Unlock(&lock);
+    }
+}
@@ -0,0 +1,550 @@
+/**
+ * @file AudioMixer.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex software audio mixer implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "AudioMixer.hpp"
+#include <string.h>
+
+namespace Audio {
+    static uint32_t ReadU32(const uint8_t* data) {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    static uint16_t ReadU16(const uint8_t* data) {
+        uint16_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    static int32_t ToQ15(float value) {
+        if (value < 0) value = 0;
+        if (value > 4) value = 4;
+        return (int32_t)(value * VOLUME_ONE);
+    }
+
+    static uint32_t ToStep(uint32_t rate, float pitch) {
+        if (pitch < 0.01f) pitch = 0.01f;
+        return (uint32_t)((double)rate / OUTPUT_RATE * pitch * 65536.0 + 0.5);
+    }
+
+    bool ParseWav(const uint8_t* data, size_t size, WavInfo& info) {
+        if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) return false;
+
+        bool hasFormat = false;
+        size_t offset = 12;
+        while (offset + 8 <= size) {
+            const uint8_t* chunk = data + offset;
+            uint32_t chunkSize = ReadU32(chunk + 4);
+
+            if (memcmp(chunk, "fmt ", 4) == 0) {
+                if (offset + 8 + 16 > size) return false;
+                uint16_t format = ReadU16(chunk + 8);
+                uint16_t channels = ReadU16(chunk + 10);
+                uint16_t bits = ReadU16(chunk + 22);
+                // WAVE_FORMAT_EXTENSIBLE files keep plain PCM in the sub-format
+                if ((format != 1 && format != 0xFFFE) || bits != 16 || channels < 1 || channels > 2) return false;
+                info.channels = channels;
+                info.rate = ReadU32(chunk + 12);
+                hasFormat = true;
+            } else if (memcmp(chunk, "data", 4) == 0) {
+                if (!hasFormat || info.rate == 0) return false;
+                info.dataOffset = offset + 8;
+                info.dataSize = chunkSize - chunkSize % (info.channels * 2);
+                return true;
+            }
+
+            // Chunks are padded to an even size
+            offset += 8 + chunkSize + (chunkSize & 1);
+        }
+        return false;
+    }
+
+    // Kernels: plain indexed loops over restrict pointers so the compiler can unroll and pipeline them
+
+    void Kernels::MixMono(int32_t* __restrict accumulator, const int16_t* __restrict source, uint32_t frames,
+                          int32_t left, int32_t right) {
+        for (uint32_t i = 0; i < frames; i++) {
+            int32_t sample = source[i];
+            accumulator[i * 2] += (sample * left) >> 15;
+            accumulator[i * 2 + 1] += (sample * right) >> 15;
+        }
+    }
+
+    void Kernels::MixStereo(int32_t* __restrict accumulator, const int16_t* __restrict source, uint32_t frames,
+                            int32_t left, int32_t right) {
+        for (uint32_t i = 0; i < frames; i++) {
+            accumulator[i * 2] += (source[i * 2] * left) >> 15;
+            accumulator[i * 2 + 1] += (source[i * 2 + 1] * right) >> 15;
+        }
+    }
+
+    // The fraction is reduced to 15 bits so (b - a) * fraction fits in 32 bits
+    void Kernels::MixMonoResample(int32_t* __restrict accumulator, const int16_t* __restrict source, uint32_t frames,
+                                  int32_t left, int32_t right, uint32_t& index, uint32_t& fraction, uint32_t step) {
+        uint32_t position = index;
+        uint32_t part = fraction;
+        for (uint32_t i = 0; i < frames; i++) {
+            int32_t a = source[position];
+            int32_t b = source[position + 1];
+            int32_t sample = a + (((b - a) * (int32_t)(part >> 1)) >> 15);
+            accumulator[i * 2] += (sample * left) >> 15;
+            accumulator[i * 2 + 1] += (sample * right) >> 15;
+
+            part += step;
+            position += part >> 16;
+            part &= 0xFFFF;
+        }
+        index = position;
+        fraction = part;
+    }
+
+    void Kernels::MixStereoResample(int32_t* __restrict accumulator, const int16_t* __restrict source, uint32_t frames,
+                                    int32_t left, int32_t right, uint32_t& index, uint32_t& fraction, uint32_t step) {
+        uint32_t position = index;
+        uint32_t part = fraction;
+        for (uint32_t i = 0; i < frames; i++) {
+            const int16_t* frame = source + position * 2;
+            int32_t weight = part >> 1;
+            int32_t sampleLeft = frame[0] + (((frame[2] - frame[0]) * weight) >> 15);
+            int32_t sampleRight = frame[1] + (((frame[3] - frame[1]) * weight) >> 15);
+            accumulator[i * 2] += (sampleLeft * left) >> 15;
+            accumulator[i * 2 + 1] += (sampleRight * right) >> 15;
+
+            part += step;
+            position += part >> 16;
+            part &= 0xFFFF;
+        }
+        index = position;
+        fraction = part;
+    }
+
+    void Kernels::Clamp(int16_t* __restrict output, const int32_t* __restrict accumulator, uint32_t samples) {
+        for (uint32_t i = 0; i < samples; i++) {
+            int32_t value = accumulator[i];
+            output[i] = value > 32767 ? 32767 : (value < -32768 ? -32768 : value);
+        }
+    }
+
+    // WavDecoder
+
+    bool WavDecoder::Open(const char* path) {
+        Close();
+        file = fopen(path, "rb");
+        if (!file) return false;
+
+        uint8_t header[4096];
+        size_t size = fread(header, 1, sizeof(header), file);
+        if (!ParseWav(header, size, info)) {
+            Close();
+            return false;
+        }
+        return Rewind();
+    }
+
+    void WavDecoder::Close() {
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+    }
+
+    uint32_t WavDecoder::Read(int16_t* output, uint32_t frames) {
+        if (!file) return 0;
+        uint32_t frameSize = info.channels * 2;
+        uint32_t bytes = frames * frameSize;
+        if (bytes > remaining) bytes = remaining;
+
+        size_t read = fread(output, 1, bytes, file);
+        remaining -= read;
+        return read / frameSize;
+    }
+
+    bool WavDecoder::Rewind() {
+        if (!file || fseek(file, info.dataOffset, SEEK_SET) != 0) return false;
+        remaining = info.dataSize;
+        return true;
+    }
+
+    // Stream
+
+    Stream::Stream() : ended(false), underruns(0) {
+        state[0].store(BLOCK_FREE, std::memory_order_relaxed);
+        state[1].store(BLOCK_FREE, std::memory_order_relaxed);
+    }
+
+    void Stream::Open(Decoder* source, uint32_t framesPerBlock, bool looping) {
+        decoder = source;
+        blockFrames = framesPerBlock;
+        loop = looping;
+        for (int i = 0; i < 2; i++) {
+            blocks[i].resize(framesPerBlock * source->GetChannels());
+            frames[i] = 0;
+            state[i].store(BLOCK_FREE, std::memory_order_relaxed);
+        }
+        decodeBlock = 0;
+        playBlock = 0;
+        ended.store(false, std::memory_order_relaxed);
+        underruns.store(0, std::memory_order_relaxed);
+
+        // Both blocks ready before the first mix
+        Decode();
+    }
+
+    bool Stream::Decode() {
+        if (!decoder) return false;
+
+        bool decoded = false;
+        while (!ended.load(std::memory_order_relaxed) &&
+               state[decodeBlock].load(std::memory_order_acquire) == BLOCK_FREE) {
+            int16_t* output = blocks[decodeBlock].data();
+            uint32_t channels = decoder->GetChannels();
+            uint32_t count = 0;
+            bool finished = false;
+            bool rewound = false;
+
+            while (count < blockFrames) {
+                uint32_t read = decoder->Read(output + count * channels, blockFrames - count);
+                count += read;
+                if (count == blockFrames) break;
+                // An empty stream would rewind forever
+                if (!loop || (read == 0 && rewound) || !decoder->Rewind()) {
+                    finished = true;
+                    break;
+                }
+                rewound = read == 0;
+            }
+
+            if (count > 0) {
+                frames[decodeBlock] = count;
+                state[decodeBlock].store(BLOCK_READY, std::memory_order_release);
+                decodeBlock ^= 1;
+                decoded = true;
+            }
+            // Set after publishing the last block so the mixer does not stop before playing it
+            if (finished) ended.store(true, std::memory_order_release);
+        }
+        return decoded;
+    }
+
+    bool Stream::NeedsData() const {
+        return !ended.load(std::memory_order_relaxed) &&
+               state[decodeBlock].load(std::memory_order_relaxed) == BLOCK_FREE;
+    }
+
+    const int16_t* Stream::AcquireBlock(uint32_t& count) {
+        if (state[playBlock].load(std::memory_order_acquire) != BLOCK_READY) return nullptr;
+        count = frames[playBlock];
+        return blocks[playBlock].data();
+    }
+
+    void Stream::ReleaseBlock() {
+        state[playBlock].store(BLOCK_FREE, std::memory_order_release);
+        playBlock ^= 1;
+    }
+
+    bool Stream::IsFinished() const {
+        return ended.load(std::memory_order_acquire) &&
+               state[0].load(std::memory_order_acquire) == BLOCK_FREE &&
+               state[1].load(std::memory_order_acquire) == BLOCK_FREE;
+    }
+
+    // Mixer
+
+    int Mixer::AllocateVoice() {
+        for (int i = 0; i < MAX_VOICES; i++) {
+            Voice& voice = voices[i];
+            if (voice.active) continue;
+
+            uint16_t generation = (voice.generation + 1) & 0x7FFF;
+            voice = Voice();
+            voice.generation = generation;
+            return (generation << 8) | i;
+        }
+        return -1;
+    }
+
+    Mixer::Voice* Mixer::GetVoice(int handle) {
+        if (handle < 0) return nullptr;
+        int index = handle & 0xFF;
+        if (index >= MAX_VOICES) return nullptr;
+        Voice& voice = voices[index];
+        if (!voice.active || voice.generation != (handle >> 8)) return nullptr;
+        return &voice;
+    }
+
+    int Mixer::Play(const SoundData& sound, float volume, float pan, float pitch, bool loop) {
+        if (!sound.samples || sound.frames == 0) return -1;
+        int handle = AllocateVoice();
+        if (handle < 0) return -1;
+
+        Voice& voice = voices[handle & 0xFF];
+        voice.samples = sound.samples;
+        voice.frames = sound.frames;
+        voice.channels = sound.channels;
+        voice.rate = sound.rate;
+        voice.loop = loop;
+        voice.active = true;
+        SetVolume(handle, volume, pan);
+        SetPitch(handle, pitch);
+        return handle;
+    }
+
+    int Mixer::PlayStream(Stream* stream, float volume) {
+        if (!stream || !stream->GetDecoder()) return -1;
+        int handle = AllocateVoice();
+        if (handle < 0) return -1;
+
+        Voice& voice = voices[handle & 0xFF];
+        voice.stream = stream;
+        voice.channels = stream->GetDecoder()->GetChannels();
+        voice.rate = stream->GetDecoder()->GetRate();
+        voice.active = true;
+        SetVolume(handle, volume, 0.0f);
+        SetPitch(handle, 1.0f);
+        return handle;
+    }
+
+    void Mixer::Stop(int handle) {
+        Voice* voice = GetVoice(handle);
+        if (voice) voice->active = false;
+    }
+
+    void Mixer::StopAll() {
+        for (Voice& voice : voices) {
+            voice.active = false;
+        }
+    }
+
+    void Mixer::SetVolume(int handle, float volume, float pan) {
+        Voice* voice = GetVoice(handle);
+        if (!voice) return;
+        if (pan < -1) pan = -1;
+        if (pan > 1) pan = 1;
+        voice->left = ToQ15(volume * (pan > 0 ? 1 - pan : 1));
+        voice->right = ToQ15(volume * (pan < 0 ? 1 + pan : 1));
+    }
+
+    void Mixer::SetPitch(int handle, float pitch) {
+        Voice* voice = GetVoice(handle);
+        if (voice) voice->step = ToStep(voice->rate, pitch);
+    }
+
+    void Mixer::SetMasterVolume(float volume) {
+        masterVolume = ToQ15(volume);
+    }
+
+    int Mixer::GetActiveVoices() const {
+        int count = 0;
+        for (const Voice& voice : voices) {
+            if (voice.active) count++;
+        }
+        return count;
+    }
+
+    uint32_t Mixer::MixRun(Voice& voice, const int16_t* source, uint32_t count, int32_t* output, uint32_t frames) {
+        int32_t left = (voice.left * masterVolume) >> 15;
+        int32_t right = (voice.right * masterVolume) >> 15;
+
+        if (voice.step == (1 << 16) && voice.fraction == 0 && !voice.seam) {
+            uint32_t available = count > voice.index ? count - voice.index : 0;
+            uint32_t produced = frames < available ? frames : available;
+            const int16_t* start = source + voice.index * voice.channels;
+            if (voice.channels == 2) {
+                Kernels::MixStereo(output, start, produced, left, right);
+            } else {
+                Kernels::MixMono(output, start, produced, left, right);
+            }
+            voice.index += produced;
+            return produced;
+        }
+
+        // Between the last frame of the previous source and the first one of this source
+        uint32_t seamFrames = 0;
+        if (voice.seam && count > 0) {
+            while (seamFrames < frames && voice.seam) {
+                int32_t weight = voice.fraction >> 1;
+                for (int channel = 0; channel < 2; channel++) {
+                    int32_t from = voice.history[voice.channels == 2 ? channel : 0];
+                    int32_t to = source[voice.channels == 2 ? channel : 0];
+                    int32_t sample = from + (((to - from) * weight) >> 15);
+                    output[seamFrames * 2 + channel] += (sample * (channel == 0 ? left : right)) >> 15;
+                }
+                seamFrames++;
+
+                voice.fraction += voice.step;
+                if (voice.fraction >> 16) {
+                    voice.index = (voice.fraction >> 16) - 1;
+                    voice.fraction &= 0xFFFF;
+                    voice.seam = false;
+                }
+            }
+            output += seamFrames * 2;
+            frames -= seamFrames;
+        }
+        if (voice.seam) return seamFrames;
+
+        // Interpolation reads index + 1, so stop before the last source frame
+        if (voice.index + 1 >= count) return seamFrames;
+        uint64_t distance = ((uint64_t)(count - 1 - voice.index) << 16) - voice.fraction;
+        uint64_t available = (distance + voice.step - 1) / voice.step;
+        uint32_t produced = frames < available ? frames : (uint32_t)available;
+        if (voice.channels == 2) {
+            Kernels::MixStereoResample(output, source, produced, left, right, voice.index, voice.fraction, voice.step);
+        } else {
+            Kernels::MixMonoResample(output, source, produced, left, right, voice.index, voice.fraction, voice.step);
+        }
+        return seamFrames + produced;
+    }
+
+    void Mixer::NextSource(Voice& voice, const int16_t* source, uint32_t count) {
+        if (voice.seam || count == 0) return;
+        if (voice.index + 1 == count) {
+            // Between the last frame and the next source: keep the frame to interpolate from
+            voice.history[0] = source[voice.index * voice.channels];
+            voice.history[1] = source[voice.index * voice.channels + voice.channels - 1];
+            voice.seam = true;
+            voice.index = 0;
+        } else {
+            // Frames stepped over at the end are skipped at the start of the next source too
+            voice.index = voice.index >= count ? voice.index - count : 0;
+        }
+    }
+
+    bool Mixer::MixSound(Voice& voice, uint32_t frames) {
+        uint32_t done = 0;
+        while (done < frames) {
+            uint32_t produced = MixRun(voice, voice.samples, voice.frames, accumulator + done * 2, frames - done);
+            done += produced;
+            if (done == frames) break;
+
+            // End of the sound (an empty sound cannot make progress)
+            if (!voice.loop || voice.frames == 0) return false;
+            NextSource(voice, voice.samples, voice.frames);
+        }
+        return true;
+    }
+
+    bool Mixer::MixStream(Voice& voice, uint32_t frames) {
+        Stream* stream = voice.stream;
+        uint32_t done = 0;
+        while (done < frames) {
+            uint32_t count = 0;
+            const int16_t* block = stream->AcquireBlock(count);
+            if (!block) {
+                if (stream->IsFinished()) return false;
+                // The decoder is late: the rest of this mix stays silent
+                stream->underruns.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            done += MixRun(voice, block, count, accumulator + done * 2, frames - done);
+            if (done == frames) break;
+
+            NextSource(voice, block, count);
+            stream->ReleaseBlock();
+        }
+        return true;
+    }
+
+    bool Mixer::MixVoice(Voice& voice, uint32_t frames) {
+        return voice.stream ? MixStream(voice, frames) : MixSound(voice, frames);
+    }
+
+    void Mixer::Mix(int16_t* output, uint32_t frames) {
+        while (frames > 0) {
+            uint32_t count = frames < MIX_BLOCK ? frames : MIX_BLOCK;
+            memset(accumulator, 0, count * 2 * sizeof(int32_t));
+
+            for (Voice& voice : voices) {
+                if (voice.active && !MixVoice(voice, count)) {
+                    voice.active = false;
+                }
+            }
+
+            Kernels::Clamp(output, accumulator, count * 2);
+            output += count * 2;
+            frames -= count;
+        }
+    }
+
+    // WavWriter
+
+    bool WavWriter::Open(const char* path, uint32_t sampleRate, uint8_t channelCount) {
+        Close();
+        file = fopen(path, "wb");
+        if (!file) return false;
+        rate = sampleRate;
+        channels = channelCount;
+        dataSize = 0;
+        WriteHeader();
+        return true;
+    }
+
+    void WavWriter::WriteHeader() {
+        uint8_t header[44];
+        uint32_t byteRate = rate * channels * 2;
+        uint16_t blockAlign = channels * 2;
+        uint16_t format = 1;
+        uint16_t channelCount = channels;
+        uint16_t bits = 16;
+        uint32_t formatSize = 16;
+        uint32_t riffSize = 36 + dataSize;
+
+        memcpy(header, "RIFF", 4);
+        memcpy(header + 4, &riffSize, 4);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        memcpy(header + 16, &formatSize, 4);
+        memcpy(header + 20, &format, 2);
+        memcpy(header + 22, &channelCount, 2);
+        memcpy(header + 24, &rate, 4);
+        memcpy(header + 28, &byteRate, 4);
+        memcpy(header + 32, &blockAlign, 2);
+        memcpy(header + 34, &bits, 2);
+        memcpy(header + 36, "data", 4);
+        memcpy(header + 40, &dataSize, 4);
+
+        fseek(file, 0, SEEK_SET);
+        fwrite(header, 1, sizeof(header), file);
+    }
+
+    void WavWriter::Write(const int16_t* samples, uint32_t frames) {
+        if (!file) return;
+        dataSize += fwrite(samples, 1, frames * channels * 2, file);
+    }
+
+    void WavWriter::Close() {
+        if (!file) return;
+        WriteHeader();
+        fclose(file);
+        file = nullptr;
+    }
+
+    // Backends
+
+    void NullBackend::Update(float deltaTime) {
+        if (!mixer) return;
+        pending += deltaTime * OUTPUT_RATE;
+        uint32_t frames = (uint32_t)pending;
+        pending -= frames;
+        Render(frames);
+    }
+
+    void NullBackend::Render(uint32_t frames) {
+        if (!mixer) return;
+        while (frames > 0) {
+            uint32_t count = frames < MIX_BLOCK ? frames : MIX_BLOCK;
+            mixer->Mix(buffer, count);
+            Output(buffer, count);
+            frames -= count;
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file Benchmark.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex microbenchmark harness implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Benchmark.hpp"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Debug;
+
+namespace {
+    struct BenchmarkCase {
+        const char* name;
+        BenchmarkFunction function;
+        u32 arg;
+    };
+
+    std::vector<BenchmarkCase>& GetCases() {
+        static std::vector<BenchmarkCase> cases;
+        return cases;
+    }
+}
+
+void Debug::RegisterBenchmark(const char* name, BenchmarkFunction function, const std::vector<u32>& args) {
+    if (args.empty()) {
+        GetCases().push_back({ name, function, 0 });
+        return;
+    }
+    for (u32 arg : args) {
+        GetCases().push_back({ name, function, arg });
+    }
+}
+
+int Debug::RunBenchmarks(const char* outputPath, const char* filter, float minSeconds) {
+    // "-" streams the JSON lines alone to stdout (host runs), so the table is not printed
+    const bool toStdout = outputPath && strcmp(outputPath, "-") == 0;
+    FILE* output = toStdout ? stdout : outputPath ? fopen(outputPath, "w") : nullptr;
+    const u64 minTicks = (u64)(minSeconds * SYSCLOCK_ARM11);
+    int count = 0;
+
+    for (const BenchmarkCase& benchmark : GetCases()) {
+        if (filter && strncmp(benchmark.name, filter, strlen(filter)) != 0) {
+            continue;
+        }
+
+        // Grow the iteration count until the run is long enough to be meaningful
+        u32 iterations = 1;
+        u64 ticks = 0;
+        u64 items = 0;
+        BenchmarkState::Counter counters[BenchmarkState::MAX_COUNTERS];
+        u32 counterCount = 0;
+        while (true) {
+            BenchmarkState state(iterations, benchmark.arg);
+            benchmark.function(state);
+            ticks = state.GetElapsedTicks();
+            items = state.GetItemsProcessed();
+            counterCount = state.GetCounterCount();
+            for (u32 i = 0; i < counterCount; i++) {
+                counters[i] = state.GetCounter(i);
+            }
+
+            if (ticks >= minTicks || iterations >= (1u << 30)) break;
+
+            u64 next = ticks > 0 ? (u64)iterations * minTicks * 14 / (ticks * 10) : (u64)iterations * 10;
+            if (next <= iterations) next = (u64)iterations * 2;
+            if (next > (u64)iterations * 100) next = (u64)iterations * 100;
+            iterations = next > (1u << 30) ? (1u << 30) : (u32)next;
+        }
+
+        char name[128];
+        if (benchmark.arg) {
+            snprintf(name, sizeof(name), "%s/%lu", benchmark.name, (unsigned long)benchmark.arg);
+        } else {
+            snprintf(name, sizeof(name), "%s", benchmark.name);
+        }
+
+        double seconds = (double)ticks / SYSCLOCK_ARM11;
+        double nsPerIteration = seconds * 1e9 / iterations;
+        double itemsPerSecond = seconds > 0 ? items / seconds : 0;
+
+        if (!toStdout) {
+            printf("%-40s %12.1f ns\n", name, nsPerIteration);
+        }
+        if (output) {
+            fprintf(output, "{\"name\":\"%s\",\"iterations\":%lu,\"ns_per_iter\":%.1f,\"items_per_second\":%.6g",
+                    name, (unsigned long)iterations, nsPerIteration, itemsPerSecond);
+            for (u32 i = 0; i < counterCount; i++) {
+                fprintf(output, ",\"%s\":%.6g", counters[i].name, counters[i].value);
+            }
+            fprintf(output, "}\n");
+        }
+        count++;
+    }
+
+    if (toStdout) {
+        fflush(output);
+    } else if (output) {
+        fclose(output);
+    }
+    return count;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file Coroutines.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex coroutines implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Coroutines.hpp"
+#include <string.h>
+#include <algorithm>
+
+namespace Coroutines {
+    // Coroutine
+
+    Coroutine::~Coroutine() {
+        Stop();
+    }
+
+    void Coroutine::Stop() {
+        if (scheduler) scheduler->Stop(this);
+    }
+
+    // Scheduler
+
+    Scheduler::~Scheduler() {
+        // The event bus may already be gone: only Clear unsubscribes
+        for (Coroutine* coroutine : slots) {
+            if (coroutine) Stop(coroutine);
+        }
+    }
+
+    void Scheduler::Start(Coroutine* coroutine, const Objects::Object* owner) {
+        if (coroutine->scheduler) coroutine->scheduler->Stop(coroutine);
+
+        u32 slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            slot = slots.size();
+            slots.push_back(nullptr);
+            generations.push_back(0);
+        }
+        slots[slot] = coroutine;
+
+        coroutine->scheduler = this;
+        coroutine->slot = slot;
+        coroutine->resumeLine = 0;
+        coroutine->wait = Coroutine::Wait::FRAMES;
+        coroutine->owner = owner;
+        coroutine->ownerPrevious = nullptr;
+        coroutine->ownerNext = nullptr;
+        if (owner) {
+            // find first: emplace allocates a node even when the owner already has coroutines
+            auto it = owners.find(owner);
+            if (it != owners.end()) {
+                coroutine->ownerNext = it->second;
+                coroutine->ownerNext->ownerPrevious = coroutine;
+                it->second = coroutine;
+            } else {
+                owners.emplace(owner, coroutine);
+            }
+        }
+
+        ready.push_back(TicketOf(coroutine));
+        count++;
+    }
+
+    void Scheduler::Stop(Coroutine* coroutine) {
+        if (coroutine->scheduler != this) return;
+
+        // Frame, event and ready entries become stale with the generation, the others are removed
+        if (coroutine->wait == Coroutine::Wait::SECONDS) {
+            timers.Cancel(coroutine->timer);
+        } else if (coroutine->wait == Coroutine::Wait::CONDITION && coroutine->pollIndex < polled.size() &&
+                   polled[coroutine->pollIndex] == coroutine) {
+            RemovePolled(coroutine);
+        }
+
+        if (coroutine->owner) {
+            if (coroutine->ownerPrevious) {
+                coroutine->ownerPrevious->ownerNext = coroutine->ownerNext;
+            } else if (coroutine->ownerNext) {
+                owners[coroutine->owner] = coroutine->ownerNext;
+            } else {
+                owners.erase(coroutine->owner);
+            }
+            if (coroutine->ownerNext) coroutine->ownerNext->ownerPrevious = coroutine->ownerPrevious;
+        }
+
+        slots[coroutine->slot] = nullptr;
+        generations[coroutine->slot]++;
+        freeSlots.push_back(coroutine->slot);
+        coroutine->scheduler = nullptr;
+        coroutine->owner = nullptr;
+        coroutine->wait = Coroutine::Wait::FRAMES;
+        count--;
+    }
+
+    void Scheduler::StopOwner(const Objects::Object* owner) {
+        auto it = owners.find(owner);
+        if (it == owners.end()) return;
+
+        Coroutine* coroutine = it->second;
+        owners.erase(it);
+        while (coroutine) {
+            Coroutine* next = coroutine->ownerNext;
+            // Already out of the owner map, so Stop leaves it alone
+            coroutine->owner = nullptr;
+            Stop(coroutine);
+            coroutine = next;
+        }
+    }
+
+    void Scheduler::Clear() {
+        for (Coroutine* coroutine : slots) {
+            if (coroutine) Stop(coroutine);
+        }
+        frameHeap.clear();
+        polled.clear();
+        ready.clear();
+        if (bus) {
+            bus->UnsubscribeAll(this);
+            bus = nullptr;
+        }
+        events.clear();
+    }
+
+    void Scheduler::RemovePolled(Coroutine* coroutine) {
+        Coroutine* last = polled.back();
+        polled[coroutine->pollIndex] = last;
+        last->pollIndex = coroutine->pollIndex;
+        polled.pop_back();
+    }
+
+    void Scheduler::OnTimer(void* userData) {
+        Coroutine* coroutine = static_cast<Coroutine*>(userData);
+        coroutine->timer = 0;
+        coroutine->scheduler->ready.push_back(coroutine->scheduler->TicketOf(coroutine));
+    }
+
+    void Scheduler::WakeEvent(u32 type, const void* event) {
+        if (type >= events.size()) return;
+
+        // Swapped out so coroutines resumed later can wait for the same type again
+        std::vector<Ticket> waiting;
+        waiting.swap(events[type].waiting);
+        for (const Ticket& ticket : waiting) {
+            Coroutine* coroutine = Resolve(ticket);
+            if (!coroutine || coroutine->wait != Coroutine::Wait::EVENT || coroutine->eventType != type) continue;
+            if (coroutine->eventOut) memcpy(coroutine->eventOut, event, coroutine->eventSize);
+            ready.push_back(ticket);
+        }
+        // Keep the capacity for the next waits
+        if (events[type].waiting.empty()) {
+            waiting.clear();
+            events[type].waiting.swap(waiting);
+        }
+    }
+
+    void Scheduler::Suspend(Coroutine* coroutine) {
+        switch (coroutine->wait) {
+            case Coroutine::Wait::FRAMES:
+                frameHeap.push_back({ frame + coroutine->frames, TicketOf(coroutine) });
+                std::push_heap(frameHeap.begin(), frameHeap.end());
+                break;
+
+            case Coroutine::Wait::SECONDS:
+                coroutine->timer = timers.After(coroutine->seconds, OnTimer, coroutine);
+                break;
+
+            case Coroutine::Wait::CONDITION:
+                coroutine->pollIndex = polled.size();
+                polled.push_back(coroutine);
+                break;
+
+            case Coroutine::Wait::EVENT:
+                if (!bus) {
+                    // Not attached to a scene manager: the event can never come, retry next frame
+                    coroutine->wait = Coroutine::Wait::FRAMES;
+                    coroutine->frames = 1;
+                    Suspend(coroutine);
+                    break;
+                }
+                if (coroutine->eventType >= events.size()) events.resize(coroutine->eventType + 1);
+                if (events[coroutine->eventType].subscription == 0) {
+                    events[coroutine->eventType].subscribe = coroutine->subscribe;
+                    events[coroutine->eventType].subscription = coroutine->subscribe(*bus, this);
+                }
+                events[coroutine->eventType].waiting.push_back(TicketOf(coroutine));
+                break;
+        }
+    }
+
+    void Scheduler::Update(Events::EventBus* eventBus) {
+        if (eventBus != bus) {
+            // Subscriptions belong to the previous bus
+            if (bus) bus->UnsubscribeAll(this);
+            bus = eventBus;
+            for (EventWaiters& waiters : events) {
+                waiters.subscription = bus && waiters.subscribe ? waiters.subscribe(*bus, this) : 0;
+            }
+        }
+
+        frame++;
+        resumed = 0;
+
+        while (!frameHeap.empty() && (s32)(frameHeap.front().frame - frame) <= 0) {
+            ready.push_back(frameHeap.front().ticket);
+            std::pop_heap(frameHeap.begin(), frameHeap.end());
+            frameHeap.pop_back();
+        }
+
+        // Backwards so the swap in RemovePolled does not skip anything
+        for (size_t i = polled.size(); i-- > 0;) {
+            Coroutine* coroutine = polled[i];
+            if (coroutine->condition(coroutine->conditionData)) {
+                RemovePolled(coroutine);
+                ready.push_back(TicketOf(coroutine));
+            }
+        }
+
+        // Coroutines made ready while resuming (Start, timers) run on the next Update
+        running.swap(ready);
+        for (const Ticket& ticket : running) {
+            Coroutine* coroutine = Resolve(ticket);
+            if (!coroutine) continue;
+
+            resumed++;
+            if (coroutine->Run()) {
+                // Finished, unless Run restarted or stopped it
+                if (Resolve(ticket) == coroutine) Stop(coroutine);
+            } else if (Resolve(ticket) == coroutine) {
+                Suspend(coroutine);
+            }
+        }
+        running.clear();
+    }
+}
@@ -0,0 +1,820 @@
+/**
+ * @file EngineBenchmarks.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex engine subsystem benchmarks
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include <math.h>
+#include <string>
+#include <memory>
+
+#include "Benchmark.hpp"
+#include "Scene.hpp"
+#include "Random.hpp"
+#include "Logging.hpp"
+#include "Math.hpp"
+#include "SceneFile.hpp"
+#include "Events.hpp"
+#include "UI.hpp"
+#include "AudioMixer.hpp"
+#include "Timers.hpp"
+#include "Coroutines.hpp"
+#include "Physics.hpp"
+#include "Pathfinding.hpp"
+#include "Pack.hpp"
+#include "Primitives.hpp"
+
+using namespace Debug;
+
+namespace {
+    // Object with a CPU heavy update, safe to run on workers
+    class HeavyObject : public Objects::Object {
+    public:
+        float value = 1.0f;
+
+    protected:
+        void OnUpdate(Scene::Scene* scene) override {
+            for (int i = 0; i < 256; i++) {
+                value = value * 0.999f + sqrtf(value + i);
+            }
+        }
+    };
+
+    void SceneUpdate(BenchmarkState& state) {
+        Scene::Scene scene("benchmark");
+        std::vector<Objects::Rectangle> rectangles(state.GetArg());
+        for (size_t i = 0; i < rectangles.size(); i++) {
+            rectangles[i].SetPosition(i % 400, i % 240);
+            scene.AddElement(&rectangles[i]);
+        }
+
+        // Record the draws so only the CPU side is measured
+        Render::DrawList drawList;
+        Render::BeginRecording(&drawList);
+        while (state.KeepRunning()) {
+            drawList.Clear();
+            scene.Update();
+        }
+        Render::EndRecording();
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    // Four shape types created in blocks of 64, as a scene file or a level generator would
+    template<bool batching>
+    void SceneUpdateMixed(BenchmarkState& state) {
+        Scene::Scene scene("benchmark");
+        scene.SetShapeBatching(batching);
+        size_t count = state.GetArg() / 4;
+        std::vector<Objects::Rectangle> rectangles(count);
+        std::vector<Objects::Line> lines(count);
+        std::vector<Objects::Circle> circles(count);
+        std::vector<Objects::Ellipse> ellipses(count);
+        for (size_t block = 0; block < count; block += 64) {
+            size_t end = block + 64 < count ? block + 64 : count;
+            for (size_t i = block; i < end; i++) scene.AddElement(&rectangles[i]);
+            for (size_t i = block; i < end; i++) scene.AddElement(&lines[i]);
+            for (size_t i = block; i < end; i++) scene.AddElement(&circles[i]);
+            for (size_t i = block; i < end; i++) scene.AddElement(&ellipses[i]);
+        }
+
+        Render::DrawList drawList;
+        Render::BeginRecording(&drawList);
+        while (state.KeepRunning()) {
+            drawList.Clear();
+            scene.Update();
+        }
+        Render::EndRecording();
+        state.SetItemsProcessed((u64)state.GetIterations() * count * 4);
+    }
+
+    // Top-down scene where every element moves a little each frame
+    void SceneUpdateYSort(BenchmarkState& state) {
+        Scene::Scene scene("benchmark");
+        scene.SetYSort(true);
+        std::vector<Objects::Rectangle> rectangles(state.GetArg());
+        for (size_t i = 0; i < rectangles.size(); i++) {
+            rectangles[i].SetPosition(i % 400, (i * 7) % 240);
+            scene.AddElement(&rectangles[i]);
+        }
+
+        Render::DrawList drawList;
+        Render::BeginRecording(&drawList);
+        int frame = 0;
+        while (state.KeepRunning()) {
+            drawList.Clear();
+            for (size_t i = 0; i < rectangles.size(); i++) {
+                rectangles[i].AddY(((i + frame) & 1) ? 1 : -1);
+            }
+            scene.Update();
+            frame++;
+        }
+        Render::EndRecording();
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    // A frame of rectangles and circles drawn through Render, instanced or all through citro2d,
+    // with the submission counters (vertices written by the CPU, draw calls) per frame.
+    // Shapes come in runs of 32 of a kind, as from a scene with shape batching (each change of
+    // kind starts a draw call). Drawn to a texture so the screen targets of the game stay untouched
+    template<bool instanced>
+    void RenderShapes(BenchmarkState& state) {
+        C3D_Tex texture;
+        if (!C3D_TexInitVRAM(&texture, 512, 256, GPU_RGBA8) && !C3D_TexInit(&texture, 512, 256, GPU_RGBA8)) return;
+        C3D_RenderTarget* target = C3D_RenderTargetCreateFromTex(&texture, GPU_TEXFACE_2D, 0, (GPU_DEPTHBUF)-1);
+        if (!target) {
+            C3D_TexDelete(&texture);
+            return;
+        }
+
+        // Loaded by the SceneManager on the console, not by the host benchmark runner
+        Primitives::Init();
+        bool wasEnabled = Primitives::IsEnabled();
+        Primitives::SetEnabled(instanced);
+
+        u32 count = state.GetArg();
+        Primitives::ResetStats();
+        while (state.KeepRunning()) {
+            C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
+            Render::SceneBegin(target);
+            for (u32 i = 0; i < count; i++) {
+                float x = (i * 13) % 400;
+                float y = (i * 7) % 240;
+                if ((i / 32) & 1) {
+                    Render::Circle(x, y, 4 + (i & 15), C2D_Color32(0, i & 255, 255, 255));
+                } else {
+                    Render::Rect(x, y, 12, 8, C2D_Color32(255, i & 255, 0, 255));
+                }
+            }
+            Render::Flush();
+            C3D_FrameEnd(0);
+        }
+
+        const Primitives::Stats& stats = Primitives::GetStats();
+        double frames = state.GetIterations();
+        state.SetCounter("vertices_per_iter", stats.vertices / frames);
+        state.SetCounter("uniforms_per_iter", stats.uniforms / frames);
+        state.SetCounter("draw_calls_per_iter", stats.drawCalls / frames);
+        state.SetCounter("instanced_per_iter", stats.instanced / frames);
+        state.SetItemsProcessed((u64)state.GetIterations() * count);
+
+        Primitives::SetEnabled(wasEnabled);
+        C3D_RenderTargetDelete(target);
+        C3D_TexDelete(&texture);
+    }
+
+    // One frame of "enemies within 50px" queries from 64 places, a quarter of the elements are enemies
+    template<bool indexed>
+    void SceneQueryRadius(BenchmarkState& state) {
+        Scene::Scene scene("benchmark");
+        Objects::TagMask enemy = Objects::RegisterTag("enemy");
+        std::vector<Objects::Rectangle> rectangles(state.GetArg());
+        for (size_t i = 0; i < rectangles.size(); i++) {
+            rectangles[i].SetPosition((i * 37) % 400, (i * 53) % 240);
+            if (i % 4 == 0) rectangles[i].AddTags(enemy);
+            scene.AddElement(&rectangles[i]);
+        }
+
+        Objects::Object* results[256];
+        size_t found = 0;
+        while (state.KeepRunning()) {
+            scene.MarkSpatialDirty();
+            for (int query = 0; query < 64; query++) {
+                float x = (query * 29) % 400;
+                float y = (query * 17) % 240;
+                if (indexed) {
+                    found += scene.QueryRadius(x, y, 50.0f, enemy, results, 256);
+                } else {
+                    // What games did before the indexes: test every element
+                    for (Objects::Object* element : scene.GetElements()) {
+                        Math::Vec2d position = element->GetPosition();
+                        float dx = position.x - x;
+                        float dy = position.y - y;
+                        if (element->HasTags(enemy) && dx * dx + dy * dy <= 2500.0f) found++;
+                    }
+                }
+            }
+        }
+        DoNotOptimize(found);
+        state.SetItemsProcessed((u64)state.GetIterations() * 64);
+    }
+
+    // Bottom screen menu: a slider above a scroll view holding one list of buttons
+    struct UIFixture {
+        UI::Canvas canvas;
+        UI::Slider slider;
+        UI::ScrollView view;
+        UI::List list;
+        std::vector<UI::Button> buttons;
+
+        UIFixture(size_t count) : buttons(count) {
+            canvas.Add(&slider);
+            slider.SetFrame(10, 5, 300, 20);
+            canvas.Add(&view);
+            view.SetFrame(0, 40, 320, 200);
+            view.Add(&list);
+            list.SetFrame(0, 0, 310, 0);
+            for (UI::Button& button : buttons) {
+                button.SetSize(0, 24);
+                list.Add(&button);
+            }
+            canvas.Layout();
+        }
+    };
+
+    // Touch held on a button and dragged (scrolling) every other frame, then the tree is drawn
+    void UICanvasFrame(BenchmarkState& state) {
+        UIFixture ui(state.GetArg());
+        Render::DrawList drawList;
+        Render::BeginRecording(&drawList);
+        int frame = 0;
+        while (state.KeepRunning()) {
+            drawList.Clear();
+            float y = (frame & 63) < 32 ? 120 + (frame & 31) : 152 - (frame & 31);
+            ui.canvas.ProcessTouch((frame & 127) != 127, 100, y, 1.0f / 60.0f);
+            ui.canvas.Draw();
+            frame++;
+        }
+        Render::EndRecording();
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    void UICanvasLayout(BenchmarkState& state) {
+        UIFixture ui(state.GetArg());
+        float width = 310;
+        while (state.KeepRunning()) {
+            width = width == 310 ? 300 : 310;
+            ui.list.SetFrame(0, 0, width, 0);
+            ui.canvas.Layout();
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    // One second of mono noise, looped on every voice; items are voice frames so the
+    // reported time is the cost of one voice per output frame
+    template<u32 rate>
+    void AudioMixerVoices(BenchmarkState& state) {
+        std::vector<s16> samples(rate);
+        for (size_t i = 0; i < samples.size(); i++) {
+            samples[i] = Random::Range(-8192, 8191);
+        }
+        Audio::SoundData sound;
+        sound.samples = samples.data();
+        sound.frames = samples.size();
+        sound.rate = rate;
+
+        Audio::Mixer mixer;
+        for (u32 i = 0; i < state.GetArg(); i++) {
+            mixer.Play(sound, 0.5f, (int)(i % 3) - 1.0f, 1.0f, true);
+        }
+
+        s16 output[Audio::MIX_BLOCK * 2];
+        while (state.KeepRunning()) {
+            mixer.Mix(output, Audio::MIX_BLOCK);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * Audio::MIX_BLOCK * state.GetArg());
+    }
+
+    void CountTimer(void* userData) {
+        (*static_cast<u32*>(userData))++;
+    }
+
+    // Many pending timers, none firing during the measured frames
+    void TimerWheelIdle(BenchmarkState& state) {
+        Timers::TimerWheel wheel(state.GetArg());
+        u32 fired = 0;
+        for (u32 i = 0; i < state.GetArg(); i++) {
+            wheel.Every(600.0f + (i % 1000), CountTimer, &fired);
+        }
+        while (state.KeepRunning()) {
+            wheel.Advance(1.0f / 60.0f);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    void TimerWheelScheduleCancel(BenchmarkState& state) {
+        Timers::TimerWheel wheel(1024);
+        u32 fired = 0;
+        u32 i = 0;
+        while (state.KeepRunning()) {
+            Timers::Handle handle = wheel.After(0.5f + (i++ & 1023) * 0.25f, CountTimer, &fired);
+            wheel.Cancel(handle);
+        }
+        state.SetItemsProcessed(state.GetIterations());
+    }
+
+    // Actor behaviour: a few frames of work, then a long pause
+    class PatrolCoroutine : public Coroutines::Coroutine {
+    public:
+        u32 steps = 0;
+        u32 step = 0;
+
+    protected:
+        bool Run() override {
+            CO_BEGIN;
+            while (true) {
+                for (step = 0; step < 4; step++) {
+                    steps++;
+                    CO_YIELD();
+                }
+                CO_WAIT_SECONDS(30.0f);
+            }
+            CO_END;
+        }
+    };
+
+    // Mostly sleeping coroutines: only the few that are due are resumed
+    void CoroutinesIdle(BenchmarkState& state) {
+        Timers::TimerWheel wheel(state.GetArg());
+        Coroutines::Scheduler scheduler(wheel);
+        std::vector<PatrolCoroutine> patrols(state.GetArg());
+        for (PatrolCoroutine& patrol : patrols) {
+            scheduler.Start(&patrol);
+        }
+        for (int i = 0; i < 8; i++) {
+            wheel.Advance(1.0f / 60.0f);
+            scheduler.Update(nullptr);
+        }
+        while (state.KeepRunning()) {
+            wheel.Advance(1.0f / 60.0f);
+            scheduler.Update(nullptr);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    // Boxes and circles dropped into a pit, at most 20 rows high (same layout as tools/physbench.cpp)
+    void BuildPhysicsPile(Physics::World& world, u32 count) {
+        u32 columns = count < 40 ? count : (count / 20 > 40 ? count / 20 : 40);
+        float width = columns * 12.0f + 40.0f;
+
+        Physics::BodyDef wall;
+        wall.type = Physics::BodyType::STATIC;
+        wall.x = width * 0.5f;
+        wall.y = 240.0f;
+        wall.width = width;
+        wall.height = 20;
+        world.CreateBody(wall);
+        wall.width = 200;
+        wall.height = 4000;
+        wall.x = -90.0f;
+        wall.y = 240.0f - 2000.0f;
+        world.CreateBody(wall);
+        wall.x = width + 90.0f;
+        world.CreateBody(wall);
+
+        Physics::BodyDef body;
+        for (u32 i = 0; i < count; i++) {
+            body.x = 30.0f + (i % columns) * 12.0f + (i / columns % 2) * 3.0f;
+            body.y = 200.0f - (i / columns) * 14.0f;
+            body.shape = i % 3 == 2 ? Physics::ShapeType::CIRCLE : Physics::ShapeType::BOX;
+            world.CreateBody(body);
+        }
+    }
+
+    // Every body awake and in contact: the cost of a busy frame
+    void PhysicsActive(BenchmarkState& state) {
+        Physics::World world;
+        world.SetSleeping(false);
+        BuildPhysicsPile(world, state.GetArg());
+        for (int i = 0; i < 120; i++) {
+            world.Step(Physics::FIXED_STEP);
+        }
+        while (state.KeepRunning()) {
+            world.Step(Physics::FIXED_STEP);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    // Settled pile: every island asleep
+    void PhysicsAsleep(BenchmarkState& state) {
+        Physics::World world;
+        BuildPhysicsPile(world, state.GetArg());
+        for (int i = 0; i < 1200 && (i < 2 || world.GetStats().awake > 0); i++) {
+            world.Step(Physics::FIXED_STEP);
+        }
+        while (state.KeepRunning()) {
+            world.Step(Physics::FIXED_STEP);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    // 256×256 level: walls every 32 tiles with doorways, plus scattered pillars (fixed seed)
+    void BuildPathfindingLevel(Pathfinding::Grid& grid) {
+        grid.Resize(256, 256);
+        for (int i = 32; i < 256; i += 32) {
+            for (int j = 0; j < 256; j++) {
+                if (j % 32 < 28) {
+                    grid.SetWalkable(i, j, false);
+                    grid.SetWalkable(j, i, false);
+                }
+            }
+        }
+        u32 seed = 12345;
+        for (int i = 0; i < 2000; i++) {
+            seed = seed * 1664525 + 1013904223;
+            grid.SetWalkable((seed >> 8) & 255, (seed >> 16) & 255, false);
+        }
+    }
+
+    struct PathfindingAgent {
+        Pathfinding::Point position;
+        bool waiting;
+    };
+
+    void OnAgentPath(Pathfinding::RequestId id, const Pathfinding::Point* path, u32 length, void* userData) {
+        PathfindingAgent* agent = static_cast<PathfindingAgent*>(userData);
+        if (length > 0) agent->position = path[length - 1];
+        agent->waiting = false;
+    }
+
+    // Every agent of arg asks for a path to a random tile, answered within one Update
+    template <Pathfinding::Algorithm ALGORITHM, bool CACHED>
+    void PathfindingAgents(BenchmarkState& state) {
+        Pathfinding::PathService service;
+        BuildPathfindingLevel(service.GetGrid());
+        service.SetCacheCapacity(CACHED ? 256 : 0);
+        std::vector<PathfindingAgent> agents(state.GetArg());
+
+        // Cached: agents travel between 16 waypoints, uncached: anywhere
+        u32 seed = 777;
+        auto next = [&]() -> s16 {
+            seed = seed * 1664525 + 1013904223;
+            return CACHED ? 8 + ((seed >> 12) & 3) * 64 : (seed >> 12) & 255;
+        };
+        for (PathfindingAgent& agent : agents) {
+            agent.position = { next(), next() };
+        }
+
+        while (state.KeepRunning()) {
+            for (PathfindingAgent& agent : agents) {
+                service.Request(agent.position, { next(), next() }, OnAgentPath, &agent, ALGORITHM);
+            }
+            service.Update(1e6f);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * agents.size());
+    }
+
+    // Agents asking again as soon as they are answered, with 2 ms of search per frame
+    void PathfindingFrame(BenchmarkState& state) {
+        Pathfinding::PathService service;
+        BuildPathfindingLevel(service.GetGrid());
+        std::vector<PathfindingAgent> agents(state.GetArg());
+        u32 seed = 777;
+        auto next = [&]() -> s16 {
+            seed = seed * 1664525 + 1013904223;
+            return (seed >> 12) & 255;
+        };
+        for (PathfindingAgent& agent : agents) {
+            agent.position = { next(), next() };
+            agent.waiting = false;
+        }
+
+        u32 answered = 0;
+        while (state.KeepRunning()) {
+            for (PathfindingAgent& agent : agents) {
+                if (agent.waiting) continue;
+                agent.waiting = true;
+                service.Request(agent.position, { next(), next() }, OnAgentPath, &agent);
+            }
+            u32 pending = service.GetPendingCount();
+            service.Update(2.0f);
+            answered += pending - service.GetPendingCount();
+        }
+        state.SetItemsProcessed(answered);
+    }
+
+    void UpdateAttachedDeep(BenchmarkState& state) {
+        std::vector<Objects::Rectangle> chain(state.GetArg() + 1);
+        for (size_t i = 1; i < chain.size(); i++) {
+            chain[i].SetPosition(i, i);
+            chain[i - 1].Attach(&chain[i]);
+        }
+        while (state.KeepRunning()) {
+            chain[0].AddX(1);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    void UpdateAttachedWide(BenchmarkState& state) {
+        Objects::Rectangle root;
+        root.SetPosition(0, 0);
+        std::vector<Objects::Rectangle> children(state.GetArg());
+        for (size_t i = 0; i < children.size(); i++) {
+            children[i].SetPosition(i, i);
+            root.Attach(&children[i]);
+        }
+        while (state.KeepRunning()) {
+            root.AddX(1);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    void InputUpdate(BenchmarkState& state) {
+        Input::InputManager input;
+        while (state.KeepRunning()) {
+            input.Update();
+        }
+    }
+
+    void InputGetButtonState(BenchmarkState& state) {
+        Input::InputManager input;
+        input.Update();
+        int pressed = 0;
+        while (state.KeepRunning()) {
+            for (int i = 0; i <= static_cast<int>(Input::Button::CPAD_DOWN); i++) {
+                pressed += input.GetButtonState(static_cast<Input::Button>(i)) == Input::ButtonState::PRESSED;
+            }
+        }
+        DoNotOptimize(pressed);
+        state.SetItemsProcessed((u64)state.GetIterations() * (static_cast<int>(Input::Button::CPAD_DOWN) + 1));
+    }
+
+    void RandomRangeInt(BenchmarkState& state) {
+        int sum = 0;
+        while (state.KeepRunning()) {
+            sum += Random::Range(0, 100);
+        }
+        DoNotOptimize(sum);
+    }
+
+    void RandomRangeDouble(BenchmarkState& state) {
+        double sum = 0;
+        while (state.KeepRunning()) {
+            sum += Random::Range(0.0, 1.0);
+        }
+        DoNotOptimize(sum);
+    }
+
+    void RandomUUID(BenchmarkState& state) {
+        size_t length = 0;
+        while (state.KeepRunning()) {
+            length += Random::UUID().size();
+        }
+        DoNotOptimize(length);
+    }
+
+    void LoggerLog(BenchmarkState& state) {
+        Debug::Logger logger("sdmc:/citroflex_benchmark.log");
+        char line[] = "benchmark log line\n";
+        while (state.KeepRunning()) {
+            logger.Log(line);
+        }
+    }
+
+    // Switch between N scenes of a private headless manager until each one is active
+    // (with one scene, every iteration reloads it)
+    void LoadSceneByName(BenchmarkState& state) {
+        Scene::SceneManager manager(false);
+        std::vector<std::unique_ptr<Scene::Scene>> scenes;
+        std::vector<std::string> names;
+        for (u32 i = 0; i < state.GetArg(); i++) {
+            names.push_back("benchmark_" + std::to_string(i));
+            scenes.emplace_back(new Scene::Scene(names.back()));
+            manager.AddScene(scenes.back().get());
+        }
+
+        u32 next = 0;
+        while (state.KeepRunning()) {
+            manager.LoadScene(names[next], Scene::Screen::BOTTOM);
+            while (manager.IsTransitioning(Scene::Screen::BOTTOM)) {
+                manager.UpdateLoading();
+            }
+            next = next + 1 < names.size() ? next + 1 : 0;
+        }
+        state.SetItemsProcessed(state.GetIterations());
+    }
+
+    void JobsParallelUpdate(BenchmarkState& state) {
+        Jobs::JobSystem jobs;
+        jobs.Start(state.GetArg());
+
+        static std::vector<HeavyObject> objects(2000);
+        auto update = [](void* data, u32 begin, u32 end) {
+            HeavyObject* objects = static_cast<HeavyObject*>(data);
+            for (u32 i = begin; i < end; i++) {
+                objects[i].UpdateLogic(nullptr);
+            }
+        };
+        while (state.KeepRunning()) {
+            jobs.ParallelFor(objects.size(), 16, update, objects.data());
+        }
+        jobs.Stop();
+        state.SetItemsProcessed((u64)state.GetIterations() * objects.size());
+    }
+
+    // Level of arg rectangles laid out as a .cfs file in memory
+    std::vector<u32> MakeSceneFile(u32 count) {
+        using namespace SceneFormat;
+        size_t size = sizeof(FileHeader) + count * sizeof(ObjectRecord) + 4;
+        std::vector<u32> buffer((size + 3) / 4, 0);
+        u8* data = reinterpret_cast<u8*>(buffer.data());
+
+        FileHeader* header = reinterpret_cast<FileHeader*>(data);
+        header->magic = MAGIC;
+        header->version = VERSION;
+        header->headerSize = sizeof(FileHeader);
+        header->fileSize = size;
+        header->objectCount = count;
+        header->sceneObjectCount = count;
+        header->objectsOffset = sizeof(FileHeader);
+        header->propertiesOffset = header->objectsOffset + count * sizeof(ObjectRecord);
+        header->prefabsOffset = header->propertiesOffset;
+        header->stringsOffset = header->propertiesOffset;
+        header->stringsSize = 4;
+        header->sceneTypes.counts[RECTANGLE] = count;
+
+        ObjectRecord* records = reinterpret_cast<ObjectRecord*>(data + header->objectsOffset);
+        for (u32 i = 0; i < count; i++) {
+            records[i].type = RECTANGLE;
+            records[i].flags = FLAG_VISIBLE;
+            records[i].parent = -1;
+            records[i].name = NO_STRING;
+            records[i].typeName = NO_STRING;
+            records[i].resource = NO_STRING;
+            records[i].x = i % 400;
+            records[i].y = i % 240;
+            records[i].color = Colors::clrWhite;
+            records[i].params[0] = 8;
+            records[i].params[1] = 8;
+        }
+        return buffer;
+    }
+
+    // 64 KB LZ4 block: 8 literals then a 56 byte match, repeated (about 5:1)
+    std::vector<u8> MakeLz4Block(size_t outputSize) {
+        std::vector<u8> block;
+        for (size_t written = 0; written + 128 <= outputSize; written += 64) {
+            block.push_back(0x8F);
+            for (int i = 0; i < 8; i++) block.push_back((u8)(written / 64 + i));
+            block.push_back(8);
+            block.push_back(0);
+            block.push_back(56 - 4 - 15);
+        }
+        size_t tail = outputSize % 64 + 64;
+        block.push_back(0xF0);
+        block.push_back(tail - 15);
+        block.insert(block.end(), tail, 0x55);
+        return block;
+    }
+
+    void PackDecompressBlock(BenchmarkState& state) {
+        const size_t size = PackFormat::DEFAULT_CHUNK_SIZE;
+        std::vector<u8> block = MakeLz4Block(size);
+        std::vector<u8> output(size);
+        while (state.KeepRunning()) {
+            Pack::DecompressBlock(block.data(), block.size(), output.data(), output.size());
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * size);
+    }
+
+    void SceneFileInstantiate(BenchmarkState& state) {
+        std::vector<u32> buffer = MakeSceneFile(state.GetArg());
+        Scene::Scene scene("benchmark");
+        SceneFormat::SceneFile file;
+        while (state.KeepRunning()) {
+            file.LoadFromMemory(buffer.data(), buffer.size() * sizeof(u32));
+            file.Instantiate(&scene);
+
+            state.PauseTiming();
+            file.Unload(&scene);
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    struct BenchmarkEvent {
+        u32 value;
+        float x, y;
+    };
+
+    void OnBenchmarkEvent(const BenchmarkEvent& event, void* userData) {
+        *static_cast<u32*>(userData) += event.value;
+    }
+
+    void EventBusDispatch(BenchmarkState& state) {
+        Events::EventBus bus;
+        u32 sum = 0;
+        bus.Subscribe<BenchmarkEvent>(OnBenchmarkEvent, &sum);
+        while (state.KeepRunning()) {
+            for (u32 i = 0; i < state.GetArg(); i++) {
+                bus.Post(BenchmarkEvent{ i, 0, 0 });
+            }
+            bus.Dispatch();
+        }
+        DoNotOptimize(sum);
+        state.SetItemsProcessed((u64)state.GetIterations() * state.GetArg());
+    }
+
+    void EventBusPostAsync(BenchmarkState& state) {
+        Events::EventBus bus;
+        u32 sum = 0;
+        bus.Subscribe<BenchmarkEvent>(OnBenchmarkEvent, &sum);
+        while (state.KeepRunning()) {
+            for (u32 i = 0; i < Events::ASYNC_CAPACITY; i++) {
+                bus.PostAsync(BenchmarkEvent{ i, 0, 0 });
+            }
+            bus.Dispatch();
+        }
+        DoNotOptimize(sum);
+        state.SetItemsProcessed((u64)state.GetIterations() * Events::ASYNC_CAPACITY);
+    }
+
+    // Typical movement code: position += velocity * dt for every entity
+    constexpr int MATH_ENTITIES = 4096;
+
+    template<typename T>
+    void MathMove(BenchmarkState& state) {
+        std::vector<Math::Vec2<T>> positions(MATH_ENTITIES);
+        std::vector<Math::Vec2<T>> velocities(MATH_ENTITIES, Math::Vec2<T>(T(1.5f), T(-0.25f)));
+        const T dt = T(1.0f / 60.0f);
+        while (state.KeepRunning()) {
+            for (int i = 0; i < MATH_ENTITIES; i++) {
+                positions[i] += velocities[i] * dt;
+            }
+            DoNotOptimize(positions[0]);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * MATH_ENTITIES);
+    }
+
+    // Typical rotation code: rotate every entity around the origin by its own angle
+    template<typename T>
+    void MathRotate(BenchmarkState& state) {
+        std::vector<Math::Vec2<T>> positions(MATH_ENTITIES, Math::Vec2<T>(T(10.0f), T(5.0f)));
+        std::vector<float> angles(MATH_ENTITIES);
+        for (int i = 0; i < MATH_ENTITIES; i++) angles[i] = i * 0.01f;
+
+        while (state.KeepRunning()) {
+            for (int i = 0; i < MATH_ENTITIES; i++) {
+                positions[i] = Math::Rotate(positions[i], Math::ToAngle(angles[i]));
+            }
+            DoNotOptimize(positions[0]);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * MATH_ENTITIES);
+    }
+
+    // Same rotation with the libm double functions, as the engine did before Math.hpp
+    void MathRotateLibm(BenchmarkState& state) {
+        std::vector<Math::Vec2d> positions(MATH_ENTITIES, Math::Vec2d(10.0, 5.0));
+        std::vector<double> angles(MATH_ENTITIES);
+        for (int i = 0; i < MATH_ENTITIES; i++) angles[i] = i * 0.01;
+
+        while (state.KeepRunning()) {
+            for (int i = 0; i < MATH_ENTITIES; i++) {
+                double s = sin(angles[i]), c = cos(angles[i]);
+                Math::Vec2d p = positions[i];
+                positions[i] = Math::Vec2d(p.x * c - p.y * s, p.x * s + p.y * c);
+            }
+            DoNotOptimize(positions[0]);
+        }
+        state.SetItemsProcessed((u64)state.GetIterations() * MATH_ENTITIES);
+    }
+}
+
+void Debug::RegisterEngineBenchmarks() {
+    RegisterBenchmark("Scene::Update", SceneUpdate, { 10, 100, 1000, 10000 });
+    RegisterBenchmark("Scene::Update/mixed_virtual", SceneUpdateMixed<false>, { 1000, 10000 });
+    RegisterBenchmark("Scene::Update/mixed_batched", SceneUpdateMixed<true>, { 1000, 10000 });
+    RegisterBenchmark("Scene::Update/ysort", SceneUpdateYSort, { 100, 1000 });
+    RegisterBenchmark("Render::Shapes/instanced", RenderShapes<true>, { 100, 1000 });
+    RegisterBenchmark("Render::Shapes/citro2d", RenderShapes<false>, { 100, 1000 });
+    RegisterBenchmark("Scene::QueryRadius/scan", SceneQueryRadius<false>, { 1000, 10000 });
+    RegisterBenchmark("Scene::QueryRadius/grid", SceneQueryRadius<true>, { 1000, 10000 });
+    RegisterBenchmark("Object::UpdateAttached/deep", UpdateAttachedDeep, { 10, 100, 500 });
+    RegisterBenchmark("Object::UpdateAttached/wide", UpdateAttachedWide, { 10, 100, 1000 });
+    RegisterBenchmark("InputManager::Update", InputUpdate);
+    RegisterBenchmark("InputManager::GetButtonState", InputGetButtonState);
+    RegisterBenchmark("Random::Range/int", RandomRangeInt);
+    RegisterBenchmark("Random::Range/double", RandomRangeDouble);
+    RegisterBenchmark("Random::UUID", RandomUUID);
+    RegisterBenchmark("Logger::Log", LoggerLog);
+    RegisterBenchmark("SceneManager::LoadScene/name", LoadSceneByName, { 1, 10, 100 });
+    RegisterBenchmark("SceneFile::Instantiate", SceneFileInstantiate, { 100, 5000 });
+    RegisterBenchmark("Pack::DecompressBlock/64KB", PackDecompressBlock);
+    RegisterBenchmark("EventBus::Dispatch", EventBusDispatch, { 10, 1000 });
+    RegisterBenchmark("EventBus::PostAsync", EventBusPostAsync);
+    RegisterBenchmark("Audio::Mixer/native", AudioMixerVoices<Audio::OUTPUT_RATE>, { 1, 8, 32 });
+    RegisterBenchmark("Audio::Mixer/resampled", AudioMixerVoices<22050>, { 1, 8, 32 });
+    RegisterBenchmark("TimerWheel::Advance/idle", TimerWheelIdle, { 100, 10000 });
+    RegisterBenchmark("TimerWheel::After+Cancel", TimerWheelScheduleCancel);
+    RegisterBenchmark("Coroutines::Scheduler/idle", CoroutinesIdle, { 100, 10000 });
+    RegisterBenchmark("Physics::World/active", PhysicsActive, { 100, 250, 500, 1000 });
+    RegisterBenchmark("Physics::World/asleep", PhysicsAsleep, { 100, 1000 });
+    RegisterBenchmark("Pathfinding::AStar/agents", PathfindingAgents<Pathfinding::Algorithm::ASTAR, false>, { 500 });
+    RegisterBenchmark("Pathfinding::JPS/agents", PathfindingAgents<Pathfinding::Algorithm::JPS, false>, { 500 });
+    RegisterBenchmark("Pathfinding::JPS/agents_cached", PathfindingAgents<Pathfinding::Algorithm::JPS, true>, { 500 });
+    RegisterBenchmark("Pathfinding::PathService/2ms_frame", PathfindingFrame, { 500 });
+    RegisterBenchmark("UI::Canvas/frame", UICanvasFrame, { 20, 200 });
+    RegisterBenchmark("UI::Canvas/layout", UICanvasLayout, { 20, 200 });
+    RegisterBenchmark("Jobs::ParallelFor/workers", JobsParallelUpdate, { 1, 2, 3, 4 });
+    RegisterBenchmark("Math::Move/double", MathMove<double>);
+    RegisterBenchmark("Math::Move/float", MathMove<float>);
+    RegisterBenchmark("Math::Move/fixed", MathMove<Math::Fixed16>);
+    RegisterBenchmark("Math::Rotate/libm_double", MathRotateLibm);
+    RegisterBenchmark("Math::Rotate/double", MathRotate<double>);
+    RegisterBenchmark("Math::Rotate/float", MathRotate<float>);
+    RegisterBenchmark("Math::Rotate/fixed", MathRotate<Math::Fixed16>);
+}
@@ -0,0 +1,170 @@
+/**
+ * @file Events.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex event bus implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Events.hpp"
+#include <string.h>
+#include <algorithm>
+
+namespace Events {
+    static_assert((ASYNC_CAPACITY & (ASYNC_CAPACITY - 1)) == 0, "ASYNC_CAPACITY must be a power of two");
+
+    u32 NextTypeId() {
+        static std::atomic<u32> next(0);
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    EventBus::EventBus() : enqueuePosition(0), posted(0), dropped(0) {
+        ring = new AsyncSlot[ASYNC_CAPACITY];
+        for (u32 i = 0; i < ASYNC_CAPACITY; i++) {
+            ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        queues[0].reserve(4096);
+        queues[1].reserve(4096);
+    }
+
+    EventBus::~EventBus() {
+        delete[] ring;
+    }
+
+    u32 EventBus::AddSubscriber(u32 type, GenericHandler handler, Invoker invoke, void* userData) {
+        if (type >= subscribers.size()) {
+            subscribers.resize(type + 1);
+        }
+        u32 id = nextSubscriberId++;
+        subscribers[type].push_back({ id, handler, invoke, userData });
+        return id;
+    }
+
+    void EventBus::Unsubscribe(u32 id) {
+        for (std::vector<Subscriber>& list : subscribers) {
+            for (size_t i = 0; i < list.size(); i++) {
+                if (list[i].id != id) continue;
+                if (dispatching) {
+                    // Removed once Dispatch no longer iterates the list
+                    list[i].handler = nullptr;
+                    removedDuringDispatch = true;
+                } else {
+                    list.erase(list.begin() + i);
+                }
+                return;
+            }
+        }
+    }
+
+    void EventBus::UnsubscribeAll(void* userData) {
+        for (std::vector<Subscriber>& list : subscribers) {
+            for (size_t i = 0; i < list.size();) {
+                if (list[i].userData != userData || !list[i].handler) {
+                    i++;
+                } else if (dispatching) {
+                    list[i++].handler = nullptr;
+                    removedDuringDispatch = true;
+                } else {
+                    list.erase(list.begin() + i);
+                }
+            }
+        }
+    }
+
+    void EventBus::Push(u32 type, const void* event, u32 size) {
+        std::vector<u8>& queue = queues[writeQueue];
+        size_t offset = queue.size();
+        u32 padded = (size + 7) & ~7u;
+
+        // Grows only until the busiest frame fits
+        queue.resize(offset + sizeof(QueuedEvent) + padded);
+        QueuedEvent header = { type, size };
+        memcpy(queue.data() + offset, &header, sizeof(header));
+        memcpy(queue.data() + offset + sizeof(QueuedEvent), event, size);
+        posted.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Bounded queue with one sequence number per slot: a producer claims a slot by advancing
+    // enqueuePosition, fills it and publishes it by setting its sequence to position + 1
+    bool EventBus::PushAsync(u32 type, const void* event, u32 size) {
+        u32 position = enqueuePosition.load(std::memory_order_relaxed);
+        AsyncSlot* slot;
+        while (true) {
+            slot = &ring[position & (ASYNC_CAPACITY - 1)];
+            u32 sequence = slot->sequence.load(std::memory_order_acquire);
+            s32 difference = (s32)(sequence - position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                // Still holds an event from ASYNC_CAPACITY posts ago
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->type = type;
+        slot->size = size;
+        memcpy(slot->data, event, size);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        posted.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void EventBus::Dispatch() {
+        // Move the events of other threads behind the ones posted on the main thread
+        while (true) {
+            AsyncSlot& slot = ring[dequeuePosition & (ASYNC_CAPACITY - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) break;
+
+            Push(slot.type, slot.data, slot.size);
+            posted.fetch_sub(1, std::memory_order_relaxed);   // Already counted by PushAsync
+            slot.sequence.store(dequeuePosition + ASYNC_CAPACITY, std::memory_order_release);
+            dequeuePosition++;
+        }
+
+        // Swap so events posted by the handlers go to the other queue
+        std::vector<u8>& queue = queues[writeQueue];
+        writeQueue ^= 1;
+        queues[writeQueue].clear();
+
+        lastStats.posted = posted.exchange(0, std::memory_order_relaxed);
+        lastStats.dropped = dropped.exchange(0, std::memory_order_relaxed);
+        lastStats.delivered = 0;
+
+        dispatching = true;
+        size_t offset = 0;
+        while (offset < queue.size()) {
+            QueuedEvent header;
+            memcpy(&header, queue.data() + offset, sizeof(header));
+            const void* event = queue.data() + offset + sizeof(QueuedEvent);
+            offset += sizeof(QueuedEvent) + ((header.size + 7) & ~7u);
+
+            if (header.type >= subscribers.size()) continue;
+
+            // Indexed every time: handlers may subscribe and reallocate the lists
+            for (size_t i = 0; i < subscribers[header.type].size(); i++) {
+                Subscriber subscriber = subscribers[header.type][i];
+                if (!subscriber.handler) continue;
+                subscriber.invoke(subscriber.handler, event, subscriber.userData);
+                lastStats.delivered++;
+            }
+        }
+        dispatching = false;
+
+        if (removedDuringDispatch) {
+            for (std::vector<Subscriber>& list : subscribers) {
+                list.erase(std::remove_if(list.begin(), list.end(),
+                                          [](const Subscriber& subscriber) { return !subscriber.handler; }),
+                           list.end());
+            }
+            removedDuringDispatch = false;
+        }
+    }
+}
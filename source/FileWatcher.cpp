@@ -0,0 +1,152 @@
+/**
+ * @file FileWatcher.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex file watcher implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "FileWatcher.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+using namespace Debug;
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (notify >= 0) close(notify);
+#endif
+}
+
+#ifdef __linux__
+int FileWatcher::AddWatch(const std::string& path) {
+    if (notify < 0) {
+        notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (notify < 0) return -1;
+    }
+
+    // Editors often write a new file and rename it over the old one, so the directory is watched
+    size_t slash = path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    // Watching a directory twice returns the same descriptor
+    return inotify_add_watch(notify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+}
+
+void FileWatcher::ReadEvents() {
+    alignas(struct inotify_event) char buffer[4096];
+    ssize_t size;
+    while ((size = read(notify, buffer, sizeof(buffer))) > 0) {
+        for (char* cursor = buffer; cursor < buffer + size;) {
+            const struct inotify_event* event = (const struct inotify_event*)cursor;
+            cursor += sizeof(struct inotify_event) + event->len;
+
+            // pending marks the files already reported by this Poll
+            for (Entry& entry : entries) {
+                if (entry.watch < 0 || entry.pending) continue;
+                // Events were lost: report every watched file
+                if (!(event->mask & IN_Q_OVERFLOW)) {
+                    if (entry.watch != event->wd || event->len == 0) continue;
+                    size_t slash = entry.path.rfind('/');
+                    const char* name = entry.path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+                    if (strcmp(name, event->name) != 0) continue;
+                }
+                entry.pending = true;
+                fired.push_back(entry);
+            }
+        }
+    }
+
+    for (Entry& entry : entries) {
+        if (entry.watch >= 0) entry.pending = false;
+    }
+}
+#endif
+
+void FileWatcher::Remove(size_t index) {
+#ifdef __linux__
+    int watch = entries[index].watch;
+    bool shared = false;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i != index && entries[i].watch == watch) shared = true;
+    }
+    if (watch >= 0 && !shared) inotify_rm_watch(notify, watch);
+#endif
+    entries.erase(entries.begin() + index);
+}
+
+int FileWatcher::Watch(const char* path, Callback callback, void* userData) {
+    Entry entry = { nextId++, path, callback, userData, 0, 0, false, -1 };
+#ifdef __linux__
+    entry.watch = AddWatch(entry.path);
+#endif
+
+    struct stat info;
+    if (stat(path, &info) == 0) {
+        entry.modified = info.st_mtime;
+        entry.size = info.st_size;
+    }
+
+    entries.push_back(entry);
+    return entry.id;
+}
+
+void FileWatcher::Unwatch(int id) {
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].id == id) {
+            Remove(i);
+            return;
+        }
+    }
+}
+
+void FileWatcher::UnwatchAll(void* userData) {
+    for (size_t i = 0; i < entries.size();) {
+        if (entries[i].userData == userData) {
+            Remove(i);
+        } else {
+            i++;
+        }
+    }
+}
+
+int FileWatcher::Poll() {
+    fired.clear();
+#ifdef __linux__
+    if (notify >= 0) ReadEvents();
+#endif
+
+    u32 checked = 0;
+    for (size_t i = 0; i < entries.size() && checked < filesPerPoll; i++) {
+        if (next >= entries.size()) next = 0;
+        Entry& entry = entries[next++];
+        // Reported by inotify
+        if (entry.watch >= 0) continue;
+        checked++;
+
+        // Missing while it is being replaced, check again later
+        struct stat info;
+        if (stat(entry.path.c_str(), &info) != 0) continue;
+
+        if (info.st_mtime != entry.modified || info.st_size != entry.size) {
+            entry.modified = info.st_mtime;
+            entry.size = info.st_size;
+            entry.pending = true;
+        } else if (entry.pending) {
+            entry.pending = false;
+            fired.push_back(entry);
+        }
+    }
+
+    // Callbacks may watch or unwatch files, so they run once the entries are no longer used
+    for (const Entry& entry : fired) {
+        entry.callback(entry.path.c_str(), entry.userData);
+    }
+    return fired.size();
+}
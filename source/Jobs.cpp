@@ -0,0 +1,310 @@
+/**
+ * @file Jobs.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex job system implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Jobs.hpp"
+
+namespace Jobs {
+    static constexpr u32 JOB_POOL_SIZE = 4096;      // Must be a power of two
+    static constexpr size_t WORKER_STACK_SIZE = 32 * 1024;
+
+    // Index of the worker running on the current thread (0 is the thread that called Start)
+    static thread_local int currentWorker = 0;
+
+    WorkQueue::WorkQueue(u32 capacity) : jobs(capacity, nullptr) {
+        LightLock_Init(&lock);
+    }
+
+    bool WorkQueue::Push(Job* job) {
+        LightLock_Lock(&lock);
+        if (tail - head >= jobs.size()) {
+            LightLock_Unlock(&lock);
+            return false;
+        }
+        jobs[tail & (jobs.size() - 1)] = job;
+        tail++;
+        LightLock_Unlock(&lock);
+        return true;
+    }
+
+    Job* WorkQueue::Pop() {
+        LightLock_Lock(&lock);
+        Job* job = nullptr;
+        if (tail != head) {
+            tail--;
+            job = jobs[tail & (jobs.size() - 1)];
+        }
+        LightLock_Unlock(&lock);
+        return job;
+    }
+
+    Job* WorkQueue::Steal() {
+        // Don't wait behind the owner, just try another queue
+        if (LightLock_TryLock(&lock) != 0) {
+            return nullptr;
+        }
+        Job* job = nullptr;
+        if (tail != head) {
+            job = jobs[head & (jobs.size() - 1)];
+            head++;
+        }
+        LightLock_Unlock(&lock);
+        return job;
+    }
+
+    JobSystem::JobSystem() : visibleWorkers(1), jobPool(JOB_POOL_SIZE), nextJob(0), running(false) {
+        LightSemaphore_Init(&wakeUp, 0, 0x7FFF);
+
+        // Running threads read the array while Start adds workers, so it must never move
+        workers.reserve(MAX_WORKERS);
+        Worker* main = new Worker();
+        main->system = this;
+        workers.push_back(main);
+    }
+
+    JobSystem::~JobSystem() {
+        Stop();
+        delete workers[0];
+    }
+
+    int JobSystem::GetRecommendedWorkerCount() {
+        bool isNew3DS = false;
+        APT_CheckNew3DS(&isNew3DS);
+        return isNew3DS ? 3 : 2;
+    }
+
+    int JobSystem::Start(int workerCount) {
+        Stop();
+
+        if (workerCount > MAX_WORKERS) workerCount = MAX_WORKERS;
+        if (workerCount <= 1) return 1;
+
+        bool isNew3DS = false;
+        APT_CheckNew3DS(&isNew3DS);
+
+        // Core 1 is shared with the system and needs a time limit before we can use it
+        if (R_SUCCEEDED(APT_SetAppCpuTimeLimit(80))) {
+            changedCpuLimit = true;
+        }
+
+        s32 priority = 0x30;
+        svcGetThreadPriority(&priority, CUR_THREAD_HANDLE);
+
+        // Extra threads go to the free cores first, then share the default core
+        const int new3DSCores[] = { 2, 1 };
+        const int old3DSCores[] = { 1 };
+        const int* cores = isNew3DS ? new3DSCores : old3DSCores;
+        const int coreCount = isNew3DS ? 2 : 1;
+
+        running = true;
+        for (int i = 1; i < workerCount; i++) {
+            Worker* worker = new Worker();
+            worker->system = this;
+            worker->index = workers.size();
+
+            int core = (i - 1) < coreCount ? cores[i - 1] : -2;
+            worker->thread = threadCreate(WorkerMain, worker, WORKER_STACK_SIZE, priority - 1, core, false);
+            if (!worker->thread && core != -2) {
+                worker->thread = threadCreate(WorkerMain, worker, WORKER_STACK_SIZE, priority - 1, -2, false);
+            }
+            if (!worker->thread) {
+                delete worker;
+                break;
+            }
+            workers.push_back(worker);
+            visibleWorkers.store(workers.size(), std::memory_order_release);
+        }
+
+        if (workers.size() == 1) {
+            running = false;
+        }
+        return workers.size();
+    }
+
+    void JobSystem::Stop() {
+        if (running) {
+            running = false;
+            LightSemaphore_Release(&wakeUp, workers.size());
+
+            for (size_t i = 1; i < workers.size(); i++) {
+                threadJoin(workers[i]->thread, U64_MAX);
+                threadFree(workers[i]->thread);
+                delete workers[i];
+            }
+            workers.resize(1);
+            visibleWorkers.store(1, std::memory_order_release);
+        }
+
+        if (changedCpuLimit) {
+            APT_SetAppCpuTimeLimit(0);
+            changedCpuLimit = false;
+        }
+    }
+
+    void JobSystem::WorkerMain(void* arg) {
+        Worker* worker = static_cast<Worker*>(arg);
+        JobSystem* system = worker->system;
+        currentWorker = worker->index;
+
+        while (system->running) {
+            Job* job = system->FindJob(worker->index);
+            if (job) {
+                system->Execute(job);
+            } else {
+                LightSemaphore_Acquire(&system->wakeUp, 1);
+            }
+        }
+    }
+
+    Job* JobSystem::AllocateJob() {
+        while (true) {
+            // Skip the jobs still in flight (e.g. a batch kept across frames by PathService)
+            for (u32 tries = 0; tries < JOB_POOL_SIZE; tries++) {
+                Job* job = &jobPool[nextJob.fetch_add(1) & (JOB_POOL_SIZE - 1)];
+                if (job->unfinished.load() == 0) return job;
+            }
+
+            // Every job is in flight: help until one finishes
+            Job* next = FindJob(currentWorker);
+            if (next) {
+                Execute(next);
+            } else {
+                svcSleepThread(0);
+            }
+        }
+    }
+
+    Job* JobSystem::FindJob(int workerIndex) {
+        int count = visibleWorkers.load(std::memory_order_acquire);
+        if (workerIndex >= count) {
+            workerIndex = 0;
+        }
+
+        Job* job = workers[workerIndex]->queue.Pop();
+        if (job) return job;
+
+        // Own queue is empty, steal from the others
+        for (int i = 1; i < count; i++) {
+            int victim = (workerIndex + i) % count;
+            job = workers[victim]->queue.Steal();
+            if (job) return job;
+        }
+        return nullptr;
+    }
+
+    Job* JobSystem::Create(JobFunction function, void* data, u32 begin, u32 end, Job* parent) {
+        Job* job = AllocateJob();
+        job->function = function;
+        job->data = data;
+        job->begin = begin;
+        job->end = end;
+        job->parent = parent;
+        job->unfinished = 1;
+        job->dependencies = 1;      // Released by Submit()
+        job->continuationCount = 0;
+
+        if (parent) {
+            parent->unfinished.fetch_add(1);
+        }
+        return job;
+    }
+
+    bool JobSystem::AddDependency(Job* job, Job* dependency) {
+        s32 slot = dependency->continuationCount.fetch_add(1);
+        if (slot >= MAX_CONTINUATIONS) {
+            dependency->continuationCount.fetch_sub(1);
+            return false;
+        }
+        job->dependencies.fetch_add(1);
+        dependency->continuations[slot] = job;
+        return true;
+    }
+
+    void JobSystem::Submit(Job* job) {
+        if (job->dependencies.fetch_sub(1) == 1) {
+            Schedule(job);
+        }
+    }
+
+    void JobSystem::Schedule(Job* job) {
+        if (workers.size() == 1) {
+            Execute(job);
+            return;
+        }
+
+        if (!workers[currentWorker < (int)workers.size() ? currentWorker : 0]->queue.Push(job)) {
+            // Queue full, run it right away
+            Execute(job);
+            return;
+        }
+        LightSemaphore_Release(&wakeUp, 1);
+    }
+
+    void JobSystem::Execute(Job* job) {
+        if (job->function) {
+            job->function(job->data, job->begin, job->end);
+        }
+        Finish(job);
+    }
+
+    void JobSystem::Finish(Job* job) {
+        // The last one goes to -1 (finished, still notifying) and to 0 once done, so AllocateJob
+        // cannot reuse the slot while the parent and the continuations are read
+        s32 unfinished = job->unfinished.load();
+        while (!job->unfinished.compare_exchange_weak(unfinished, unfinished == 1 ? -1 : unfinished - 1)) {}
+        if (unfinished != 1) {
+            return;
+        }
+
+        if (job->parent) {
+            Finish(job->parent);
+        }
+
+        s32 count = job->continuationCount.load();
+        for (s32 i = 0; i < count && i < MAX_CONTINUATIONS; i++) {
+            Submit(job->continuations[i]);
+        }
+        job->unfinished.store(0);
+    }
+
+    void JobSystem::Wait(Job* job) {
+        while (!IsFinished(job)) {
+            Job* next = FindJob(currentWorker);
+            if (next) {
+                Execute(next);
+            } else {
+                svcSleepThread(0);
+            }
+        }
+    }
+
+    void JobSystem::ParallelFor(u32 count, u32 grainSize, JobFunction function, void* data) {
+        if (count == 0) return;
+
+        if (workers.size() == 1) {
+            function(data, 0, count);
+            return;
+        }
+
+        if (grainSize == 0) grainSize = 1;
+
+        // A few chunks per worker so that stealing can balance uneven costs
+        u32 chunk = count / (workers.size() * 4);
+        if (chunk < grainSize) chunk = grainSize;
+
+        Job* root = Create(nullptr, nullptr);
+        for (u32 begin = 0; begin < count; begin += chunk) {
+            u32 end = begin + chunk < count ? begin + chunk : count;
+            Submit(Create(function, data, begin, end, root));
+        }
+        Submit(root);
+        Wait(root);
+    }
+}
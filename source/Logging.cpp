@@ -16,6 +16,7 @@ using namespace Debug;
 
 Logger::Logger(const char* file) {
     filename = file;
+    this->file = nullptr;
     fsInit();
 }
 
@@ -23,6 +24,7 @@ bool Logger::Log(char data[]) {
     if (NOLOG) { return false; }
 
     file = fopen(filename, "a");
+    if (!file) { return false; }
 
     size_t dataSize = sizeof(data);
     size_t elementsWritten = fwrite(data, dataSize, sizeof(data) / dataSize, file);
@@ -35,7 +37,7 @@ bool Logger::Log(char data[]) {
 }
 
 bool Logger::LogUnmanaged(char data[]) {
-    if (NOLOG) { return false; }
+    if (NOLOG || !file) { return false; }
 
     size_t dataSize = sizeof(data);
     size_t elementsWritten = fwrite(data, dataSize, sizeof(data) / dataSize, file);
@@ -49,7 +51,8 @@ void Logger::OpenFile() {
 }
 
 void Logger::CloseFile() {
-    fclose(file);
+    if (file) { fclose(file); }
+    file = nullptr;
 }
 
 Logger::~Logger() {
@@ -0,0 +1,326 @@
+/**
+ * @file Memory.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex memory accounting implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Memory.hpp"
+#include <stdlib.h>
+#include <malloc.h>
+#include <vector>
+
+namespace Memory {
+    static const int REGION_COUNT = static_cast<int>(Region::COUNT);
+    static const int TAG_COUNT = static_cast<int>(Tag::COUNT);
+
+    // Stored in front of every heap allocation so Free knows what to uncount
+    struct Header {
+        u32 size;
+        u8 tag;
+        u8 scope;
+        u16 magic;
+    };
+    static_assert(sizeof(Header) == 8, "Header must keep 8 byte alignment");
+    static const u16 HEADER_MAGIC = 0xCF3D;
+
+    // Linear allocations can't have a header without breaking their alignment
+    struct LinearRecord {
+        void* pointer;
+        u32 size;
+        u8 tag;
+        u8 scope;
+    };
+
+    static Counters tagCounters[REGION_COUNT][TAG_COUNT];
+    static Counters scopeCounters[REGION_COUNT][MAX_SCOPES];
+    static Counters totalCounters[REGION_COUNT];
+    static std::vector<LinearRecord> linearRecords;
+    static int currentScope = 0;
+    static FailureHandler failureHandler = nullptr;
+    static u32 heapAllocationCount = 0;
+    static LightLock lock;
+    static bool lockReady = false;
+
+    static void Lock() {
+        if (!lockReady) {
+            LightLock_Init(&lock);
+            lockReady = true;
+        }
+        LightLock_Lock(&lock);
+    }
+
+    static void Unlock() {
+        LightLock_Unlock(&lock);
+    }
+
+    static void Add(Counters& counters, ptrdiff_t bytes, int count) {
+        counters.live += bytes;
+        counters.allocations += count;
+        if (counters.live > counters.peak) {
+            counters.peak = counters.live;
+        }
+    }
+
+    // Must be called with the lock held
+    static void Count(Region region, Tag tag, int scope, ptrdiff_t bytes, int count) {
+        int r = static_cast<int>(region);
+        Add(tagCounters[r][static_cast<int>(tag)], bytes, count);
+        Add(scopeCounters[r][scope], bytes, count);
+        Add(totalCounters[r], bytes, count);
+    }
+
+    static void Fail(size_t size, Tag tag, Region region) {
+        Lock();
+        tagCounters[static_cast<int>(region)][static_cast<int>(tag)].failures++;
+        totalCounters[static_cast<int>(region)].failures++;
+        Unlock();
+
+        if (failureHandler) {
+            failureHandler(size, tag, region);
+        } else {
+            printf("Memory: failed to allocate %u bytes (%s, %s)\n", (unsigned)size, GetTagName(tag),
+                   region == Region::LINEAR ? "linear" : "heap");
+            Dump();
+        }
+    }
+
+    void* Allocate(size_t size, Tag tag) {
+        Header* header = static_cast<Header*>(malloc(sizeof(Header) + size));
+        if (!header) {
+            Fail(size, tag, Region::HEAP);
+            return nullptr;
+        }
+
+        Lock();
+        heapAllocationCount++;
+        header->size = size;
+        header->tag = static_cast<u8>(tag);
+        header->scope = currentScope;
+        header->magic = HEADER_MAGIC;
+        Count(Region::HEAP, tag, currentScope, size, 1);
+        Unlock();
+
+        return header + 1;
+    }
+
+    void Free(void* pointer) {
+        if (!pointer) return;
+
+        Header* header = static_cast<Header*>(pointer) - 1;
+        if (header->magic != HEADER_MAGIC) {
+            printf("Memory: freeing a pointer that was not allocated by Memory::Allocate\n");
+            return;
+        }
+
+        Lock();
+        Count(Region::HEAP, static_cast<Tag>(header->tag), header->scope, -(ptrdiff_t)header->size, -1);
+        header->magic = 0;
+        Unlock();
+
+        free(header);
+    }
+
+    void* LinearAllocate(size_t size, Tag tag, size_t alignment) {
+        void* pointer = linearMemAlign(size, alignment);
+        if (!pointer) {
+            Fail(size, tag, Region::LINEAR);
+            return nullptr;
+        }
+
+        Lock();
+        linearRecords.push_back({ pointer, (u32)size, static_cast<u8>(tag), (u8)currentScope });
+        Count(Region::LINEAR, tag, currentScope, size, 1);
+        Unlock();
+
+        return pointer;
+    }
+
+    void LinearFree(void* pointer) {
+        if (!pointer) return;
+
+        Lock();
+        for (size_t i = 0; i < linearRecords.size(); i++) {
+            if (linearRecords[i].pointer == pointer) {
+                const LinearRecord& record = linearRecords[i];
+                Count(Region::LINEAR, static_cast<Tag>(record.tag), record.scope, -(ptrdiff_t)record.size, -1);
+                linearRecords[i] = linearRecords.back();
+                linearRecords.pop_back();
+                break;
+            }
+        }
+        Unlock();
+
+        linearFree(pointer);
+    }
+
+    void Track(Tag tag, Region region, ptrdiff_t bytes) {
+        Lock();
+        Count(region, tag, currentScope, bytes, bytes > 0 ? 1 : (bytes < 0 ? -1 : 0));
+        Unlock();
+    }
+
+    int SetScope(int scope) {
+        int previous = currentScope;
+        currentScope = (scope >= 0 && scope < MAX_SCOPES) ? scope : 0;
+        return previous;
+    }
+
+    int GetScope() {
+        return currentScope;
+    }
+
+    Counters GetCounters(Tag tag, Region region) {
+        Lock();
+        Counters counters = tagCounters[static_cast<int>(region)][static_cast<int>(tag)];
+        Unlock();
+        return counters;
+    }
+
+    Counters GetScopeCounters(int scope, Region region) {
+        if (scope < 0 || scope >= MAX_SCOPES) return Counters();
+        Lock();
+        Counters counters = scopeCounters[static_cast<int>(region)][scope];
+        Unlock();
+        return counters;
+    }
+
+    size_t GetLiveBytes(Region region) {
+        return totalCounters[static_cast<int>(region)].live;
+    }
+
+    size_t GetPeakBytes(Region region) {
+        return totalCounters[static_cast<int>(region)].peak;
+    }
+
+    void ResetPeaks() {
+        Lock();
+        for (int r = 0; r < REGION_COUNT; r++) {
+            for (int t = 0; t < TAG_COUNT; t++) tagCounters[r][t].peak = tagCounters[r][t].live;
+            for (int s = 0; s < MAX_SCOPES; s++) scopeCounters[r][s].peak = scopeCounters[r][s].live;
+            totalCounters[r].peak = totalCounters[r].live;
+        }
+        Unlock();
+    }
+
+    const char* GetTagName(Tag tag) {
+        switch (tag) {
+            case Tag::GENERAL: return "GENERAL";
+            case Tag::SCENE: return "SCENE";
+            case Tag::SPRITE: return "SPRITE";
+            case Tag::TEXT: return "TEXT";
+            case Tag::COMMANDS: return "COMMANDS";
+            case Tag::AUDIO: return "AUDIO";
+            case Tag::FRAME: return "FRAME";
+            default: return "?";
+        }
+    }
+
+    u32 GetHeapAllocationCount() {
+        return heapAllocationCount;
+    }
+
+    void SetFailureHandler(FailureHandler handler) {
+        failureHandler = handler;
+    }
+
+    void Dump(FILE* output) {
+        static const char* regionNames[] = { "heap", "linear" };
+
+        Lock();
+        for (int r = 0; r < REGION_COUNT; r++) {
+            fprintf(output, "[%s] live %u peak %u\n", regionNames[r],
+                    (unsigned)totalCounters[r].live, (unsigned)totalCounters[r].peak);
+            for (int t = 0; t < TAG_COUNT; t++) {
+                const Counters& c = tagCounters[r][t];
+                if (c.peak == 0 && c.failures == 0) continue;
+                fprintf(output, "  %-8s live %u peak %u allocs %lu fails %lu\n", GetTagName(static_cast<Tag>(t)),
+                        (unsigned)c.live, (unsigned)c.peak, (unsigned long)c.allocations, (unsigned long)c.failures);
+            }
+            for (int s = 0; s < MAX_SCOPES; s++) {
+                const Counters& c = scopeCounters[r][s];
+                if (c.peak == 0) continue;
+                fprintf(output, "  scope %-2d live %u peak %u\n", s, (unsigned)c.live, (unsigned)c.peak);
+            }
+        }
+        Unlock();
+
+#ifdef __GLIBC__
+        // Host builds: glibc deprecates mallinfo() (its int fields overflow)
+        struct mallinfo2 info = mallinfo2();
+#else
+        struct mallinfo info = mallinfo();
+#endif
+        fprintf(output, "free: heap %u (in use %u), linear %lu\n", (unsigned)(info.fordblks),
+                (unsigned)info.uordblks, (unsigned long)linearSpaceFree());
+    }
+
+    Arena::Arena(size_t capacity, Tag tag) : capacity(capacity), tag(tag) {
+        block = static_cast<u8*>(Memory::Allocate(capacity, tag));
+        if (!block) this->capacity = 0;
+    }
+
+    Arena::~Arena() {
+        Reset();
+        Memory::Free(block);
+    }
+
+    void* Arena::Allocate(size_t size, size_t alignment) {
+        size_t start = (used + alignment - 1) & ~(alignment - 1);
+        if (start + size <= capacity) {
+            used = start + size;
+            if (GetUsed() > peak) peak = GetUsed();
+            return block + start;
+        }
+
+        // Main block full: take an extra block, the main block grows on the next Reset
+        void* extra = Memory::Allocate(size + alignment, tag);
+        if (!extra) return nullptr;
+        overflow.push_back(extra);
+        overflowUsed += size + alignment;
+        if (GetUsed() > peak) peak = GetUsed();
+
+        uintptr_t address = ((uintptr_t)extra + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        return (void*)address;
+    }
+
+    void Arena::Reset() {
+        if (!overflow.empty()) {
+            for (void* extra : overflow) {
+                Memory::Free(extra);
+            }
+            overflow.clear();
+
+            // Grow so the same workload fits in one block next time
+            Memory::Free(block);
+            capacity = peak + peak / 4;
+            block = static_cast<u8*>(Memory::Allocate(capacity, tag));
+            if (!block) capacity = 0;
+        }
+        used = 0;
+        overflowUsed = 0;
+    }
+}
+
+#ifdef CITROFLEX_DEBUG
+// Count every C++ heap allocation so SceneManager can check that steady frames don't allocate
+void* operator new(size_t size) {
+    Memory::heapAllocationCount++;
+    void* pointer = malloc(size ? size : 1);
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    Memory::heapAllocationCount++;
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+#endif
@@ -10,9 +10,93 @@
  */
 
 #include <Objects.hpp>
+#include <Scene.hpp>
+#include <Pack.hpp>
+#include <algorithm>
+#include <unordered_map>
 
 using namespace Objects;
 
+// Names and tags
+
+namespace {
+    // Names live as long as the program; id 0 is the empty name
+    struct NameTable {
+        std::vector<std::string> names{ std::string() };
+        std::unordered_map<std::string, NameId> ids;
+    };
+
+    NameTable& GetNameTable() {
+        static NameTable table;
+        return table;
+    }
+
+    std::vector<std::string>& GetTagNames() {
+        static std::vector<std::string> tagNames;
+        return tagNames;
+    }
+}
+
+NameId Objects::InternName(const char* name) {
+    if (!name || name[0] == '\0') return 0;
+    NameTable& table = GetNameTable();
+    auto it = table.ids.find(name);
+    if (it != table.ids.end()) return it->second;
+
+    NameId id = table.names.size();
+    table.names.emplace_back(name);
+    table.ids.emplace(table.names.back(), id);
+    return id;
+}
+
+NameId Objects::FindName(const char* name) {
+    if (!name || name[0] == '\0') return 0;
+    NameTable& table = GetNameTable();
+    auto it = table.ids.find(name);
+    return it != table.ids.end() ? it->second : 0;
+}
+
+const char* Objects::GetNameString(NameId id) {
+    NameTable& table = GetNameTable();
+    return id < table.names.size() ? table.names[id].c_str() : "";
+}
+
+TagMask Objects::RegisterTag(const char* name) {
+    TagMask tag = FindTag(name);
+    if (tag) return tag;
+    std::vector<std::string>& tagNames = GetTagNames();
+    if (tagNames.size() >= MAX_TAGS) return 0;
+    tagNames.emplace_back(name);
+    return 1u << (tagNames.size() - 1);
+}
+
+TagMask Objects::FindTag(const char* name) {
+    std::vector<std::string>& tagNames = GetTagNames();
+    for (size_t i = 0; i < tagNames.size(); i++) {
+        if (tagNames[i] == name) return 1u << i;
+    }
+    return 0;
+}
+
+
+Object::Object(const Object& other)
+    : x(other.x), y(other.y), inputManager(other.inputManager), hasLogic(other.hasLogic), customDraw(other.customDraw),
+      layer(other.layer), z(other.z), nameId(other.nameId), tags(other.tags), visible(other.visible),
+      threadSafe(other.threadSafe), depth(other.depth), kind(other.kind) {}
+
+Object& Object::operator=(const Object& other) {
+    if (this == &other) return *this;
+    SetPosition(other.x, other.y);
+    SetLayer(other.layer);
+    SetZ(other.z);
+    SetNameId(other.nameId);
+    SetTags(other.tags);
+    // hasLogic and customDraw describe this object's own type (set by DetectOverrides), not the source's
+    visible = other.visible;
+    threadSafe = other.threadSafe;
+    depth = other.depth;
+    return *this;
+}
 
 double Object::get_x() { return x; }
 void Object::SetX( double new_x ) { 
@@ -38,6 +122,40 @@ void Object::AddY( double add_y ) {
     UpdateAttached();
 }
 
+void Object::SetPosition( double new_x, double new_y ) {
+    x = new_x;
+    y = new_y;
+    if (!attachedElements.empty()) {
+        UpdateAttached();
+    }
+}
+
+void Object::SetLayer( s16 newLayer ) {
+    if (newLayer == layer) return;
+    layer = newLayer;
+    if (currentScene) currentScene->MarkOrderDirty();
+}
+
+void Object::SetZ( float newZ ) {
+    if (newZ == z) return;
+    z = newZ;
+    if (currentScene) currentScene->MarkOrderDirty();
+}
+
+void Object::SetNameId(NameId id) {
+    if (id == nameId) return;
+    NameId old = nameId;
+    nameId = id;
+    if (currentScene) currentScene->OnNameChanged(this, old);
+}
+
+void Object::SetTags(TagMask mask) {
+    if (mask == tags) return;
+    TagMask old = tags;
+    tags = mask;
+    if (currentScene) currentScene->OnTagsChanged(this, old);
+}
+
 void Object::UpdateAttached() {
     for (Object* element : attachedElements) {
         element->x = x + element->relativeX;
@@ -48,8 +166,88 @@ void Object::UpdateAttached() {
     }
 }
 
+// The function a virtual call would reach is read with GCC's bound member function extension, so
+// overrides are found without calling them
+#pragma GCC diagnostic ignored "-Wpmf-conversions"
+
+typedef void (*UpdateFunction)(Object*, Scene::Scene*);
+typedef void (*DrawFunction)(Object*);
+
+template<typename T>
+static bool OverridesShape(Object* object) {
+    return (UpdateFunction)(object->*(&Object::Update)) != (UpdateFunction)(&T::Update) ||
+           (DrawFunction)(object->*(&Object::Draw)) != (DrawFunction)(&T::Draw);
+}
+
+void Object::DetectOverrides() {
+    hasLogic = (UpdateFunction)(this->*(&Object::OnUpdate)) != (UpdateFunction)(&Object::OnUpdate);
+
+    switch (kind) {
+        case ObjectKind::RECTANGLE: customDraw = OverridesShape<Rectangle>(this); break;
+        case ObjectKind::LINE:      customDraw = OverridesShape<Line>(this); break;
+        case ObjectKind::CIRCLE:    customDraw = OverridesShape<Circle>(this); break;
+        case ObjectKind::ELLIPSE:   customDraw = OverridesShape<Ellipse>(this); break;
+        case ObjectKind::SPRITE:    customDraw = OverridesShape<Sprite>(this); break;
+        default: customDraw = true; break;
+    }
+}
+
 void Object::Update( Scene::Scene* scene ) {
-    OnUpdate(scene);
+    if (hasLogic) OnUpdate(scene);
+    DrawInScene();
+}
+
+void Object::DrawInScene() {
+    if (IsDrawnByCache()) return;
+    Render::TextureCache* cache = renderCache.cache;
+    if (cache && cache->IsReady()) {
+        cache->Draw(x, y, depth);
+        return;
+    }
+    if (visible) Draw();
+}
+
+void Object::SetCached(bool enabled) {
+    if (enabled == IsCached()) return;
+    if (enabled) {
+        renderCache.cache = new Render::TextureCache();
+    } else {
+        delete renderCache.cache;
+        renderCache.cache = nullptr;
+    }
+    if (currentScene) currentScene->MarkCachesDirty();
+}
+
+void Object::UpdateCache() {
+    Render::TextureCache* cache = renderCache.cache;
+    if (!cache || !currentScene) return;
+
+    // Hidden roots draw nothing, and roots inside an outer cache (updated first) are drawn by it
+    if (!visible || IsDrawnByCache()) {
+        cache->Skip();
+        return;
+    }
+
+    cache->Record();
+    Draw();
+    RecordAttached(currentScene->GetCacheFrame());
+    if (!cache->Finish(x, y)) {
+        // Too large or out of VRAM: the subtree draws itself
+        RecordAttached(0);
+    }
+}
+
+bool Object::IsDrawnByCache() const {
+    return cachedFrame != 0 && currentScene && currentScene->GetCacheFrame() == cachedFrame;
+}
+
+void Object::RecordAttached(u32 frame) {
+    for (Object* element : attachedElements) {
+        if (element->currentScene != currentScene) continue;
+        element->cachedFrame = frame;
+        if (frame != 0 && element->visible) element->Draw();
+        element->RecordAttached(frame);
+    }
 }
 
 void Object::Init() {
@@ -59,7 +257,14 @@ void Object::Attach(Object *obj) {
     // Calculate relative position
     obj->relativeX = obj->get_x() - x;
     obj->relativeY = obj->get_y() - y;
-    
+
+    // Attaching again only updates the relative position
+    if (obj->parent == this) return;
+    if (obj->parent) {
+        std::vector<Object*>& siblings = obj->parent->attachedElements;
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), obj), siblings.end());
+    }
+
     obj->parent = this;
     attachedElements.push_back(obj);
 }
@@ -69,18 +274,12 @@ void Object::SetRelativePosition(double x, double y) {
     relativeY = y;
 }
 
-void Rectangle::Update( Scene::Scene* scene ) {
-    Object::Update(scene);
-    if (!visible) return;
-    C2D_DrawRectSolid(get_x(), get_y(), 0, width, height, color);
+void Rectangle::Draw() {
+    Render::Rect(get_x(), get_y(), width, height, color, depth);
 }
 
-void Line::Update( Scene::Scene* scene ) {
-    Object::Update(scene);
-    if (!visible) return;
-    C2D_DrawLine(get_x(), get_y(), color, 
-                endX, endY, color, 
-                thickness, 0.0f);
+void Line::Draw() {
+    Render::Line(get_x(), get_y(), endX, endY, color, thickness, depth);
 }
 
 void Line::SetEndPoint(double x, double y) {
@@ -88,48 +287,151 @@ void Line::SetEndPoint(double x, double y) {
     endY = y;
 }
 
-void Circle::Update( Scene::Scene* scene ) {
-    Object::Update(scene);
-    if (!visible) return;
-    C2D_DrawCircleSolid(get_x(), get_y(), 0, radius, color);
+void Circle::Draw() {
+    Render::Circle(get_x(), get_y(), radius, color, depth);
 }
 
-void Ellipse::Update( Scene::Scene* scene ) {
-    Object::Update(scene);
-    if (!visible) return;
-    C2D_DrawEllipseSolid(get_x(), get_y(), 0, width, height, color);
+void Ellipse::Draw() {
+    Render::Ellipse(get_x(), get_y(), width, height, color, depth);
 }
 
-Sprite::~Sprite() {
-    if (spriteSheet) {
-        C2D_SpriteSheetFree(spriteSheet);
+// SpriteDef
+
+static std::vector<SpriteDef*>& GetSpriteDefs() {
+    static std::vector<SpriteDef*> defs;
+    return defs;
+}
+
+SpriteDef::~SpriteDef() {
+    if (sheet) {
+        C2D_SpriteSheetFree(sheet);
+        Memory::Track(Memory::Tag::SPRITE, Memory::Region::LINEAR, -(ptrdiff_t)sheetBytes);
+    }
+}
+
+bool SpriteDef::LoadSheet() {
+    // citro2d allocates the texture itself, count what it took from linear memory
+    u32 linearBefore = linearSpaceFree();
+    C2D_SpriteSheet loaded = nullptr;
+    const PackFormat::EntryRecord* entry = nullptr;
+    Pack::PackFile* pack = Pack::FindMounted(path.c_str(), &entry);
+    if (pack) {
+        // Decompressed from the pack, then imported by citro2d from memory
+        void* data = pack->ReadAlloc(entry, Memory::Tag::SPRITE);
+        if (!data) return false;
+        loaded = C2D_SpriteSheetLoadFromMem(data, entry->size);
+        Memory::Free(data);
+    } else {
+        loaded = C2D_SpriteSheetLoad(path.c_str());
+    }
+    if (!loaded) return false;
+    size_t loadedBytes = linearBefore - linearSpaceFree();
+
+    if (sheet) {
+        C2D_SpriteSheetFree(sheet);
+        Memory::Track(Memory::Tag::SPRITE, Memory::Region::LINEAR, -(ptrdiff_t)sheetBytes);
+    }
+    sheet = loaded;
+    sheetBytes = loadedBytes;
+    Memory::Track(Memory::Tag::SPRITE, Memory::Region::LINEAR, sheetBytes);
+
+    // Frame sizes are read once here instead of by every sprite
+    size_t count = C2D_SpriteSheetCount(sheet);
+    frames.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        Frame& frame = frames[i];
+        frame.image = C2D_SpriteSheetGetImage(sheet, i);
+        frame.width = frame.image.subtex->width;
+        frame.height = frame.image.subtex->height;
+    }
+    return true;
+}
+
+SpriteDef* SpriteDef::Load(const char* path) {
+    SpriteDef* def = Find(path);
+    if (!def) {
+        def = new SpriteDef(path);
+        if (!def->LoadSheet()) {
+            delete def;
+            return nullptr;
+        }
+        GetSpriteDefs().push_back(def);
     }
+    def->Retain();
+    return def;
+}
+
+SpriteDef* SpriteDef::Find(const char* path) {
+    for (SpriteDef* def : GetSpriteDefs()) {
+        if (def->path == path) return def;
+    }
+    return nullptr;
+}
+
+void SpriteDef::Release() {
+    if (--references > 0) return;
+    std::vector<SpriteDef*>& defs = GetSpriteDefs();
+    defs.erase(std::remove(defs.begin(), defs.end(), this), defs.end());
+    delete this;
+}
+
+bool SpriteDef::Reload() {
+    return LoadSheet();
+}
+
+// Sprite
+
+Sprite::Sprite(const Sprite& other)
+    : Object(other), def(other.def), frameIndex(other.frameIndex), angle(other.angle), radians(other.radians),
+      width(other.width), height(other.height) {
+    if (def) def->Retain();
+}
+
+Sprite& Sprite::operator=(const Sprite& other) {
+    if (this == &other) return *this;
+    Object::operator=(other);
+    SetDef(other.def);
+    frameIndex = other.frameIndex;
+    angle = other.angle;
+    radians = other.radians;
+    width = other.width;
+    height = other.height;
+    return *this;
+}
+
+Sprite::~Sprite() {
+    if (def) def->Release();
 }
 
 bool Sprite::LoadFromFile(const char* path) {
-    spriteSheet = C2D_SpriteSheetLoad(path);
-    if (!spriteSheet) return false;
-    
-    C2D_SpriteFromSheet(&sprite, spriteSheet, frameIndex);
-    C2D_SpriteSetCenter(&sprite, 0.5f, 0.5f);
-    C2D_SpriteSetPos(&sprite, get_x(), get_y());
+    SpriteDef* loaded = SpriteDef::Load(path);
+    if (!loaded) return false;
+    if (def) def->Release();
+    def = loaded;
     return true;
 }
 
+void Sprite::SetDef(SpriteDef* definition) {
+    if (definition) definition->Retain();
+    if (def) def->Release();
+    def = definition;
+}
+
 void Sprite::SetFrame(int index) {
-    if (spriteSheet) {
+    if (def) {
         frameIndex = index;
-        C2D_SpriteFromSheet(&sprite, spriteSheet, frameIndex);
     }
 }
 
-void Sprite::Update( Scene::Scene* scene ) {
-    Object::Update(scene);
-    if (!visible) return;
-    if (spriteSheet) {
-        C2D_SpriteSetPos(&sprite, get_x(), get_y());
-        C2D_SpriteSetRotation(&sprite, angle * M_PI / 180.0);
-        C2D_DrawSprite(&sprite);
+void Sprite::Draw() {
+    const SpriteDef::Frame* frame = def ? def->GetFrame(frameIndex) : nullptr;
+    if (frame) {
+        C2D_DrawParams params;
+        params.pos = { (float)get_x(), (float)get_y(), frame->width, frame->height };
+        params.center = { frame->width * def->centerX, frame->height * def->centerY };
+        params.depth = 0.5f;
+        params.angle = radians;
+        Render::Image(frame->image, params, depth);
     }
 }
 
@@ -139,8 +441,62 @@ double Sprite::getAngle() {
 
 void Sprite::SetAngle(double new_angle) { 
     angle = new_angle;
+    radians = Math::DegToRad(angle);
 }
 
 void Sprite::AddAngle(double add_angle) { 
     angle += add_angle;
+    radians = Math::DegToRad(angle);
+}
+
+// SpriteBatch
+
+SpriteBatch::~SpriteBatch() {
+    if (def) def->Release();
+}
+
+bool SpriteBatch::LoadFromFile(const char* path) {
+    SpriteDef* loaded = SpriteDef::Load(path);
+    if (!loaded) return false;
+    if (def) def->Release();
+    def = loaded;
+    return true;
+}
+
+void SpriteBatch::SetDef(SpriteDef* definition) {
+    if (definition) definition->Retain();
+    if (def) def->Release();
+    def = definition;
+}
+
+void SpriteBatch::Remove(u32 index) {
+    if (index >= instances.size()) return;
+    instances[index] = instances.back();
+    instances.pop_back();
+}
+
+void SpriteBatch::Draw() {
+    if (!def) return;
+    float originX = get_x();
+    float originY = get_y();
+    u32 frameCount = def->GetFrameCount();
+
+    // One pass over the packed instances, the draw parameters only exist here
+    C2D_DrawParams params;
+    params.depth = 0.5f;
+    for (const SpriteInstance& instance : instances) {
+        if (!(instance.flags & SpriteInstance::VISIBLE) || instance.frame >= frameCount) continue;
+        const SpriteDef::Frame* frame = def->GetFrame(instance.frame);
+
+        float scale = instance.scale * (1.0f / 256.0f);
+        float w = frame->width * scale;
+        float h = frame->height * scale;
+        // A negative size mirrors the image around its center
+        if (instance.flags & SpriteInstance::FLIP_X) w = -w;
+        if (instance.flags & SpriteInstance::FLIP_Y) h = -h;
+        params.pos = { originX + instance.x, originY + instance.y, w, h };
+        params.center = { w * def->centerX, h * def->centerY };
+        params.angle = instance.angle * (Math::TWO_PI / 65536.0f);
+        Render::Image(frame->image, params, depth, instance.tint, instance.blend);
+    }
 }
@@ -0,0 +1,300 @@
+/**
+ * @file Pack.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex asset pack reader implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Pack.hpp"
+#include <string.h>
+#include <algorithm>
+
+using namespace PackFormat;
+
+namespace Pack {
+    static std::vector<PackFile*>& GetMounted() {
+        static std::vector<PackFile*> mounted;
+        return mounted;
+    }
+
+    int DecompressBlock(const u8* source, size_t sourceSize, u8* destination, size_t capacity) {
+        const u8* in = source;
+        const u8* inEnd = source + sourceSize;
+        u8* out = destination;
+        u8* outEnd = destination + capacity;
+
+        // Sequences of literals followed by a match, lengths of 15 continue in 255-terminated bytes
+        while (in < inEnd) {
+            u8 token = *in++;
+
+            size_t literals = token >> 4;
+            if (literals == 15) {
+                u8 byte;
+                do {
+                    if (in >= inEnd) return -1;
+                    byte = *in++;
+                    literals += byte;
+                } while (byte == 255);
+            }
+            if ((size_t)(inEnd - in) < literals || (size_t)(outEnd - out) < literals) return -1;
+            memcpy(out, in, literals);
+            in += literals;
+            out += literals;
+
+            // The last sequence has no match
+            if (in == inEnd) break;
+
+            if (inEnd - in < 2) return -1;
+            size_t offset = in[0] | (in[1] << 8);
+            in += 2;
+            if (offset == 0 || offset > (size_t)(out - destination)) return -1;
+
+            size_t length = (token & 15) + 4;
+            if ((token & 15) == 15) {
+                u8 byte;
+                do {
+                    if (in >= inEnd) return -1;
+                    byte = *in++;
+                    length += byte;
+                } while (byte == 255);
+            }
+            if ((size_t)(outEnd - out) < length) return -1;
+
+            const u8* match = out - offset;
+            if (offset >= length) {
+                memcpy(out, match, length);
+                out += length;
+            } else {
+                // Overlapping copy: repeats the last offset bytes
+                while (length-- > 0) *out++ = *match++;
+            }
+        }
+        return out - destination;
+    }
+
+    // PackFile
+
+    PackFile::PackFile() {
+        LightLock_Init(&lock);
+    }
+
+    PackFile::~PackFile() {
+        Close();
+    }
+
+    bool PackFile::Open(const char* filePath) {
+        Close();
+
+        FILE* handle = fopen(filePath, "rb");
+        if (!handle) return false;
+
+        FileHeader header;
+        fseek(handle, 0, SEEK_END);
+        long length = ftell(handle);
+        fseek(handle, 0, SEEK_SET);
+        if (length < (long)sizeof(FileHeader) || fread(&header, sizeof(FileHeader), 1, handle) != 1 ||
+            header.magic != MAGIC || header.version != VERSION || header.headerSize != sizeof(FileHeader) ||
+            header.fileSize != (u32)length || header.chunkSize == 0) {
+            fclose(handle);
+            return false;
+        }
+
+        // Table of contents: entries then names, right after the header
+        u64 entriesEnd = header.entriesOffset + (u64)header.entryCount * sizeof(EntryRecord);
+        u64 tableSize = (u64)header.namesOffset + header.namesSize;
+        if (header.entriesOffset < sizeof(FileHeader) || entriesEnd > header.namesOffset ||
+            tableSize > header.fileSize || header.namesSize == 0) {
+            fclose(handle);
+            return false;
+        }
+
+        table = static_cast<u8*>(Memory::Allocate(tableSize, Memory::Tag::GENERAL));
+        fseek(handle, 0, SEEK_SET);
+        if (!table || fread(table, 1, tableSize, handle) != tableSize) {
+            Memory::Free(table);
+            table = nullptr;
+            fclose(handle);
+            return false;
+        }
+
+        entries = reinterpret_cast<const EntryRecord*>(table + header.entriesOffset);
+        names = reinterpret_cast<const char*>(table + header.namesOffset);
+        entryCount = header.entryCount;
+        chunkSize = header.chunkSize;
+        dataEnd = header.fileSize;
+
+        // Every name offset is then null-terminated and every entry inside the file
+        bool valid = names[header.namesSize - 1] == '\0';
+        for (u32 i = 0; valid && i < entryCount; i++) {
+            const EntryRecord& entry = entries[i];
+            valid = entry.name < header.namesSize && (u64)entry.offset + entry.storedSize <= dataEnd &&
+                    (i == 0 || entries[i - 1].hash <= entry.hash);
+            if (valid && (entry.flags & FLAG_COMPRESSED)) {
+                valid = entry.storedSize >= (u64)ChunkCount(entry.size, chunkSize) * sizeof(u32);
+            }
+        }
+        if (!valid) {
+            Memory::Free(table);
+            table = nullptr;
+            entryCount = 0;
+            fclose(handle);
+            return false;
+        }
+
+        file = handle;
+        path = filePath;
+        return true;
+    }
+
+    void PackFile::Close() {
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+        Memory::Free(table);
+        table = nullptr;
+        entries = nullptr;
+        names = nullptr;
+        entryCount = 0;
+        path.clear();
+    }
+
+    const EntryRecord* PackFile::Find(const char* name) const {
+        u32 hash = HashName(name);
+        const EntryRecord* end = entries + entryCount;
+        const EntryRecord* entry = std::lower_bound(entries, end, hash,
+            [](const EntryRecord& record, u32 value) { return record.hash < value; });
+        // Names decide between colliding hashes
+        for (; entry != end && entry->hash == hash; entry++) {
+            if (strcmp(names + entry->name, name) == 0) return entry;
+        }
+        return nullptr;
+    }
+
+    bool PackFile::ReadLocked(const EntryRecord* entry, u8* destination) {
+        if (fseek(file, entry->offset, SEEK_SET) != 0) return false;
+
+        if (!(entry->flags & FLAG_COMPRESSED)) {
+            return entry->storedSize == entry->size && fread(destination, 1, entry->size, file) == entry->size;
+        }
+
+        u32 chunks = ChunkCount(entry->size, chunkSize);
+        chunkSizes.resize(chunks);
+        if (fread(chunkSizes.data(), sizeof(u32), chunks, file) != chunks) return false;
+
+        u32 remaining = entry->storedSize - chunks * sizeof(u32);
+        for (u32 i = 0; i < chunks; i++) {
+            u32 stored = chunkSizes[i] & ~STORED_CHUNK;
+            u32 expected = std::min(chunkSize, entry->size - i * chunkSize);
+            if (stored > remaining) return false;
+            remaining -= stored;
+
+            u8* out = destination + i * chunkSize;
+            if (chunkSizes[i] & STORED_CHUNK) {
+                // Incompressible chunk: straight into the destination
+                if (stored != expected || fread(out, 1, stored, file) != stored) return false;
+            } else {
+                if (staging.size() < stored) staging.resize(stored);
+                if (fread(staging.data(), 1, stored, file) != stored) return false;
+                if (DecompressBlock(staging.data(), stored, out, expected) != (int)expected) return false;
+            }
+        }
+        return true;
+    }
+
+    bool PackFile::Read(const EntryRecord* entry, void* destination, size_t capacity) {
+        if (!file || !entry || capacity < entry->size) return false;
+
+        LightLock_Lock(&lock);
+        bool result = ReadLocked(entry, static_cast<u8*>(destination));
+        LightLock_Unlock(&lock);
+        return result;
+    }
+
+    void* PackFile::ReadAlloc(const EntryRecord* entry, Memory::Tag tag, bool linear) {
+        if (!file || !entry) return nullptr;
+
+        size_t size = entry->size > 0 ? entry->size : 1;
+        void* buffer = linear ? Memory::LinearAllocate(size, tag) : Memory::Allocate(size, tag);
+        if (!buffer) return nullptr;
+
+        if (!Read(entry, buffer, size)) {
+            if (linear) {
+                Memory::LinearFree(buffer);
+            } else {
+                Memory::Free(buffer);
+            }
+            return nullptr;
+        }
+        return buffer;
+    }
+
+    // Mounted packs
+
+    void Mount(PackFile* pack) {
+        Unmount(pack);
+        GetMounted().push_back(pack);
+    }
+
+    void Unmount(PackFile* pack) {
+        std::vector<PackFile*>& mounted = GetMounted();
+        mounted.erase(std::remove(mounted.begin(), mounted.end(), pack), mounted.end());
+    }
+
+    PackFile* FindMounted(const char* path, const EntryRecord** entry) {
+        std::vector<PackFile*>& mounted = GetMounted();
+        for (size_t i = mounted.size(); i-- > 0;) {
+            const EntryRecord* found = mounted[i]->Find(path);
+            if (found) {
+                *entry = found;
+                return mounted[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void* ReadFile(const char* path, size_t& size, Memory::Tag tag, bool linear) {
+        const EntryRecord* entry = nullptr;
+        PackFile* pack = FindMounted(path, &entry);
+        if (pack) {
+            void* buffer = pack->ReadAlloc(entry, tag, linear);
+            if (buffer) size = entry->size;
+            return buffer;
+        }
+
+        FILE* file = fopen(path, "rb");
+        if (!file) return nullptr;
+
+        fseek(file, 0, SEEK_END);
+        long length = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if (length < 0) {
+            fclose(file);
+            return nullptr;
+        }
+
+        size_t allocation = length > 0 ? length : 1;
+        void* buffer = linear ? Memory::LinearAllocate(allocation, tag) : Memory::Allocate(allocation, tag);
+        if (!buffer) {
+            fclose(file);
+            return nullptr;
+        }
+
+        size_t read = fread(buffer, 1, length, file);
+        fclose(file);
+        if (read != (size_t)length) {
+            if (linear) {
+                Memory::LinearFree(buffer);
+            } else {
+                Memory::Free(buffer);
+            }
+            return nullptr;
+        }
+        size = length;
+        return buffer;
+    }
+}
@@ -0,0 +1,509 @@
+/**
+ * @file Pathfinding.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex grid pathfinding implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Pathfinding.hpp"
+#include <stdlib.h>
+#include <algorithm>
+
+namespace Pathfinding {
+    static constexpr u32 NONE = 0xFFFFFFFF;
+    static constexpr u32 STRAIGHT_COST = 10;
+    static constexpr u32 DIAGONAL_COST = 14;
+    static constexpr u32 DEADLINE_INTERVAL = 64;   // Nodes expanded between deadline checks (power of two)
+
+    static const s8 directionX[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+    static const s8 directionY[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+    static int Sign(int value) {
+        return (value > 0) - (value < 0);
+    }
+
+    // Grid
+
+    void Grid::Resize(u16 newWidth, u16 newHeight) {
+        width = newWidth;
+        height = newHeight;
+        regionsX = (width + (1 << REGION_SHIFT) - 1) >> REGION_SHIFT;
+        u32 regionsY = (height + (1 << REGION_SHIFT) - 1) >> REGION_SHIFT;
+        blocked.assign((size_t)width * height, 0);
+        // Region versions never exceed the grid version, so every cached path becomes stale
+        version++;
+        regionVersions.assign(regionsX * regionsY, version);
+    }
+
+    void Grid::SetWalkable(int x, int y, bool walkable) {
+        if ((unsigned)x >= width || (unsigned)y >= height) return;
+        u8& tile = blocked[y * width + x];
+        if (tile == (walkable ? 0 : 1)) return;
+        tile = walkable ? 0 : 1;
+        version++;
+
+        int regionX = x >> REGION_SHIFT;
+        int regionY = y >> REGION_SHIFT;
+        int regionsY = regionVersions.size() / regionsX;
+        for (int ry = std::max(regionY - 1, 0); ry <= std::min(regionY + 1, regionsY - 1); ry++) {
+            for (int rx = std::max(regionX - 1, 0); rx <= std::min(regionX + 1, regionsX - 1); rx++) {
+                regionVersions[ry * regionsX + rx]++;
+            }
+        }
+    }
+
+    // Pathfinder
+
+    u32 Pathfinder::Heuristic(int x0, int y0, int x1, int y1) {
+        u32 dx = std::abs(x1 - x0);
+        u32 dy = std::abs(y1 - y0);
+        return STRAIGHT_COST * (dx + dy) - (2 * STRAIGHT_COST - DIAGONAL_COST) * std::min(dx, dy);
+    }
+
+    void Pathfinder::Reach(u32 node, u32 from, u32 g) {
+        if (closed[node] == search) return;
+        if (visited[node] == search && cost[node] <= g) return;
+
+        visited[node] = search;
+        cost[node] = g;
+        parent[node] = from;
+        u32 width = grid->GetWidth();
+        open.push_back({ g + Heuristic(node % width, node / width, goal.x, goal.y), g, node });
+        std::push_heap(open.begin(), open.end());
+    }
+
+    void Pathfinder::ExpandAStar(u32 node) {
+        u32 width = grid->GetWidth();
+        int x = node % width;
+        int y = node / width;
+        u32 g = cost[node];
+
+        for (int i = 0; i < 8; i++) {
+            int dx = directionX[i];
+            int dy = directionY[i];
+            if (!grid->IsWalkable(x + dx, y + dy)) continue;
+            if (dx && dy) {
+                if (!grid->IsWalkable(x + dx, y) || !grid->IsWalkable(x, y + dy)) continue;
+                Reach(node + dy * (int)width + dx, node, g + DIAGONAL_COST);
+            } else {
+                Reach(node + dy * (int)width + dx, node, g + STRAIGHT_COST);
+            }
+        }
+    }
+
+    bool Pathfinder::JumpStraight(int& x, int& y, int dx, int dy) const {
+        for (;;) {
+            x += dx;
+            y += dy;
+            if (!grid->IsWalkable(x, y)) return false;
+            if (x == goal.x && y == goal.y) return true;
+
+            // A side tile whose tile behind is a wall can only be reached through this one
+            if (dx) {
+                if ((grid->IsWalkable(x, y - 1) && !grid->IsWalkable(x - dx, y - 1)) ||
+                    (grid->IsWalkable(x, y + 1) && !grid->IsWalkable(x - dx, y + 1))) return true;
+            } else {
+                if ((grid->IsWalkable(x - 1, y) && !grid->IsWalkable(x - 1, y - dy)) ||
+                    (grid->IsWalkable(x + 1, y) && !grid->IsWalkable(x + 1, y - dy))) return true;
+            }
+        }
+    }
+
+    u32 Pathfinder::Jump(int x, int y, int dx, int dy) const {
+        u32 width = grid->GetWidth();
+        if (dx && dy) {
+            for (;;) {
+                if (!grid->IsWalkable(x + dx, y) || !grid->IsWalkable(x, y + dy) ||
+                    !grid->IsWalkable(x + dx, y + dy)) return NONE;
+                x += dx;
+                y += dy;
+                if (x == goal.x && y == goal.y) return y * width + x;
+
+                // Diagonal moves have no forced neighbours without corner cutting, but a straight
+                // scan finding a jump point makes this tile one
+                int scanX = x;
+                int scanY = y;
+                if (JumpStraight(scanX, scanY, dx, 0)) return y * width + x;
+                scanX = x;
+                scanY = y;
+                if (JumpStraight(scanX, scanY, 0, dy)) return y * width + x;
+            }
+        }
+
+        return JumpStraight(x, y, dx, dy) ? y * width + x : NONE;
+    }
+
+    void Pathfinder::ExpandJps(u32 node) {
+        u32 width = grid->GetWidth();
+        int x = node % width;
+        int y = node / width;
+        u32 g = cost[node];
+
+        // Directions worth scanning: all from the start, otherwise the natural and forced ones
+        s8 scanX[8];
+        s8 scanY[8];
+        int scans = 0;
+        auto add = [&](int dx, int dy) {
+            scanX[scans] = dx;
+            scanY[scans] = dy;
+            scans++;
+        };
+
+        if (parent[node] == NONE) {
+            for (int i = 0; i < 8; i++) add(directionX[i], directionY[i]);
+        } else {
+            int dx = Sign(x - (int)(parent[node] % width));
+            int dy = Sign(y - (int)(parent[node] / width));
+            if (dx && dy) {
+                add(dx, 0);
+                add(0, dy);
+                add(dx, dy);
+            } else if (dx) {
+                add(dx, 0);
+                for (int side = -1; side <= 1; side += 2) {
+                    if (!grid->IsWalkable(x - dx, y + side)) {
+                        add(0, side);
+                        add(dx, side);
+                    }
+                }
+            } else {
+                add(0, dy);
+                for (int side = -1; side <= 1; side += 2) {
+                    if (!grid->IsWalkable(x + side, y - dy)) {
+                        add(side, 0);
+                        add(side, dy);
+                    }
+                }
+            }
+        }
+
+        for (int i = 0; i < scans; i++) {
+            u32 jumpPoint = Jump(x, y, scanX[i], scanY[i]);
+            if (jumpPoint == NONE) continue;
+            Reach(jumpPoint, node, g + Heuristic(x, y, jumpPoint % width, jumpPoint / width));
+        }
+    }
+
+    void Pathfinder::BuildPath() {
+        u32 width = grid->GetWidth();
+        path.clear();
+        for (u32 node = goal.y * width + goal.x; node != NONE; node = parent[node]) {
+            path.push_back({ (s16)(node % width), (s16)(node / width) });
+        }
+        std::reverse(path.begin(), path.end());
+        if (algorithm == Algorithm::ASTAR) return;
+
+        // Jump points are joined by straight or diagonal lines: add the tiles in between
+        size_t jumpPoints = path.size();
+        std::vector<Point> points;
+        points.swap(path);
+        path.push_back(points[0]);
+        for (size_t i = 1; i < jumpPoints; i++) {
+            int dx = Sign(points[i].x - points[i - 1].x);
+            int dy = Sign(points[i].y - points[i - 1].y);
+            Point tile = points[i - 1];
+            while (tile.x != points[i].x || tile.y != points[i].y) {
+                tile.x += dx;
+                tile.y += dy;
+                path.push_back(tile);
+            }
+        }
+    }
+
+    bool Pathfinder::Begin(const Grid& target, Point from, Point to, Algorithm method) {
+        grid = &target;
+        start = from;
+        goal = to;
+        algorithm = method;
+        gridVersion = target.GetVersion();
+        expanded = 0;
+        open.clear();
+        path.clear();
+
+        size_t size = (size_t)target.GetWidth() * target.GetHeight();
+        if (visited.size() != size) {
+            cost.assign(size, 0);
+            parent.assign(size, NONE);
+            visited.assign(size, 0);
+            closed.assign(size, 0);
+            search = 0;
+        }
+        if (++search == 0) {
+            // Wrapped around: old tags could match again
+            std::fill(visited.begin(), visited.end(), 0);
+            std::fill(closed.begin(), closed.end(), 0);
+            search = 1;
+        }
+
+        if (!target.IsWalkable(from.x, from.y) || !target.IsWalkable(to.x, to.y)) {
+            status = Status::NOT_FOUND;
+            return false;
+        }
+
+        Reach(from.y * target.GetWidth() + from.x, NONE, 0);
+        status = Status::RUNNING;
+        return true;
+    }
+
+    Pathfinder::Status Pathfinder::Continue(u64 deadline) {
+        if (status != Status::RUNNING) return status;
+
+        u32 goalNode = goal.y * grid->GetWidth() + goal.x;
+        u32 count = 0;
+        while (!open.empty()) {
+            if ((++count & (DEADLINE_INTERVAL - 1)) == 0 && svcGetSystemTick() >= deadline) return status;
+
+            OpenNode top = open.front();
+            std::pop_heap(open.begin(), open.end());
+            open.pop_back();
+            // Entries left behind when a cheaper way to the tile was found
+            if (closed[top.node] == search || top.g != cost[top.node]) continue;
+
+            closed[top.node] = search;
+            expanded++;
+            if (top.node == goalNode) {
+                BuildPath();
+                status = Status::FOUND;
+                return status;
+            }
+
+            if (algorithm == Algorithm::ASTAR) {
+                ExpandAStar(top.node);
+            } else {
+                ExpandJps(top.node);
+            }
+        }
+
+        status = Status::NOT_FOUND;
+        return status;
+    }
+
+    const std::vector<Point>& Pathfinder::Find(const Grid& target, Point from, Point to, Algorithm method) {
+        if (Begin(target, from, to, method)) Continue(~0ULL);
+        return path;
+    }
+
+    // PathService
+
+    PathService::~PathService() {
+        if (job) jobs->Wait(job);
+    }
+
+    void PathService::SetWalkable(int x, int y, bool walkable) {
+        // The worker reads the grid; its results are searched again by FinishBatch
+        if (job) jobs->Wait(job);
+        grid.SetWalkable(x, y, walkable);
+    }
+
+    void PathService::SetJobSystem(Jobs::JobSystem* system, u32 requestsPerJob) {
+        if (job) {
+            jobs->Wait(job);
+            job = nullptr;
+            FinishBatch();
+        }
+        jobs = system;
+        batchSize = requestsPerJob > 0 ? requestsPerJob : 1;
+    }
+
+    void PathService::SetCacheCapacity(u32 capacity) {
+        cache.clear();
+        cacheIndex.clear();
+        cacheNext = 0;
+        cacheCapacity = capacity;
+    }
+
+    const PathService::CacheEntry* PathService::Lookup(Point start, Point goal) {
+        auto it = cacheIndex.find(KeyOf(start, goal));
+        if (it == cacheIndex.end()) return nullptr;
+
+        const CacheEntry& entry = cache[it->second];
+        bool valid = true;
+        if (!entry.found) {
+            valid = entry.gridVersion == grid.GetVersion();
+        } else {
+            for (size_t i = 0; i < entry.regions.size(); i += 2) {
+                if (grid.GetRegionVersion(entry.regions[i]) != entry.regions[i + 1]) {
+                    valid = false;
+                    break;
+                }
+            }
+        }
+
+        if (!valid) {
+            // The ring slot is reused when its turn comes
+            cacheIndex.erase(it);
+            return nullptr;
+        }
+        return &entry;
+    }
+
+    void PathService::Store(Point start, Point goal, const std::vector<Point>& path) {
+        if (cacheCapacity == 0) return;
+
+        u64 key = KeyOf(start, goal);
+        u32 slot;
+        auto it = cacheIndex.find(key);
+        if (it != cacheIndex.end()) {
+            slot = it->second;
+        } else {
+            if (cache.size() < cacheCapacity) {
+                slot = cache.size();
+                cache.emplace_back();
+            } else {
+                // Oldest entry first
+                slot = cacheNext;
+                cacheNext = (cacheNext + 1) % cacheCapacity;
+                auto old = cacheIndex.find(cache[slot].key);
+                if (old != cacheIndex.end() && old->second == slot) cacheIndex.erase(old);
+            }
+            cacheIndex[key] = slot;
+        }
+
+        CacheEntry& entry = cache[slot];
+        entry.key = key;
+        entry.found = !path.empty();
+        entry.gridVersion = grid.GetVersion();
+        entry.path.assign(path.begin(), path.end());
+        entry.regions.clear();
+        u32 last = NONE;
+        for (const Point& tile : path) {
+            u32 region = grid.GetRegion(tile.x, tile.y);
+            if (region == last) continue;
+            entry.regions.push_back(region);
+            entry.regions.push_back(grid.GetRegionVersion(region));
+            last = region;
+        }
+    }
+
+    void PathService::Complete(const QueuedRequest& request, const std::vector<Point>& path) {
+        Store(request.start, request.goal, path);
+        if (request.callback) request.callback(request.id, path.data(), path.size(), request.userData);
+    }
+
+    bool PathService::AnswerFromCache(const QueuedRequest& request) {
+        const CacheEntry* entry = Lookup(request.start, request.goal);
+        if (!entry) return false;
+
+        stats.cacheHits++;
+        request.callback(request.id, entry->found ? entry->path.data() : nullptr,
+                         entry->found ? entry->path.size() : 0, request.userData);
+        return true;
+    }
+
+    void PathService::BatchJob(void* data, u32 begin, u32 end) {
+        PathService* service = static_cast<PathService*>(data);
+        for (u32 i = begin; i < end; i++) {
+            BatchEntry& entry = service->batch[i];
+            entry.path = service->workerFinder.Find(service->grid, entry.request.start, entry.request.goal,
+                                                    entry.request.algorithm);
+            entry.expanded = service->workerFinder.GetExpanded();
+        }
+    }
+
+    void PathService::FinishBatch() {
+        if (grid.GetVersion() != batchVersion) {
+            // Tiles changed since the batch was searched: search again, in the same order
+            for (size_t i = batch.size(); i-- > 0;) {
+                if (!batch[i].request.callback) continue;
+                queue.push_front(batch[i].request);
+                stats.restarts++;
+            }
+        } else {
+            // Indexed: callbacks can cancel entries but never resize the batch
+            for (size_t i = 0; i < batch.size(); i++) {
+                stats.searches++;
+                stats.expanded += batch[i].expanded;
+                Complete(batch[i].request, batch[i].path);
+            }
+        }
+        batch.clear();
+    }
+
+    RequestId PathService::Request(Point start, Point goal, PathCallback callback, void* userData, Algorithm algorithm) {
+        if (!callback) return 0;
+
+        RequestId id = nextId++;
+        if (nextId == 0) nextId = 1;
+        queue.push_back({ id, start, goal, algorithm, callback, userData });
+        stats.requests++;
+        return id;
+    }
+
+    void PathService::Cancel(RequestId id) {
+        for (QueuedRequest& request : queue) {
+            if (request.id == id) request.callback = nullptr;
+        }
+        for (BatchEntry& entry : batch) {
+            if (entry.request.id == id) entry.request.callback = nullptr;
+        }
+        if (searching && current.id == id) searching = false;
+    }
+
+    void PathService::CancelAll(void* userData) {
+        for (QueuedRequest& request : queue) {
+            if (request.userData == userData) request.callback = nullptr;
+        }
+        for (BatchEntry& entry : batch) {
+            if (entry.request.userData == userData) entry.request.callback = nullptr;
+        }
+        if (searching && current.userData == userData) searching = false;
+    }
+
+    void PathService::Update(float budgetMilliseconds) {
+        if (jobs && jobs->GetWorkerCount() > 1) {
+            if (job) {
+                if (!jobs->IsFinished(job)) return;
+                job = nullptr;
+                FinishBatch();
+            }
+
+            // Cached requests are answered here, the others go to the next batch
+            for (size_t queued = queue.size(); queued > 0 && batch.size() < batchSize; queued--) {
+                QueuedRequest request = queue.front();
+                queue.pop_front();
+                if (!request.callback || AnswerFromCache(request)) continue;
+                batch.push_back({ request, {}, 0 });
+            }
+            if (!batch.empty()) {
+                batchVersion = grid.GetVersion();
+                job = jobs->Create(BatchJob, this, 0, batch.size());
+                jobs->Submit(job);
+            }
+            return;
+        }
+
+        u64 begin = svcGetSystemTick();
+        u64 deadline = begin + (u64)(budgetMilliseconds * CPU_TICKS_PER_MSEC);
+        // Requests queued by the callbacks wait for the next Update
+        size_t queued = queue.size();
+        for (;;) {
+            if (!searching) {
+                if (queued == 0) break;
+                queued--;
+                current = queue.front();
+                queue.pop_front();
+                if (!current.callback || AnswerFromCache(current)) continue;
+                finder.Begin(grid, current.start, current.goal, current.algorithm);
+                searching = true;
+            } else if (finder.IsStale()) {
+                stats.restarts++;
+                finder.Begin(grid, current.start, current.goal, current.algorithm);
+            }
+
+            // Cached answers cost nothing, searches stop at the deadline
+            if (svcGetSystemTick() >= deadline) break;
+            if (finder.Continue(deadline) == Pathfinder::Status::RUNNING) break;
+
+            searching = false;
+            stats.searches++;
+            stats.expanded += finder.GetExpanded();
+            QueuedRequest request = current;
+            Complete(request, finder.GetPath());
+        }
+        stats.ticks += svcGetSystemTick() - begin;
+    }
+}
@@ -0,0 +1,594 @@
+/**
+ * @file Physics.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex 2D rigid body physics implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Physics.hpp"
+#include <math.h>
+#include <algorithm>
+
+namespace Physics {
+    static constexpr float SLOP = 0.5f;                     // Overlap left uncorrected (pixels)
+    static constexpr float BAUMGARTE = 0.2f;                // Fraction of the overlap corrected per step
+    static constexpr float RESTITUTION_THRESHOLD = 60.0f;   // Slower impacts do not bounce (pixels/s)
+    static constexpr float SLEEP_VELOCITY = 6.0f;           // Bodies slower than this can sleep (pixels/s)
+    static constexpr float TIME_TO_SLEEP = 0.5f;            // Time an island must stay slow to sleep
+
+    uint32_t World::Find(BodyId id) const {
+        uint32_t slot = (id & ((1u << INDEX_BITS) - 1)) - 1;
+        if (id == 0 || slot >= denseIndex.size() || generations[slot] != (id >> INDEX_BITS)) return NONE;
+        return denseIndex[slot];
+    }
+
+    BodyId World::CreateBody(const BodyDef& def) {
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            if (denseIndex.size() >= (1u << INDEX_BITS) - 1) return 0;
+            slot = denseIndex.size();
+            denseIndex.push_back(NONE);
+            generations.push_back(1);
+        }
+        BodyId id = ((BodyId)generations[slot] << INDEX_BITS) | (slot + 1);
+
+        bool circle = def.shape == ShapeType::CIRCLE;
+        float mass = 0;
+        if (def.type == BodyType::DYNAMIC) {
+            float area = circle ? 3.14159265f * def.radius * def.radius : def.width * def.height;
+            mass = (def.density > 0 ? def.density : 1.0f) * (area > 0 ? area : 1.0f);
+        }
+
+        uint32_t index = handles.size();
+        denseIndex[slot] = index;
+        positionX.push_back(def.x);
+        positionY.push_back(def.y);
+        velocityX.push_back(0);
+        velocityY.push_back(0);
+        inverseMass.push_back(mass > 0 ? 1.0f / mass : 0.0f);
+        halfWidth.push_back(circle ? def.radius : def.width * 0.5f);
+        halfHeight.push_back(circle ? def.radius : def.height * 0.5f);
+        friction.push_back(def.friction);
+        restitution.push_back(def.restitution);
+        gravityScale.push_back(def.gravityScale);
+        sleepTime.push_back(0);
+        types.push_back((uint8_t)def.type);
+        shapes.push_back((uint8_t)def.shape);
+        flags.push_back(def.type == BodyType::DYNAMIC ? (AWAKE | MOVED) : MOVED);
+        userData.push_back(def.userData);
+        handles.push_back(id);
+
+        // The insertion sort of the next step moves it to its place
+        sweep.push_back(index);
+        if (def.userData) bodiesByUserData[def.userData] = id;
+        return id;
+    }
+
+    void World::DestroyBody(BodyId id) {
+        uint32_t index = Find(id);
+        if (index == NONE) return;
+
+        WakeTouching(index);
+
+        if (userData[index]) {
+            auto it = bodiesByUserData.find(userData[index]);
+            if (it != bodiesByUserData.end() && it->second == id) bodiesByUserData.erase(it);
+        }
+
+        // The last body takes the free place in every array
+        uint32_t last = handles.size() - 1;
+        auto move = [index](auto& array) {
+            array[index] = array.back();
+            array.pop_back();
+        };
+        move(positionX);
+        move(positionY);
+        move(velocityX);
+        move(velocityY);
+        move(inverseMass);
+        move(halfWidth);
+        move(halfHeight);
+        move(friction);
+        move(restitution);
+        move(gravityScale);
+        move(sleepTime);
+        move(types);
+        move(shapes);
+        move(flags);
+        move(userData);
+        move(handles);
+        if (index != last) denseIndex[(handles[index] & ((1u << INDEX_BITS) - 1)) - 1] = index;
+
+        sweep.erase(std::find(sweep.begin(), sweep.end(), index));
+        for (uint32_t& entry : sweep) {
+            if (entry == last) entry = index;
+        }
+
+        uint32_t slot = (id & ((1u << INDEX_BITS) - 1)) - 1;
+        denseIndex[slot] = NONE;
+        generations[slot] = (generations[slot] + 1) & ((1u << (32 - INDEX_BITS)) - 1);
+        if (generations[slot] == 0) generations[slot] = 1;
+        freeSlots.push_back(slot);
+    }
+
+    void World::Clear() {
+        positionX.clear();
+        positionY.clear();
+        velocityX.clear();
+        velocityY.clear();
+        inverseMass.clear();
+        halfWidth.clear();
+        halfHeight.clear();
+        friction.clear();
+        restitution.clear();
+        gravityScale.clear();
+        sleepTime.clear();
+        types.clear();
+        shapes.clear();
+        flags.clear();
+        userData.clear();
+        handles.clear();
+        sweep.clear();
+        contacts.clear();
+        previous.clear();
+        bodiesByUserData.clear();
+
+        // Slots are kept with a new generation so old handles stay invalid
+        freeSlots.clear();
+        for (uint32_t slot = 0; slot < denseIndex.size(); slot++) {
+            if (denseIndex[slot] != NONE) {
+                generations[slot] = (generations[slot] + 1) & ((1u << (32 - INDEX_BITS)) - 1);
+                if (generations[slot] == 0) generations[slot] = 1;
+                denseIndex[slot] = NONE;
+            }
+            freeSlots.push_back(slot);
+        }
+        accumulator = 0;
+        stats = Stats();
+    }
+
+    BodyId World::FindBody(const void* data) const {
+        auto it = bodiesByUserData.find(data);
+        return it != bodiesByUserData.end() ? it->second : 0;
+    }
+
+    void World::SetSleeping(bool enabled) {
+        sleeping = enabled;
+        if (!enabled) {
+            for (uint32_t i = 0; i < handles.size(); i++) WakeIndex(i);
+        }
+    }
+
+    void World::WakeIndex(uint32_t index) {
+        if (types[index] == (uint8_t)BodyType::STATIC) return;
+        flags[index] |= AWAKE;
+        sleepTime[index] = 0;
+    }
+
+    void World::WakeTouching(uint32_t index) {
+        // Sleeping bodies are not in the last step's contacts (none are kept once everything sleeps),
+        // so resting bodies are found by their boxes, grown by the slop they rest within
+        float left = positionX[index] - halfWidth[index] - SLOP;
+        float right = positionX[index] + halfWidth[index] + SLOP;
+        float top = positionY[index] - halfHeight[index] - SLOP;
+        float bottom = positionY[index] + halfHeight[index] + SLOP;
+        for (uint32_t i = 0; i < handles.size(); i++) {
+            if (i == index || IsActive(i)) continue;
+            if (positionX[i] + halfWidth[i] < left || positionX[i] - halfWidth[i] > right) continue;
+            if (positionY[i] + halfHeight[i] < top || positionY[i] - halfHeight[i] > bottom) continue;
+            WakeIndex(i);
+        }
+    }
+
+    bool World::GetPosition(BodyId id, float& x, float& y) const {
+        uint32_t index = Find(id);
+        if (index == NONE) return false;
+        x = positionX[index];
+        y = positionY[index];
+        return true;
+    }
+
+    void World::SetPosition(BodyId id, float x, float y) {
+        uint32_t index = Find(id);
+        if (index == NONE) return;
+        // Static bodies never wake: wake what rested on it at the old place and what it lands on
+        bool isStatic = types[index] == (uint8_t)BodyType::STATIC;
+        if (isStatic) WakeTouching(index);
+        positionX[index] = x;
+        positionY[index] = y;
+        flags[index] |= MOVED;
+        if (isStatic) WakeTouching(index);
+        WakeIndex(index);
+    }
+
+    bool World::GetVelocity(BodyId id, float& x, float& y) const {
+        uint32_t index = Find(id);
+        if (index == NONE) return false;
+        x = velocityX[index];
+        y = velocityY[index];
+        return true;
+    }
+
+    void World::SetVelocity(BodyId id, float x, float y) {
+        uint32_t index = Find(id);
+        if (index == NONE || types[index] == (uint8_t)BodyType::STATIC) return;
+        velocityX[index] = x;
+        velocityY[index] = y;
+        WakeIndex(index);
+    }
+
+    void World::ApplyImpulse(BodyId id, float x, float y) {
+        uint32_t index = Find(id);
+        if (index == NONE || types[index] != (uint8_t)BodyType::DYNAMIC) return;
+        velocityX[index] += x * inverseMass[index];
+        velocityY[index] += y * inverseMass[index];
+        WakeIndex(index);
+    }
+
+    bool World::IsAwake(BodyId id) const {
+        uint32_t index = Find(id);
+        return index != NONE && IsActive(index);
+    }
+
+    void World::Wake(BodyId id) {
+        uint32_t index = Find(id);
+        if (index != NONE) WakeIndex(index);
+    }
+
+    // Narrowphase: normal from the first shape to the second one
+
+    static bool BoxBox(float dx, float dy, float halfWidth, float halfHeight, float& normalX, float& normalY, float& penetration) {
+        float overlapX = halfWidth - fabsf(dx);
+        float overlapY = halfHeight - fabsf(dy);
+        if (overlapX <= 0 || overlapY <= 0) return false;
+        if (overlapX < overlapY) {
+            normalX = dx < 0 ? -1.0f : 1.0f;
+            normalY = 0;
+            penetration = overlapX;
+        } else {
+            normalX = 0;
+            normalY = dy < 0 ? -1.0f : 1.0f;
+            penetration = overlapY;
+        }
+        return true;
+    }
+
+    static bool CircleCircle(float dx, float dy, float radius, float& normalX, float& normalY, float& penetration) {
+        float distanceSquared = dx * dx + dy * dy;
+        if (distanceSquared >= radius * radius) return false;
+        float distance = sqrtf(distanceSquared);
+        if (distance > 1e-4f) {
+            normalX = dx / distance;
+            normalY = dy / distance;
+        } else {
+            normalX = 0;
+            normalY = 1;
+        }
+        penetration = radius - distance;
+        return true;
+    }
+
+    // dx, dy: circle center relative to the box center
+    static bool BoxCircle(float dx, float dy, float halfWidth, float halfHeight, float radius,
+                          float& normalX, float& normalY, float& penetration) {
+        float closestX = std::min(std::max(dx, -halfWidth), halfWidth);
+        float closestY = std::min(std::max(dy, -halfHeight), halfHeight);
+
+        if (closestX == dx && closestY == dy) {
+            // Center inside the box: push out through the nearest face
+            float faceX = halfWidth - fabsf(dx);
+            float faceY = halfHeight - fabsf(dy);
+            if (faceX < faceY) {
+                normalX = dx < 0 ? -1.0f : 1.0f;
+                normalY = 0;
+                penetration = faceX + radius;
+            } else {
+                normalX = 0;
+                normalY = dy < 0 ? -1.0f : 1.0f;
+                penetration = faceY + radius;
+            }
+            return true;
+        }
+
+        float offsetX = dx - closestX;
+        float offsetY = dy - closestY;
+        float distanceSquared = offsetX * offsetX + offsetY * offsetY;
+        if (distanceSquared >= radius * radius) return false;
+        float distance = sqrtf(distanceSquared);
+        normalX = offsetX / distance;
+        normalY = offsetY / distance;
+        penetration = radius - distance;
+        return true;
+    }
+
+    bool World::Collide(uint32_t first, uint32_t second) {
+        uint32_t a = handles[first] < handles[second] ? first : second;
+        uint32_t b = a == first ? second : first;
+
+        float dx = positionX[b] - positionX[a];
+        float dy = positionY[b] - positionY[a];
+        float normalX, normalY, penetration;
+        bool touching;
+
+        bool circleA = shapes[a] == (uint8_t)ShapeType::CIRCLE;
+        bool circleB = shapes[b] == (uint8_t)ShapeType::CIRCLE;
+        if (!circleA && !circleB) {
+            touching = BoxBox(dx, dy, halfWidth[a] + halfWidth[b], halfHeight[a] + halfHeight[b], normalX, normalY, penetration);
+        } else if (circleA && circleB) {
+            touching = CircleCircle(dx, dy, halfWidth[a] + halfWidth[b], normalX, normalY, penetration);
+        } else if (circleB) {
+            touching = BoxCircle(dx, dy, halfWidth[a], halfHeight[a], halfWidth[b], normalX, normalY, penetration);
+        } else {
+            touching = BoxCircle(-dx, -dy, halfWidth[b], halfHeight[b], halfWidth[a], normalX, normalY, penetration);
+            normalX = -normalX;
+            normalY = -normalY;
+        }
+        if (!touching) return false;
+
+        Contact contact;
+        contact.key = ((uint64_t)handles[a] << 32) | handles[b];
+        contact.a = a;
+        contact.b = b;
+        contact.normalX = normalX;
+        contact.normalY = normalY;
+        contact.penetration = penetration;
+        contact.normalImpulse = 0;
+        contact.tangentImpulse = 0;
+        contacts.push_back(contact);
+        return true;
+    }
+
+    void World::Broadphase() {
+        // Bodies move little between steps, so the insertion sort is close to linear
+        for (size_t i = 1; i < sweep.size(); i++) {
+            uint32_t index = sweep[i];
+            float left = positionX[index] - halfWidth[index];
+            size_t j = i;
+            while (j > 0 && positionX[sweep[j - 1]] - halfWidth[sweep[j - 1]] > left) {
+                sweep[j] = sweep[j - 1];
+                j--;
+            }
+            sweep[j] = index;
+        }
+
+        // Sweep from left to right keeping the bodies still open on X; pairs need an awake body,
+        // so static and sleeping bodies are only compared with the awake ones
+        openActive.clear();
+        openInactive.clear();
+        for (uint32_t index : sweep) {
+            float left = positionX[index] - halfWidth[index];
+            float top = positionY[index] - halfHeight[index];
+            float bottom = positionY[index] + halfHeight[index];
+            bool active = IsActive(index);
+
+            for (int list = active ? 2 : 1; list > 0; list--) {
+                std::vector<uint32_t>& open = list == 1 ? openActive : openInactive;
+                for (size_t k = 0; k < open.size();) {
+                    uint32_t other = open[k];
+                    if (positionX[other] + halfWidth[other] < left) {
+                        open[k] = open.back();
+                        open.pop_back();
+                        continue;
+                    }
+                    k++;
+                    if (positionY[other] + halfHeight[other] < top || positionY[other] - halfHeight[other] > bottom) continue;
+                    if (inverseMass[index] == 0 && inverseMass[other] == 0) continue;
+
+                    stats.pairs++;
+                    // A sleeping body touched by an awake one wakes up (and its island through it)
+                    if (Collide(index, other)) {
+                        if (!active) WakeIndex(index);
+                        if (!IsActive(other)) WakeIndex(other);
+                    }
+                }
+            }
+            (active ? openActive : openInactive).push_back(index);
+        }
+    }
+
+    void World::PrepareContacts(float step) {
+        std::sort(contacts.begin(), contacts.end(), [](const Contact& a, const Contact& b) { return a.key < b.key; });
+
+        // Both lists are sorted by key: warm start from last step's impulses in one pass
+        size_t old = 0;
+        for (Contact& contact : contacts) {
+            while (old < previous.size() && previous[old].key < contact.key) old++;
+            if (old < previous.size() && previous[old].key == contact.key) {
+                contact.normalImpulse = previous[old].normalImpulse;
+                contact.tangentImpulse = previous[old].tangentImpulse;
+            }
+
+            uint32_t a = contact.a;
+            uint32_t b = contact.b;
+            contact.normalMass = 1.0f / (inverseMass[a] + inverseMass[b]);
+            contact.friction = sqrtf(friction[a] * friction[b]);
+
+            float normalVelocity = (velocityX[b] - velocityX[a]) * contact.normalX + (velocityY[b] - velocityY[a]) * contact.normalY;
+            float bounce = 0;
+            if (normalVelocity < -RESTITUTION_THRESHOLD) {
+                bounce = -std::max(restitution[a], restitution[b]) * normalVelocity;
+            }
+            float push = BAUMGARTE / step * std::max(contact.penetration - SLOP, 0.0f);
+            contact.velocityBias = std::max(bounce, push);
+
+            float impulseX = contact.normalX * contact.normalImpulse - contact.normalY * contact.tangentImpulse;
+            float impulseY = contact.normalY * contact.normalImpulse + contact.normalX * contact.tangentImpulse;
+            velocityX[a] -= impulseX * inverseMass[a];
+            velocityY[a] -= impulseY * inverseMass[a];
+            velocityX[b] += impulseX * inverseMass[b];
+            velocityY[b] += impulseY * inverseMass[b];
+        }
+    }
+
+    void World::SolveContacts() {
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            for (Contact& contact : contacts) {
+                uint32_t a = contact.a;
+                uint32_t b = contact.b;
+                float inverseA = inverseMass[a];
+                float inverseB = inverseMass[b];
+
+                // Friction along the tangent, bounded by the normal impulse
+                float tangentX = -contact.normalY;
+                float tangentY = contact.normalX;
+                float relativeX = velocityX[b] - velocityX[a];
+                float relativeY = velocityY[b] - velocityY[a];
+                float lambda = -(relativeX * tangentX + relativeY * tangentY) * contact.normalMass;
+                float limit = contact.friction * contact.normalImpulse;
+                float accumulated = std::min(std::max(contact.tangentImpulse + lambda, -limit), limit);
+                lambda = accumulated - contact.tangentImpulse;
+                contact.tangentImpulse = accumulated;
+                velocityX[a] -= tangentX * lambda * inverseA;
+                velocityY[a] -= tangentY * lambda * inverseA;
+                velocityX[b] += tangentX * lambda * inverseB;
+                velocityY[b] += tangentY * lambda * inverseB;
+
+                // Normal impulse, never pulling
+                relativeX = velocityX[b] - velocityX[a];
+                relativeY = velocityY[b] - velocityY[a];
+                float normalVelocity = relativeX * contact.normalX + relativeY * contact.normalY;
+                lambda = (contact.velocityBias - normalVelocity) * contact.normalMass;
+                accumulated = std::max(contact.normalImpulse + lambda, 0.0f);
+                lambda = accumulated - contact.normalImpulse;
+                contact.normalImpulse = accumulated;
+                velocityX[a] -= contact.normalX * lambda * inverseA;
+                velocityY[a] -= contact.normalY * lambda * inverseA;
+                velocityX[b] += contact.normalX * lambda * inverseB;
+                velocityY[b] += contact.normalY * lambda * inverseB;
+            }
+        }
+    }
+
+    uint32_t World::Root(uint32_t index) {
+        while (islandParent[index] != index) {
+            islandParent[index] = islandParent[islandParent[index]];
+            index = islandParent[index];
+        }
+        return index;
+    }
+
+    void World::UpdateIslands(float step) {
+        size_t count = handles.size();
+        islandParent.resize(count);
+        islandSleep.resize(count);
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (!IsActive(i)) continue;
+            float speedSquared = velocityX[i] * velocityX[i] + velocityY[i] * velocityY[i];
+            if (types[i] == (uint8_t)BodyType::KINEMATIC) {
+                // A kinematic body standing still has nothing to simulate
+                if (speedSquared == 0) flags[i] &= ~AWAKE;
+                continue;
+            }
+            sleepTime[i] = speedSquared < SLEEP_VELOCITY * SLEEP_VELOCITY ? sleepTime[i] + step : 0;
+            islandParent[i] = i;
+            islandSleep[i] = sleepTime[i];
+        }
+
+        // Static and kinematic bodies do not join islands: a pile on the ground sleeps on its own
+        for (const Contact& contact : contacts) {
+            if (inverseMass[contact.a] == 0 || inverseMass[contact.b] == 0) continue;
+            uint32_t rootA = Root(contact.a);
+            uint32_t rootB = Root(contact.b);
+            if (rootA == rootB) continue;
+            islandParent[rootA] = rootB;
+            islandSleep[rootB] = std::min(islandSleep[rootB], islandSleep[rootA]);
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (!IsActive(i) || types[i] != (uint8_t)BodyType::DYNAMIC) continue;
+            uint32_t root = Root(i);
+            bool still = sleeping && islandSleep[root] >= TIME_TO_SLEEP;
+            if (root == i) {
+                stats.islands++;
+                if (still) stats.slept++;
+            }
+            if (still) {
+                flags[i] &= ~AWAKE;
+                velocityX[i] = 0;
+                velocityY[i] = 0;
+            }
+        }
+    }
+
+    void World::StepOnce(float step) {
+        stats.awake = 0;
+        stats.islands = 0;
+        stats.slept = 0;
+        stats.pairs = 0;
+        stats.contacts = 0;
+
+        size_t count = handles.size();
+        for (uint32_t i = 0; i < count; i++) {
+            if (!IsActive(i)) continue;
+            stats.awake++;
+            if (types[i] == (uint8_t)BodyType::DYNAMIC) {
+                velocityX[i] += gravityX * gravityScale[i] * step;
+                velocityY[i] += gravityY * gravityScale[i] * step;
+            }
+        }
+        if (stats.awake == 0) {
+            // Everything sleeps: nothing moves and no contact can appear
+            previous.clear();
+            return;
+        }
+
+        Broadphase();
+        stats.contacts = contacts.size();
+        PrepareContacts(step);
+        SolveContacts();
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (!IsActive(i)) continue;
+            positionX[i] += velocityX[i] * step;
+            positionY[i] += velocityY[i] * step;
+            flags[i] |= MOVED;
+        }
+
+        UpdateIslands(step);
+        previous.swap(contacts);
+        contacts.clear();
+    }
+
+    int World::Step(float deltaTime) {
+        if (handles.empty()) {
+            accumulator = 0;
+            stats.steps = 0;
+            return 0;
+        }
+
+        accumulator += deltaTime;
+        int steps = 0;
+        while (accumulator >= FIXED_STEP && steps < MAX_STEPS) {
+            StepOnce(FIXED_STEP);
+            accumulator -= FIXED_STEP;
+            steps++;
+        }
+        // Too far behind (long frame): drop the time instead of spiralling
+        if (accumulator >= FIXED_STEP) accumulator = 0;
+
+        stats.bodies = handles.size();
+        stats.steps = steps;
+        return steps;
+    }
+
+    void World::Sync(SyncCallback callback) {
+        for (uint32_t i = 0; i < handles.size(); i++) {
+            if (!(flags[i] & MOVED)) continue;
+            flags[i] &= ~MOVED;
+            if (!userData[i]) continue;
+            if (shapes[i] == (uint8_t)ShapeType::CIRCLE) {
+                callback(userData[i], positionX[i], positionY[i]);
+            } else {
+                callback(userData[i], positionX[i] - halfWidth[i], positionY[i] - halfHeight[i]);
+            }
+        }
+    }
+}
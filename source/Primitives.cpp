@@ -0,0 +1,288 @@
+/**
+ * @file Primitives.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex instanced rectangles, circles and ellipses implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Primitives.hpp"
+#include "Memory.hpp"
+#include "primitives_shbin.h"
+#include <math.h>
+
+namespace Primitives {
+    struct Instance {
+        float x, y, width, height;
+        u32 color;
+        Shape shape;
+    };
+
+    struct Corner {
+        float u, v, index;
+    };
+
+    static constexpr u32 CIRCLE_SIZE = 64;
+
+    static Instance queue[QUEUE_SIZE];
+    static u32 queued = 0;
+    static bool ready = false;
+    static bool enabled = true;
+    static u32 minBatch = MIN_BATCH;
+    static Stats stats;
+
+    static DVLB_s* shader = nullptr;
+    static shaderProgram_s program;
+    static s8 projectionLocation;
+    static s8 transformsLocation;
+    static s8 colorsLocation;
+    static C3D_AttrInfo attrInfo;
+    static C3D_BufInfo bufInfo;
+    static Corner* corners = nullptr;       // 4 per instance slot (linear memory)
+    static u16* indices = nullptr;          // 6 per instance slot (linear memory)
+    static C3D_Tex circle;
+    static C3D_Mtx projection;
+
+    // Offset of a texel in an 8x8 tiled (Morton order) texture
+    static u32 TiledOffset(u32 x, u32 y, u32 width) {
+        u32 tile = ((y >> 3) * (width >> 3) + (x >> 3)) * 64;
+        u32 texel = (x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) | ((x & 4) << 2) | ((y & 4) << 3);
+        return tile + texel;
+    }
+
+    // Coverage of a disc filling the texture, computed again for each mip level
+    static void FillCircle(u8* data, u32 size) {
+        float radius = size * 0.5f;
+        for (u32 y = 0; y < size; y++) {
+            for (u32 x = 0; x < size; x++) {
+                float dx = x + 0.5f - radius;
+                float dy = y + 0.5f - radius;
+                float coverage = radius - sqrtf(dx * dx + dy * dy) + 0.5f;
+                coverage = coverage < 0.0f ? 0.0f : (coverage > 1.0f ? 1.0f : coverage);
+                data[TiledOffset(x, y, size)] = (u8)(coverage * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    static void DrawCitro2D(const Instance& instance) {
+        if (instance.shape == Shape::RECT) {
+            C2D_DrawRectSolid(instance.x, instance.y, 0, instance.width, instance.height, instance.color);
+        } else {
+            C2D_DrawEllipseSolid(instance.x, instance.y, 0, instance.width, instance.height, instance.color);
+        }
+        stats.vertices += 6;
+    }
+
+    static void SetTexEnv(Shape shape) {
+        C3D_TexEnv* env = C3D_GetTexEnv(0);
+        C3D_TexEnvInit(env);
+        if (shape == Shape::RECT) {
+            C3D_TexEnvSrc(env, C3D_Both, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR);
+            C3D_TexEnvFunc(env, C3D_Both, GPU_REPLACE);
+        } else {
+            C3D_TexEnvSrc(env, C3D_RGB, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR);
+            C3D_TexEnvFunc(env, C3D_RGB, GPU_REPLACE);
+            C3D_TexEnvSrc(env, C3D_Alpha, GPU_PRIMARY_COLOR, GPU_TEXTURE0, GPU_PRIMARY_COLOR);
+            C3D_TexEnvFunc(env, C3D_Alpha, GPU_MODULATE);
+        }
+    }
+
+    static void DrawInstanced() {
+        // Pending citro2d vertices go first, then the view and citro2d's state are kept for after
+        C2D_Flush();
+        C2D_Mtx view;
+        C2D_ViewSave(&view);
+
+        C3D_Mtx modelView;
+        Mtx_Identity(&modelView);
+        modelView.r[0].x = view.r[0];
+        modelView.r[0].y = view.r[1];
+        modelView.r[0].w = view.r[2];
+        modelView.r[1].x = view.r[3];
+        modelView.r[1].y = view.r[4];
+        modelView.r[1].w = view.r[5];
+        C3D_Mtx transform;
+        Mtx_Multiply(&transform, &projection, &modelView);
+
+        C3D_BindProgram(&program);
+        C3D_SetAttrInfo(&attrInfo);
+        C3D_SetBufInfo(&bufInfo);
+        C3D_TexBind(0, &circle);
+        C3D_FVUnifMtx4x4(GPU_VERTEX_SHADER, projectionLocation, &transform);
+        for (int i = 1; i < 6; i++) {
+            C3D_TexEnvInit(C3D_GetTexEnv(i));
+        }
+        stats.uniforms += 4;
+        stats.switches++;
+
+        // Draw calls of up to BATCH_SIZE shapes of one kind
+        u32 begin = 0;
+        while (begin < queued) {
+            Shape shape = queue[begin].shape;
+            u32 end = begin + 1;
+            while (end < queued && end - begin < BATCH_SIZE && queue[end].shape == shape) end++;
+            u32 count = end - begin;
+
+            SetTexEnv(shape);
+            C3D_FVec* transforms = C3D_FVUnifWritePtr(GPU_VERTEX_SHADER, transformsLocation, count);
+            C3D_FVec* colors = C3D_FVUnifWritePtr(GPU_VERTEX_SHADER, colorsLocation, count);
+            for (u32 i = 0; i < count; i++) {
+                const Instance& instance = queue[begin + i];
+                transforms[i] = FVec4_New(instance.x, instance.y, instance.width, instance.height);
+                colors[i] = FVec4_New((instance.color & 0xFF) / 255.0f, ((instance.color >> 8) & 0xFF) / 255.0f,
+                                      ((instance.color >> 16) & 0xFF) / 255.0f, (instance.color >> 24) / 255.0f);
+            }
+            C3D_DrawElements(GPU_TRIANGLES, count * 6, C3D_UNSIGNED_SHORT, indices);
+
+            stats.drawCalls++;
+            stats.uniforms += count * 2;
+            begin = end;
+        }
+        stats.instanced += queued;
+
+        C2D_Prepare();
+        C2D_ViewRestore(&view);
+    }
+
+    bool Init() {
+        if (ready) return true;
+
+        shader = DVLB_ParseFile((u32*)primitives_shbin, primitives_shbin_size);
+        if (!shader) return false;
+        shaderProgramInit(&program);
+        shaderProgramSetVsh(&program, &shader->DVLE[0]);
+        projectionLocation = shaderInstanceGetUniformLocation(program.vertexShader, "projection");
+        transformsLocation = shaderInstanceGetUniformLocation(program.vertexShader, "transforms");
+        colorsLocation = shaderInstanceGetUniformLocation(program.vertexShader, "colors");
+
+        corners = static_cast<Corner*>(Memory::LinearAllocate(sizeof(Corner) * 4 * BATCH_SIZE, Memory::Tag::COMMANDS));
+        indices = static_cast<u16*>(Memory::LinearAllocate(sizeof(u16) * 6 * BATCH_SIZE, Memory::Tag::COMMANDS));
+        bool circleReady = corners && indices && C3D_TexInitMipmap(&circle, CIRCLE_SIZE, CIRCLE_SIZE, GPU_A8);
+        if (!circleReady) {
+            Memory::LinearFree(corners);
+            Memory::LinearFree(indices);
+            corners = nullptr;
+            indices = nullptr;
+            shaderProgramFree(&program);
+            DVLB_Free(shader);
+            shader = nullptr;
+            return false;
+        }
+
+        // The mesh never changes: one unit quad per instance slot, with the slot index
+        for (u32 i = 0; i < BATCH_SIZE; i++) {
+            Corner* quad = corners + i * 4;
+            quad[0] = { 0.0f, 0.0f, (float)i };
+            quad[1] = { 1.0f, 0.0f, (float)i };
+            quad[2] = { 0.0f, 1.0f, (float)i };
+            quad[3] = { 1.0f, 1.0f, (float)i };
+            u16* triangles = indices + i * 6;
+            u16 first = i * 4;
+            triangles[0] = first;
+            triangles[1] = first + 1;
+            triangles[2] = first + 2;
+            triangles[3] = first + 2;
+            triangles[4] = first + 1;
+            triangles[5] = first + 3;
+        }
+        GSPGPU_FlushDataCache(corners, sizeof(Corner) * 4 * BATCH_SIZE);
+        GSPGPU_FlushDataCache(indices, sizeof(u16) * 6 * BATCH_SIZE);
+
+        AttrInfo_Init(&attrInfo);
+        AttrInfo_AddLoader(&attrInfo, 0, GPU_FLOAT, 3);
+        BufInfo_Init(&bufInfo);
+        BufInfo_Add(&bufInfo, corners, sizeof(Corner), 1, 0x0);
+
+        // Each mip level is computed at its size so small circles stay round
+        for (int level = 0; level <= circle.maxLevel; level++) {
+            u8* data = static_cast<u8*>(C3D_TexGetImagePtr(&circle, circle.data, level, nullptr));
+            FillCircle(data, CIRCLE_SIZE >> level);
+        }
+        C3D_TexFlush(&circle);
+        C3D_TexSetFilter(&circle, GPU_LINEAR, GPU_LINEAR);
+        C3D_TexSetFilterMipmap(&circle, GPU_LINEAR);
+        C3D_TexSetWrap(&circle, GPU_CLAMP_TO_EDGE, GPU_CLAMP_TO_EDGE);
+
+        Mtx_OrthoTilt(&projection, 0.0f, 400.0f, 240.0f, 0.0f, 1.0f, -1.0f, true);
+        ready = true;
+        return true;
+    }
+
+    void Fini() {
+        if (!ready) return;
+        queued = 0;
+        C3D_TexDelete(&circle);
+        Memory::LinearFree(corners);
+        Memory::LinearFree(indices);
+        corners = nullptr;
+        indices = nullptr;
+        shaderProgramFree(&program);
+        DVLB_Free(shader);
+        shader = nullptr;
+        ready = false;
+    }
+
+    void SetEnabled(bool enable) {
+        if (!enable) Flush();
+        enabled = enable;
+    }
+
+    bool IsEnabled() {
+        return enabled && ready;
+    }
+
+    void SetMinBatch(u32 count) {
+        minBatch = count > 0 ? count : 1;
+    }
+
+    u32 GetMinBatch() {
+        return minBatch;
+    }
+
+    void SetTarget(C3D_RenderTarget* target) {
+        // Same projections as citro2d: screens are rotated, textures are not
+        if (target->linked) {
+            Mtx_OrthoTilt(&projection, 0.0f, target->frameBuf.height, target->frameBuf.width, 0.0f, 1.0f, -1.0f, true);
+        } else {
+            Mtx_Ortho(&projection, 0.0f, target->frameBuf.width, target->frameBuf.height, 0.0f, 1.0f, -1.0f, true);
+        }
+    }
+
+    void Draw(Shape shape, float x, float y, float width, float height, u32 color) {
+        stats.shapes++;
+        Instance instance = { x, y, width, height, color, shape };
+        bool instanceable = shape == Shape::RECT ||
+                            (fabsf(width) <= MAX_ELLIPSE_SIZE && fabsf(height) <= MAX_ELLIPSE_SIZE);
+        if (!enabled || !ready || !instanceable) {
+            Flush();
+            DrawCitro2D(instance);
+            return;
+        }
+
+        queue[queued++] = instance;
+        if (queued == QUEUE_SIZE) Flush();
+    }
+
+    void Flush() {
+        if (queued == 0) return;
+        if (queued < minBatch) {
+            for (u32 i = 0; i < queued; i++) {
+                DrawCitro2D(queue[i]);
+            }
+        } else {
+            DrawInstanced();
+        }
+        queued = 0;
+    }
+
+    const Stats& GetStats() {
+        return stats;
+    }
+
+    void ResetStats() {
+        stats = Stats();
+    }
+}
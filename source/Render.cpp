@@ -0,0 +1,392 @@
+/**
+ * @file Render.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex draw commands implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Render.hpp"
+#include "Primitives.hpp"
+#include <math.h>
+#include <algorithm>
+
+namespace Render {
+    static DrawList* recording = nullptr;   // Active list, nullptr when drawing directly
+    static float layerDepth = 0.0f;
+
+    static void Execute(const DrawCommand& command, float offset) {
+        switch (command.type) {
+            case CommandType::RECT:
+                Primitives::Draw(Primitives::Shape::RECT, command.shape.x + offset, command.shape.y,
+                                 command.shape.a, command.shape.b, command.shape.color);
+                break;
+            case CommandType::LINE:
+                Primitives::Flush();
+                C2D_DrawLine(command.shape.x + offset, command.shape.y, command.shape.color,
+                             command.shape.a + offset, command.shape.b, command.shape.color,
+                             command.shape.thickness, 0.0f);
+                break;
+            case CommandType::CIRCLE:
+                Primitives::Draw(Primitives::Shape::ELLIPSE, command.shape.x - command.shape.a + offset,
+                                 command.shape.y - command.shape.a, command.shape.a * 2, command.shape.a * 2,
+                                 command.shape.color);
+                break;
+            case CommandType::ELLIPSE:
+                Primitives::Draw(Primitives::Shape::ELLIPSE, command.shape.x + offset, command.shape.y,
+                                 command.shape.a, command.shape.b, command.shape.color);
+                break;
+            case CommandType::IMAGE: {
+                Primitives::Flush();
+                C2D_DrawParams params = command.image.params;
+                params.pos.x += offset;
+                // Untinted opaque images skip the tint so citro2d keeps its plain texture path
+                if (command.image.blend != 0 || (command.image.tint >> 24) != 0xFF) {
+                    C2D_ImageTint tint;
+                    C2D_PlainImageTint(&tint, command.image.tint, command.image.blend / 255.0f);
+                    C2D_DrawImage(command.image.image, &params, &tint);
+                } else {
+                    C2D_DrawImage(command.image.image, &params, nullptr);
+                }
+                break;
+            }
+        }
+    }
+
+    static void Submit(const DrawCommand& command) {
+        if (recording) {
+            recording->Add(command);
+        } else {
+            Execute(command, 0.0f);
+        }
+    }
+
+    static DrawCommand MakeShape(CommandType type, float x, float y, float a, float b, u32 color, float depth) {
+        DrawCommand command;
+        command.type = type;
+        command.depth = depth + layerDepth;
+        command.shape.x = x;
+        command.shape.y = y;
+        command.shape.a = a;
+        command.shape.b = b;
+        command.shape.thickness = 0;
+        command.shape.color = color;
+        return command;
+    }
+
+    void DrawList::Replay(float parallax) const {
+        for (const DrawCommand& command : commands) {
+            Execute(command, command.depth * parallax);
+        }
+    }
+
+    void BeginRecording(DrawList* list) {
+        recording = list;
+    }
+
+    void EndRecording() {
+        recording = nullptr;
+    }
+
+    void SceneBegin(C3D_RenderTarget* target) {
+        Primitives::Flush();
+        C2D_SceneBegin(target);
+        Primitives::SetTarget(target);
+    }
+
+    void ViewTranslate(float x, float y) {
+        Primitives::Flush();
+        C2D_ViewTranslate(x, y);
+    }
+
+    void ViewReset() {
+        Primitives::Flush();
+        C2D_ViewReset();
+    }
+
+    void Flush() {
+        Primitives::Flush();
+        C2D_Flush();
+    }
+
+    bool IsRecording() {
+        return recording != nullptr;
+    }
+
+    void SetLayerDepth(float depth) {
+        layerDepth = depth;
+    }
+
+    void Rect(float x, float y, float width, float height, u32 color, float depth) {
+        Submit(MakeShape(CommandType::RECT, x, y, width, height, color, depth));
+    }
+
+    void Line(float x0, float y0, float x1, float y1, u32 color, float thickness, float depth) {
+        DrawCommand command = MakeShape(CommandType::LINE, x0, y0, x1, y1, color, depth);
+        command.shape.thickness = thickness;
+        Submit(command);
+    }
+
+    void Circle(float x, float y, float radius, u32 color, float depth) {
+        Submit(MakeShape(CommandType::CIRCLE, x, y, radius, 0, color, depth));
+    }
+
+    void Ellipse(float x, float y, float width, float height, u32 color, float depth) {
+        Submit(MakeShape(CommandType::ELLIPSE, x, y, width, height, color, depth));
+    }
+
+    void Image(const C2D_Image& image, const C2D_DrawParams& params, float depth, u32 tint, u8 blend) {
+        DrawCommand command;
+        command.type = CommandType::IMAGE;
+        command.depth = depth + layerDepth;
+        command.image.image = image;
+        command.image.params = params;
+        command.image.tint = tint;
+        command.image.blend = blend;
+        Submit(command);
+    }
+
+    // TextureCache
+
+    bool TextureCache::debug = false;
+
+    static constexpr u8 FLASH_FRAMES = 20;
+
+    struct RetiredTarget {
+        C3D_RenderTarget* target;
+        C3D_Tex texture;
+    };
+
+    static std::vector<RetiredTarget>& GetRetired() {
+        static std::vector<RetiredTarget> retired;
+        return retired;
+    }
+
+    // Relative positions of a moving subtree only differ by rounding errors
+    static bool Near(float a, float b) {
+        return fabsf(a - b) <= 1.0f / 256.0f;
+    }
+
+    static bool SameCommand(const DrawCommand& a, const DrawCommand& b) {
+        if (a.type != b.type) return false;
+        if (a.type == CommandType::IMAGE) {
+            const C2D_DrawParams& p = a.image.params;
+            const C2D_DrawParams& q = b.image.params;
+            return a.image.image.tex == b.image.image.tex && a.image.image.subtex == b.image.image.subtex &&
+                   Near(p.pos.x, q.pos.x) && Near(p.pos.y, q.pos.y) && p.pos.w == q.pos.w && p.pos.h == q.pos.h &&
+                   p.center.x == q.center.x && p.center.y == q.center.y && p.angle == q.angle &&
+                   a.image.tint == b.image.tint && a.image.blend == b.image.blend;
+        }
+        // The union may hold garbage past the shape, so fields are compared one by one
+        bool endPoint = a.type == CommandType::LINE;
+        return Near(a.shape.x, b.shape.x) && Near(a.shape.y, b.shape.y) &&
+               (endPoint ? Near(a.shape.a, b.shape.a) && Near(a.shape.b, b.shape.b)
+                         : a.shape.a == b.shape.a && a.shape.b == b.shape.b) &&
+               a.shape.thickness == b.shape.thickness && a.shape.color == b.shape.color;
+    }
+
+    static void Translate(DrawCommand& command, float x, float y) {
+        if (command.type == CommandType::IMAGE) {
+            command.image.params.pos.x -= x;
+            command.image.params.pos.y -= y;
+            return;
+        }
+        command.shape.x -= x;
+        command.shape.y -= y;
+        if (command.type == CommandType::LINE) {
+            command.shape.a -= x;
+            command.shape.b -= y;
+        }
+    }
+
+    static void ExtendBounds(const DrawCommand& command, float* bounds) {
+        float x0, y0, x1, y1;
+        switch (command.type) {
+            case CommandType::RECT:
+            case CommandType::ELLIPSE:
+                x0 = command.shape.x;
+                y0 = command.shape.y;
+                x1 = x0 + command.shape.a;
+                y1 = y0 + command.shape.b;
+                break;
+            case CommandType::CIRCLE:
+                x0 = command.shape.x - command.shape.a;
+                y0 = command.shape.y - command.shape.a;
+                x1 = command.shape.x + command.shape.a;
+                y1 = command.shape.y + command.shape.a;
+                break;
+            case CommandType::LINE: {
+                float half = command.shape.thickness * 0.5f;
+                x0 = std::min(command.shape.x, command.shape.a) - half;
+                y0 = std::min(command.shape.y, command.shape.b) - half;
+                x1 = std::max(command.shape.x, command.shape.a) + half;
+                y1 = std::max(command.shape.y, command.shape.b) + half;
+                break;
+            }
+            case CommandType::IMAGE:
+            default: {
+                // The image spans -center..size-center around pos, rotated by angle around pos
+                const C2D_DrawParams& params = command.image.params;
+                float left = -params.center.x;
+                float top = -params.center.y;
+                float right = params.pos.w - params.center.x;
+                float bottom = params.pos.h - params.center.y;
+                if (params.angle != 0.0f) {
+                    float dx = std::max(fabsf(left), fabsf(right));
+                    float dy = std::max(fabsf(top), fabsf(bottom));
+                    float radius = sqrtf(dx * dx + dy * dy);
+                    left = top = -radius;
+                    right = bottom = radius;
+                }
+                x0 = params.pos.x + left;
+                y0 = params.pos.y + top;
+                x1 = params.pos.x + right;
+                y1 = params.pos.y + bottom;
+                break;
+            }
+        }
+        bounds[0] = std::min(bounds[0], std::min(x0, x1));
+        bounds[1] = std::min(bounds[1], std::min(y0, y1));
+        bounds[2] = std::max(bounds[2], std::max(x0, x1));
+        bounds[3] = std::max(bounds[3], std::max(y0, y1));
+    }
+
+    static u16 TextureSide(float size) {
+        u16 side = 8;
+        while (side < size) side <<= 1;
+        return side;
+    }
+
+    TextureCache::~TextureCache() {
+        ReleaseTarget();
+    }
+
+    void TextureCache::ReleaseTarget() {
+        if (!target) return;
+        GetRetired().push_back({ target, texture });
+        target = nullptr;
+        textureWidth = 0;
+        textureHeight = 0;
+    }
+
+    void TextureCache::Record() {
+        ready = false;
+        recorded.Clear();
+        outerList = recording;
+        recording = &recorded;
+    }
+
+    bool TextureCache::Finish(float originX, float originY) {
+        recording = outerList;
+        outerList = nullptr;
+        if (flash > 0) flash--;
+
+        size_t count = recorded.Size();
+        DrawCommand* commands = recorded.Data();
+        for (size_t i = 0; i < count; i++) {
+            Translate(commands[i], originX, originY);
+        }
+
+        bool same = count == rendered.Size();
+        const DrawCommand* previous = rendered.Data();
+        for (size_t i = 0; same && i < count; i++) {
+            same = SameCommand(commands[i], previous[i]);
+        }
+
+        if (same) {
+            hits++;
+        } else {
+            if (!RenderTexture()) {
+                rendered.Clear();
+                return false;
+            }
+            rebuilds++;
+            flash = FLASH_FRAMES;
+        }
+        ready = true;
+        return true;
+    }
+
+    bool TextureCache::RenderTexture() {
+        rendered.Swap(recorded);
+        size_t count = rendered.Size();
+        const DrawCommand* commands = rendered.Data();
+        empty = count == 0;
+        if (empty) return true;
+
+        float bounds[4] = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+        for (size_t i = 0; i < count; i++) {
+            ExtendBounds(commands[i], bounds);
+        }
+        left = floorf(bounds[0]);
+        top = floorf(bounds[1]);
+        float width = ceilf(bounds[2]) - left;
+        float height = ceilf(bounds[3]) - top;
+        // Also rejects NaN from broken draws
+        if (!(width <= MAX_SIZE && height <= MAX_SIZE)) return false;
+
+        u16 neededWidth = TextureSide(width);
+        u16 neededHeight = TextureSide(height);
+        if (!target || textureWidth < neededWidth || textureHeight < neededHeight) {
+            ReleaseTarget();
+            if (!C3D_TexInitVRAM(&texture, neededWidth, neededHeight, GPU_RGBA8)) return false;
+            // No depth buffer: citro2d draws in order
+            target = C3D_RenderTargetCreateFromTex(&texture, GPU_TEXFACE_2D, 0, (GPU_DEPTHBUF)-1);
+            if (!target) {
+                C3D_TexDelete(&texture);
+                return false;
+            }
+            textureWidth = neededWidth;
+            textureHeight = neededHeight;
+        }
+
+        Render::SceneBegin(target);
+        C2D_TargetClear(target, 0);
+        ViewTranslate(-left, -top);
+        for (size_t i = 0; i < count; i++) {
+            Execute(commands[i], 0.0f);
+        }
+        ViewReset();
+
+        subTexture = { (u16)width, (u16)height, 0.0f, 1.0f, width / textureWidth, 1.0f - height / textureHeight };
+        return true;
+    }
+
+    void TextureCache::Draw(float x, float y, float depth) {
+        if (!ready || empty) return;
+
+        C2D_Image image = { &texture, &subTexture };
+        C2D_DrawParams params = {};
+        params.pos.x = x + left;
+        params.pos.y = y + top;
+        params.pos.w = subTexture.width;
+        params.pos.h = subTexture.height;
+        Image(image, params, depth);
+
+        if (debug) {
+            float w = params.pos.w;
+            float h = params.pos.h;
+            if (flash > 0) {
+                Rect(params.pos.x, params.pos.y, w, h, C2D_Color32(255, 0, 0, flash * 160 / FLASH_FRAMES), depth);
+            } else {
+                u32 green = C2D_Color32(0, 255, 0, 255);
+                Rect(params.pos.x, params.pos.y, w, 1, green, depth);
+                Rect(params.pos.x, params.pos.y + h - 1, w, 1, green, depth);
+                Rect(params.pos.x, params.pos.y, 1, h, green, depth);
+                Rect(params.pos.x + w - 1, params.pos.y, 1, h, green, depth);
+            }
+        }
+    }
+
+    void ReleaseRetired() {
+        std::vector<RetiredTarget>& retired = GetRetired();
+        for (RetiredTarget& entry : retired) {
+            C3D_RenderTargetDelete(entry.target);
+            C3D_TexDelete(&entry.texture);
+        }
+        retired.clear();
+    }
+}
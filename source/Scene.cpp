@@ -10,6 +10,10 @@
  */
 
 #include "Scene.hpp"
+#include "Primitives.hpp"
+#include <assert.h>
+#include <math.h>
+#include <float.h>
 
 namespace Scene {
 
@@ -21,20 +25,210 @@ namespace Scene {
     }
 
     void Scene::AddElement(Objects::Object* element) {
+        // Already registered (e.g. OnLoad running again after an unload): looked up in the kind index,
+        // the scene pointer alone does not prove membership
+        if (element->GetScene() == this) {
+            const ElementList& list = kindElements[(u32)element->GetKind()];
+            if (std::find(list.begin(), list.end(), element) != list.end()) return;
+        }
+
+        element->DetectOverrides();
         elements.push_back(element);
+        if (!drawOrder.empty() && DrawsAfter(drawOrder.back(), element)) MarkOrderDirty();
+        drawOrder.push_back(element);
+        element->SetScene(this);
+        IndexElement(element);
+        if (element->IsCached()) cacheListDirty = true;
         if (inputManager) {
             element->SetInputManager(inputManager);
         }
     }
 
+    Memory::Arena* Scene::GetFrameArena() const {
+        return sceneManager ? &sceneManager->GetFrameArena() : nullptr;
+    }
+
+    void Scene::UpdateElementsJob(void* data, u32 begin, u32 end) {
+        Scene* scene = static_cast<Scene*>(data);
+        for (u32 i = begin; i < end; i++) {
+            scene->parallelElements[i]->UpdateLogic(scene);
+        }
+    }
+
+    void Scene::SortDrawOrder() {
+        sortStats.frames++;
+        if (orderChanges == 0 && !ySort) return;
+
+        u64 start = svcGetSystemTick();
+        size_t count = drawOrder.size();
+        u32 moved = 0;
+        if (orderChanges > count / 8 + 1) {
+            // Many changes at once (e.g. a whole layer moved): O(n log n) stable merge sort
+            std::stable_sort(drawOrder.begin(), drawOrder.end(),
+                             [this](const Objects::Object* a, const Objects::Object* b) { return DrawsAfter(b, a); });
+            moved = count;
+        } else {
+            // Nearly sorted: stable insertion sort, linear when nothing moved
+            for (size_t i = 1; i < count; i++) {
+                Objects::Object* element = drawOrder[i];
+                size_t j = i;
+                while (j > 0 && DrawsAfter(drawOrder[j - 1], element)) {
+                    drawOrder[j] = drawOrder[j - 1];
+                    j--;
+                }
+                if (j != i) {
+                    drawOrder[j] = element;
+                    moved++;
+                }
+            }
+        }
+        orderChanges = 0;
+
+        if (moved > 0) {
+            sortStats.sorts++;
+            sortStats.moved += moved;
+        }
+        sortStats.lastTicks = svcGetSystemTick() - start;
+        sortStats.totalTicks += sortStats.lastTicks;
+    }
+
+    void Scene::SyncBody(void* userData, float x, float y) {
+        static_cast<Objects::Object*>(userData)->SetPosition(x, y);
+    }
+
+    Physics::BodyId Scene::AddBody(Objects::Rectangle* rectangle, Physics::BodyDef def) {
+        def.shape = Physics::ShapeType::BOX;
+        def.width = rectangle->width;
+        def.height = rectangle->height;
+        def.x = rectangle->GetPosition().x + rectangle->width * 0.5;
+        def.y = rectangle->GetPosition().y + rectangle->height * 0.5;
+        def.userData = rectangle;
+        return physics.CreateBody(def);
+    }
+
+    Physics::BodyId Scene::AddBody(Objects::Circle* circle, Physics::BodyDef def) {
+        def.shape = Physics::ShapeType::CIRCLE;
+        def.radius = circle->radius;
+        def.x = circle->GetPosition().x;
+        def.y = circle->GetPosition().y;
+        def.userData = circle;
+        return physics.CreateBody(def);
+    }
+
     void Scene::Update() {
-        for(auto element : elements) {
-            element->Update(this);
+        Render::SetLayerDepth(depth);
+        spatialDirty = true;
+        if (sceneManager) {
+            timers.Advance(sceneManager->GetDeltaTime());
+            coroutines.Update(&sceneManager->GetEventBus());
+            if (physics.GetBodyCount() > 0) {
+                physics.Step(sceneManager->GetDeltaTime());
+                physics.Sync(SyncBody);
+            }
+        }
+        SortDrawOrder();
+
+        bool parallel = false;
+        if (sceneManager && sceneManager->GetJobSystem().GetWorkerCount() > 1) {
+            parallelElements.clear();
+            for (auto element : elements) {
+                if (element->threadSafe) {
+                    parallelElements.push_back(element);
+                }
+            }
+
+            if (!parallelElements.empty()) {
+                sceneManager->GetJobSystem().ParallelFor(parallelElements.size(), 4, UpdateElementsJob, this);
+                parallel = true;
+            }
+        }
+
+        size_t count = drawOrder.size();
+        for (size_t i = 0; i < count;) {
+            Objects::Object* element = drawOrder[i];
+            Objects::ObjectKind kind = element->GetKind();
+
+            if (shapeBatching && kind != Objects::ObjectKind::CUSTOM && IsDrawOnly(element, parallel)) {
+                size_t end = i + 1;
+                while (end < count && drawOrder[end]->GetKind() == kind && IsDrawOnly(drawOrder[end], parallel)) {
+                    end++;
+                }
+                DrawRun(kind, i, end);
+                i = end;
+                continue;
+            }
+
+            if (parallel && element->threadSafe) {
+                // Logic already ran on the workers
+                element->DrawInScene();
+            } else {
+                element->Update(this);
+            }
+            i++;
+        }
+    }
+
+    void Scene::DrawRun(Objects::ObjectKind kind, size_t begin, size_t end) {
+        Objects::Object* const* run = drawOrder.data() + begin;
+        size_t count = end - begin;
+        switch (kind) {
+            case Objects::ObjectKind::RECTANGLE: DrawShapes<Objects::Rectangle>(run, count); break;
+            case Objects::ObjectKind::LINE:      DrawShapes<Objects::Line>(run, count); break;
+            case Objects::ObjectKind::CIRCLE:    DrawShapes<Objects::Circle>(run, count); break;
+            case Objects::ObjectKind::ELLIPSE:   DrawShapes<Objects::Ellipse>(run, count); break;
+            case Objects::ObjectKind::SPRITE:    DrawShapes<Objects::Sprite>(run, count); break;
+            default: break;
+        }
+    }
+
+    void Scene::Draw() {
+        Render::SetLayerDepth(depth);
+        SortDrawOrder();
+        for (auto element : drawOrder) {
+            element->DrawInScene();
+        }
+    }
+
+    static int CountAncestors(const Objects::Object* element) {
+        int count = 0;
+        for (const Objects::Object* parent = element->parent; parent; parent = parent->parent) count++;
+        return count;
+    }
+
+    void Scene::UpdateCaches() {
+        if (cacheListDirty) {
+            cachedElements.clear();
+            for (auto element : elements) {
+                if (element->IsCached()) cachedElements.push_back(element);
+            }
+            cacheListDirty = false;
+        }
+        if (cachedElements.empty()) return;
+
+        // Marks of the previous frame become stale
+        if (++cacheFrame == 0) cacheFrame = 1;
+
+        // Outer caches record first, inner roots they drew then skip their own cache
+        std::sort(cachedElements.begin(), cachedElements.end(), [](const Objects::Object* a, const Objects::Object* b) {
+            return CountAncestors(a) < CountAncestors(b);
+        });
+        for (auto element : cachedElements) {
+            element->UpdateCache();
         }
     }
 
     void Scene::RemoveElement(size_t index) {
         if (index < elements.size()) {
+            if (sceneManager) {
+                sceneManager->GetTweenManager().CancelTarget(elements[index]);
+            }
+            timers.CancelOwner(elements[index]);
+            coroutines.StopOwner(elements[index]);
+            physics.DestroyBody(physics.FindBody(elements[index]));
+            UnindexElement(elements[index]);
+            if (elements[index]->GetScene() == this) elements[index]->SetScene(nullptr);
+            if (elements[index]->IsCached()) cacheListDirty = true;
+            drawOrder.erase(std::find(drawOrder.begin(), drawOrder.end(), elements[index]));
             elements.erase(elements.begin() + index);
         }
     }
@@ -42,10 +236,48 @@ namespace Scene {
     void Scene::RemoveElementByInstance(Objects::Object* element) {
         auto it = std::find(elements.begin(), elements.end(), element);
         if (it != elements.end()) {
+            if (sceneManager) {
+                sceneManager->GetTweenManager().CancelTarget(element);
+            }
+            timers.CancelOwner(element);
+            coroutines.StopOwner(element);
+            physics.DestroyBody(physics.FindBody(element));
+            UnindexElement(element);
+            if (element->GetScene() == this) element->SetScene(nullptr);
+            if (element->IsCached()) cacheListDirty = true;
+            drawOrder.erase(std::find(drawOrder.begin(), drawOrder.end(), element));
             elements.erase(it);
         }
     }
 
+    void Scene::RemoveElements(Objects::Object* const* list, size_t count) {
+        if (count == 0) return;
+
+        // Sorted copy so each element is checked in O(log n) instead of searching the scene for each
+        std::vector<Objects::Object*> sorted(list, list + count);
+        std::sort(sorted.begin(), sorted.end());
+        UnindexElements(sorted);
+
+        auto removed = std::remove_if(elements.begin(), elements.end(), [&](Objects::Object* element) {
+            if (!std::binary_search(sorted.begin(), sorted.end(), element)) return false;
+            if (sceneManager) {
+                sceneManager->GetTweenManager().CancelTarget(element);
+            }
+            timers.CancelOwner(element);
+            coroutines.StopOwner(element);
+            physics.DestroyBody(physics.FindBody(element));
+            if (element->GetScene() == this) element->SetScene(nullptr);
+            if (element->IsCached()) cacheListDirty = true;
+            return true;
+        });
+        elements.erase(removed, elements.end());
+
+        // Removing keeps the draw order sorted
+        drawOrder.erase(std::remove_if(drawOrder.begin(), drawOrder.end(), [&](Objects::Object* element) {
+            return std::binary_search(sorted.begin(), sorted.end(), element);
+        }), drawOrder.end());
+    }
+
     int Scene::GetElementIndex(Objects::Object* element) const {
         auto it = std::find(elements.begin(), elements.end(), element);
         if (it != elements.end()) {
@@ -54,11 +286,263 @@ namespace Scene {
         return -1;
     }
 
-    SceneManager::SceneManager() {
+    // Indexes
+
+    // Lists of the indexes are unordered: removing moves the last element into the hole
+    static void RemoveFromList(ElementList& list, Objects::Object* element) {
+        auto it = std::find(list.begin(), list.end(), element);
+        if (it == list.end()) return;
+        *it = list.back();
+        list.pop_back();
+    }
+
+    static void RemoveSorted(ElementList& list, const std::vector<Objects::Object*>& sorted) {
+        list.erase(std::remove_if(list.begin(), list.end(), [&](Objects::Object* element) {
+            return std::binary_search(sorted.begin(), sorted.end(), element);
+        }), list.end());
+    }
+
+    void Scene::IndexElement(Objects::Object* element) {
+        kindElements[(u32)element->GetKind()].push_back(element);
+        for (Objects::TagMask tags = element->GetTags(); tags != 0; tags &= tags - 1) {
+            taggedElements[__builtin_ctz(tags)].push_back(element);
+        }
+        if (element->GetNameId() != 0) namedElements[element->GetNameId()].push_back(element);
+        spatialDirty = true;
+    }
+
+    void Scene::UnindexElement(Objects::Object* element) {
+        RemoveFromList(kindElements[(u32)element->GetKind()], element);
+        for (Objects::TagMask tags = element->GetTags(); tags != 0; tags &= tags - 1) {
+            RemoveFromList(taggedElements[__builtin_ctz(tags)], element);
+        }
+        if (element->GetNameId() != 0) {
+            auto it = namedElements.find(element->GetNameId());
+            if (it != namedElements.end()) {
+                RemoveFromList(it->second, element);
+                if (it->second.empty()) namedElements.erase(it);
+            }
+        }
+        spatialDirty = true;
+    }
+
+    void Scene::UnindexElements(const std::vector<Objects::Object*>& sorted) {
+        // Only the lists of the removed elements' kinds, tags and names are filtered
+        u32 kinds = 0;
+        Objects::TagMask tags = 0;
+        std::vector<Objects::NameId> names;
+        for (Objects::Object* element : sorted) {
+            if (element->GetScene() != this) continue;
+            kinds |= 1u << (u32)element->GetKind();
+            tags |= element->GetTags();
+            if (element->GetNameId() != 0) names.push_back(element->GetNameId());
+        }
+        for (u32 kind = 0; kind < Objects::OBJECT_KIND_COUNT; kind++) {
+            if (kinds & (1u << kind)) RemoveSorted(kindElements[kind], sorted);
+        }
+        for (; tags != 0; tags &= tags - 1) {
+            RemoveSorted(taggedElements[__builtin_ctz(tags)], sorted);
+        }
+        for (Objects::NameId name : names) {
+            auto it = namedElements.find(name);
+            if (it == namedElements.end()) continue;
+            RemoveSorted(it->second, sorted);
+            if (it->second.empty()) namedElements.erase(it);
+        }
+        spatialDirty = true;
+    }
+
+    void Scene::OnNameChanged(Objects::Object* element, Objects::NameId old) {
+        if (old != 0) {
+            auto it = namedElements.find(old);
+            if (it != namedElements.end()) {
+                RemoveFromList(it->second, element);
+                if (it->second.empty()) namedElements.erase(it);
+            }
+        }
+        if (element->GetNameId() != 0) namedElements[element->GetNameId()].push_back(element);
+    }
+
+    void Scene::OnTagsChanged(Objects::Object* element, Objects::TagMask old) {
+        Objects::TagMask current = element->GetTags();
+        for (Objects::TagMask removed = old & ~current; removed != 0; removed &= removed - 1) {
+            RemoveFromList(taggedElements[__builtin_ctz(removed)], element);
+        }
+        for (Objects::TagMask added = current & ~old; added != 0; added &= added - 1) {
+            taggedElements[__builtin_ctz(added)].push_back(element);
+        }
+        spatialDirty = true;
+    }
+
+    Objects::Object* Scene::FindByName(const char* name) const {
+        auto it = namedElements.find(Objects::FindName(name));
+        return it != namedElements.end() ? it->second.front() : nullptr;
+    }
+
+    ElementRange Scene::FindAllByName(const char* name) const {
+        auto it = namedElements.find(Objects::FindName(name));
+        if (it == namedElements.end()) return ElementRange(nullptr, nullptr);
+        return ElementRange(it->second.data(), it->second.data() + it->second.size());
+    }
+
+    ElementRange Scene::GetTagged(Objects::TagMask tag) const {
+        if (tag == 0) return ElementRange(nullptr, nullptr);
+        const ElementList& list = taggedElements[__builtin_ctz(tag)];
+        return ElementRange(list.data(), list.data() + list.size());
+    }
+
+    const ElementList& Scene::ShortestTagList(Objects::TagMask tags) const {
+        const ElementList* shortest = &taggedElements[__builtin_ctz(tags)];
+        for (tags &= tags - 1; tags != 0; tags &= tags - 1) {
+            const ElementList& list = taggedElements[__builtin_ctz(tags)];
+            if (list.size() < shortest->size()) shortest = &list;
+        }
+        return *shortest;
+    }
+
+    // Grids with more cells are built with larger cells
+    static const u32 MAX_GRID_CELLS = 4096;
+
+    // Cell of a coordinate, clamped to the grid
+    static u32 CellOf(float value, float origin, float inverse, u32 count) {
+        float cell = (value - origin) * inverse;
+        if (!(cell > 0.0f)) return 0;
+        return cell < count - 1 ? (u32)cell : count - 1;
+    }
+
+    void Scene::BuildSpatialGrid() {
+        spatialDirty = false;
+        queryStats.rebuilds++;
+        size_t count = elements.size();
+        spatialBuffer.resize(count);
+        spatialEntries.resize(count);
+        gridColumns = 0;
+        gridRows = 0;
+        if (count == 0) return;
+
+        gridLeft = FLT_MAX;
+        gridTop = FLT_MAX;
+        gridRight = -FLT_MAX;
+        gridBottom = -FLT_MAX;
+        for (size_t i = 0; i < count; i++) {
+            Math::Vec2d position = elements[i]->GetPosition();
+            SpatialEntry& entry = spatialBuffer[i];
+            entry.element = elements[i];
+            entry.x = position.x;
+            entry.y = position.y;
+            entry.tags = elements[i]->GetTags();
+            gridLeft = std::min(gridLeft, entry.x);
+            gridTop = std::min(gridTop, entry.y);
+            gridRight = std::max(gridRight, entry.x);
+            gridBottom = std::max(gridBottom, entry.y);
+        }
+
+        gridCellSize = spatialCellSize;
+        for (;;) {
+            float columns = floorf((gridRight - gridLeft) / gridCellSize) + 1.0f;
+            float rows = floorf((gridBottom - gridTop) / gridCellSize) + 1.0f;
+            if (columns * rows <= MAX_GRID_CELLS) {
+                gridColumns = columns;
+                gridRows = rows;
+                break;
+            }
+            if (gridCellSize >= FLT_MAX) {
+                // Positions too far apart for any grid: a single cell
+                gridColumns = 1;
+                gridRows = 1;
+                break;
+            }
+            gridCellSize *= 2.0f;
+        }
+
+        // Counting sort: count per cell, prefix sums, then place each entry at its cell's cursor
+        float inverse = 1.0f / gridCellSize;
+        u32 cells = gridColumns * gridRows;
+        spatialCells.assign(cells + 1, 0);
+        for (const SpatialEntry& entry : spatialBuffer) {
+            u32 cell = CellOf(entry.y, gridTop, inverse, gridRows) * gridColumns + CellOf(entry.x, gridLeft, inverse, gridColumns);
+            spatialCells[cell + 1]++;
+        }
+        for (u32 cell = 0; cell < cells; cell++) {
+            spatialCells[cell + 1] += spatialCells[cell];
+        }
+        for (const SpatialEntry& entry : spatialBuffer) {
+            u32 cell = CellOf(entry.y, gridTop, inverse, gridRows) * gridColumns + CellOf(entry.x, gridLeft, inverse, gridColumns);
+            spatialEntries[spatialCells[cell]++] = entry;
+        }
+        // Each cursor now points at the next cell's first entry
+        for (u32 cell = cells; cell > 0; cell--) {
+            spatialCells[cell] = spatialCells[cell - 1];
+        }
+        spatialCells[0] = 0;
+    }
+
+    size_t Scene::Query(float left, float top, float right, float bottom, float radius, Objects::TagMask tags,
+                        Objects::Object** results, size_t capacity) {
+        queryStats.queries++;
+        float centerX = (left + right) * 0.5f;
+        float centerY = (top + bottom) * 0.5f;
+        float radiusSquared = radius * radius;
+        auto inside = [&](float x, float y) {
+            if (x < left || x > right || y < top || y > bottom) return false;
+            if (radius < 0.0f) return true;
+            float dx = x - centerX;
+            float dy = y - centerY;
+            return dx * dx + dy * dy <= radiusSquared;
+        };
+
+        if (spatialDirty) BuildSpatialGrid();
+        if (gridColumns == 0 || right < gridLeft || left > gridRight || bottom < gridTop || top > gridBottom) return 0;
+
+        float inverse = 1.0f / gridCellSize;
+        u32 firstColumn = CellOf(left, gridLeft, inverse, gridColumns);
+        u32 lastColumn = CellOf(right, gridLeft, inverse, gridColumns);
+        u32 firstRow = CellOf(top, gridTop, inverse, gridRows);
+        u32 lastRow = CellOf(bottom, gridTop, inverse, gridRows);
+
+        // Cells of a row are contiguous, so the candidates are counted without visiting them
+        size_t candidates = 0;
+        for (u32 row = firstRow; row <= lastRow; row++) {
+            candidates += spatialCells[row * gridColumns + lastColumn + 1] - spatialCells[row * gridColumns + firstColumn];
+        }
+
+        size_t found = 0;
+        if (tags != 0 && ShortestTagList(tags).size() < candidates) {
+            // Fewer elements have the rarest tag than the region holds
+            const ElementList& list = ShortestTagList(tags);
+            queryStats.tested += list.size();
+            for (Objects::Object* element : list) {
+                if (found == capacity) break;
+                Math::Vec2d position = element->GetPosition();
+                if (element->HasTags(tags) && inside(position.x, position.y)) results[found++] = element;
+            }
+        } else {
+            queryStats.tested += candidates;
+            for (u32 row = firstRow; row <= lastRow && found < capacity; row++) {
+                u32 end = spatialCells[row * gridColumns + lastColumn + 1];
+                for (u32 i = spatialCells[row * gridColumns + firstColumn]; i < end; i++) {
+                    const SpatialEntry& entry = spatialEntries[i];
+                    if ((entry.tags & tags) != tags || !inside(entry.x, entry.y)) continue;
+                    results[found++] = entry.element;
+                    if (found == capacity) break;
+                }
+            }
+        }
+        queryStats.found += found;
+        return found;
+    }
+
+    // Frames allowed to allocate after a scene change before the steady state check starts
+    static const u32 STEADY_STATE_FRAMES = 60;
+
+    SceneManager::SceneManager(bool initGraphics) : graphics(initGraphics), frameArena(64 * 1024, Memory::Tag::FRAME) {
+        if (!graphics) return;
+
         gfxInitDefault();
         C3D_Init(C3D_DEFAULT_CMDBUF_SIZE);
         C2D_Init(C2D_DEFAULT_MAX_OBJECTS);
         C2D_Prepare();
+        Primitives::Init();
         consoleInit(GFX_BOTTOM, NULL);
 
         topScreen = C2D_CreateScreenTarget(GFX_TOP, GFX_LEFT);
@@ -66,76 +550,485 @@ namespace Scene {
     }
 
     SceneManager::~SceneManager() {
+        jobSystem.Stop();
+        audio.Stop();
+        if (!graphics) return;
+
+        for (ScreenState& screen : screens) {
+            if (screen.cacheTarget) {
+                C3D_RenderTargetDelete(screen.cacheTarget);
+                C3D_TexDelete(&screen.cacheTexture);
+            }
+        }
+        Render::ReleaseRetired();
+        Primitives::Fini();
         C2D_Fini();
         C3D_Fini();
         gfxExit();
     }
 
+    void SceneManager::SetStereo(bool enable) {
+        if (enable && !topScreenRight) {
+            topScreenRight = C2D_CreateScreenTarget(GFX_TOP, GFX_RIGHT);
+        }
+        gfxSet3D(enable);
+        stereo = enable;
+    }
+
+    int SceneManager::EnableJobs(int workerCount) {
+        if (workerCount <= 0) {
+            workerCount = Jobs::JobSystem::GetRecommendedWorkerCount();
+        }
+        return jobSystem.Start(workerCount);
+    }
+
     int SceneManager::AddScene(Scene* scene) {
         scene->SetSceneManager(this);
         scene->SetInputManager(&inputManager);
         scenes.push_back(scene);
+        // The first scene added with a name keeps it
+        sceneIndices.emplace(scene->GetName(), scenes.size() - 1);
         return scenes.size() - 1;
     }
 
-    void SceneManager::LoadScene(const std::string& sceneName, Screen targetScreen) {
-        for (size_t i = 0; i < scenes.size(); i++) {
-            if (scenes[i]->GetName() == sceneName) {
-                LoadScene(i, targetScreen);
-                return;
+    int SceneManager::GetSceneIndex(const std::string& sceneName) const {
+        auto it = sceneIndices.find(sceneName);
+        return it != sceneIndices.end() ? it->second : -1;
+    }
+
+    void SceneManager::LoadScene(const std::string& sceneName, Screen targetScreen, Transition transition, float duration) {
+        LoadScene(GetSceneIndex(sceneName), targetScreen, transition, duration);
+    }
+
+    void SceneManager::LoadScene(int index, Screen targetScreen, Transition transition, float duration) {
+        if (index < 0 || index >= (int)scenes.size()) return;
+
+        ScreenState& screen = screens[static_cast<int>(targetScreen)];
+
+        // Loading a displayed scene again reloads it from scratch; the stack is unloaded by UpdateLoading
+        // once the outgoing transition is over (it keeps drawing until then, and OnUpdate may be the caller)
+        bool displayed = false;
+        for (int i = 0; i < screen.layerCount; i++) {
+            if (screen.layers[i] == index) displayed = true;
+        }
+
+        screen.pending = index;
+        screen.pendingPush = false;
+        screen.pendingReload = displayed;
+        screen.transition = duration > 0.0f ? transition : Transition::NONE;
+        screen.duration = duration / 2;
+        screen.elapsed = 0;
+        screen.fadingIn = false;
+
+        if (!displayed && scenes[index]->state == SceneState::UNLOADED) {
+            BeginLoading(index);
+        }
+    }
+
+    void SceneManager::PushScene(const std::string& sceneName, Screen targetScreen) {
+        PushScene(GetSceneIndex(sceneName), targetScreen);
+    }
+
+    void SceneManager::PushScene(int index, Screen targetScreen) {
+        if (index < 0 || index >= (int)scenes.size()) return;
+
+        ScreenState& screen = screens[static_cast<int>(targetScreen)];
+        if (screen.layerCount >= MAX_LAYERS) return;
+        for (int i = 0; i < screen.layerCount; i++) {
+            if (screen.layers[i] == index) return;
+        }
+
+        screen.pending = index;
+        screen.pendingPush = true;
+        screen.pendingReload = false;
+        screen.transition = Transition::NONE;
+        screen.elapsed = 0;
+        screen.fadingIn = false;
+
+        if (scenes[index]->state == SceneState::UNLOADED) {
+            BeginLoading(index);
+        }
+    }
+
+    bool SceneManager::PopScene(Screen targetScreen) {
+        ScreenState& screen = screens[static_cast<int>(targetScreen)];
+        if (screen.layerCount == 0) return false;
+
+        Deactivate(screen.layers[--screen.layerCount]);
+        if (screen.cachedLayers > screen.layerCount) screen.cachedLayers = 0;
+        framesSinceLoad = 0;
+        return true;
+    }
+
+    Scene* SceneManager::GetTopScene(Screen targetScreen) const {
+        int top = screens[static_cast<int>(targetScreen)].Top();
+        return top >= 0 ? scenes[top] : nullptr;
+    }
+
+    void SceneManager::PreloadScene(const std::string& sceneName) {
+        PreloadScene(GetSceneIndex(sceneName));
+    }
+
+    void SceneManager::PreloadScene(int index) {
+        if (index < 0 || index >= (int)scenes.size()) return;
+        if (scenes[index]->IsLoaded()) return;
+        if (std::find(preloadQueue.begin(), preloadQueue.end(), index) != preloadQueue.end()) return;
+        preloadQueue.push_back(index);
+    }
+
+    void SceneManager::UnloadScene(int index) {
+        if (index < 0 || index >= (int)scenes.size()) return;
+        for (const ScreenState& screen : screens) {
+            if (screen.pending == index) return;
+            for (int i = 0; i < screen.layerCount; i++) {
+                if (screen.layers[i] == index) return;
             }
         }
+        Unload(index);
+    }
+
+    bool SceneManager::IsTransitioning(Screen screen) const {
+        const ScreenState& state = screens[static_cast<int>(screen)];
+        return state.pending >= 0 || state.fadingIn;
+    }
+
+    void SceneManager::BeginLoading(int index) {
+        Scene* scene = scenes[index];
+        int scope = GetMemoryScope(index);
+        int previousScope = Memory::SetScope(scope);
+
+        scene->loadStart.heap = Memory::GetScopeCounters(scope, Memory::Region::HEAP).live;
+        scene->loadStart.linear = Memory::GetScopeCounters(scope, Memory::Region::LINEAR).live;
+        scene->state = SceneState::LOADING;
+        scene->OnPreload();
+
+        Memory::SetScope(previousScope);
+    }
+
+    bool SceneManager::StepLoading(int index, u64 deadline) {
+        Scene* scene = scenes[index];
+        if (scene->IsLoaded()) return true;
+        if (scene->state == SceneState::UNLOADED) BeginLoading(index);
+
+        int scope = GetMemoryScope(index);
+        int previousScope = Memory::SetScope(scope);
+
+        // Always make one step so a slow scene still progresses when the budget is used up
+        bool done;
+        do {
+            done = scene->OnLoadStep();
+        } while (!done && svcGetSystemTick() < deadline);
+
+        if (done) {
+            scene->state = SceneState::LOADED;
+            scene->loadDelta.heap = (ptrdiff_t)Memory::GetScopeCounters(scope, Memory::Region::HEAP).live - scene->loadStart.heap;
+            scene->loadDelta.linear = (ptrdiff_t)Memory::GetScopeCounters(scope, Memory::Region::LINEAR).live - scene->loadStart.linear;
+
+            if (reportMemory) {
+                printf("%s load: heap %+d, linear %+d\n", scene->GetName().c_str(),
+                       (int)scene->loadDelta.heap, (int)scene->loadDelta.linear);
+            }
+        }
+
+        Memory::SetScope(previousScope);
+        return done;
+    }
+
+    void SceneManager::SwitchScene(ScreenState& screen) {
+        if (!screen.pendingPush) {
+            while (screen.layerCount > 0) {
+                Deactivate(screen.layers[--screen.layerCount]);
+            }
+            screen.cachedLayers = 0;
+        }
+
+        int index = screen.pending;
+        screen.layers[screen.layerCount++] = index;
+        screen.pending = -1;
+        screen.pendingPush = false;
+
+        Scene* scene = scenes[index];
+        int previousScope = Memory::SetScope(GetMemoryScope(index));
+        scene->state = SceneState::ACTIVE;
+        scene->OnActivate();
+        Memory::SetScope(previousScope);
+
+        framesSinceLoad = 0;
+    }
+
+    void SceneManager::Deactivate(int index) {
+        Scene* scene = scenes[index];
+        if (scene->state != SceneState::ACTIVE) return;
+
+        int previousScope = Memory::SetScope(GetMemoryScope(index));
+        scene->OnDeactivate();
+        scene->state = SceneState::LOADED;
+        Memory::SetScope(previousScope);
+
+        if (!scene->keepLoaded) {
+            Unload(index);
+        }
+    }
+
+    void SceneManager::Unload(int index) {
+        Scene* scene = scenes[index];
+        if (scene->state == SceneState::UNLOADED) return;
+
+        auto queued = std::find(preloadQueue.begin(), preloadQueue.end(), index);
+        if (queued != preloadQueue.end()) preloadQueue.erase(queued);
+
+        int scope = GetMemoryScope(index);
+        int previousScope = Memory::SetScope(scope);
+
+        size_t heapBefore = Memory::GetScopeCounters(scope, Memory::Region::HEAP).live;
+        size_t linearBefore = Memory::GetScopeCounters(scope, Memory::Region::LINEAR).live;
+
+        // Also called on a partially loaded scene so it can release what OnLoadStep created
+        scene->OnUnload();
+        scene->state = SceneState::UNLOADED;
+        // Timers, coroutines and bodies created by OnLoad are not carried over to the next load
+        scene->coroutines.Clear();
+        scene->timers.Clear();
+        scene->physics.Clear();
+
+        scene->unloadDelta.heap = (ptrdiff_t)Memory::GetScopeCounters(scope, Memory::Region::HEAP).live - (ptrdiff_t)heapBefore;
+        scene->unloadDelta.linear = (ptrdiff_t)Memory::GetScopeCounters(scope, Memory::Region::LINEAR).live - (ptrdiff_t)linearBefore;
+        Memory::SetScope(previousScope);
+
+        if (reportMemory) {
+            printf("%s unload: heap %+d, linear %+d\n", scene->GetName().c_str(),
+                   (int)scene->unloadDelta.heap, (int)scene->unloadDelta.linear);
+        }
     }
 
-    void SceneManager::LoadScene(int index, Screen targetScreen) {
-        if (index >= 0 && index < scenes.size()) {
-            // Unload current scene
-            if (targetScreen == Screen::TOP && currentTopSceneIndex >= 0) {
-                scenes[currentTopSceneIndex]->OnUnload();
+    void SceneManager::UpdateLoading() {
+        u64 deadline = svcGetSystemTick() + (u64)(loadBudget * CPU_TICKS_PER_MSEC);
+
+        for (ScreenState& screen : screens) {
+            if (screen.pending >= 0) {
+                bool leaving = screen.transition != Transition::NONE && screen.elapsed < screen.duration;
+                if (screen.pendingReload && !leaving) {
+                    while (screen.layerCount > 0) {
+                        int top = screen.layers[--screen.layerCount];
+                        Deactivate(top);
+                        Unload(top);
+                    }
+                    screen.cachedLayers = 0;
+                    screen.pendingReload = false;
+                }
+                bool loaded = !screen.pendingReload && StepLoading(screen.pending, deadline);
+
+                // The old scene finishes leaving before the new one appears, even if it loaded faster
+                if (leaving) {
+                    screen.elapsed += deltaTime;
+                } else if (loaded) {
+                    SwitchScene(screen);
+                    screen.elapsed = 0;
+                    screen.fadingIn = screen.transition != Transition::NONE;
+                }
+            } else if (screen.fadingIn) {
+                screen.elapsed += deltaTime;
+                if (screen.elapsed >= screen.duration) {
+                    screen.fadingIn = false;
+                    screen.transition = Transition::NONE;
+                }
             }
-            else if (targetScreen == Screen::BOTTOM && currentBottomSceneIndex >= 0) {
-                scenes[currentBottomSceneIndex]->OnUnload();
+        }
+
+        // Preload with whatever time is left
+        while (!preloadQueue.empty() && svcGetSystemTick() < deadline) {
+            if (!StepLoading(preloadQueue.front(), deadline)) break;
+            preloadQueue.erase(preloadQueue.begin());
+        }
+    }
+
+    void SceneManager::RenderLayerCache(ScreenState& screen, int first, int count) {
+        if (!screen.cacheTarget) {
+            // 512x256 is the smallest texture holding a 400x240 screen
+            if (!C3D_TexInitVRAM(&screen.cacheTexture, 512, 256, GPU_RGBA8)) return;
+            screen.cacheTarget = C3D_RenderTargetCreateFromTex(&screen.cacheTexture, GPU_TEXFACE_2D, 0, GPU_RB_DEPTH24_STENCIL8);
+            if (!screen.cacheTarget) {
+                C3D_TexDelete(&screen.cacheTexture);
+                return;
             }
+        }
+
+        Render::SceneBegin(screen.cacheTarget);
+        C2D_TargetClear(screen.cacheTarget, scenes[screen.layers[first]]->GetBackgroundColor());
+        for (int i = first; i < count; i++) {
+            Memory::SetScope(GetMemoryScope(screen.layers[i]));
+            scenes[screen.layers[i]]->Draw();
+        }
+        screen.cachedLayers = count;
+    }
 
-            // Load new scene
-            if (targetScreen == Screen::TOP) {
-                currentTopSceneIndex = index;
+    void SceneManager::UpdateLayers(const ScreenState& screen, int frozen, float width) {
+        if (frozen > 0 && screen.cachedLayers == frozen) {
+            static const Tex3DS_SubTexture topSubTexture = { 400, 240, 0.0f, 1.0f, 400 / 512.0f, 1.0f - 240 / 256.0f };
+            static const Tex3DS_SubTexture bottomSubTexture = { 320, 240, 0.0f, 1.0f, 320 / 512.0f, 1.0f - 240 / 256.0f };
+            C2D_Image image = { const_cast<C3D_Tex*>(&screen.cacheTexture), width > 320.0f ? &topSubTexture : &bottomSubTexture };
+            C2D_DrawParams params = {};
+            params.pos.w = width;
+            params.pos.h = 240;
+            Render::SetLayerDepth(0);
+            Render::Image(image, params);
+        }
+
+        // Policies only get stronger going down, so walk down from the top
+        LayerPolicy below = LayerPolicy::UPDATE_BELOW;
+        LayerPolicy modes[MAX_LAYERS];
+        int first = screen.layerCount;
+        while (first > frozen && below != LayerPolicy::HIDE_BELOW && below != LayerPolicy::FREEZE_BELOW) {
+            first--;
+            modes[first] = below;
+            below = std::max(below, scenes[screen.layers[first]]->GetLayerPolicy());
+        }
+
+        for (int i = first; i < screen.layerCount; i++) {
+            Memory::SetScope(GetMemoryScope(screen.layers[i]));
+            if (modes[i] == LayerPolicy::UPDATE_BELOW) {
+                scenes[screen.layers[i]]->Update();
             } else {
-                currentBottomSceneIndex = index;
+                scenes[screen.layers[i]]->Draw();
             }
-            scenes[index]->OnLoad();
         }
     }
 
-    void SceneManager::Update() {
-        // Updates top screen
-        if (currentTopSceneIndex >= 0) {
-            C2D_SceneBegin(topScreen);
-            C2D_TargetClear(topScreen, scenes[currentTopSceneIndex]->GetBackgroundColor());
-            scenes[currentTopSceneIndex]->Update();
+    void SceneManager::UpdateScreen(Screen target) {
+        ScreenState& screen = screens[static_cast<int>(target)];
+        C3D_RenderTarget* renderTarget = target == Screen::TOP ? topScreen : bottomScreen;
+        float width = target == Screen::TOP ? 400.0f : 320.0f;
+
+        // Progress of the current half: 0 shows the scene, 1 hides it
+        float progress = screen.duration > 0.0f ? std::min(screen.elapsed / screen.duration, 1.0f) : 1.0f;
+        if (screen.fadingIn) progress = 1.0f - progress;
+
+        float offset = 0;
+        u8 fade = 0;
+        if (screen.transition == Transition::FADE) {
+            fade = (u8)(progress * 255);
+        } else if (screen.transition != Transition::NONE) {
+            // Leaves on one side, comes back from the other
+            bool left = (screen.transition == Transition::SLIDE_LEFT) != screen.fadingIn;
+            offset = left ? -progress * width : progress * width;
         }
 
-        // Updates bottom screen
-        if (currentBottomSceneIndex >= 0) {
-            C2D_SceneBegin(bottomScreen);
-            C2D_TargetClear(bottomScreen, scenes[currentBottomSceneIndex]->GetBackgroundColor());
-            scenes[currentBottomSceneIndex]->Update();
+        // Bottom layers hidden or frozen by the layers above them
+        int visible = 0;
+        int frozen = 0;
+        for (int i = screen.layerCount - 1; i > 0; i--) {
+            LayerPolicy policy = scenes[screen.layers[i]]->GetLayerPolicy();
+            if (policy == LayerPolicy::HIDE_BELOW) {
+                visible = i;
+                break;
+            }
+            if (policy == LayerPolicy::FREEZE_BELOW && frozen == 0) {
+                // Keep looking below: a HIDE_BELOW under the freeze still hides what is beneath it
+                frozen = i;
+            }
+        }
+        // Object texture caches render into their own targets, before any scene of the screen begins
+        int firstCached = frozen > 0 && screen.cachedLayers == frozen ? frozen : visible;
+        for (int i = firstCached; i < screen.layerCount; i++) {
+            Memory::SetScope(GetMemoryScope(screen.layers[i]));
+            scenes[screen.layers[i]]->UpdateCaches();
         }
 
-        C2D_Flush();
+        if (frozen > 0 && screen.cachedLayers != frozen) {
+            RenderLayerCache(screen, visible, frozen);
+        }
+
+        u32 background = screen.layerCount > 0 ? scenes[screen.layers[visible]]->GetBackgroundColor() : Colors::clrBlack;
+
+        if (target == Screen::TOP && stereo) {
+            // The left eye begins before recording, so direct C2D_Draw* calls that Render cannot
+            // record still reach it (under the recorded draws) instead of the last bound target
+            Render::SceneBegin(topScreen);
+            C2D_TargetClear(topScreen, background);
+            Render::ViewTranslate(offset, 0);
+
+            // Run the logic once and record the draws, then replay them for each eye
+            topDrawList.Clear();
+            Render::BeginRecording(&topDrawList);
+            UpdateLayers(screen, frozen, width);
+            Render::EndRecording();
+
+            float slider = osGet3DSliderState();
+
+            // At 0 the right eye is not displayed, skip the second pass
+            for (int eye = 0; eye < (slider > 0.0f ? 2 : 1); eye++) {
+                if (eye == 1) {
+                    Render::SceneBegin(topScreenRight);
+                    C2D_TargetClear(topScreenRight, background);
+                    Render::ViewTranslate(offset, 0);
+                }
+                topDrawList.Replay(eye == 0 ? slider : -slider);
+                Render::ViewReset();
+                if (fade) Render::Rect(0, 0, width, 240, C2D_Color32(0, 0, 0, fade));
+            }
+        } else {
+            Render::SceneBegin(renderTarget);
+            C2D_TargetClear(renderTarget, background);
+            Render::ViewTranslate(offset, 0);
+            UpdateLayers(screen, frozen, width);
+            Render::ViewReset();
+            if (fade) Render::Rect(0, 0, width, 240, C2D_Color32(0, 0, 0, fade));
+        }
+    }
+
+    void SceneManager::MarkUpdatingScenes() {
+        for (Scene* scene : scenes) {
+            scene->updating = false;
+        }
+        // Same walk as UpdateLayers: from the top down while the layers above let the lower ones update
+        for (const ScreenState& screen : screens) {
+            for (int i = screen.layerCount - 1; i >= 0; i--) {
+                Scene* scene = scenes[screen.layers[i]];
+                scene->updating = true;
+                if (scene->GetLayerPolicy() != LayerPolicy::UPDATE_BELOW) break;
+            }
+        }
+    }
+
+    bool SceneManager::IsTweenPaused(const Objects::Object* owner) {
+        const Scene* scene = owner->GetScene();
+        return scene && !scene->IsUpdating();
+    }
+
+    void SceneManager::Update() {
+        UpdateLoading();
+        UpdateScreen(Screen::TOP);
+        UpdateScreen(Screen::BOTTOM);
+
+        Memory::SetScope(0);
+        Render::Flush();
     }
 
     void SceneManager::Run() {
+        lastFrameTime = osGetTime();
         while (aptMainLoop()) {
+#ifdef CITROFLEX_DEBUG
+            // Counted over the whole frame: input, tweens, audio and events may not allocate either
+            u32 allocationsBefore = Memory::GetHeapAllocationCount();
+#endif
             inputManager.Update();
 
+            u64 now = osGetTime();
+            deltaTime = (now - lastFrameTime) / 1000.0f;
+            MarkUpdatingScenes();
+            tweenManager.Update(deltaTime, IsTweenPaused);
+            audio.Update(deltaTime);
+            lastFrameTime = now;
+
+            // Events posted during the previous frame (or by other threads) are delivered here
+            eventBus.Dispatch();
+
             // Checks if we can exit
             bool canExitGame = false;
-            if (currentTopSceneIndex >= 0) {
-                canExitGame |= scenes[currentTopSceneIndex]->CanExitWithKey();
-            }
-            if (currentBottomSceneIndex >= 0) {
-                canExitGame |= scenes[currentBottomSceneIndex]->CanExitWithKey();
+            for (const ScreenState& screen : screens) {
+                if (screen.layerCount > 0) {
+                    canExitGame |= scenes[screen.Top()]->CanExitWithKey();
+                }
             }
 
             if (canExitGame && (inputManager.GetButtonState(exitKey) == Input::ButtonState::PRESSED)) {
@@ -145,6 +1038,22 @@ namespace Scene {
             C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
             Update();
             C3D_FrameEnd(0);
+
+            frameArena.Reset();
+            Render::ReleaseRetired();
+
+            // Hot-reload between frames, reloads may allocate
+            if (fileWatcher.Poll() > 0) {
+                framesSinceLoad = 0;
+            }
+
+#ifdef CITROFLEX_DEBUG
+            // Once a scene has settled, frames must not touch the heap
+            if (framesSinceLoad >= STEADY_STATE_FRAMES) {
+                assert(Memory::GetHeapAllocationCount() == allocationsBefore && "Heap allocation in a steady state frame");
+            }
+#endif
+            framesSinceLoad++;
         }
     }
 }
\ No newline at end of file
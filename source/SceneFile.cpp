@@ -0,0 +1,494 @@
+/**
+ * @file SceneFile.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex binary scene loader implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "SceneFile.hpp"
+#include "Scene.hpp"
+#include "Pack.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+namespace SceneFormat {
+    namespace {
+        struct FactoryEntry {
+            std::string typeName;
+            Factory factory;
+            void* userData;
+        };
+
+        std::vector<FactoryEntry>& GetFactories() {
+            static std::vector<FactoryEntry> factories;
+            return factories;
+        }
+
+        // Section of count items of itemSize bytes fits in the file
+        bool SectionFits(uint32_t offset, uint32_t count, size_t itemSize, size_t fileSize) {
+            return offset % 4 == 0 && (uint64_t)offset + (uint64_t)count * itemSize <= fileSize;
+        }
+    }
+
+    void RegisterFactory(const char* typeName, Factory factory, void* userData) {
+        for (FactoryEntry& entry : GetFactories()) {
+            if (entry.typeName == typeName) {
+                entry.factory = factory;
+                entry.userData = userData;
+                return;
+            }
+        }
+        GetFactories().push_back({ typeName, factory, userData });
+    }
+
+    SceneFile::~SceneFile() {
+        Unload(nullptr);
+    }
+
+    uint8_t* SceneFile::ReadFile(const char* filePath, size_t& size) {
+        // The whole file in one block (from a mounted pack if one has it), records are used in place
+        size_t length = 0;
+        uint8_t* block = static_cast<uint8_t*>(Pack::ReadFile(filePath, length, Memory::Tag::SCENE));
+        if (!block) return nullptr;
+
+        if (length < sizeof(FileHeader)) {
+            Memory::Free(block);
+            return nullptr;
+        }
+        size = length;
+        return block;
+    }
+
+    bool SceneFile::Load(const char* filePath) {
+        if (!instances.empty()) return false;
+        Unload(nullptr);
+
+        size_t size = 0;
+        ownedData = ReadFile(filePath, size);
+        if (!ownedData) return false;
+
+        data = ownedData;
+        if (!Validate(size)) {
+            Unload(nullptr);
+            return false;
+        }
+        path = filePath;
+        return true;
+    }
+
+    bool SceneFile::LoadFromMemory(const void* memory, size_t size) {
+        if (!instances.empty()) return false;
+        Unload(nullptr);
+
+        if (!memory || ((uintptr_t)memory & 3) != 0) return false;
+
+        data = static_cast<const uint8_t*>(memory);
+        if (!Validate(size)) {
+            Unload(nullptr);
+            return false;
+        }
+        return true;
+    }
+
+    bool SceneFile::Validate(size_t size) {
+        if (size < sizeof(FileHeader)) return false;
+
+        const FileHeader* fileHeader = reinterpret_cast<const FileHeader*>(data);
+        if (fileHeader->magic != MAGIC || fileHeader->version != VERSION) return false;
+        if (fileHeader->headerSize != sizeof(FileHeader) || fileHeader->fileSize != size) return false;
+        if (fileHeader->sceneObjectCount > fileHeader->objectCount) return false;
+
+        if (!SectionFits(fileHeader->objectsOffset, fileHeader->objectCount, sizeof(ObjectRecord), size) ||
+            !SectionFits(fileHeader->propertiesOffset, fileHeader->propertyCount, sizeof(PropertyRecord), size) ||
+            !SectionFits(fileHeader->prefabsOffset, fileHeader->prefabCount, sizeof(PrefabRecord), size) ||
+            !SectionFits(fileHeader->stringsOffset, fileHeader->stringsSize, 1, size)) {
+            return false;
+        }
+
+        // Every string offset below stringsSize is then null-terminated
+        const char* table = reinterpret_cast<const char*>(data + fileHeader->stringsOffset);
+        if (fileHeader->stringsSize == 0 || table[fileHeader->stringsSize - 1] != '\0') return false;
+
+        auto validString = [&](uint32_t offset) {
+            return offset == NO_STRING || offset < fileHeader->stringsSize;
+        };
+
+        const ObjectRecord* objectRecords = reinterpret_cast<const ObjectRecord*>(data + fileHeader->objectsOffset);
+        const PropertyRecord* propertyRecords = reinterpret_cast<const PropertyRecord*>(data + fileHeader->propertiesOffset);
+        const PrefabRecord* prefabRecords = reinterpret_cast<const PrefabRecord*>(data + fileHeader->prefabsOffset);
+
+        for (uint32_t i = 0; i < fileHeader->propertyCount; i++) {
+            const PropertyRecord& property = propertyRecords[i];
+            if (property.type > PROPERTY_STRING || !validString(property.key)) return false;
+            if (property.type == PROPERTY_STRING && !validString(property.value.s)) return false;
+        }
+
+        // Records of a block only reference earlier records of the same block, and match its type counts
+        auto validBlock = [&](uint32_t first, uint32_t count, const TypeCounts& types) {
+            if ((uint64_t)first + count > fileHeader->objectCount) return false;
+            uint32_t counts[TYPE_COUNT] = {};
+            for (uint32_t i = 0; i < count; i++) {
+                const ObjectRecord& record = objectRecords[first + i];
+                if (record.type >= TYPE_COUNT) return false;
+                if (record.parent < -1 || record.parent >= (int32_t)i) return false;
+                if (!validString(record.name) || !validString(record.typeName) || !validString(record.resource)) return false;
+                if ((uint64_t)record.firstProperty + record.propertyCount > fileHeader->propertyCount) return false;
+                counts[record.type]++;
+            }
+            return memcmp(counts, types.counts, sizeof(counts)) == 0;
+        };
+
+        if (!validBlock(0, fileHeader->sceneObjectCount, fileHeader->sceneTypes)) return false;
+        for (uint32_t i = 0; i < fileHeader->prefabCount; i++) {
+            const PrefabRecord& prefab = prefabRecords[i];
+            if (!validString(prefab.name) || prefab.objectCount == 0) return false;
+            if (!validBlock(prefab.firstObject, prefab.objectCount, prefab.types)) return false;
+        }
+
+        header = fileHeader;
+        records = objectRecords;
+        properties = propertyRecords;
+        prefabs = prefabRecords;
+        strings = table;
+        return true;
+    }
+
+    SceneFile::Instance* SceneFile::Create(Scene::Scene* scene, uint32_t first, uint32_t count, const TypeCounts& types,
+                                           float offsetX, float offsetY) {
+        // Exact sizes from the file: one allocation per type and the objects never move
+        Instance* instance = new Instance();
+        instance->rectangles.reserve(types.counts[RECTANGLE]);
+        instance->lines.reserve(types.counts[LINE]);
+        instance->circles.reserve(types.counts[CIRCLE]);
+        instance->ellipses.reserve(types.counts[ELLIPSE]);
+        instance->sprites.reserve(types.counts[SPRITE]);
+        instance->objects.resize(count, nullptr);
+        instance->first = first;
+        instance->offsetX = offsetX;
+        instance->offsetY = offsetY;
+
+        for (uint32_t i = 0; i < count; i++) {
+            const ObjectRecord& record = records[first + i];
+            Objects::Object* object = nullptr;
+
+            switch (record.type) {
+                case RECTANGLE: object = &instance->rectangles.emplace_back(); break;
+                case LINE: object = &instance->lines.emplace_back(); break;
+                case CIRCLE: object = &instance->circles.emplace_back(); break;
+                case ELLIPSE: object = &instance->ellipses.emplace_back(); break;
+                case SPRITE: object = &instance->sprites.emplace_back(); break;
+                case CUSTOM: {
+                    const char* typeName = GetString(record.typeName);
+                    for (const FactoryEntry& entry : GetFactories()) {
+                        if (entry.typeName == typeName) {
+                            object = entry.factory(record, entry.userData);
+                            break;
+                        }
+                    }
+                    break;
+                }
+            }
+
+            if (!object) continue;
+
+            Apply(object, record, offsetX, offsetY);
+            if (record.name != NO_STRING) object->SetName(GetString(record.name));
+
+            // The sheet is placed at the position of the sprite, load it once the position is set
+            if (record.type == SPRITE && record.resource != NO_STRING) {
+                Objects::Sprite* sprite = static_cast<Objects::Sprite*>(object);
+                if (sprite->LoadFromFile(GetString(record.resource))) {
+                    sprite->SetFrame((int)record.params[3]);
+                }
+            }
+
+            if (record.parent >= 0 && instance->objects[record.parent]) {
+                instance->objects[record.parent]->Attach(object);
+            }
+            instance->objects[i] = object;
+
+            if (scene) {
+                scene->AddElement(object);
+            }
+        }
+
+        instances.push_back(instance);
+        return instance;
+    }
+
+    void SceneFile::Apply(Objects::Object* object, const ObjectRecord& record, float offsetX, float offsetY) {
+        switch (record.type) {
+            case RECTANGLE: {
+                Objects::Rectangle* rectangle = static_cast<Objects::Rectangle*>(object);
+                rectangle->width = record.params[0];
+                rectangle->height = record.params[1];
+                rectangle->color = record.color;
+                break;
+            }
+            case LINE: {
+                Objects::Line* line = static_cast<Objects::Line*>(object);
+                line->SetEndPoint(record.params[0] + offsetX, record.params[1] + offsetY);
+                line->thickness = record.params[2];
+                line->color = record.color;
+                break;
+            }
+            case CIRCLE: {
+                Objects::Circle* circle = static_cast<Objects::Circle*>(object);
+                circle->radius = record.params[0];
+                circle->color = record.color;
+                break;
+            }
+            case ELLIPSE: {
+                Objects::Ellipse* ellipse = static_cast<Objects::Ellipse*>(object);
+                ellipse->width = record.params[0];
+                ellipse->height = record.params[1];
+                ellipse->color = record.color;
+                break;
+            }
+            case SPRITE: {
+                Objects::Sprite* sprite = static_cast<Objects::Sprite*>(object);
+                sprite->width = record.params[0];
+                sprite->height = record.params[1];
+                sprite->SetAngle(record.params[2]);
+                break;
+            }
+        }
+
+        object->SetPosition(record.x + offsetX, record.y + offsetY);
+        object->depth = record.depth;
+        object->visible = (record.flags & FLAG_VISIBLE) != 0;
+        object->threadSafe = (record.flags & FLAG_THREAD_SAFE) != 0;
+    }
+
+    int SceneFile::Instantiate(Scene::Scene* scene) {
+        if (!header || sceneInstance) return 0;
+        sceneInstance = Create(scene, 0, header->sceneObjectCount, header->sceneTypes, 0, 0);
+        return header->sceneObjectCount;
+    }
+
+    Objects::Object* SceneFile::InstantiatePrefab(Scene::Scene* scene, const char* prefabName, double x, double y) {
+        if (!header) return nullptr;
+
+        for (uint32_t i = 0; i < header->prefabCount; i++) {
+            const PrefabRecord& prefab = prefabs[i];
+            if (strcmp(GetString(prefab.name), prefabName) != 0) continue;
+
+            // Move the whole block so that its root lands on (x, y)
+            const ObjectRecord& root = records[prefab.firstObject];
+            Instance* instance = Create(scene, prefab.firstObject, prefab.objectCount, prefab.types,
+                                        x - root.x, y - root.y);
+            return instance->objects[0];
+        }
+        return nullptr;
+    }
+
+    void SceneFile::Destroy(Scene::Scene* scene, Instance* instance) {
+        if (scene) {
+            scene->RemoveElements(instance->objects.data(), instance->objects.size());
+        }
+        // Custom objects outlive the instance, don't leave them pointing at pooled objects
+        for (Objects::Object* object : instance->objects) {
+            if (!object) continue;
+            object->attachedElements.clear();
+            object->parent = nullptr;
+        }
+        delete instance;
+    }
+
+    void SceneFile::Clear(Scene::Scene* scene) {
+        for (Instance* instance : instances) {
+            Destroy(scene, instance);
+        }
+        instances.clear();
+        sceneInstance = nullptr;
+    }
+
+    void SceneFile::Unload(Scene::Scene* scene) {
+        if (watcher) {
+            watcher->UnwatchAll(this);
+            watcher = nullptr;
+            watchedScene = nullptr;
+        }
+        Clear(scene);
+        path.clear();
+        Memory::Free(ownedData);
+        ownedData = nullptr;
+        data = nullptr;
+        header = nullptr;
+        records = nullptr;
+        properties = nullptr;
+        prefabs = nullptr;
+        strings = nullptr;
+    }
+
+    bool SceneFile::Reload(Scene::Scene* scene) {
+        if (path.empty()) return false;
+
+        size_t size = 0;
+        uint8_t* block = ReadFile(path.c_str(), size);
+        if (!block) return false;
+
+        // Keep the current file until the new one is known to be valid
+        const uint8_t* oldData = data;
+        uint8_t* oldOwnedData = ownedData;
+        const ObjectRecord* oldRecords = records;
+        const char* oldStrings = strings;
+        uint32_t oldSceneCount = header->sceneObjectCount;
+        auto oldString = [oldStrings](uint32_t offset) { return offset == NO_STRING ? "" : oldStrings + offset; };
+
+        data = block;
+        if (!Validate(size)) {
+            data = oldData;
+            Memory::Free(block);
+            return false;
+        }
+        ownedData = block;
+
+        bool sameLayout = sceneInstance && header->sceneObjectCount == oldSceneCount;
+        for (uint32_t i = 0; sameLayout && i < oldSceneCount; i++) {
+            sameLayout = records[i].type == oldRecords[i].type && records[i].parent == oldRecords[i].parent &&
+                         (records[i].type != CUSTOM ||
+                          strcmp(GetString(records[i].typeName), oldString(oldRecords[i].typeName)) == 0);
+        }
+
+        if (sameLayout) {
+            // Parents come first: they move their children, which then get their own position
+            for (uint32_t i = 0; i < oldSceneCount; i++) {
+                Objects::Object* object = sceneInstance->objects[i];
+                if (!object) continue;
+                Apply(object, records[i], 0, 0);
+
+                // Apply leaves names alone: renamed records must move in the scene's name index
+                const char* name = GetString(records[i].name);
+                if (strcmp(name, object->GetName()) != 0) object->SetName(name);
+
+                Objects::Object* parent = records[i].parent >= 0 ? sceneInstance->objects[records[i].parent] : nullptr;
+                if (parent) parent->Attach(object);
+
+                if (records[i].type == SPRITE && records[i].resource != NO_STRING) {
+                    const char* sheet = GetString(records[i].resource);
+                    bool changed = strcmp(sheet, oldString(oldRecords[i].resource)) != 0;
+                    Objects::Sprite* sprite = static_cast<Objects::Sprite*>(object);
+                    if (changed) sprite->LoadFromFile(sheet);
+                    sprite->SetFrame((int)records[i].params[3]);
+                }
+            }
+        } else if (sceneInstance) {
+            // Only the scene block is recreated, prefab instances stay with the game
+            instances.erase(std::find(instances.begin(), instances.end(), sceneInstance));
+            Destroy(scene, sceneInstance);
+            sceneInstance = nullptr;
+            Instantiate(scene);
+        }
+
+        Memory::Free(oldOwnedData);
+        return true;
+    }
+
+    void SceneFile::ReloadSheet(const char* sheetPath) {
+        // Sprites share the definition of their sheet, reloading it once updates all of them
+        Objects::SpriteDef* def = Objects::SpriteDef::Find(sheetPath);
+        if (def) def->Reload();
+    }
+
+    void SceneFile::OnFileChanged(const char* path, void* userData) {
+        SceneFile* file = static_cast<SceneFile*>(userData);
+        if (file->Reload(file->watchedScene)) {
+            // Sprites may use other sheets now
+            file->Watch(*file->watcher, file->watchedScene);
+        }
+    }
+
+    void SceneFile::OnSheetChanged(const char* path, void* userData) {
+        static_cast<SceneFile*>(userData)->ReloadSheet(path);
+    }
+
+    void SceneFile::Watch(Debug::FileWatcher& fileWatcher, Scene::Scene* scene) {
+        if (watcher) watcher->UnwatchAll(this);
+        watcher = &fileWatcher;
+        watchedScene = scene;
+        if (!header || path.empty()) return;
+
+        watcher->Watch(path.c_str(), OnFileChanged, this);
+
+        // Each sheet once, whatever the number of sprites using it
+        std::vector<uint32_t> sheets;
+        for (uint32_t i = 0; i < header->objectCount; i++) {
+            uint32_t sheet = records[i].resource;
+            if (records[i].type != SPRITE || sheet == NO_STRING) continue;
+            if (std::find(sheets.begin(), sheets.end(), sheet) != sheets.end()) continue;
+            sheets.push_back(sheet);
+            watcher->Watch(GetString(sheet), OnSheetChanged, this);
+        }
+    }
+
+    const ObjectRecord* SceneFile::GetRecord(uint32_t index) const {
+        if (!header || index >= header->objectCount) return nullptr;
+        return &records[index];
+    }
+
+    int SceneFile::FindRecord(const char* name) const {
+        if (!header) return -1;
+        for (uint32_t i = 0; i < header->sceneObjectCount; i++) {
+            if (records[i].name != NO_STRING && strcmp(strings + records[i].name, name) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    Objects::Object* SceneFile::GetObject(uint32_t index) const {
+        if (!sceneInstance || index >= sceneInstance->objects.size()) return nullptr;
+        return sceneInstance->objects[index];
+    }
+
+    Objects::Object* SceneFile::FindObject(const char* name) const {
+        int index = FindRecord(name);
+        return index >= 0 ? GetObject(index) : nullptr;
+    }
+
+    const char* SceneFile::GetString(uint32_t offset) const {
+        if (!header || offset == NO_STRING) return "";
+        return strings + offset;
+    }
+
+    const PropertyRecord* SceneFile::FindProperty(uint32_t index, const char* key) const {
+        const ObjectRecord* record = GetRecord(index);
+        if (!record) return nullptr;
+
+        for (uint32_t i = 0; i < record->propertyCount; i++) {
+            const PropertyRecord& property = properties[record->firstProperty + i];
+            if (strcmp(strings + property.key, key) == 0) {
+                return &property;
+            }
+        }
+        return nullptr;
+    }
+
+    int SceneFile::GetInt(uint32_t index, const char* key, int fallback) const {
+        const PropertyRecord* property = FindProperty(index, key);
+        if (!property) return fallback;
+        if (property->type == PROPERTY_INT) return property->value.i;
+        if (property->type == PROPERTY_FLOAT) return (int)property->value.f;
+        return fallback;
+    }
+
+    float SceneFile::GetFloat(uint32_t index, const char* key, float fallback) const {
+        const PropertyRecord* property = FindProperty(index, key);
+        if (!property) return fallback;
+        if (property->type == PROPERTY_FLOAT) return property->value.f;
+        if (property->type == PROPERTY_INT) return (float)property->value.i;
+        return fallback;
+    }
+
+    const char* SceneFile::GetText(uint32_t index, const char* key, const char* fallback) const {
+        const PropertyRecord* property = FindProperty(index, key);
+        if (!property || property->type != PROPERTY_STRING) return fallback;
+        return GetString(property->value.s);
+    }
+}
@@ -0,0 +1,233 @@
+/**
+ * @file Timers.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex timer wheel implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Timers.hpp"
+
+namespace Timers {
+    static u32 ToTicks(float seconds) {
+        if (!(seconds > 0.001f)) return 1;
+        if (seconds > 4000000.0f) seconds = 4000000.0f;  // Keeps the tick count below 2^32
+        return (u32)(seconds * 1000.0f + 0.5f);
+    }
+
+    TimerWheel::TimerWheel(u32 capacity) {
+        timers.reserve(capacity);
+        for (int level = 0; level < LEVELS; level++) {
+            for (u32 slot = 0; slot < SLOTS; slot++) {
+                slots[level][slot] = NONE;
+            }
+        }
+    }
+
+    TimerWheel::TimerData* TimerWheel::Find(Handle handle) {
+        u32 index = (handle & ((1u << INDEX_BITS) - 1)) - 1;
+        if (handle == 0 || index >= timers.size()) return nullptr;
+        TimerData& timer = timers[index];
+        if (!timer.active || timer.generation != (handle >> INDEX_BITS)) return nullptr;
+        return &timer;
+    }
+
+    void TimerWheel::Insert(u32 index) {
+        TimerData& timer = timers[index];
+        u32 delta = timer.expires - now;
+
+        // Level n holds the timers expiring within 64^(n + 1) ticks
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (1u << (SLOT_BITS * (level + 1)))) {
+            level++;
+        }
+        // Too far for the wheel: parked in the last slot of the top level and re-bucketed later
+        u32 expires = timer.expires;
+        if (delta >= (1u << (SLOT_BITS * LEVELS))) {
+            expires = now + (1u << (SLOT_BITS * LEVELS)) - 1;
+        }
+
+        u32 slot = (expires >> (SLOT_BITS * level)) & (SLOTS - 1);
+        timer.level = level;
+        timer.slot = slot;
+        timer.previous = NONE;
+        timer.next = slots[level][slot];
+        if (timer.next != NONE) timers[timer.next].previous = index;
+        slots[level][slot] = index;
+    }
+
+    void TimerWheel::Unlink(u32 index) {
+        TimerData& timer = timers[index];
+        if (timer.previous != NONE) {
+            timers[timer.previous].next = timer.next;
+        } else {
+            slots[timer.level][timer.slot] = timer.next;
+        }
+        if (timer.next != NONE) timers[timer.next].previous = timer.previous;
+    }
+
+    void TimerWheel::Release(u32 index) {
+        TimerData& timer = timers[index];
+        Unlink(index);
+
+        if (timer.owner) {
+            if (timer.ownerPrevious != NONE) {
+                timers[timer.ownerPrevious].ownerNext = timer.ownerNext;
+            } else if (timer.ownerNext != NONE) {
+                owners[timer.owner] = timer.ownerNext;
+            } else {
+                owners.erase(timer.owner);
+            }
+            if (timer.ownerNext != NONE) timers[timer.ownerNext].ownerPrevious = timer.ownerPrevious;
+        }
+
+        timer.active = false;
+        timer.next = freeList;
+        freeList = index;
+        count--;
+    }
+
+    Handle TimerWheel::Schedule(u32 delay, u32 interval, Callback callback, void* userData, const Objects::Object* owner) {
+        if (!callback) return 0;
+
+        u32 index;
+        if (freeList != NONE) {
+            index = freeList;
+            freeList = timers[index].next;
+        } else {
+            if (timers.size() >= (1u << INDEX_BITS) - 1) return 0;
+            index = timers.size();
+            timers.push_back(TimerData());
+            timers[index].generation = 0;
+        }
+
+        TimerData& timer = timers[index];
+        timer.callback = callback;
+        timer.userData = userData;
+        timer.owner = owner;
+        timer.expires = now + delay;
+        timer.interval = interval;
+        timer.generation = (timer.generation + 1) & ((1u << (32 - INDEX_BITS)) - 1);
+        timer.active = true;
+        timer.ownerPrevious = NONE;
+        timer.ownerNext = NONE;
+
+        if (owner) {
+            // find first: emplace allocates a node even when the owner already has timers
+            auto it = owners.find(owner);
+            if (it != owners.end()) {
+                timer.ownerNext = it->second;
+                timers[timer.ownerNext].ownerPrevious = index;
+                it->second = index;
+            } else {
+                owners.emplace(owner, index);
+            }
+        }
+
+        Insert(index);
+        count++;
+        return (timer.generation << INDEX_BITS) | (index + 1);
+    }
+
+    Handle TimerWheel::After(float seconds, Callback callback, void* userData, const Objects::Object* owner) {
+        return Schedule(ToTicks(seconds), 0, callback, userData, owner);
+    }
+
+    Handle TimerWheel::Every(float seconds, Callback callback, void* userData, const Objects::Object* owner) {
+        u32 interval = ToTicks(seconds);
+        return Schedule(interval, interval, callback, userData, owner);
+    }
+
+    bool TimerWheel::Cancel(Handle handle) {
+        TimerData* timer = Find(handle);
+        if (!timer) return false;
+        Release(timer - timers.data());
+        return true;
+    }
+
+    void TimerWheel::CancelOwner(const Objects::Object* owner) {
+        auto it = owners.find(owner);
+        if (it == owners.end()) return;
+
+        u32 index = it->second;
+        owners.erase(it);
+        while (index != NONE) {
+            u32 next = timers[index].ownerNext;
+            // Already out of the owner map, so Release only unlinks the slot
+            timers[index].owner = nullptr;
+            Release(index);
+            index = next;
+        }
+    }
+
+    void TimerWheel::Clear() {
+        for (size_t i = 0; i < timers.size(); i++) {
+            if (timers[i].active) {
+                timers[i].owner = nullptr;
+                Release(i);
+            }
+        }
+        owners.clear();
+    }
+
+    float TimerWheel::GetRemaining(Handle handle) {
+        TimerData* timer = Find(handle);
+        if (!timer) return 0;
+        return ((timer->expires - now) - remainder) / 1000.0f;
+    }
+
+    void TimerWheel::Cascade(int level) {
+        u32 slot = (now >> (SLOT_BITS * level)) & (SLOTS - 1);
+        u32 index = slots[level][slot];
+        slots[level][slot] = NONE;
+        while (index != NONE) {
+            u32 next = timers[index].next;
+            Insert(index);
+            index = next;
+        }
+    }
+
+    void TimerWheel::Advance(float deltaTime) {
+        remainder += deltaTime * 1000.0f;
+        u32 ticks = (u32)remainder;
+        remainder -= ticks;
+
+        while (ticks > 0) {
+            // Nothing scheduled: jump straight to the end
+            if (count == 0) {
+                now += ticks;
+                return;
+            }
+
+            ticks--;
+            now++;
+
+            // Each time a level wraps, the matching slot of the next level comes within its range
+            for (int level = 1; level < LEVELS; level++) {
+                if (now & ((1u << (SLOT_BITS * level)) - 1)) break;
+                Cascade(level);
+            }
+
+            u32 slot = now & (SLOTS - 1);
+            while (slots[0][slot] != NONE) {
+                u32 index = slots[0][slot];
+                TimerData& timer = timers[index];
+                Callback callback = timer.callback;
+                void* userData = timer.userData;
+
+                if (timer.interval > 0) {
+                    // Re-armed before the call so the callback can cancel it
+                    Unlink(index);
+                    timer.expires = now + timer.interval;
+                    Insert(index);
+                } else {
+                    Release(index);
+                }
+                callback(userData);
+            }
+        }
+    }
+}
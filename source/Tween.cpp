@@ -0,0 +1,318 @@
+/**
+ * @file Tween.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex tweens and easing implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "Tween.hpp"
+#include <math.h>
+
+namespace Tween {
+    static float Linear(float t) { return t; }
+    static float QuadIn(float t) { return t * t; }
+    static float QuadOut(float t) { return t * (2.0f - t); }
+    static float QuadInOut(float t) { return t < 0.5f ? 2.0f * t * t : -1.0f + (4.0f - 2.0f * t) * t; }
+    static float CubicIn(float t) { return t * t * t; }
+    static float CubicOut(float t) { float f = t - 1.0f; return f * f * f + 1.0f; }
+    static float CubicInOut(float t) {
+        if (t < 0.5f) return 4.0f * t * t * t;
+        float f = 2.0f * t - 2.0f;
+        return 0.5f * f * f * f + 1.0f;
+    }
+    static float SineIn(float t) { return 1.0f - cosf(t * (float)M_PI_2); }
+    static float SineOut(float t) { return sinf(t * (float)M_PI_2); }
+    static float SineInOut(float t) { return 0.5f * (1.0f - cosf(t * (float)M_PI)); }
+    static float ExpoIn(float t) { return t <= 0.0f ? 0.0f : powf(2.0f, 10.0f * (t - 1.0f)); }
+    static float ExpoOut(float t) { return t >= 1.0f ? 1.0f : 1.0f - powf(2.0f, -10.0f * t); }
+    static float BackIn(float t) { const float s = 1.70158f; return t * t * ((s + 1.0f) * t - s); }
+    static float BackOut(float t) { const float s = 1.70158f; float f = t - 1.0f; return f * f * ((s + 1.0f) * f + s) + 1.0f; }
+    static float ElasticOut(float t) {
+        if (t <= 0.0f || t >= 1.0f) return t;
+        return powf(2.0f, -10.0f * t) * sinf((t - 0.075f) * (2.0f * (float)M_PI) / 0.3f) + 1.0f;
+    }
+    static float BounceOut(float t) {
+        if (t < 1.0f / 2.75f) return 7.5625f * t * t;
+        if (t < 2.0f / 2.75f) { t -= 1.5f / 2.75f; return 7.5625f * t * t + 0.75f; }
+        if (t < 2.5f / 2.75f) { t -= 2.25f / 2.75f; return 7.5625f * t * t + 0.9375f; }
+        t -= 2.625f / 2.75f;
+        return 7.5625f * t * t + 0.984375f;
+    }
+
+    // Indexed by Ease
+    static float (* const easeTable[])(float) = {
+        Linear,
+        QuadIn, QuadOut, QuadInOut,
+        CubicIn, CubicOut, CubicInOut,
+        SineIn, SineOut, SineInOut,
+        ExpoIn, ExpoOut,
+        BackIn, BackOut,
+        ElasticOut,
+        BounceOut
+    };
+    static_assert(sizeof(easeTable) / sizeof(easeTable[0]) == (size_t)Ease::COUNT, "Missing easing function");
+
+    float Evaluate(Ease ease, float t) {
+        return easeTable[(size_t)ease](t);
+    }
+
+    u32 LerpColor(u32 from, u32 to, float t) {
+        u32 result = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            float a = (from >> shift) & 0xFF;
+            float b = (to >> shift) & 0xFF;
+            u32 channel = (u32)(a + (b - a) * t + 0.5f);
+            if (channel > 0xFF) channel = 0xFF;
+            result |= channel << shift;
+        }
+        return result;
+    }
+
+    TweenManager::TweenManager(u16 capacity) : capacity(capacity) {
+        u16 initial = capacity < INITIAL_CAPACITY ? capacity : INITIAL_CAPACITY;
+        tweens.reserve(initial);
+        completed.reserve(initial);
+        slotToIndex.reserve(initial);
+        slotGeneration.reserve(initial);
+        freeSlots.reserve(initial);
+    }
+
+    TweenManager::TweenData* TweenManager::Find(Handle handle) {
+        u16 slot = handle & 0xFFFF;
+        u16 generation = handle >> 16;
+        if (handle == 0 || slot >= slotGeneration.size() || slotGeneration[slot] != generation) {
+            return nullptr;
+        }
+        TweenData& tween = tweens[slotToIndex[slot]];
+        return (tween.flags & DEAD) ? nullptr : &tween;
+    }
+
+    Handle TweenManager::Create(Property property, void* target, Objects::Object* owner, double to, float duration, Ease ease) {
+        u16 slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else if (slotGeneration.size() < capacity) {
+            // Every slot is in use: add one (the arrays grow geometrically)
+            slot = slotGeneration.size();
+            slotToIndex.push_back(0);
+            slotGeneration.push_back(1);
+        } else {
+            return 0;
+        }
+        slotToIndex[slot] = tweens.size();
+
+        TweenData tween;
+        tween.target = target;
+        tween.owner = owner;
+        tween.from = 0;
+        tween.to = to;
+        tween.fromColor = 0;
+        tween.toColor = 0;
+        tween.duration = duration > 0 ? duration : 0.0001f;
+        tween.delay = 0;
+        tween.elapsed = 0;
+        tween.onComplete = nullptr;
+        tween.userData = nullptr;
+        tween.next = 0;
+        tween.slot = slot;
+        tween.repeats = 0;
+        tween.property = property;
+        tween.ease = ease;
+        tween.flags = ACTIVE | FROM_CURRENT;
+        tweens.push_back(tween);
+
+        return ((u32)slotGeneration[slot] << 16) | slot;
+    }
+
+    Handle TweenManager::MoveX(Objects::Object* object, double to, float duration, Ease ease) {
+        return Create(Property::X, object, object, to, duration, ease);
+    }
+
+    Handle TweenManager::MoveY(Objects::Object* object, double to, float duration, Ease ease) {
+        return Create(Property::Y, object, object, to, duration, ease);
+    }
+
+    Handle TweenManager::Rotate(Objects::Sprite* sprite, double to, float duration, Ease ease) {
+        return Create(Property::ANGLE, sprite, sprite, to, duration, ease);
+    }
+
+    Handle TweenManager::Color(Objects::Object* owner, u32* color, u32 to, float duration, Ease ease) {
+        Handle handle = Create(Property::COLOR, color, owner, 0, duration, ease);
+        if (handle) {
+            Find(handle)->toColor = to;
+        }
+        return handle;
+    }
+
+    Handle TweenManager::Value(Objects::Object* owner, double* value, double to, float duration, Ease ease) {
+        return Create(Property::VALUE, value, owner, to, duration, ease);
+    }
+
+    void TweenManager::From(Handle handle, double from) {
+        TweenData* tween = Find(handle);
+        if (tween) {
+            tween->from = from;
+            tween->flags &= ~FROM_CURRENT;
+        }
+    }
+
+    void TweenManager::FromColor(Handle handle, u32 from) {
+        TweenData* tween = Find(handle);
+        if (tween) {
+            tween->fromColor = from;
+            tween->flags &= ~FROM_CURRENT;
+        }
+    }
+
+    void TweenManager::SetDelay(Handle handle, float delay) {
+        TweenData* tween = Find(handle);
+        if (tween) tween->delay = delay;
+    }
+
+    void TweenManager::SetRepeat(Handle handle, s16 count, bool yoyo) {
+        TweenData* tween = Find(handle);
+        if (!tween) return;
+        tween->repeats = count;
+        if (yoyo) tween->flags |= YOYO;
+        else tween->flags &= ~YOYO;
+    }
+
+    void TweenManager::OnComplete(Handle handle, Callback callback, void* userData) {
+        TweenData* tween = Find(handle);
+        if (tween) {
+            tween->onComplete = callback;
+            tween->userData = userData;
+        }
+    }
+
+    Handle TweenManager::Then(Handle handle, Handle next) {
+        TweenData* tween = Find(handle);
+        TweenData* nextTween = Find(next);
+        if (tween && nextTween) {
+            tween->next = next;
+            nextTween->flags &= ~ACTIVE;
+        }
+        return next;
+    }
+
+    bool TweenManager::IsActive(Handle handle) {
+        return Find(handle) != nullptr;
+    }
+
+    void TweenManager::Cancel(Handle handle) {
+        TweenData* tween = Find(handle);
+        while (tween) {
+            tween->flags |= DEAD;
+            tween = Find(tween->next);
+        }
+    }
+
+    void TweenManager::CancelTarget(const Objects::Object* owner) {
+        for (TweenData& tween : tweens) {
+            if (tween.owner == owner) {
+                Cancel(((u32)slotGeneration[tween.slot] << 16) | tween.slot);
+            }
+        }
+    }
+
+    void TweenManager::Clear() {
+        for (TweenData& tween : tweens) {
+            tween.flags |= DEAD;
+        }
+        for (size_t i = tweens.size(); i > 0; i--) {
+            Remove(i - 1);
+        }
+    }
+
+    void TweenManager::Start(TweenData& tween) {
+        tween.flags |= STARTED;
+        if (!(tween.flags & FROM_CURRENT)) return;
+
+        switch (tween.property) {
+            case Property::X: tween.from = static_cast<Objects::Object*>(tween.target)->get_x(); break;
+            case Property::Y: tween.from = static_cast<Objects::Object*>(tween.target)->get_y(); break;
+            case Property::ANGLE: tween.from = static_cast<Objects::Sprite*>(tween.target)->getAngle(); break;
+            case Property::COLOR: tween.fromColor = *static_cast<u32*>(tween.target); break;
+            case Property::VALUE: tween.from = *static_cast<double*>(tween.target); break;
+        }
+    }
+
+    void TweenManager::Write(TweenData& tween, float progress) {
+        float eased = easeTable[(size_t)tween.ease](progress);
+        double value = tween.from + (tween.to - tween.from) * eased;
+
+        switch (tween.property) {
+            case Property::X: static_cast<Objects::Object*>(tween.target)->SetX(value); break;
+            case Property::Y: static_cast<Objects::Object*>(tween.target)->SetY(value); break;
+            case Property::ANGLE: static_cast<Objects::Sprite*>(tween.target)->SetAngle(value); break;
+            case Property::COLOR: *static_cast<u32*>(tween.target) = LerpColor(tween.fromColor, tween.toColor, eased); break;
+            case Property::VALUE: *static_cast<double*>(tween.target) = value; break;
+        }
+    }
+
+    void TweenManager::Remove(size_t index) {
+        // Swap with the last tween to keep the array dense
+        u16 slot = tweens[index].slot;
+        if (index != tweens.size() - 1) {
+            tweens[index] = tweens.back();
+            slotToIndex[tweens[index].slot] = index;
+        }
+        tweens.pop_back();
+
+        slotGeneration[slot]++;
+        if (slotGeneration[slot] == 0) slotGeneration[slot] = 1;
+        freeSlots.push_back(slot);
+    }
+
+    void TweenManager::Update(float deltaTime, PauseFilter isPaused) {
+        completed.clear();
+
+        for (TweenData& tween : tweens) {
+            if ((tween.flags & (ACTIVE | DEAD)) != ACTIVE) continue;
+            if (isPaused && tween.owner && isPaused(tween.owner)) continue;
+
+            tween.elapsed += deltaTime;
+            if (tween.elapsed < tween.delay) continue;
+            if (!(tween.flags & STARTED)) Start(tween);
+
+            float progress = (tween.elapsed - tween.delay) / tween.duration;
+            bool finished = progress >= 1.0f;
+            if (finished) progress = 1.0f;
+
+            Write(tween, (tween.flags & REVERSED) ? 1.0f - progress : progress);
+            if (!finished) continue;
+
+            if (tween.repeats != 0) {
+                if (tween.repeats > 0) tween.repeats--;
+                if (tween.flags & YOYO) tween.flags ^= REVERSED;
+                tween.elapsed = tween.delay;
+                continue;
+            }
+
+            tween.flags |= DEAD;
+            completed.push_back({ tween.onComplete, tween.userData, tween.next });
+        }
+
+        // Remove finished and cancelled tweens before running callbacks so they can create new ones
+        for (size_t i = tweens.size(); i > 0; i--) {
+            if (tweens[i - 1].flags & DEAD) {
+                Remove(i - 1);
+            }
+        }
+
+        for (const Completion& completion : completed) {
+            TweenData* next = Find(completion.next);
+            if (next) {
+                next->flags |= ACTIVE;
+            }
+            if (completion.onComplete) {
+                completion.onComplete(completion.userData);
+            }
+        }
+    }
+}
@@ -0,0 +1,574 @@
+/**
+ * @file UI.cpp
+ * @author ADAMOUMOU
+ * @brief CitroFlex touch UI widgets implementation
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#include "UI.hpp"
+#include "Scene.hpp"
+#include "Render.hpp"
+#include <algorithm>
+
+namespace UI {
+    Rect Rect::Intersect(const Rect& other) const {
+        float left = std::max(x, other.x);
+        float top = std::max(y, other.y);
+        float right = std::min(x + width, other.x + other.width);
+        float bottom = std::min(y + height, other.y + other.height);
+        Rect result;
+        result.x = left;
+        result.y = top;
+        result.width = right > left ? right - left : 0;
+        result.height = bottom > top ? bottom - top : 0;
+        return result;
+    }
+
+    // Widget
+
+    Widget::~Widget() {
+        if (parent) parent->Remove(this);
+        for (Widget* child : children) {
+            child->parent = nullptr;
+            child->SetCanvas(nullptr);
+        }
+    }
+
+    void Widget::SetCanvas(Canvas* newCanvas) {
+        canvas = newCanvas;
+        for (Widget* child : children) {
+            child->SetCanvas(newCanvas);
+        }
+    }
+
+    void Widget::MarkLayoutDirty() {
+        if (canvas) canvas->layoutDirty = true;
+    }
+
+    void Widget::Add(Widget* child) {
+        if (child->parent == this) return;
+        if (child->parent) child->parent->Remove(child);
+
+        children.push_back(child);
+        child->parent = this;
+        child->SetCanvas(canvas);
+        MarkLayoutDirty();
+    }
+
+    void Widget::Remove(Widget* child) {
+        auto it = std::find(children.begin(), children.end(), child);
+        if (it == children.end()) return;
+
+        if (canvas) canvas->OnWidgetRemoved(child);
+        MarkLayoutDirty();
+        children.erase(it);
+        child->parent = nullptr;
+        child->SetCanvas(nullptr);
+    }
+
+    void Widget::SetFrame(float x, float y, float width, float height) {
+        if (frame.x == x && frame.y == y && frame.width == width && frame.height == height) return;
+        frame.x = x;
+        frame.y = y;
+        frame.width = width;
+        frame.height = height;
+        MarkLayoutDirty();
+    }
+
+    void Widget::SetVisible(bool value) {
+        if (visible == value) return;
+        visible = value;
+        if (!visible && canvas) canvas->OnWidgetRemoved(this);
+        MarkLayoutDirty();
+    }
+
+    void Widget::SetEnabled(bool value) {
+        if (enabled == value) return;
+        enabled = value;
+        if (!enabled && canvas) canvas->OnWidgetRemoved(this);
+        MarkLayoutDirty();
+    }
+
+    bool Widget::Contains(const Widget* widget) const {
+        for (; widget; widget = widget->parent) {
+            if (widget == this) return true;
+        }
+        return false;
+    }
+
+    void Widget::RevealWidget(Widget* widget) {
+        for (Widget* ancestor = widget->parent; ancestor; ancestor = ancestor->parent) {
+            ancestor->OnDescendantFocused(widget);
+        }
+    }
+
+    void Widget::FillRect(float x, float y, float width, float height, u32 color) const {
+        Rect area;
+        area.x = x;
+        area.y = y;
+        area.width = width;
+        area.height = height;
+        area = area.Intersect(clip);
+        if (!area.Empty()) Render::Rect(area.x, area.y, area.width, area.height, color);
+    }
+
+    void Widget::DrawOutline(u32 color) const {
+        FillRect(bounds.x, bounds.y, bounds.width, 1, color);
+        FillRect(bounds.x, bounds.y + bounds.height - 1, bounds.width, 1, color);
+        FillRect(bounds.x, bounds.y + 1, 1, bounds.height - 2, color);
+        FillRect(bounds.x + bounds.width - 1, bounds.y + 1, 1, bounds.height - 2, color);
+    }
+
+    // Button
+
+    bool Button::OnTouch(const TouchEvent& event) {
+        switch (event.type) {
+            case TouchType::PRESS:
+                longPressed = false;
+                return true;
+            case TouchType::DRAG:
+                // Let a scroll view take the drag
+                return false;
+            case TouchType::RELEASE:
+                if (!longPressed && GetBounds().Contains(event.position.x, event.position.y) && onClick) {
+                    onClick(this, clickData);
+                }
+                return true;
+            case TouchType::LONG_PRESS:
+                if (!onLongPress) return false;
+                longPressed = true;
+                onLongPress(this, longPressData);
+                return true;
+            default:
+                return true;
+        }
+    }
+
+    void Button::OnActivate() {
+        if (onClick) onClick(this, clickData);
+    }
+
+    void Button::Draw() {
+        const Rect& area = GetBounds();
+        u32 fill = !IsEnabled() ? disabledColor : (IsPressed() ? pressedColor : color);
+        FillRect(area.x, area.y, area.width, area.height, fill);
+        if (IsFocused()) DrawOutline(focusColor);
+    }
+
+    // Slider
+
+    void Slider::SetRange(float min, float max, float dpadStep) {
+        minimum = min;
+        maximum = max > min ? max : min;
+        step = dpadStep;
+        SetValue(value);
+    }
+
+    void Slider::SetValue(float newValue) {
+        newValue = std::min(std::max(newValue, minimum), maximum);
+        if (newValue == value) return;
+        value = newValue;
+        if (onChange) onChange(this, changeData);
+    }
+
+    void Slider::SetFromPosition(float x) {
+        const Rect& area = GetBounds();
+        if (area.width <= 0) return;
+        float ratio = (x - area.x) / area.width;
+        SetValue(minimum + ratio * (maximum - minimum));
+    }
+
+    bool Slider::OnTouch(const TouchEvent& event) {
+        if (event.type == TouchType::PRESS || event.type == TouchType::DRAG) {
+            SetFromPosition(event.position.x);
+        }
+        return event.type != TouchType::LONG_PRESS;
+    }
+
+    bool Slider::OnDirection(Direction direction) {
+        if (direction == Direction::LEFT) {
+            SetValue(value - step);
+            return true;
+        }
+        if (direction == Direction::RIGHT) {
+            SetValue(value + step);
+            return true;
+        }
+        return false;
+    }
+
+    void Slider::Draw() {
+        const Rect& area = GetBounds();
+        float ratio = maximum > minimum ? (value - minimum) / (maximum - minimum) : 0;
+        float trackY = area.y + area.height / 2 - 2;
+        float knobX = area.x + ratio * area.width;
+
+        FillRect(area.x, trackY, area.width, 4, trackColor);
+        FillRect(area.x, trackY, knobX - area.x, 4, fillColor);
+        FillRect(knobX - 3, area.y, 6, area.height, knobColor);
+        if (IsFocused()) DrawOutline(focusColor);
+    }
+
+    // List
+
+    void List::Arrange() {
+        float y = 0;
+        float width = GetFrame().width;
+        for (size_t i = 0; i < GetChildCount(); i++) {
+            Widget* row = GetChild(i);
+            if (!row->IsVisible()) continue;
+            row->SetFrame(0, y, width, row->GetFrame().height);
+            y += row->GetFrame().height + spacing;
+        }
+        SetSize(width, y > 0 ? y - spacing : 0);
+    }
+
+    int List::GetRowAt(float y) const {
+        for (size_t i = 0; i < GetChildCount(); i++) {
+            const Widget* row = GetChild(i);
+            if (!row->IsVisible()) continue;
+            const Rect& area = row->GetBounds();
+            if (y >= area.y && y < area.y + area.height) return i;
+        }
+        return -1;
+    }
+
+    bool List::OnTouch(const TouchEvent& event) {
+        if (event.type == TouchType::DRAG) return false;
+        if (event.type == TouchType::RELEASE) {
+            int row = GetRowAt(event.position.y);
+            if (row >= 0 && row == GetRowAt(event.start.y)) {
+                highlighted = row;
+                Select(row);
+            }
+        }
+        return true;
+    }
+
+    bool List::OnDirection(Direction direction) {
+        int count = GetChildCount();
+        if (direction == Direction::UP && highlighted > 0) {
+            highlighted--;
+        } else if (direction == Direction::DOWN && highlighted + 1 < count) {
+            highlighted++;
+        } else {
+            return false;
+        }
+
+        // Keep the highlighted row on screen inside a scroll view
+        RevealWidget(GetChild(highlighted));
+        return true;
+    }
+
+    void List::OnActivate() {
+        if (highlighted < (int)GetChildCount()) Select(highlighted);
+    }
+
+    void List::Select(int index) {
+        if (index >= (int)GetChildCount()) return;
+        selected = index;
+        if (index >= 0 && onSelect) onSelect(this, index, selectData);
+    }
+
+    void List::Draw() {
+        if (selected >= 0 && selected < (int)GetChildCount()) {
+            const Rect& area = GetChild(selected)->GetBounds();
+            FillRect(area.x, area.y, area.width, area.height, selectedColor);
+        }
+        if (IsFocused() && highlighted < (int)GetChildCount() && highlighted != selected) {
+            const Rect& area = GetChild(highlighted)->GetBounds();
+            FillRect(area.x, area.y, area.width, area.height, highlightColor);
+        }
+    }
+
+    // ScrollView
+
+    void ScrollView::Arrange() {
+        contentHeight = 0;
+        for (size_t i = 0; i < GetChildCount(); i++) {
+            const Widget* child = GetChild(i);
+            if (!child->IsVisible()) continue;
+            contentHeight = std::max(contentHeight, child->GetFrame().y + child->GetFrame().height);
+        }
+        scroll = std::min(std::max(scroll, 0.0f), std::max(contentHeight - GetFrame().height, 0.0f));
+    }
+
+    void ScrollView::ScrollTo(float offset) {
+        offset = std::min(std::max(offset, 0.0f), std::max(contentHeight - GetFrame().height, 0.0f));
+        if (offset == scroll) return;
+        scroll = offset;
+        MarkLayoutDirty();
+    }
+
+    bool ScrollView::OnTouch(const TouchEvent& event) {
+        if (event.type == TouchType::DRAG) {
+            ScrollTo(scroll - event.delta.y);
+        }
+        return event.type != TouchType::LONG_PRESS;
+    }
+
+    void ScrollView::OnDescendantFocused(Widget* widget) {
+        const Rect& area = widget->GetBounds();
+        const Rect& view = GetBounds();
+        if (area.y < view.y) {
+            ScrollTo(scroll - (view.y - area.y));
+        } else if (area.y + area.height > view.y + view.height) {
+            ScrollTo(scroll + (area.y + area.height - view.y - view.height));
+        }
+    }
+
+    void ScrollView::Draw() {
+        const Rect& view = GetBounds();
+        if (contentHeight <= view.height) return;
+        float barHeight = std::max(view.height * view.height / contentHeight, 8.0f);
+        float barY = view.y + (view.height - barHeight) * scroll / (contentHeight - view.height);
+        FillRect(view.x + view.width - 3, barY, 3, barHeight, barColor);
+    }
+
+    // Canvas
+
+    Canvas::Canvas() {
+        root.canvas = this;
+        root.frame.width = 320;
+        root.frame.height = 240;
+        root.bounds = root.frame;
+        root.clip = root.frame;
+        for (std::vector<Widget*>& cell : cells) {
+            cell.reserve(8);
+        }
+    }
+
+    Canvas::~Canvas() {
+        for (Widget* child : root.children) {
+            child->parent = nullptr;
+            child->SetCanvas(nullptr);
+        }
+        root.children.clear();
+    }
+
+    void Canvas::OnWidgetRemoved(Widget* widget) {
+        if (focus && widget->Contains(focus)) SetFocus(nullptr);
+        if (captured && widget->Contains(captured)) {
+            captured->pressed = false;
+            captured = nullptr;
+        }
+    }
+
+    void Canvas::Layout() {
+        if (!layoutDirty) return;
+        layoutDirty = false;
+        stats.layouts++;
+
+        for (std::vector<Widget*>& cell : cells) {
+            cell.clear();
+        }
+        focusables.clear();
+        ArrangeWidget(&root);
+        LayoutWidget(&root);
+
+        // The frames set by Arrange are already placed
+        layoutDirty = false;
+    }
+
+    void Canvas::ArrangeWidget(Widget* widget) {
+        // Before the children for their widths, after them for the heights they end up with
+        widget->Arrange();
+        if (widget->children.empty()) return;
+        for (Widget* child : widget->children) {
+            if (child->visible) ArrangeWidget(child);
+        }
+        widget->Arrange();
+    }
+
+    void Canvas::LayoutWidget(Widget* widget) {
+        Rect area = widget->bounds.Intersect(widget->clip);
+        if (widget->enabled && widget->touchable && !area.Empty()) {
+            int left = std::max((int)area.x / CELL_SIZE, 0);
+            int top = std::max((int)area.y / CELL_SIZE, 0);
+            int right = std::min((int)(area.x + area.width - 1) / CELL_SIZE, GRID_COLUMNS - 1);
+            int bottom = std::min((int)(area.y + area.height - 1) / CELL_SIZE, GRID_ROWS - 1);
+            for (int row = top; row <= bottom; row++) {
+                for (int column = left; column <= right; column++) {
+                    cells[row * GRID_COLUMNS + column].push_back(widget);
+                }
+            }
+        }
+        if (widget->enabled && widget->focusable) focusables.push_back(widget);
+
+        Math::Vec2f offset = widget->GetContentOffset();
+        Rect childClip = widget->ClipsChildren() ? widget->clip.Intersect(widget->bounds) : widget->clip;
+        for (Widget* child : widget->children) {
+            if (!child->visible) continue;
+            child->bounds.x = widget->bounds.x + child->frame.x - offset.x;
+            child->bounds.y = widget->bounds.y + child->frame.y - offset.y;
+            child->bounds.width = child->frame.width;
+            child->bounds.height = child->frame.height;
+            child->clip = childClip;
+            LayoutWidget(child);
+        }
+    }
+
+    Widget* Canvas::HitTest(float x, float y) {
+        Layout();
+        int column = (int)x / CELL_SIZE;
+        int row = (int)y / CELL_SIZE;
+        if (x < 0 || y < 0 || column >= GRID_COLUMNS || row >= GRID_ROWS) return nullptr;
+
+        stats.hitTests++;
+        const std::vector<Widget*>& cell = cells[row * GRID_COLUMNS + column];
+        for (size_t i = cell.size(); i > 0; i--) {
+            Widget* widget = cell[i - 1];
+            stats.widgetsTested++;
+            if (widget->bounds.Intersect(widget->clip).Contains(x, y)) return widget;
+        }
+        return nullptr;
+    }
+
+    Widget* Canvas::Deliver(Widget* widget, TouchType type, Math::Vec2f position, Math::Vec2f delta) {
+        TouchEvent event = { type, position, delta, touchStart };
+        for (; widget && widget != &root; widget = widget->parent) {
+            if (widget->OnTouch(event)) return widget;
+        }
+        return nullptr;
+    }
+
+    void Canvas::ProcessTouch(bool pressed, float x, float y, float deltaTime) {
+        Math::Vec2f position(x, y);
+
+        if (pressed && !touching) {
+            touching = true;
+            dragging = false;
+            longPressSent = false;
+            holdTime = 0;
+            touchStart = position;
+            lastTouch = position;
+
+            Widget* target = HitTest(x, y);
+            captured = Deliver(target, TouchType::PRESS, position, Math::Vec2f(0, 0));
+            if (captured) {
+                captured->pressed = true;
+                if (captured->focusable) SetFocus(captured);
+            }
+        } else if (pressed) {
+            holdTime += deltaTime;
+            Math::Vec2f delta = position - lastTouch;
+            if (!dragging && (position - touchStart).LengthSquared() > dragThreshold * dragThreshold) {
+                dragging = true;
+                delta = position - touchStart;
+            }
+
+            if (dragging && captured && (delta.x != 0 || delta.y != 0)) {
+                Widget* handler = Deliver(captured, TouchType::DRAG, position, delta);
+                if (handler && handler != captured) {
+                    // A parent took the drag over (e.g. a scroll view under a button)
+                    TouchEvent cancel = { TouchType::CANCEL, position, delta, touchStart };
+                    captured->OnTouch(cancel);
+                    captured->pressed = false;
+                    captured = handler;
+                    captured->pressed = true;
+                }
+            } else if (!dragging && !longPressSent && captured && holdTime >= longPressTime) {
+                longPressSent = true;
+                Deliver(captured, TouchType::LONG_PRESS, position, Math::Vec2f(0, 0));
+            }
+            if (dragging) lastTouch = position;
+        } else if (touching) {
+            // The touch screen reports (0, 0) once released, so the last position is used
+            touching = false;
+            if (captured) {
+                Widget* target = captured;
+                captured = nullptr;
+                target->pressed = false;
+                TouchEvent release = { TouchType::RELEASE, lastTouch, Math::Vec2f(0, 0), touchStart };
+                target->OnTouch(release);
+            }
+        }
+    }
+
+    void Canvas::ProcessDirection(Direction direction) {
+        Layout();
+        if (focus && focus->OnDirection(direction)) return;
+        if (!focus) {
+            if (!focusables.empty()) SetFocus(focusables[0]);
+            return;
+        }
+
+        // Closest focusable widget in the direction, preferring widgets in line with the focus
+        const Rect& from = focus->bounds;
+        Math::Vec2f center(from.x + from.width / 2, from.y + from.height / 2);
+        Widget* best = nullptr;
+        float bestScore = 0;
+        for (Widget* widget : focusables) {
+            if (widget == focus) continue;
+            const Rect& to = widget->bounds;
+            Math::Vec2f offset = Math::Vec2f(to.x + to.width / 2, to.y + to.height / 2) - center;
+
+            float along;
+            float across;
+            switch (direction) {
+                case Direction::LEFT:  along = -offset.x; across = offset.y; break;
+                case Direction::RIGHT: along = offset.x;  across = offset.y; break;
+                case Direction::UP:    along = -offset.y; across = offset.x; break;
+                default:               along = offset.y;  across = offset.x; break;
+            }
+            if (along <= 0) continue;
+
+            float score = along + 2 * (across < 0 ? -across : across);
+            if (!best || score < bestScore) {
+                best = widget;
+                bestScore = score;
+            }
+        }
+        if (best) SetFocus(best);
+    }
+
+    void Canvas::ProcessActivate() {
+        if (focus) focus->OnActivate();
+    }
+
+    void Canvas::SetFocus(Widget* widget) {
+        if (widget == focus) return;
+        if (focus) focus->focused = false;
+        focus = widget;
+        if (!focus) return;
+
+        focus->focused = true;
+        Widget::RevealWidget(focus);
+    }
+
+    void Canvas::OnUpdate(Scene::Scene* scene) {
+        Input::InputManager* input = GetInputManager();
+        if (!input) return;
+
+        float deltaTime = 1.0f / 60.0f;
+        if (scene && scene->GetSceneManager()) deltaTime = scene->GetSceneManager()->GetDeltaTime();
+
+        Input::TouchPosition touch = input->GetTouchPosition();
+        ProcessTouch(touch.isPressed, touch.position.x, touch.position.y, deltaTime);
+
+        if (input->GetButtonState(Input::Button::LEFT) == Input::ButtonState::PRESSED) ProcessDirection(Direction::LEFT);
+        if (input->GetButtonState(Input::Button::RIGHT) == Input::ButtonState::PRESSED) ProcessDirection(Direction::RIGHT);
+        if (input->GetButtonState(Input::Button::UP) == Input::ButtonState::PRESSED) ProcessDirection(Direction::UP);
+        if (input->GetButtonState(Input::Button::DOWN) == Input::ButtonState::PRESSED) ProcessDirection(Direction::DOWN);
+        if (input->GetButtonState(Input::Button::A) == Input::ButtonState::PRESSED) ProcessActivate();
+    }
+
+    void Canvas::Draw() {
+        Layout();
+        for (Widget* child : root.children) {
+            if (child->visible) DrawWidget(child);
+        }
+    }
+
+    void Canvas::DrawWidget(Widget* widget) {
+        if (widget->bounds.Intersect(widget->clip).Empty()) return;
+        widget->Draw();
+        for (Widget* child : widget->children) {
+            if (child->visible) DrawWidget(child);
+        }
+    }
+}
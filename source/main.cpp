@@ -9,6 +9,11 @@
 EXAMPLE CODE
 */
 
+// Sent by objects that want to change level, handled in main()
+struct ChangeLevel {
+	const char* name;
+};
+
 class Player : public Objects::Rectangle {
 protected:
 	void OnUpdate(Scene::Scene* scene) override {
@@ -19,13 +24,17 @@ protected:
 		auto buttonState = input->GetButtonState(Input::Button::A);
 		if (buttonState == Input::ButtonState::PRESSED) {
 			printf("\x1b[10;1HButton A pressed!");
-			scene->GetSceneManager()->LoadScene("Level2", Scene::Screen::TOP);
+			scene->GetSceneManager()->GetEventBus().Post(ChangeLevel{ "Level2" });
 		}
 
 		if (input->GetButtonState(Input::Button::Y) == Input::ButtonState::PRESSED) {
 			scene->SetBackgroundColor(Colors::clrRed);
 		}
 
+		if (input->GetButtonState(Input::Button::X) == Input::ButtonState::PRESSED) {
+			scene->GetSceneManager()->PushScene("Pause", Scene::Screen::TOP);
+		}
+
 		// Movement with Circle Pad
 		auto stick = input->GetCirclePadPosition();
 		AddX(stick.x * 5.0f);
@@ -46,7 +55,17 @@ protected:
 		u32 kDown = hidKeysDown();
 		
 		if (kDown & KEY_A) {
-			scene->GetSceneManager()->LoadScene("Level1", Scene::Screen::TOP);
+			scene->GetSceneManager()->GetEventBus().Post(ChangeLevel{ "Level1" });
+		}
+	}
+};
+
+class ResumeButton : public Objects::Rectangle {
+protected:
+	void OnUpdate(Scene::Scene* scene) override {
+		auto input = GetInputManager();
+		if (input && input->GetButtonState(Input::Button::X) == Input::ButtonState::PRESSED) {
+			scene->GetSceneManager()->PopScene(Scene::Screen::TOP);
 		}
 	}
 };
@@ -67,6 +86,11 @@ public:
 		delete portal;  // Don't forget to free memory
 	}
 
+	void OnActivate() override {
+		// Load the next level in the background while this one is played
+		GetSceneManager()->PreloadScene("Level2");
+	}
+
 	void OnLoad() override {
 		// Player configuration
 		player.width = 20;
@@ -120,6 +144,24 @@ public:
 	}
 };
 
+// Pause menu pushed over the level, the level is frozen and drawn as a single image
+class PauseScene : public Scene::Scene {
+private:
+	ResumeButton overlay;
+
+public:
+	PauseScene() : Scene("Pause") {
+		SetLayerPolicy(::Scene::LayerPolicy::FREEZE_BELOW);
+	}
+
+	void OnLoad() override {
+		overlay.width = 400;
+		overlay.height = 240;
+		overlay.color = C2D_Color32(0, 0, 0, 128);
+		AddElement(&overlay);
+	}
+};
+
 // Example scene for bottom screen
 class ConsoleScene : public Scene::Scene {
 public:
@@ -137,6 +179,11 @@ int main(int argc, char* argv[]) {
 	sceneManager.AddScene(new Level1Scene());
 	sceneManager.AddScene(new Level2Scene());
 	sceneManager.AddScene(new ConsoleScene());
+	sceneManager.AddScene(new PauseScene());
+
+	sceneManager.GetEventBus().Subscribe<ChangeLevel>([](const ChangeLevel& event, void* userData) {
+		static_cast<Scene::SceneManager*>(userData)->LoadScene(event.name, Scene::Screen::TOP, Scene::Transition::FADE);
+	}, &sceneManager);
 
 	sceneManager.LoadScene("Level1", Scene::Screen::TOP);
 	sceneManager.LoadScene("Console", Scene::Screen::BOTTOM);
@@ -0,0 +1,157 @@
+/**
+ * @file audiomix.cpp
+ * @author ADAMOUMOU
+ * @brief Host runner for the CitroFlex audio mixer
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ *
+ * @details
+ * Build on the host: g++ -std=c++17 -O2 -Iinclude -o audiomix tools/audiomix.cpp source/AudioMixer.cpp
+ * Usage: audiomix [-o out.wav] [-v voices] [-s seconds] [-m music.wav] [sound.wav ...]
+ *
+ * Plays every sound (or generated tones when none is given) on the requested number of voices with
+ * different pans and pitches, optionally with a streamed music file, through the WAV backend when
+ * -o is given and the null backend otherwise. Prints the mixing time per voice and output frame.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "../include/AudioMixer.hpp"
+
+static bool LoadSound(const char* path, std::vector<int16_t>& samples, Audio::SoundData& sound) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    std::vector<uint8_t> data;
+    uint8_t chunk[65536];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    fclose(file);
+
+    Audio::WavInfo info;
+    if (!Audio::ParseWav(data.data(), data.size(), info) || (size_t)info.dataOffset + info.dataSize > data.size()) {
+        return false;
+    }
+    samples.resize(info.dataSize / 2);
+    memcpy(samples.data(), data.data() + info.dataOffset, info.dataSize);
+    sound.samples = samples.data();
+    sound.frames = info.dataSize / (info.channels * 2);
+    sound.rate = info.rate;
+    sound.channels = info.channels;
+    return true;
+}
+
+static void MakeTone(float frequency, uint32_t rate, std::vector<int16_t>& samples, Audio::SoundData& sound) {
+    samples.resize(rate);
+    for (uint32_t i = 0; i < rate; i++) {
+        float envelope = 1.0f - (float)i / rate;
+        samples[i] = (int16_t)(sinf(6.2831853f * frequency * i / rate) * 12000.0f * envelope);
+    }
+    sound.samples = samples.data();
+    sound.frames = rate;
+    sound.rate = rate;
+    sound.channels = 1;
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = nullptr;
+    const char* musicPath = nullptr;
+    int voiceCount = 8;
+    float seconds = 5.0f;
+    std::vector<const char*> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (!strcmp(argv[i], "-v") && i + 1 < argc) {
+            voiceCount = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-m") && i + 1 < argc) {
+            musicPath = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [-o out.wav] [-v voices] [-s seconds] [-m music.wav] [sound.wav ...]\n", argv[0]);
+            return 1;
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (voiceCount < 0 || voiceCount > Audio::MAX_VOICES) {
+        fprintf(stderr, "voices must be between 0 and %d\n", Audio::MAX_VOICES);
+        return 1;
+    }
+
+    // Sounds: the input files, or tones at the output rate and at 22050 Hz to exercise both kernels
+    std::vector<std::vector<int16_t>> samples(inputs.empty() ? 2 : inputs.size());
+    std::vector<Audio::SoundData> sounds(samples.size());
+    if (inputs.empty()) {
+        MakeTone(440.0f, Audio::OUTPUT_RATE, samples[0], sounds[0]);
+        MakeTone(660.0f, 22050, samples[1], sounds[1]);
+    }
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (!LoadSound(inputs[i], samples[i], sounds[i])) {
+            fprintf(stderr, "%s: not a 16 bit PCM WAV file\n", inputs[i]);
+            return 1;
+        }
+    }
+
+    Audio::Mixer mixer;
+    mixer.SetMasterVolume(1.0f / (voiceCount > 4 ? voiceCount / 4 : 1));
+    for (int i = 0; i < voiceCount; i++) {
+        float pan = voiceCount > 1 ? -1.0f + 2.0f * i / (voiceCount - 1) : 0.0f;
+        float pitch = 1.0f + 0.05f * (i % 5);
+        mixer.Play(sounds[i % sounds.size()], 1.0f, pan, pitch, true);
+    }
+
+    Audio::WavDecoder decoder;
+    Audio::Stream stream;
+    if (musicPath) {
+        if (!decoder.Open(musicPath)) {
+            fprintf(stderr, "%s: not a 16 bit PCM WAV file\n", musicPath);
+            return 1;
+        }
+        stream.Open(&decoder);
+        mixer.PlayStream(&stream);
+    }
+
+    Audio::WavBackend wav;
+    Audio::NullBackend null;
+    Audio::NullBackend* backend = &null;
+    if (outputPath) {
+        if (!wav.Open(outputPath)) {
+            fprintf(stderr, "%s: cannot create\n", outputPath);
+            return 1;
+        }
+        backend = &wav;
+    }
+    backend->Start(&mixer);
+
+    // 60 updates per second like the game loop, the stream decoded between them
+    uint32_t total = (uint32_t)(seconds * Audio::OUTPUT_RATE);
+    uint32_t perFrame = Audio::OUTPUT_RATE / 60;
+    double mixSeconds = 0;
+    for (uint32_t done = 0; done < total; done += perFrame) {
+        uint32_t frames = total - done < perFrame ? total - done : perFrame;
+        auto start = std::chrono::steady_clock::now();
+        backend->Render(frames);
+        mixSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (musicPath) stream.Decode();
+    }
+    backend->Stop();
+
+    int voices = voiceCount + (musicPath ? 1 : 0);
+    printf("%u frames, %d voices: %.3f ms mixing (%.1f ns per voice frame, %.2f%% of real time)\n",
+           total, voices, mixSeconds * 1000.0, voices > 0 ? mixSeconds * 1e9 / ((double)total * voices) : 0.0,
+           mixSeconds * 100.0 / seconds);
+    if (musicPath) printf("stream underruns: %u\n", stream.GetUnderruns());
+    return 0;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file benchhost.cpp
+ * @author ADAMOUMOU
+ * @brief Host runner for the CitroFlex engine benchmarks
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ *
+ * @details
+ * Build on the host: make -C tools bench (links the engine against the stand-ins in tools/host)
+ * Usage: benchhost [-s min_seconds] [filter]
+ *
+ * Runs Debug::RegisterEngineBenchmarks() on the PC and prints one JSON object per line on
+ * stdout, the same lines the console writes to the SD card, so results can be diffed by CI.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/Benchmark.hpp"
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    float minSeconds = 0.2f;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            minSeconds = (float)atof(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Usage: %s [-s min_seconds] [filter]\n", argv[0]);
+            return 1;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    Debug::RegisterEngineBenchmarks();
+    return Debug::RunBenchmarks("-", filter, minSeconds) > 0 ? 0 : 1;
+}
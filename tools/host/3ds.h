@@ -0,0 +1,183 @@
+/**
+ * @file 3ds.h
+ * @author ADAMOUMOU
+ * @brief Host stand-in for the parts of libctru used by CitroFlex (see HostStubs.cpp)
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ *
+ * @details
+ * Only what the engine sources reference is declared. Types keep the libctru names and sizes
+ * that matter to the engine; HID reports no input and the system tick runs at the ARM11 clock.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef volatile s32 vs32;
+typedef s32 Result;
+typedef u32 Handle;
+
+#define U64_MAX UINT64_MAX
+#define R_SUCCEEDED(res) ((res) >= 0)
+#define R_FAILED(res) ((res) < 0)
+
+// HID
+
+enum {
+    KEY_A = 1 << 0,
+    KEY_B = 1 << 1,
+    KEY_SELECT = 1 << 2,
+    KEY_START = 1 << 3,
+    KEY_DRIGHT = 1 << 4,
+    KEY_DLEFT = 1 << 5,
+    KEY_DUP = 1 << 6,
+    KEY_DDOWN = 1 << 7,
+    KEY_R = 1 << 8,
+    KEY_L = 1 << 9,
+    KEY_X = 1 << 10,
+    KEY_Y = 1 << 11,
+    KEY_ZL = 1 << 14,
+    KEY_ZR = 1 << 15,
+    KEY_TOUCH = 1 << 20,
+    KEY_CSTICK_RIGHT = 1 << 24,
+    KEY_CSTICK_LEFT = 1 << 25,
+    KEY_CSTICK_UP = 1 << 26,
+    KEY_CSTICK_DOWN = 1 << 27,
+    KEY_CPAD_RIGHT = 1 << 28,
+    KEY_CPAD_LEFT = 1 << 29,
+    KEY_CPAD_UP = 1 << 30,
+    KEY_CPAD_DOWN = (int)(1u << 31),
+    KEY_UP = KEY_DUP | KEY_CPAD_UP,
+    KEY_DOWN = KEY_DDOWN | KEY_CPAD_DOWN,
+    KEY_LEFT = KEY_DLEFT | KEY_CPAD_LEFT,
+    KEY_RIGHT = KEY_DRIGHT | KEY_CPAD_RIGHT
+};
+
+typedef struct { s16 dx, dy; } circlePosition;
+typedef struct { u16 px, py; } touchPosition;
+
+void hidScanInput(void);
+u32 hidKeysDown(void);
+u32 hidKeysHeld(void);
+u32 hidKeysUp(void);
+void hidCircleRead(circlePosition* pos);
+void hidCstickRead(circlePosition* pos);
+void hidTouchRead(touchPosition* pos);
+
+// GFX, APT and services
+
+typedef enum { GFX_TOP = 0, GFX_BOTTOM = 1 } gfxScreen_t;
+typedef enum { GFX_LEFT = 0, GFX_RIGHT = 1 } gfx3dSide_t;
+
+void gfxInitDefault(void);
+void gfxExit(void);
+void gfxSet3D(bool enable);
+bool aptMainLoop(void);
+void* consoleInit(gfxScreen_t screen, void* console);
+Result fsInit(void);
+void fsExit(void);
+Result romfsInit(void);
+Result romfsExit(void);
+Result APT_SetAppCpuTimeLimit(u32 percent);
+Result APT_CheckNew3DS(bool* out);
+Result osSetSpeedupEnable(bool enable);
+float osGet3DSliderState(void);
+
+// Time
+
+#define SYSCLOCK_ARM11 268111856
+#define CPU_TICKS_PER_MSEC (SYSCLOCK_ARM11 / 1000.0)
+#define CPU_TICKS_PER_USEC (SYSCLOCK_ARM11 / 1000000.0)
+
+u64 svcGetSystemTick(void);
+u64 osGetTime(void);
+void svcSleepThread(s64 ns);
+
+// Threads and synchronization
+
+#define CUR_THREAD_HANDLE 0xFFFF8000
+
+typedef struct Thread_tag* Thread;
+typedef void (*ThreadFunc)(void*);
+
+Thread threadCreate(ThreadFunc entrypoint, void* arg, size_t stackSize, int prio, int coreId, bool detached);
+Result threadJoin(Thread thread, u64 timeoutNs);
+void threadFree(Thread thread);
+void threadExit(int rc);
+Result svcGetThreadPriority(s32* out, Handle handle);
+
+typedef s32 LightLock;
+void LightLock_Init(LightLock* lock);
+void LightLock_Lock(LightLock* lock);
+int LightLock_TryLock(LightLock* lock);
+void LightLock_Unlock(LightLock* lock);
+
+typedef enum { RESET_ONESHOT = 0, RESET_STICKY = 1, RESET_PULSE = 2 } ResetType;
+typedef struct { s32 state; LightLock lock; } LightEvent;
+void LightEvent_Init(LightEvent* event, ResetType resetType);
+void LightEvent_Signal(LightEvent* event);
+void LightEvent_Wait(LightEvent* event);
+void LightEvent_Clear(LightEvent* event);
+
+typedef struct { s32 current_count; s16 num_threads_acq; s16 max_count; } LightSemaphore;
+void LightSemaphore_Init(LightSemaphore* semaphore, s16 initialCount, s16 maxCount);
+void LightSemaphore_Acquire(LightSemaphore* semaphore, s32 count);
+void LightSemaphore_Release(LightSemaphore* semaphore, s32 count);
+
+// Memory
+
+void* linearAlloc(size_t size);
+void* linearMemAlign(size_t size, size_t alignment);
+void linearFree(void* mem);
+u32 linearSpaceFree(void);
+u32 linearGetSize(void* mem);
+void DSP_FlushDataCache(const void* address, u32 size);
+void GSPGPU_FlushDataCache(const void* address, u32 size);
+
+// NDSP (accepts buffers and never plays them)
+
+typedef struct {
+    union { s16* data_pcm16; void* data_vaddr; };
+    u32 nsamples;
+    void* adpcm_data;
+    u32 offset;
+    bool looping;
+    u8 status;
+    u16 sequence_id;
+    void* next;
+} ndspWaveBuf;
+
+enum { NDSP_WBUF_FREE = 0, NDSP_WBUF_QUEUED, NDSP_WBUF_PLAYING, NDSP_WBUF_DONE };
+
+#define NDSP_FORMAT_MONO_PCM16 5
+#define NDSP_FORMAT_STEREO_PCM16 10
+#define NDSP_INTERP_NONE 0
+#define NDSP_INTERP_LINEAR 1
+#define NDSP_OUTPUT_STEREO 1
+
+Result ndspInit(void);
+void ndspExit(void);
+void ndspSetOutputMode(int mode);
+void ndspChnReset(int id);
+void ndspChnSetInterp(int id, int type);
+void ndspChnSetRate(int id, float rate);
+void ndspChnSetFormat(int id, u16 format);
+void ndspChnSetMix(int id, float mix[12]);
+void ndspChnWaveBufAdd(int id, ndspWaveBuf* buf);
+void ndspChnWaveBufClear(int id);
@@ -0,0 +1,390 @@
+/**
+ * @file HostStubs.cpp
+ * @author ADAMOUMOU
+ * @brief Host implementation of the libctru, citro2d and citro3d stand-ins in tools/host
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ *
+ * @details
+ * Enough for the engine to run headless on a PC: time, threads, locks and memory behave like
+ * on the console, input is always idle and nothing is drawn or played. Draw submission still
+ * runs (the primitives shader loads), so the Render benchmarks count the vertices they write.
+ */
+
+#include <3ds.h>
+#include <citro2d.h>
+#include <citro3d.h>
+#include "primitives_shbin.h"
+
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+
+const unsigned char primitives_shbin[] = { 0 };
+const unsigned int primitives_shbin_size = 0;
+
+// HID
+
+void hidScanInput(void) {}
+u32 hidKeysDown(void) { return 0; }
+u32 hidKeysHeld(void) { return 0; }
+u32 hidKeysUp(void) { return 0; }
+void hidCircleRead(circlePosition* pos) { pos->dx = 0; pos->dy = 0; }
+void hidCstickRead(circlePosition* pos) { pos->dx = 0; pos->dy = 0; }
+void hidTouchRead(touchPosition* pos) { pos->px = 0; pos->py = 0; }
+
+// GFX, APT and services
+
+void gfxInitDefault(void) {}
+void gfxExit(void) {}
+void gfxSet3D(bool enable) {}
+bool aptMainLoop(void) { return false; }
+void* consoleInit(gfxScreen_t screen, void* console) { return nullptr; }
+Result fsInit(void) { return 0; }
+void fsExit(void) {}
+Result romfsInit(void) { return 0; }
+Result romfsExit(void) { return 0; }
+Result APT_SetAppCpuTimeLimit(u32 percent) { return -1; }
+Result APT_CheckNew3DS(bool* out) { *out = true; return 0; }
+Result osSetSpeedupEnable(bool enable) { return 0; }
+float osGet3DSliderState(void) { return 0.0f; }
+
+// Time
+
+u64 svcGetSystemTick(void) {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    u64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+    // Split to keep the product in 64 bits
+    return (ns / 1000000000ull) * SYSCLOCK_ARM11 + (ns % 1000000000ull) * SYSCLOCK_ARM11 / 1000000000ull;
+}
+
+u64 osGetTime(void) {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+void svcSleepThread(s64 ns) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
+
+// Threads and synchronization
+
+struct Thread_tag {
+    std::thread thread;
+};
+
+Thread threadCreate(ThreadFunc entrypoint, void* arg, size_t stackSize, int prio, int coreId, bool detached) {
+    Thread thread = new Thread_tag();
+    thread->thread = std::thread(entrypoint, arg);
+    if (detached) thread->thread.detach();
+    return thread;
+}
+
+Result threadJoin(Thread thread, u64 timeoutNs) {
+    if (thread->thread.joinable()) thread->thread.join();
+    return 0;
+}
+
+void threadFree(Thread thread) {
+    if (thread->thread.joinable()) thread->thread.detach();
+    delete thread;
+}
+
+void threadExit(int rc) {}
+
+Result svcGetThreadPriority(s32* out, Handle handle) {
+    *out = 0x30;
+    return 0;
+}
+
+void LightLock_Init(LightLock* lock) {
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+void LightLock_Lock(LightLock* lock) {
+    while (LightLock_TryLock(lock) != 0) std::this_thread::yield();
+}
+
+// Zero on success, like libctru
+int LightLock_TryLock(LightLock* lock) {
+    s32 expected = 0;
+    return __atomic_compare_exchange_n(lock, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ? 0 : 1;
+}
+
+void LightLock_Unlock(LightLock* lock) {
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+// state is 1 while signaled, lock holds the reset type
+void LightEvent_Init(LightEvent* event, ResetType resetType) {
+    event->lock = resetType;
+    __atomic_store_n(&event->state, 0, __ATOMIC_RELEASE);
+}
+
+void LightEvent_Signal(LightEvent* event) {
+    __atomic_store_n(&event->state, 1, __ATOMIC_RELEASE);
+}
+
+void LightEvent_Wait(LightEvent* event) {
+    s32 after = event->lock == RESET_STICKY ? 1 : 0;
+    for (;;) {
+        s32 expected = 1;
+        if (__atomic_compare_exchange_n(&event->state, &expected, after, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return;
+        std::this_thread::yield();
+    }
+}
+
+void LightEvent_Clear(LightEvent* event) {
+    __atomic_store_n(&event->state, 0, __ATOMIC_RELEASE);
+}
+
+void LightSemaphore_Init(LightSemaphore* semaphore, s16 initialCount, s16 maxCount) {
+    semaphore->num_threads_acq = 0;
+    semaphore->max_count = maxCount;
+    __atomic_store_n(&semaphore->current_count, initialCount, __ATOMIC_RELEASE);
+}
+
+void LightSemaphore_Acquire(LightSemaphore* semaphore, s32 count) {
+    for (;;) {
+        s32 current = __atomic_load_n(&semaphore->current_count, __ATOMIC_ACQUIRE);
+        if (current >= count &&
+            __atomic_compare_exchange_n(&semaphore->current_count, &current, current - count, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void LightSemaphore_Release(LightSemaphore* semaphore, s32 count) {
+    __atomic_fetch_add(&semaphore->current_count, count, __ATOMIC_RELEASE);
+}
+
+// Memory (linear memory is plain aligned heap memory)
+
+static const size_t LINEAR_SIZE = 64 * 1024 * 1024;
+
+void* linearAlloc(size_t size) {
+    return linearMemAlign(size, 0x80);
+}
+
+void* linearMemAlign(size_t size, size_t alignment) {
+    void* memory = nullptr;
+    if (alignment < sizeof(void*)) alignment = sizeof(void*);
+    return posix_memalign(&memory, alignment, size > 0 ? size : 1) == 0 ? memory : nullptr;
+}
+
+void linearFree(void* mem) { free(mem); }
+u32 linearSpaceFree(void) { return LINEAR_SIZE; }
+u32 linearGetSize(void* mem) { return 0; }
+void DSP_FlushDataCache(const void* address, u32 size) {}
+void GSPGPU_FlushDataCache(const void* address, u32 size) {}
+
+// NDSP
+
+Result ndspInit(void) { return -1; }
+void ndspExit(void) {}
+void ndspSetOutputMode(int mode) {}
+void ndspChnReset(int id) {}
+void ndspChnSetInterp(int id, int type) {}
+void ndspChnSetRate(int id, float rate) {}
+void ndspChnSetFormat(int id, u16 format) {}
+void ndspChnSetMix(int id, float mix[12]) {}
+void ndspChnWaveBufAdd(int id, ndspWaveBuf* buf) { buf->status = NDSP_WBUF_DONE; }
+void ndspChnWaveBufClear(int id) {}
+
+// citro3d (VRAM allocations fail so layer and texture caches fall back, textures and render
+// targets in linear memory work, the rest does nothing)
+
+static C3D_RenderTarget screenTargets[2][2];
+static C3D_AttrInfo attrInfo;
+static C3D_BufInfo bufInfo;
+static C3D_TexEnv texEnvs[6];
+static C3D_FVec uniforms[96];
+static DVLE_s shaderEntry;
+static DVLB_s shaderBinary = { 1, &shaderEntry };
+
+static u32 TexelSize(int format) {
+    return format == GPU_RGBA8 ? 4 : format == GPU_RGB565 ? 2 : 1;
+}
+
+static bool AllocateTexture(C3D_Tex* tex, u16 width, u16 height, int format, int maxLevel) {
+    u32 size = 0;
+    for (int level = 0; level <= maxLevel; level++) {
+        size += (width >> level) * (height >> level) * TexelSize(format);
+    }
+    tex->data = linearAlloc(size);
+    tex->width = width;
+    tex->height = height;
+    tex->maxLevel = maxLevel;
+    return tex->data != nullptr;
+}
+
+bool C3D_Init(size_t cmdBufSize) { return true; }
+void C3D_Fini(void) {}
+bool C3D_FrameBegin(u8 flags) { return true; }
+void C3D_FrameEnd(u8 flags) {}
+
+bool C3D_TexInit(C3D_Tex* tex, u16 width, u16 height, GPU_TEXCOLOR format) {
+    return AllocateTexture(tex, width, height, format, 0);
+}
+
+bool C3D_TexInitVRAM(C3D_Tex* tex, u16 width, u16 height, GPU_TEXCOLOR format) { return false; }
+
+bool C3D_TexInitMipmap(C3D_Tex* tex, u16 width, u16 height, int format) {
+    // Levels down to 8x8, as citro3d
+    int maxLevel = 0;
+    while ((width >> (maxLevel + 1)) >= 8 && (height >> (maxLevel + 1)) >= 8) maxLevel++;
+    return AllocateTexture(tex, width, height, format, maxLevel);
+}
+
+void C3D_TexDelete(C3D_Tex* tex) {
+    linearFree(tex->data);
+    tex->data = nullptr;
+}
+
+void C3D_TexUpload(C3D_Tex* tex, const void* data) {}
+void C3D_TexFlush(C3D_Tex* tex) {}
+
+void* C3D_TexGetImagePtr(C3D_Tex* tex, void* data, int level, u32* size) {
+    // Only A8 mipmaps are read back level by level (Primitives' circle)
+    u32 offset = 0;
+    for (int i = 0; i < level; i++) {
+        offset += (tex->width >> i) * (tex->height >> i);
+    }
+    if (size) *size = (tex->width >> level) * (tex->height >> level);
+    return static_cast<u8*>(data) + offset;
+}
+
+void C3D_TexSetFilter(C3D_Tex* tex, int magFilter, int minFilter) {}
+void C3D_TexSetFilterMipmap(C3D_Tex* tex, int filter) {}
+void C3D_TexSetWrap(C3D_Tex* tex, int wrapS, int wrapT) {}
+void C3D_TexBind(int unitId, C3D_Tex* tex) {}
+
+C3D_RenderTarget* C3D_RenderTargetCreateFromTex(C3D_Tex* tex, int face, int level, int depthFmt) {
+    C3D_RenderTarget* target = new C3D_RenderTarget();
+    target->frameBuf.colorBuf = tex->data;
+    target->frameBuf.width = tex->width;
+    target->frameBuf.height = tex->height;
+    target->ownsColor = false;
+    return target;
+}
+
+void C3D_RenderTargetDelete(C3D_RenderTarget* target) {
+    // Screen targets are static
+    if (target && !target->linked) delete target;
+}
+
+void AttrInfo_Init(C3D_AttrInfo* info) {}
+int AttrInfo_AddLoader(C3D_AttrInfo* info, int regId, int format, int count) { return 0; }
+void BufInfo_Init(C3D_BufInfo* info) {}
+int BufInfo_Add(C3D_BufInfo* info, const void* data, ptrdiff_t stride, int attribCount, u64 permutation) { return 0; }
+C3D_AttrInfo* C3D_GetAttrInfo(void) { return &attrInfo; }
+C3D_BufInfo* C3D_GetBufInfo(void) { return &bufInfo; }
+void C3D_SetAttrInfo(C3D_AttrInfo* info) {}
+void C3D_SetBufInfo(C3D_BufInfo* info) {}
+
+C3D_TexEnv* C3D_GetTexEnv(int id) { return &texEnvs[id]; }
+void C3D_TexEnvInit(C3D_TexEnv* env) {}
+void C3D_TexEnvSrc(C3D_TexEnv* env, int mode, int s1, int s2, int s3) {}
+void C3D_TexEnvFunc(C3D_TexEnv* env, int mode, int param) {}
+
+DVLB_s* DVLB_ParseFile(u32* shbinData, u32 shbinSize) { return &shaderBinary; }
+void DVLB_Free(DVLB_s* dvlb) {}
+int shaderProgramInit(shaderProgram_s* sp) { return 0; }
+int shaderProgramFree(shaderProgram_s* sp) { return 0; }
+int shaderProgramSetVsh(shaderProgram_s* sp, DVLE_s* dvle) { return 0; }
+s8 shaderInstanceGetUniformLocation(void* si, const char* name) { return 0; }
+void C3D_BindProgram(shaderProgram_s* program) {}
+void C3D_FVUnifMtx4x4(int type, int id, const C3D_Mtx* mtx) {}
+C3D_FVec* C3D_FVUnifWritePtr(int type, int id, int size) { return uniforms; }
+
+void C3D_DrawArrays(int primitive, int first, int size) {}
+void C3D_DrawElements(int primitive, int count, int type, const void* indices) {}
+
+void Mtx_Identity(C3D_Mtx* out) {
+    for (int i = 0; i < 16; i++) out->m[i] = 0.0f;
+    out->r[0].x = out->r[1].y = out->r[2].z = out->r[3].w = 1.0f;
+}
+
+void Mtx_Multiply(C3D_Mtx* out, const C3D_Mtx* a, const C3D_Mtx* b) {
+    C3D_Mtx result;
+    for (int row = 0; row < 4; row++) {
+        for (int column = 0; column < 4; column++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) sum += a->r[row].c[3 - k] * b->r[k].c[3 - column];
+            result.r[row].c[3 - column] = sum;
+        }
+    }
+    *out = result;
+}
+
+void Mtx_Ortho(C3D_Mtx* mtx, float left, float right, float bottom, float top, float near, float far, bool isLeftHanded) {
+    Mtx_Identity(mtx);
+}
+
+void Mtx_OrthoTilt(C3D_Mtx* mtx, float left, float right, float bottom, float top, float near, float far, bool isLeftHanded) {
+    Mtx_Identity(mtx);
+}
+
+// citro2d
+
+bool C2D_Init(size_t maxObjects) { return true; }
+void C2D_Fini(void) {}
+void C2D_Prepare(void) {}
+void C2D_Flush(void) {}
+
+C3D_RenderTarget* C2D_CreateScreenTarget(gfxScreen_t screen, gfx3dSide_t side) {
+    C3D_RenderTarget* target = &screenTargets[screen][side];
+    target->frameBuf.width = 240;
+    target->frameBuf.height = screen == GFX_TOP ? 400 : 320;
+    target->linked = true;
+    return target;
+}
+
+void C2D_SceneBegin(C3D_RenderTarget* target) {}
+void C2D_SceneSize(u32 width, u32 height, bool tilt) {}
+void C2D_TargetClear(C3D_RenderTarget* target, u32 color) {}
+
+void C2D_ViewReset(void) {}
+void C2D_ViewTranslate(float x, float y) {}
+void C2D_ViewSave(C2D_Mtx* matrix) { *matrix = C2D_Mtx{ { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f } }; }
+void C2D_ViewRestore(const C2D_Mtx* matrix) {}
+
+bool C2D_DrawRectSolid(float x, float y, float z, float w, float h, u32 clr) { return true; }
+bool C2D_DrawRectangle(float x, float y, float z, float w, float h, u32 clr0, u32 clr1, u32 clr2, u32 clr3) { return true; }
+bool C2D_DrawLine(float x0, float y0, u32 clr0, float x1, float y1, u32 clr1, float thickness, float depth) { return true; }
+bool C2D_DrawCircleSolid(float x, float y, float z, float radius, u32 clr) { return true; }
+bool C2D_DrawEllipseSolid(float x, float y, float z, float w, float h, u32 clr) { return true; }
+bool C2D_DrawTriangle(float x0, float y0, u32 clr0, float x1, float y1, u32 clr1, float x2, float y2, u32 clr2, float depth) { return true; }
+bool C2D_DrawImage(C2D_Image img, const C2D_DrawParams* params, const C2D_ImageTint* tint) { return true; }
+
+void C2D_PlainImageTint(C2D_ImageTint* tint, u32 color, float blend) {
+    for (int i = 0; i < 4; i++) {
+        tint->color[i] = color;
+        tint->blend[i] = blend;
+    }
+}
+
+void C2D_AlphaImageTint(C2D_ImageTint* tint, float alpha) {
+    C2D_PlainImageTint(tint, C2D_Color32(0, 0, 0, (u8)(alpha * 255.0f)), 0.0f);
+}
+
+C2D_SpriteSheet C2D_SpriteSheetLoad(const char* filename) { return nullptr; }
+C2D_SpriteSheet C2D_SpriteSheetLoadFromMem(const void* data, size_t size) { return nullptr; }
+void C2D_SpriteSheetFree(C2D_SpriteSheet sheet) {}
+size_t C2D_SpriteSheetCount(C2D_SpriteSheet sheet) { return 0; }
+C2D_Image C2D_SpriteSheetGetImage(C2D_SpriteSheet sheet, size_t index) { return C2D_Image{ nullptr, nullptr }; }
+
+void C2D_SpriteFromSheet(C2D_Sprite* sprite, C2D_SpriteSheet sheet, size_t index) {}
+void C2D_SpriteFromImage(C2D_Sprite* sprite, C2D_Image image) { sprite->image = image; }
+void C2D_SpriteSetCenter(C2D_Sprite* sprite, float x, float y) {}
+void C2D_SpriteSetPos(C2D_Sprite* sprite, float x, float y) {}
+void C2D_SpriteSetRotation(C2D_Sprite* sprite, float radians) {}
+void C2D_SpriteSetDepth(C2D_Sprite* sprite, float depth) {}
+void C2D_SpriteSetScale(C2D_Sprite* sprite, float x, float y) {}
+bool C2D_DrawSprite(const C2D_Sprite* sprite) { return true; }
+bool C2D_DrawSpriteTinted(const C2D_Sprite* sprite, const C2D_ImageTint* tint) { return true; }
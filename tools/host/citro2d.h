@@ -0,0 +1,83 @@
+/**
+ * @file citro2d.h
+ * @author ADAMOUMOU
+ * @brief Host stand-in for the parts of citro2d used by CitroFlex (see HostStubs.cpp)
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ *
+ * @details
+ * Draw calls do nothing; sprite sheets never load.
+ */
+
+#pragma once
+
+#include <citro3d.h>
+
+#define C2D_DEFAULT_MAX_OBJECTS 4096
+
+typedef struct { u16 width, height; float left, top, right, bottom; } Tex3DS_SubTexture;
+typedef struct { C3D_Tex* tex; const Tex3DS_SubTexture* subtex; } C2D_Image;
+typedef struct {
+    struct { float x, y, w, h; } pos;
+    struct { float x, y; } center;
+    float depth;
+    float angle;
+} C2D_DrawParams;
+typedef struct { C2D_Image image; C2D_DrawParams params; } C2D_Sprite;
+typedef struct C2D_SpriteSheet_s* C2D_SpriteSheet;
+typedef struct { u32 color[4]; float blend[4]; } C2D_ImageTint;
+typedef struct { float r[6]; } C2D_Mtx;
+
+static inline u32 C2D_Color32(u8 r, u8 g, u8 b, u8 a) {
+    return r | (g << 8) | (b << 16) | ((u32)a << 24);
+}
+
+bool C2D_Init(size_t maxObjects);
+void C2D_Fini(void);
+void C2D_Prepare(void);
+void C2D_Flush(void);
+C3D_RenderTarget* C2D_CreateScreenTarget(gfxScreen_t screen, gfx3dSide_t side);
+void C2D_SceneBegin(C3D_RenderTarget* target);
+void C2D_SceneSize(u32 width, u32 height, bool tilt);
+void C2D_TargetClear(C3D_RenderTarget* target, u32 color);
+
+void C2D_ViewReset(void);
+void C2D_ViewTranslate(float x, float y);
+void C2D_ViewSave(C2D_Mtx* matrix);
+void C2D_ViewRestore(const C2D_Mtx* matrix);
+
+bool C2D_DrawRectSolid(float x, float y, float z, float w, float h, u32 clr);
+bool C2D_DrawRectangle(float x, float y, float z, float w, float h, u32 clr0, u32 clr1, u32 clr2, u32 clr3);
+bool C2D_DrawLine(float x0, float y0, u32 clr0, float x1, float y1, u32 clr1, float thickness, float depth);
+bool C2D_DrawCircleSolid(float x, float y, float z, float radius, u32 clr);
+bool C2D_DrawEllipseSolid(float x, float y, float z, float w, float h, u32 clr);
+bool C2D_DrawTriangle(float x0, float y0, u32 clr0, float x1, float y1, u32 clr1, float x2, float y2, u32 clr2, float depth);
+bool C2D_DrawImage(C2D_Image img, const C2D_DrawParams* params, const C2D_ImageTint* tint);
+
+static inline bool C2D_DrawImageAt(C2D_Image img, float x, float y, float depth, const C2D_ImageTint* tint = NULL,
+                                   float scaleX = 1.0f, float scaleY = 1.0f) {
+    C2D_DrawParams params = { { x, y, scaleX * img.subtex->width, scaleY * img.subtex->height }, { 0.0f, 0.0f }, depth, 0.0f };
+    return C2D_DrawImage(img, &params, tint);
+}
+
+void C2D_PlainImageTint(C2D_ImageTint* tint, u32 color, float blend);
+void C2D_AlphaImageTint(C2D_ImageTint* tint, float alpha);
+
+C2D_SpriteSheet C2D_SpriteSheetLoad(const char* filename);
+C2D_SpriteSheet C2D_SpriteSheetLoadFromMem(const void* data, size_t size);
+void C2D_SpriteSheetFree(C2D_SpriteSheet sheet);
+size_t C2D_SpriteSheetCount(C2D_SpriteSheet sheet);
+C2D_Image C2D_SpriteSheetGetImage(C2D_SpriteSheet sheet, size_t index);
+
+void C2D_SpriteFromSheet(C2D_Sprite* sprite, C2D_SpriteSheet sheet, size_t index);
+void C2D_SpriteFromImage(C2D_Sprite* sprite, C2D_Image image);
+void C2D_SpriteSetCenter(C2D_Sprite* sprite, float x, float y);
+void C2D_SpriteSetPos(C2D_Sprite* sprite, float x, float y);
+void C2D_SpriteSetRotation(C2D_Sprite* sprite, float radians);
+void C2D_SpriteSetDepth(C2D_Sprite* sprite, float depth);
+void C2D_SpriteSetScale(C2D_Sprite* sprite, float x, float y);
+bool C2D_DrawSprite(const C2D_Sprite* sprite);
+bool C2D_DrawSpriteTinted(const C2D_Sprite* sprite, const C2D_ImageTint* tint);
@@ -0,0 +1,121 @@
+/**
+ * @file citro3d.h
+ * @author ADAMOUMOU
+ * @brief Host stand-in for the parts of citro3d used by CitroFlex (see HostStubs.cpp)
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ *
+ * @details
+ * Every call succeeds and draws nothing, except the allocations (textures, targets, shaders)
+ * which fail so the engine takes its fallback paths.
+ */
+
+#pragma once
+
+#include <3ds.h>
+
+#define C3D_DEFAULT_CMDBUF_SIZE 0x40000
+#define C3D_FRAME_SYNCDRAW 1
+
+#define GPU_NEAREST 0
+#define GPU_LINEAR 1
+#define GPU_CLAMP_TO_EDGE 0
+#define GPU_TEXFACE_2D 0
+#define GPU_A8 8
+#define GPU_FLOAT 3
+#define GPU_UNSIGNED_BYTE 1
+#define GPU_TRIANGLES 0
+#define GPU_VERTEX_SHADER 0
+#define GPU_PRIMARY_COLOR 0
+#define GPU_TEXTURE0 3
+#define GPU_REPLACE 0
+#define GPU_MODULATE 1
+#define C3D_UNSIGNED_SHORT 1
+
+typedef enum { GPU_RGBA8 = 0, GPU_RGB565 = 3 } GPU_TEXCOLOR;
+typedef enum { GPU_RB_DEPTH24_STENCIL8 = 3 } GPU_DEPTHBUF;
+enum { C3D_RGB = 1, C3D_Alpha = 2, C3D_Both = 3 };
+
+typedef union { struct { float w, z, y, x; }; float c[4]; } C3D_FVec;
+typedef union { C3D_FVec r[4]; float m[16]; } C3D_Mtx;
+
+typedef struct { void* data; u16 width, height; u8 maxLevel; } C3D_Tex;
+typedef struct { void* colorBuf; void* depthBuf; u16 width, height; } C3D_FrameBuf;
+typedef struct C3D_RenderTarget_tag C3D_RenderTarget;
+struct C3D_RenderTarget_tag {
+    C3D_RenderTarget* next;
+    C3D_RenderTarget* prev;
+    C3D_FrameBuf frameBuf;
+    bool used, ownsColor, ownsDepth, linked;
+};
+
+typedef struct { int unused; } C3D_AttrInfo;
+typedef struct { int unused; } C3D_BufInfo;
+typedef struct { int unused; } C3D_TexEnv;
+typedef struct { int unused; } DVLE_s;
+typedef struct { u32 numDVLE; DVLE_s* DVLE; } DVLB_s;
+typedef struct { void* vertexShader; } shaderProgram_s;
+
+bool C3D_Init(size_t cmdBufSize);
+void C3D_Fini(void);
+bool C3D_FrameBegin(u8 flags);
+void C3D_FrameEnd(u8 flags);
+
+bool C3D_TexInit(C3D_Tex* tex, u16 width, u16 height, GPU_TEXCOLOR format);
+bool C3D_TexInitVRAM(C3D_Tex* tex, u16 width, u16 height, GPU_TEXCOLOR format);
+bool C3D_TexInitMipmap(C3D_Tex* tex, u16 width, u16 height, int format);
+void C3D_TexDelete(C3D_Tex* tex);
+void C3D_TexUpload(C3D_Tex* tex, const void* data);
+void C3D_TexFlush(C3D_Tex* tex);
+void* C3D_TexGetImagePtr(C3D_Tex* tex, void* data, int level, u32* size);
+void C3D_TexSetFilter(C3D_Tex* tex, int magFilter, int minFilter);
+void C3D_TexSetFilterMipmap(C3D_Tex* tex, int filter);
+void C3D_TexSetWrap(C3D_Tex* tex, int wrapS, int wrapT);
+void C3D_TexBind(int unitId, C3D_Tex* tex);
+
+C3D_RenderTarget* C3D_RenderTargetCreateFromTex(C3D_Tex* tex, int face, int level, int depthFmt);
+void C3D_RenderTargetDelete(C3D_RenderTarget* target);
+
+void AttrInfo_Init(C3D_AttrInfo* info);
+int AttrInfo_AddLoader(C3D_AttrInfo* info, int regId, int format, int count);
+void BufInfo_Init(C3D_BufInfo* info);
+int BufInfo_Add(C3D_BufInfo* info, const void* data, ptrdiff_t stride, int attribCount, u64 permutation);
+C3D_AttrInfo* C3D_GetAttrInfo(void);
+C3D_BufInfo* C3D_GetBufInfo(void);
+void C3D_SetAttrInfo(C3D_AttrInfo* info);
+void C3D_SetBufInfo(C3D_BufInfo* info);
+
+C3D_TexEnv* C3D_GetTexEnv(int id);
+void C3D_TexEnvInit(C3D_TexEnv* env);
+void C3D_TexEnvSrc(C3D_TexEnv* env, int mode, int s1, int s2, int s3);
+void C3D_TexEnvFunc(C3D_TexEnv* env, int mode, int param);
+
+DVLB_s* DVLB_ParseFile(u32* shbinData, u32 shbinSize);
+void DVLB_Free(DVLB_s* dvlb);
+int shaderProgramInit(shaderProgram_s* sp);
+int shaderProgramFree(shaderProgram_s* sp);
+int shaderProgramSetVsh(shaderProgram_s* sp, DVLE_s* dvle);
+s8 shaderInstanceGetUniformLocation(void* si, const char* name);
+void C3D_BindProgram(shaderProgram_s* program);
+void C3D_FVUnifMtx4x4(int type, int id, const C3D_Mtx* mtx);
+C3D_FVec* C3D_FVUnifWritePtr(int type, int id, int size);
+
+void C3D_DrawArrays(int primitive, int first, int size);
+void C3D_DrawElements(int primitive, int count, int type, const void* indices);
+
+void Mtx_Identity(C3D_Mtx* out);
+void Mtx_Multiply(C3D_Mtx* out, const C3D_Mtx* a, const C3D_Mtx* b);
+void Mtx_Ortho(C3D_Mtx* mtx, float left, float right, float bottom, float top, float near, float far, bool isLeftHanded);
+void Mtx_OrthoTilt(C3D_Mtx* mtx, float left, float right, float bottom, float top, float near, float far, bool isLeftHanded);
+
+static inline C3D_FVec FVec4_New(float x, float y, float z, float w) {
+    C3D_FVec v;
+    v.x = x;
+    v.y = y;
+    v.z = z;
+    v.w = w;
+    return v;
+}
@@ -0,0 +1,15 @@
+/**
+ * @file primitives_shbin.h
+ * @author ADAMOUMOU
+ * @brief Host stand-in for the shader binary generated from source/primitives.v.pica
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ */
+
+#pragma once
+
+extern const unsigned char primitives_shbin[];
+extern const unsigned int primitives_shbin_size;
@@ -0,0 +1,303 @@
+/**
+ * @file packc.cpp
+ * @author ADAMOUMOU
+ * @brief Host packer building CitroFlex .cfp asset packs
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ *
+ * @details
+ * Build on the host: g++ -std=c++17 -O2 -Iinclude -o packc tools/packc.cpp
+ * Usage: packc [-C dir] [-p prefix] [-c chunk_kb] [-0] output.cfp inputs...
+ *
+ * Inputs are files or directories (added recursively), read relative to -C dir. Each entry is named
+ * prefix + input path, which is the path the game passes to Sprite::LoadFromFile or SceneFile::Load:
+ *
+ *     packc -C romfs -p romfs:/ romfs/assets.cfp gfx levels
+ *
+ * packs romfs/gfx and romfs/levels as "romfs:/gfx/..." and "romfs:/levels/...". Entries are cut
+ * into chunks (64 KB by default) compressed with LZ4; chunks that do not shrink are stored as is,
+ * and so are whole entries when nothing shrinks or -0 is given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "../include/PackFormat.hpp"
+
+using namespace PackFormat;
+
+namespace {
+    struct Input {
+        std::string name;                   // Entry name
+        std::string path;                   // Path on the host
+        uint32_t hash = 0;
+        uint32_t flags = 0;
+        uint32_t size = 0;
+        std::vector<uint8_t> stored;        // Data as written in the pack
+    };
+
+    constexpr size_t MIN_MATCH = 4;
+    constexpr size_t LAST_LITERALS = 5;     // The block ends with at least 5 literals
+    constexpr size_t MATCH_LIMIT = 12;      // The last match starts at least 12 bytes before the end
+    constexpr int HASH_BITS = 16;
+
+    [[noreturn]] void Fail(const std::string& message) {
+        fprintf(stderr, "packc: %s\n", message.c_str());
+        exit(1);
+    }
+
+    uint32_t Read32(const uint8_t* data) {
+        uint32_t value;
+        memcpy(&value, data, 4);
+        return value;
+    }
+
+    void PutLength(std::vector<uint8_t>& out, size_t length) {
+        while (length >= 255) {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back((uint8_t)length);
+    }
+
+    void PutSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength) {
+        size_t matchCode = matchLength > 0 ? matchLength - MIN_MATCH : 0;
+        out.push_back((uint8_t)((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15)));
+        if (literalCount >= 15) PutLength(out, literalCount - 15);
+        out.insert(out.end(), literals, literals + literalCount);
+        if (matchLength == 0) return;
+
+        out.push_back((uint8_t)offset);
+        out.push_back((uint8_t)(offset >> 8));
+        if (matchCode >= 15) PutLength(out, matchCode - 15);
+    }
+
+    // Greedy LZ4 block compressor with a single hash table
+    void CompressBlock(const uint8_t* source, size_t size, std::vector<uint8_t>& out) {
+        out.clear();
+        size_t anchor = 0;
+        if (size > MATCH_LIMIT) {
+            std::vector<int32_t> table(1 << HASH_BITS, -1);
+            size_t limit = size - MATCH_LIMIT;
+            size_t matchEnd = size - LAST_LITERALS;
+            size_t position = 0;
+            while (position < limit) {
+                uint32_t sequence = Read32(source + position);
+                uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+                int32_t candidate = table[hash];
+                table[hash] = (int32_t)position;
+
+                if (candidate < 0 || position - candidate > 65535 || Read32(source + candidate) != sequence) {
+                    position++;
+                    continue;
+                }
+
+                size_t match = candidate;
+                while (position > anchor && match > 0 && source[position - 1] == source[match - 1]) {
+                    position--;
+                    match--;
+                }
+                size_t length = MIN_MATCH;
+                while (position + length < matchEnd && source[position + length] == source[match + length]) {
+                    length++;
+                }
+
+                PutSequence(out, source + anchor, position - anchor, position - match, length);
+                position += length;
+                anchor = position;
+            }
+        }
+        PutSequence(out, source + anchor, size - anchor, 0, 0);
+    }
+
+    std::vector<uint8_t> ReadAll(const std::string& path) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) Fail("cannot open " + path);
+        std::vector<uint8_t> data;
+        uint8_t chunk[65536];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            data.insert(data.end(), chunk, chunk + read);
+        }
+        fclose(file);
+        return data;
+    }
+
+    void AddInputs(std::vector<Input>& inputs, const std::string& root, const std::string& relative, const std::string& prefix) {
+        std::string path = root.empty() ? relative : root + "/" + relative;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) Fail("cannot find " + path);
+
+        if (S_ISDIR(info.st_mode)) {
+            DIR* directory = opendir(path.c_str());
+            if (!directory) Fail("cannot open " + path);
+            std::vector<std::string> children;
+            while (dirent* child = readdir(directory)) {
+                if (child->d_name[0] == '.') continue;
+                children.push_back(child->d_name);
+            }
+            closedir(directory);
+            // Same pack for the same tree whatever the directory order
+            std::sort(children.begin(), children.end());
+            for (const std::string& child : children) {
+                AddInputs(inputs, root, relative == "." ? child : relative + "/" + child, prefix);
+            }
+            return;
+        }
+
+        Input input;
+        input.name = prefix + relative;
+        input.path = path;
+        inputs.push_back(input);
+    }
+
+    void PackInput(Input& input, uint32_t chunkSize, bool compress) {
+        std::vector<uint8_t> data = ReadAll(input.path);
+        if (data.size() > 0x7FFFFFFF) Fail(input.path + " is too large");
+        input.size = data.size();
+
+        if (compress && !data.empty()) {
+            uint32_t chunks = ChunkCount(input.size, chunkSize);
+            std::vector<uint32_t> sizes(chunks);
+            std::vector<uint8_t> body;
+            std::vector<uint8_t> block;
+            bool shrunk = false;
+            for (uint32_t i = 0; i < chunks; i++) {
+                size_t begin = (size_t)i * chunkSize;
+                size_t length = std::min<size_t>(chunkSize, data.size() - begin);
+                CompressBlock(data.data() + begin, length, block);
+                if (block.size() < length) {
+                    sizes[i] = block.size();
+                    body.insert(body.end(), block.begin(), block.end());
+                    shrunk = true;
+                } else {
+                    sizes[i] = length | STORED_CHUNK;
+                    body.insert(body.end(), data.begin() + begin, data.begin() + begin + length);
+                }
+            }
+
+            if (shrunk && body.size() + chunks * sizeof(uint32_t) < data.size()) {
+                input.flags = FLAG_COMPRESSED;
+                input.stored.resize(chunks * sizeof(uint32_t));
+                memcpy(input.stored.data(), sizes.data(), input.stored.size());
+                input.stored.insert(input.stored.end(), body.begin(), body.end());
+                return;
+            }
+        }
+
+        input.flags = 0;
+        input.stored.swap(data);
+    }
+
+    void Align(std::vector<uint8_t>& file) {
+        file.resize((file.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, 0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string root;
+    std::string prefix;
+    uint32_t chunkSize = DEFAULT_CHUNK_SIZE;
+    bool compress = true;
+    std::vector<std::string> arguments;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-C") && i + 1 < argc) {
+            root = argv[++i];
+        } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            prefix = argv[++i];
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            chunkSize = atoi(argv[++i]) * 1024;
+        } else if (!strcmp(argv[i], "-0")) {
+            compress = false;
+        } else if (argv[i][0] == '-') {
+            arguments.clear();
+            break;
+        } else {
+            arguments.push_back(argv[i]);
+        }
+    }
+    if (arguments.size() < 2 || chunkSize == 0 || chunkSize >= STORED_CHUNK) {
+        fprintf(stderr, "usage: %s [-C dir] [-p prefix] [-c chunk_kb] [-0] output.cfp inputs...\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<Input> inputs;
+    for (size_t i = 1; i < arguments.size(); i++) {
+        std::string relative = arguments[i];
+        while (relative.size() > 1 && relative.back() == '/') relative.pop_back();
+        AddInputs(inputs, root, relative, prefix);
+    }
+
+    for (Input& input : inputs) {
+        input.hash = HashName(input.name.c_str());
+    }
+    std::sort(inputs.begin(), inputs.end(), [](const Input& a, const Input& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.name < b.name;
+    });
+    for (size_t i = 1; i < inputs.size(); i++) {
+        if (inputs[i].name == inputs[i - 1].name) Fail("duplicate entry " + inputs[i].name);
+    }
+
+    // Header, entries and names, then the data of each entry on an ALIGNMENT boundary
+    std::vector<char> names;
+    std::vector<EntryRecord> records(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        records[i].hash = inputs[i].hash;
+        records[i].name = names.size();
+        names.insert(names.end(), inputs[i].name.begin(), inputs[i].name.end());
+        names.push_back('\0');
+    }
+    if (names.empty()) names.push_back('\0');
+
+    FileHeader header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.headerSize = sizeof(FileHeader);
+    header.entryCount = records.size();
+    header.entriesOffset = sizeof(FileHeader);
+    header.namesOffset = header.entriesOffset + records.size() * sizeof(EntryRecord);
+    header.namesSize = names.size();
+    header.chunkSize = chunkSize;
+
+    std::vector<uint8_t> file(header.namesOffset + header.namesSize);
+    memcpy(file.data() + header.namesOffset, names.data(), names.size());
+
+    uint64_t totalSize = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        Input& input = inputs[i];
+        PackInput(input, chunkSize, compress);
+        Align(file);
+        records[i].flags = input.flags;
+        records[i].offset = file.size();
+        records[i].storedSize = input.stored.size();
+        records[i].size = input.size;
+        file.insert(file.end(), input.stored.begin(), input.stored.end());
+        if (file.size() > 0xFFFFFFFF) Fail("pack larger than 4 GB");
+        totalSize += input.size;
+
+        printf("%-48s %10u -> %10u%s\n", input.name.c_str(), input.size, records[i].storedSize,
+               input.flags & FLAG_COMPRESSED ? "" : " (stored)");
+        std::vector<uint8_t>().swap(input.stored);
+    }
+
+    header.fileSize = file.size();
+    memcpy(file.data(), &header, sizeof(FileHeader));
+    if (!records.empty()) memcpy(file.data() + header.entriesOffset, records.data(), records.size() * sizeof(EntryRecord));
+
+    FILE* output = fopen(arguments[0].c_str(), "wb");
+    if (!output || fwrite(file.data(), 1, file.size(), output) != file.size()) Fail("cannot write " + arguments[0]);
+    fclose(output);
+
+    printf("%zu entries, %llu bytes -> %zu bytes\n", inputs.size(), (unsigned long long)totalSize, file.size());
+    return 0;
+}
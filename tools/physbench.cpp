@@ -0,0 +1,133 @@
+/**
+ * @file physbench.cpp
+ * @author ADAMOUMOU
+ * @brief Host benchmark for the CitroFlex physics world
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ *
+ * @details
+ * Build on the host: g++ -std=c++17 -O2 -Iinclude -o physbench tools/physbench.cpp source/Physics.cpp
+ * Usage: physbench [-b budget_ms] [-s seconds] [counts ...]
+ *
+ * Drops a pile of boxes and circles into a walled pit for each body count (100 to 2000 by
+ * default) and reports the time per step while the pile is falling, once it has settled and
+ * asleep, and the largest count whose falling steps fit the budget (a third of a 60 fps frame
+ * unless -b is given).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "../include/Physics.hpp"
+
+struct Result {
+    double fallingMs = 0;   // Average step while the pile falls
+    double peakMs = 0;      // Slowest step
+    double restingMs = 0;   // Average step once everything sleeps
+    float settleTime = 0;   // Simulated seconds until everything sleeps (0 if it never did)
+};
+
+static void BuildPile(Physics::World& world, int count) {
+    // Wider pits for larger counts so piles stay at most 20 rows high, like a screen full of bodies
+    int columns = count < 40 ? count : (count / 20 > 40 ? count / 20 : 40);
+    float width = columns * 12.0f + 40.0f;
+
+    Physics::BodyDef wall;
+    wall.type = Physics::BodyType::STATIC;
+    wall.x = width * 0.5f;
+    wall.y = 240.0f;
+    wall.width = width;
+    wall.height = 20;
+    world.CreateBody(wall);
+    wall.width = 200;
+    wall.height = 4000;
+    wall.x = -90.0f;
+    wall.y = 240.0f - 2000.0f;
+    world.CreateBody(wall);
+    wall.x = width + 90.0f;
+    world.CreateBody(wall);
+
+    Physics::BodyDef body;
+    for (int i = 0; i < count; i++) {
+        body.x = 30.0f + (i % columns) * 12.0f + (i / columns % 2) * 3.0f;
+        body.y = 200.0f - (i / columns) * 14.0f;
+        if (i % 3 == 2) {
+            body.shape = Physics::ShapeType::CIRCLE;
+            body.radius = 5;
+        } else {
+            body.shape = Physics::ShapeType::BOX;
+            body.width = 10;
+            body.height = 10;
+        }
+        world.CreateBody(body);
+    }
+}
+
+static Result Run(int count, float seconds) {
+    Physics::World world;
+    BuildPile(world, count);
+    Result result;
+
+    int steps = (int)(seconds / Physics::FIXED_STEP);
+    int fallingSteps = 0;
+    double fallingTotal = 0;
+    for (int i = 0; i < steps; i++) {
+        auto start = std::chrono::steady_clock::now();
+        world.Step(Physics::FIXED_STEP);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (world.GetStats().awake == 0) {
+            result.settleTime = (i + 1) * Physics::FIXED_STEP;
+            break;
+        }
+        fallingTotal += ms;
+        fallingSteps++;
+        if (ms > result.peakMs) result.peakMs = ms;
+    }
+    result.fallingMs = fallingSteps > 0 ? fallingTotal / fallingSteps : 0;
+
+    if (result.settleTime > 0) {
+        const int restingSteps = 600;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < restingSteps; i++) {
+            world.Step(Physics::FIXED_STEP);
+        }
+        result.restingMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / restingSteps;
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    double budget = 1000.0 / 60.0 / 3.0;
+    float seconds = 20.0f;
+    std::vector<int> counts;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            budget = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [-b budget_ms] [-s seconds] [counts ...]\n", argv[0]);
+            return 1;
+        } else {
+            counts.push_back(atoi(argv[i]));
+        }
+    }
+    if (counts.empty()) counts = { 100, 250, 500, 1000, 2000 };
+
+    int sustainable = 0;
+    printf("%8s %12s %12s %12s %10s\n", "bodies", "falling ms", "peak ms", "asleep ms", "settle s");
+    for (int count : counts) {
+        Result result = Run(count, seconds);
+        printf("%8d %12.3f %12.3f %12.4f %10.2f\n", count, result.fallingMs, result.peakMs, result.restingMs, result.settleTime);
+        if (result.fallingMs <= budget && count > sustainable) sustainable = count;
+    }
+    printf("largest count within %.2f ms per step: %d\n", budget, sustainable);
+    return 0;
+}
@@ -0,0 +1,365 @@
+/**
+ * @file scenec.cpp
+ * @author ADAMOUMOU
+ * @brief Host converter from the CitroFlex text scene format to .cfs files
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2024 ADAMOUMOU
+ * This project is released under the MIT License.
+ * See the LICENSE file for details.
+ *
+ * @details
+ * Build on the host: g++ -std=c++17 -O2 -Iinclude -o scenec tools/scenec.cpp
+ * Usage: scenec level1.txt romfs/level1.cfs
+ *
+ * One statement per line, a word starting with '#' starts a comment:
+ *
+ *     object rectangle name=player x=100 y=100 width=20 height=20 color=#0000FF
+ *     object circle name=portal x=200 y=120 radius=15 color=#800080FF
+ *     object line x=50 y=50 endx=250 endy=50 thickness=2
+ *     object sprite x=200 y=120 sheet=romfs:/gfx/coin.t3x frame=0 angle=45
+ *     object Enemy name=slime x=10 y=10 prop.hp=10 prop.speed=1.5 prop.kind="green slime"
+ *     object rectangle parent=player x=110 y=95 width=4 height=4
+ *
+ *     prefab Bullet
+ *     object circle x=0 y=0 radius=2
+ *     end
+ *
+ * Any type other than rectangle, line, circle, ellipse and sprite is a custom type created by the factory
+ * registered under that name (SceneFormat::RegisterFactory). Positions are absolute, children must come
+ * after their parent. Colors are #RRGGBB or #RRGGBBAA. Custom params go in p0 to p3.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "../include/SceneFormat.hpp"
+
+using namespace SceneFormat;
+
+namespace {
+    struct Block {
+        std::string name;                   // Prefab name, empty for the scene
+        std::vector<ObjectRecord> records;
+        std::vector<std::vector<PropertyRecord>> properties;
+        std::map<std::string, int> names;   // Object index by name in this block
+        TypeCounts types = {};
+    };
+
+    class StringTable {
+    public:
+        std::vector<char> data;
+        std::map<std::string, uint32_t> offsets;
+
+        uint32_t Add(const std::string& text) {
+            auto it = offsets.find(text);
+            if (it != offsets.end()) return it->second;
+            uint32_t offset = data.size();
+            data.insert(data.end(), text.begin(), text.end());
+            data.push_back('\0');
+            offsets[text] = offset;
+            return offset;
+        }
+    };
+
+    const char* inputPath = "";
+    int lineNumber = 0;
+
+    [[noreturn]] void Fail(const std::string& message) {
+        fprintf(stderr, "%s:%d: %s\n", inputPath, lineNumber, message.c_str());
+        exit(1);
+    }
+
+    std::vector<std::string> Tokenize(const std::string& line) {
+        std::vector<std::string> tokens;
+        std::string token;
+        bool quoted = false;
+        bool inToken = false;
+
+        for (char c : line) {
+            if (c == '"') {
+                quoted = !quoted;
+                inToken = true;
+            } else if (!quoted && !inToken && c == '#') {
+                break;
+            } else if (!quoted && (c == ' ' || c == '\t' || c == '\r')) {
+                if (inToken) tokens.push_back(token);
+                token.clear();
+                inToken = false;
+            } else {
+                token += c;
+                inToken = true;
+            }
+        }
+        if (quoted) Fail("unterminated string");
+        if (inToken) tokens.push_back(token);
+        return tokens;
+    }
+
+    float ParseFloat(const std::string& key, const std::string& value) {
+        char* end;
+        float result = strtof(value.c_str(), &end);
+        if (value.empty() || *end) Fail("'" + key + "' expects a number, got '" + value + "'");
+        return result;
+    }
+
+    bool ParseBool(const std::string& key, const std::string& value) {
+        if (value == "true" || value == "1") return true;
+        if (value == "false" || value == "0") return false;
+        Fail("'" + key + "' expects true or false, got '" + value + "'");
+    }
+
+    // Same layout as C2D_Color32: R in the low byte, A in the high byte
+    uint32_t ParseColor(const std::string& value) {
+        if (value.size() != 7 && value.size() != 9) Fail("colors are #RRGGBB or #RRGGBBAA, got '" + value + "'");
+        if (value[0] != '#') Fail("colors start with #, got '" + value + "'");
+
+        char* end;
+        uint32_t rgba = strtoul(value.c_str() + 1, &end, 16);
+        if (*end) Fail("invalid color '" + value + "'");
+        if (value.size() == 7) rgba = (rgba << 8) | 0xFF;
+
+        uint32_t r = (rgba >> 24) & 0xFF, g = (rgba >> 16) & 0xFF, b = (rgba >> 8) & 0xFF, a = rgba & 0xFF;
+        return r | (g << 8) | (b << 16) | (a << 24);
+    }
+
+    PropertyRecord ParseProperty(StringTable& strings, const std::string& key, const std::string& value) {
+        PropertyRecord property = {};
+        property.key = strings.Add(key);
+
+        char* end;
+        long integer = strtol(value.c_str(), &end, 10);
+        if (!value.empty() && !*end) {
+            property.type = PROPERTY_INT;
+            property.value.i = (int32_t)integer;
+            return property;
+        }
+
+        float number = strtof(value.c_str(), &end);
+        if (!value.empty() && !*end) {
+            property.type = PROPERTY_FLOAT;
+            property.value.f = number;
+            return property;
+        }
+
+        property.type = PROPERTY_STRING;
+        property.value.s = strings.Add(value);
+        return property;
+    }
+
+    void ParseObject(Block& block, StringTable& strings, const std::vector<std::string>& tokens) {
+        if (tokens.size() < 2) Fail("object needs a type");
+
+        static const char* typeNames[] = { "rectangle", "line", "circle", "ellipse", "sprite" };
+        ObjectRecord record = {};
+        record.type = CUSTOM;
+        for (int i = 0; i < CUSTOM; i++) {
+            if (tokens[1] == typeNames[i]) record.type = i;
+        }
+        record.flags = FLAG_VISIBLE;
+        record.parent = -1;
+        record.name = NO_STRING;
+        record.typeName = record.type == CUSTOM ? strings.Add(tokens[1]) : NO_STRING;
+        record.resource = NO_STRING;
+        record.color = 0xFFFFFFFF;
+
+        // Same defaults as the Objects classes
+        switch (record.type) {
+            case RECTANGLE: record.params[0] = 10; record.params[1] = 10; break;
+            case LINE: record.params[2] = 1; break;
+            case CIRCLE: record.params[0] = 10; break;
+            case ELLIPSE: record.params[0] = 20; record.params[1] = 10; break;
+        }
+
+        std::vector<PropertyRecord> properties;
+        std::string name;
+
+        for (size_t i = 2; i < tokens.size(); i++) {
+            size_t equal = tokens[i].find('=');
+            if (equal == std::string::npos) Fail("expected key=value, got '" + tokens[i] + "'");
+            std::string key = tokens[i].substr(0, equal);
+            std::string value = tokens[i].substr(equal + 1);
+
+            if (key.compare(0, 5, "prop.") == 0) {
+                properties.push_back(ParseProperty(strings, key.substr(5), value));
+            } else if (key == "name") {
+                name = value;
+                record.name = strings.Add(value);
+            } else if (key == "parent") {
+                auto it = block.names.find(value);
+                if (it == block.names.end()) Fail("unknown parent '" + value + "' (parents must come first)");
+                record.parent = it->second;
+            } else if (key == "x") {
+                record.x = ParseFloat(key, value);
+            } else if (key == "y") {
+                record.y = ParseFloat(key, value);
+            } else if (key == "depth") {
+                record.depth = ParseFloat(key, value);
+            } else if (key == "color") {
+                record.color = ParseColor(value);
+            } else if (key == "visible") {
+                record.flags = ParseBool(key, value) ? (record.flags | FLAG_VISIBLE) : (record.flags & ~FLAG_VISIBLE);
+            } else if (key == "threadsafe") {
+                record.flags = ParseBool(key, value) ? (record.flags | FLAG_THREAD_SAFE) : (record.flags & ~FLAG_THREAD_SAFE);
+            } else if (key == "width" && record.type != LINE && record.type != CIRCLE) {
+                record.params[0] = ParseFloat(key, value);
+            } else if (key == "height" && record.type != LINE && record.type != CIRCLE) {
+                record.params[1] = ParseFloat(key, value);
+            } else if (key == "endx" && record.type == LINE) {
+                record.params[0] = ParseFloat(key, value);
+            } else if (key == "endy" && record.type == LINE) {
+                record.params[1] = ParseFloat(key, value);
+            } else if (key == "thickness" && record.type == LINE) {
+                record.params[2] = ParseFloat(key, value);
+            } else if (key == "radius" && record.type == CIRCLE) {
+                record.params[0] = ParseFloat(key, value);
+            } else if (key == "angle" && record.type == SPRITE) {
+                record.params[2] = ParseFloat(key, value);
+            } else if (key == "frame" && record.type == SPRITE) {
+                record.params[3] = ParseFloat(key, value);
+            } else if (key == "sheet" && record.type == SPRITE) {
+                record.resource = strings.Add(value);
+            } else if (key.size() == 2 && key[0] == 'p' && key[1] >= '0' && key[1] <= '3' && record.type == CUSTOM) {
+                record.params[key[1] - '0'] = ParseFloat(key, value);
+            } else {
+                Fail("unknown key '" + key + "' for " + tokens[1]);
+            }
+        }
+
+        if (properties.size() > 0xFFFF) Fail("too many properties");
+        record.propertyCount = properties.size();
+
+        if (!name.empty()) {
+            if (block.names.count(name)) Fail("duplicate name '" + name + "'");
+            block.names[name] = block.records.size();
+        }
+        block.types.counts[record.type]++;
+        block.records.push_back(record);
+        block.properties.push_back(properties);
+    }
+
+    void Align(std::vector<uint8_t>& output) {
+        while (output.size() % 4) output.push_back(0);
+    }
+
+    template<typename T>
+    void Append(std::vector<uint8_t>& output, const T& value) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        output.insert(output.end(), bytes, bytes + sizeof(T));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s input.txt output.cfs\n", argv[0]);
+        return 1;
+    }
+
+    inputPath = argv[1];
+    FILE* input = fopen(inputPath, "r");
+    if (!input) {
+        fprintf(stderr, "cannot open %s\n", inputPath);
+        return 1;
+    }
+
+    StringTable strings;
+    std::vector<Block> blocks(1);   // blocks[0] is the scene
+    Block* current = &blocks[0];
+
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), input)) {
+        lineNumber++;
+        std::string line = buffer;
+        if (!line.empty() && line.back() == '\n') line.pop_back();
+
+        std::vector<std::string> tokens = Tokenize(line);
+        if (tokens.empty()) continue;
+
+        if (tokens[0] == "object") {
+            ParseObject(*current, strings, tokens);
+        } else if (tokens[0] == "prefab") {
+            if (current != &blocks[0]) Fail("prefabs can't be nested");
+            if (tokens.size() != 2) Fail("prefab needs a name");
+            for (const Block& block : blocks) {
+                if (block.name == tokens[1]) Fail("duplicate prefab '" + tokens[1] + "'");
+            }
+            blocks.emplace_back();
+            blocks.back().name = tokens[1];
+            current = &blocks.back();
+        } else if (tokens[0] == "end") {
+            if (current == &blocks[0]) Fail("end without prefab");
+            if (current->records.empty()) Fail("empty prefab '" + current->name + "'");
+            current = &blocks[0];
+        } else {
+            Fail("unknown statement '" + tokens[0] + "'");
+        }
+    }
+    fclose(input);
+
+    if (current != &blocks[0]) {
+        Fail("missing end for prefab '" + current->name + "'");
+    }
+
+    // Flatten the blocks: scene objects first, then each prefab
+    std::vector<ObjectRecord> records;
+    std::vector<PropertyRecord> properties;
+    std::vector<PrefabRecord> prefabs;
+    for (size_t b = 0; b < blocks.size(); b++) {
+        Block& block = blocks[b];
+        if (b > 0) {
+            PrefabRecord prefab = {};
+            prefab.name = strings.Add(block.name);
+            prefab.firstObject = records.size();
+            prefab.objectCount = block.records.size();
+            prefab.types = block.types;
+            prefabs.push_back(prefab);
+        }
+        for (size_t i = 0; i < block.records.size(); i++) {
+            ObjectRecord record = block.records[i];
+            record.firstProperty = properties.size();
+            properties.insert(properties.end(), block.properties[i].begin(), block.properties[i].end());
+            records.push_back(record);
+        }
+    }
+    if (strings.data.empty()) strings.data.push_back('\0');
+
+    FileHeader header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.headerSize = sizeof(FileHeader);
+    header.objectCount = records.size();
+    header.sceneObjectCount = blocks[0].records.size();
+    header.propertyCount = properties.size();
+    header.prefabCount = prefabs.size();
+    header.stringsSize = strings.data.size();
+    header.sceneTypes = blocks[0].types;
+
+    std::vector<uint8_t> output;
+    Append(output, header);
+    header.objectsOffset = output.size();
+    for (const ObjectRecord& record : records) Append(output, record);
+    header.propertiesOffset = output.size();
+    for (const PropertyRecord& property : properties) Append(output, property);
+    header.prefabsOffset = output.size();
+    for (const PrefabRecord& prefab : prefabs) Append(output, prefab);
+    header.stringsOffset = output.size();
+    output.insert(output.end(), strings.data.begin(), strings.data.end());
+    Align(output);
+    header.fileSize = output.size();
+    memcpy(output.data(), &header, sizeof(header));
+
+    FILE* file = fopen(argv[2], "wb");
+    if (!file || fwrite(output.data(), 1, output.size(), file) != output.size()) {
+        fprintf(stderr, "cannot write %s\n", argv[2]);
+        return 1;
+    }
+    fclose(file);
+
+    printf("%s: %u objects, %u prefabs, %u bytes\n", argv[2], (unsigned)records.size(),
+           (unsigned)prefabs.size(), (unsigned)output.size());
+    return 0;
+}